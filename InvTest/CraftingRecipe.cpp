@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CraftingRecipe.h"
+#include "InvTest.h"
+
+void UCraftingCatalog::PostLoad()
+{
+	Super::PostLoad();
+
+	BuildIndex();
+}
+
+#if WITH_EDITOR
+void UCraftingCatalog::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	BuildIndex();
+}
+#endif
+
+void UCraftingCatalog::BuildIndex()
+{
+	RecipesByIngredient.Reset();
+	RecipeIndices.Reset();
+	NumIngredients.SetNumUninitialized(Recipes.Num());
+	++IndexVersion;
+
+	TMap<FItemDataId, int32> RecipeCounts;
+	for (int32 RecipeIndex = 0; RecipeIndex < Recipes.Num(); ++RecipeIndex)
+	{
+		const UCraftingRecipe* Recipe = Recipes[RecipeIndex];
+		if (!Recipe)
+		{
+			NumIngredients[RecipeIndex] = MAX_int32;
+			continue;
+		}
+
+		RecipeIndices.Add(Recipe, RecipeIndex);
+
+		/** Merge ingredients listed more than once, the index holds one use per ingredient and recipe */
+		RecipeCounts.Reset();
+		for (const FCraftingIngredient& Ingredient : Recipe->Ingredients)
+		{
+			const FItemDataId Id = FItemDataId::FromPath(Ingredient.ItemData.ToSoftObjectPath());
+			if (!Id.IsValid())
+			{
+				UE_LOG(LogInventory, Warning, TEXT("UCraftingCatalog: %s has an ingredient without item data"), *Recipe->GetName());
+				continue;
+			}
+			RecipeCounts.FindOrAdd(Id) += FMath::Max(Ingredient.Count, 1);
+		}
+
+		NumIngredients[RecipeIndex] = RecipeCounts.Num();
+		for (const TPair<FItemDataId, int32>& Pair : RecipeCounts)
+		{
+			FCraftingIngredientUse& Use = RecipesByIngredient.FindOrAdd(Pair.Key).AddDefaulted_GetRef();
+			Use.RecipeIndex = RecipeIndex;
+			Use.Count = Pair.Value;
+		}
+	}
+}
+
+int32 UCraftingCatalog::GetRecipeIndex(const UCraftingRecipe* Recipe) const
+{
+	const int32* Index = RecipeIndices.Find(Recipe);
+	return Index ? *Index : INDEX_NONE;
+}
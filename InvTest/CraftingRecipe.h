@@ -0,0 +1,117 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "ItemInstance.h"
+#include "CraftingRecipe.generated.h"
+
+/**
+ * Count units of an item consumed by a recipe.
+ */
+USTRUCT(BlueprintType)
+struct FCraftingIngredient
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	TSoftObjectPtr<UItemData> ItemData;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, meta = (ClampMin = "1"))
+	int32 Count = 1;
+};
+
+/**
+ * Count units of an item produced by a recipe.
+ */
+USTRUCT(BlueprintType)
+struct FCraftingOutput
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	TSoftObjectPtr<UItemData> ItemData;
+
+	/** Instance class created for non-stackable items */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	TSubclassOf<UItemInstance> ItemClass;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, meta = (ClampMin = "1"))
+	int32 Count = 1;
+};
+
+/**
+ * Turns a set of ingredients into a set of outputs, see UCraftingSubsystem.
+ */
+UCLASS(BlueprintType)
+class INVTEST_API UCraftingRecipe : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Crafting")
+	FText Name;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Crafting")
+	TArray<FCraftingIngredient> Ingredients;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Crafting")
+	TArray<FCraftingOutput> Outputs;
+};
+
+/**
+ * A recipe using an ingredient, and how many units it needs.
+ */
+struct FCraftingIngredientUse
+{
+	int32 RecipeIndex = INDEX_NONE;
+	int32 Count = 0;
+};
+
+/**
+ * Every recipe the game knows about, precompiled into an ingredient -> recipe index.
+ *
+ * The index is keyed by FItemDataId, so building it only needs the ingredients' paths and
+ * none of the item data has to be loaded. It is built in PostLoad, like ULootTable's sampler.
+ */
+UCLASS(BlueprintType)
+class INVTEST_API UCraftingCatalog : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin UObject Interface
+	virtual void PostLoad() override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+	//~ End UObject Interface
+
+	UPROPERTY(EditDefaultsOnly, Category = "Crafting")
+	TArray<TObjectPtr<UCraftingRecipe>> Recipes;
+
+	/** Rebuilds the index from Recipes, call after changing Recipes at runtime. Recipe indices may change. */
+	void BuildIndex();
+
+	/** Changes every time the index is rebuilt, anything holding recipe indices compares it to know they are stale */
+	uint32 GetIndexVersion() const { return IndexVersion; }
+
+	/** Recipes using an ingredient, or nullptr if no recipe uses it */
+	const TArray<FCraftingIngredientUse>* FindIngredientUses(FItemDataId Id) const { return RecipesByIngredient.Find(Id); }
+
+	/** Index of Recipe in Recipes, or INDEX_NONE if it is not in this catalog */
+	int32 GetRecipeIndex(const UCraftingRecipe* Recipe) const;
+
+	/** Number of distinct ingredients of a recipe, MAX_int32 for an empty (null) entry so it is never craftable */
+	int32 GetNumIngredients(int32 RecipeIndex) const { return NumIngredients[RecipeIndex]; }
+
+	int32 GetNumRecipes() const { return NumIngredients.Num(); }
+
+private:
+	TMap<FItemDataId, TArray<FCraftingIngredientUse>> RecipesByIngredient;
+	TMap<const UCraftingRecipe*, int32> RecipeIndices;
+	TArray<int32> NumIngredients;
+
+	uint32 IndexVersion = 0;
+};
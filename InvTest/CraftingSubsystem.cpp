@@ -0,0 +1,347 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CraftingSubsystem.h"
+#include "InvTest.h"
+#include "CraftingRecipe.h"
+#include "InventoryComponent.h"
+#include "InventoryStats.h"
+#include "ItemAssetLoader.h"
+
+DECLARE_CYCLE_STAT(TEXT("Craftable Recipes"), STAT_Inventory_CraftableRecipes, STATGROUP_Inventory);
+DECLARE_CYCLE_STAT(TEXT("Craft"), STAT_Inventory_Craft, STATGROUP_Inventory);
+
+void UCraftingSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	if (!DefaultCatalog.IsNull())
+	{
+		SetCatalog(DefaultCatalog.LoadSynchronous());
+	}
+}
+
+void UCraftingSubsystem::Deinitialize()
+{
+	ResetTrackers();
+
+	Super::Deinitialize();
+}
+
+bool UCraftingSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UCraftingSubsystem::SetCatalog(UCraftingCatalog* InCatalog)
+{
+	ResetTrackers();
+	Catalog = InCatalog;
+}
+
+TArray<UCraftingRecipe*> UCraftingSubsystem::GetCraftableRecipes(UInventoryComponent* Inventory)
+{
+	INVENTORY_SCOPE(STAT_Inventory_CraftableRecipes);
+
+	TArray<UCraftingRecipe*> Recipes;
+
+	const FCraftingTracker* Tracker = GetUpdatedTracker(Inventory);
+	if (!Tracker)
+	{
+		return Recipes;
+	}
+
+	for (TConstSetBitIterator<> It(Tracker->Craftable); It; ++It)
+	{
+		Recipes.Add(Catalog->Recipes[It.GetIndex()]);
+	}
+	return Recipes;
+}
+
+bool UCraftingSubsystem::IsRecipeCraftable(UInventoryComponent* Inventory, const UCraftingRecipe* Recipe)
+{
+	const int32 RecipeIndex = Catalog ? Catalog->GetRecipeIndex(Recipe) : INDEX_NONE;
+	if (RecipeIndex == INDEX_NONE)
+	{
+		return false;
+	}
+
+	const FCraftingTracker* Tracker = GetUpdatedTracker(Inventory);
+	return Tracker && Tracker->Craftable[RecipeIndex];
+}
+
+bool UCraftingSubsystem::Craft(UInventoryComponent* Inventory, const UCraftingRecipe* Recipe, int32 Times)
+{
+	INVENTORY_SCOPE(STAT_Inventory_Craft);
+
+	if (!Inventory || !Inventory->GetOwner()->HasAuthority())
+	{
+		UE_LOG(LogInventory, Warning, TEXT("UCraftingSubsystem::Craft needs an inventory on the authority"));
+		return false;
+	}
+
+	if (!Catalog || Catalog->GetRecipeIndex(Recipe) == INDEX_NONE || Times < 1 || Times > MaxCraftTimes)
+	{
+		UE_LOG(LogInventory, Warning, TEXT("UCraftingSubsystem::Craft: %s is not in the catalog, or can't be crafted %d times"), *GetNameSafe(Recipe), Times);
+		return false;
+	}
+
+	/** Validate everything before the inventory is touched, so a failed craft changes nothing */
+	TArray<TPair<UItemData*, int32>> Ingredients;
+	for (const FCraftingIngredient& Ingredient : Recipe->Ingredients)
+	{
+		/** Items in an inventory are loaded, an ingredient that is not loaded can't be held */
+		UItemData* ItemData = Ingredient.ItemData.Get();
+		if (!ItemData)
+		{
+			return false;
+		}
+
+		TPair<UItemData*, int32>* Existing = Ingredients.FindByPredicate([ItemData](const TPair<UItemData*, int32>& Pair) { return Pair.Key == ItemData; });
+		if (Existing)
+		{
+			Existing->Value += Ingredient.Count * Times;
+		}
+		else
+		{
+			Ingredients.Emplace(ItemData, Ingredient.Count * Times);
+		}
+	}
+
+	for (const TPair<UItemData*, int32>& Ingredient : Ingredients)
+	{
+		if (Inventory->GetItemCountByData(Ingredient.Key) < Ingredient.Value)
+		{
+			return false;
+		}
+	}
+
+	UItemAssetLoader* AssetLoader = UItemAssetLoader::Get();
+
+	TArray<TPair<UItemData*, int32>> StackOutputs;
+	TArray<FItemInstanceInitializer> InstanceOutputs;
+	TArray<const UItemData*> InstanceOutputData;
+	for (const FCraftingOutput& Output : Recipe->Outputs)
+	{
+		UItemData* ItemData = AssetLoader ? AssetLoader->ResolveItemData(Output.ItemData) : Output.ItemData.LoadSynchronous();
+		if (!ItemData)
+		{
+			UE_LOG(LogInventory, Warning, TEXT("UCraftingSubsystem::Craft: an output of %s failed to load"), *Recipe->GetName());
+			return false;
+		}
+
+		const int32 Count = Output.Count * Times;
+		if (ItemData->IsStackable())
+		{
+			StackOutputs.Emplace(ItemData, Count);
+			continue;
+		}
+
+		if (!ItemData->IsCompatibleWith(Output.ItemClass))
+		{
+			UE_LOG(LogInventory, Warning, TEXT("UCraftingSubsystem::Craft: output %s of %s has no compatible ItemClass"), *ItemData->GetName(), *Recipe->GetName());
+			return false;
+		}
+
+		for (int32 Unit = 0; Unit < Count; ++Unit)
+		{
+			FItemInstanceInitializer& Initializer = InstanceOutputs.AddDefaulted_GetRef();
+			Initializer.ItemClass = Output.ItemClass;
+			Initializer.ItemData = ItemData;
+			InstanceOutputData.Add(ItemData);
+		}
+	}
+
+	if (!Inventory->CanAddItems(InstanceOutputData))
+	{
+		return false;
+	}
+
+	/** Checked before consuming, the stacks an output opens count against the inventory's stack limit */
+	int32 NumStacksNeeded = 0;
+	for (const TPair<UItemData*, int32>& Output : StackOutputs)
+	{
+		NumStacksNeeded += Inventory->GetNumStacksNeeded(Output.Key, Output.Value);
+	}
+	if (NumStacksNeeded > Inventory->GetNumFreeStacks())
+	{
+		return false;
+	}
+
+	/** Consume, stacks first since they don't carry any unique state */
+	for (const TPair<UItemData*, int32>& Ingredient : Ingredients)
+	{
+		const int32 Remaining = Ingredient.Value - Inventory->RemoveStackableItem(Ingredient.Key, Ingredient.Value);
+		if (Remaining > 0)
+		{
+			TArray<UItemInstance*> Instances = Inventory->FindItemsByData(Ingredient.Key);
+			Instances.SetNum(FMath::Min(Remaining, Instances.Num()));
+			Inventory->RemoveItemsFromInventory(Instances);
+		}
+	}
+
+	/** Produce, all within this frame so it goes out with the same net update as the consumption */
+	for (const TPair<UItemData*, int32>& Output : StackOutputs)
+	{
+		Inventory->AddStackableItem(Output.Key, Output.Value);
+	}
+	if (InstanceOutputs.Num() > 0)
+	{
+		Inventory->CreateItemsInInventory(InstanceOutputs);
+	}
+
+	return true;
+}
+
+FCraftingTracker* UCraftingSubsystem::GetUpdatedTracker(UInventoryComponent* Inventory)
+{
+	if (!Inventory || !Catalog)
+	{
+		return nullptr;
+	}
+
+	if (FCraftingTracker* Tracker = Trackers.Find(Inventory))
+	{
+		/** Recipe indices of a rebuilt index don't line up with the tracker's arrays anymore */
+		if (Tracker->CatalogVersion != Catalog->GetIndexVersion())
+		{
+			BuildTracker(*Tracker);
+		}
+		else
+		{
+			UpdateTracker(*Tracker);
+		}
+		return Tracker;
+	}
+
+	/** New inventories are rare, forget about the ones that are gone while at it */
+	for (auto It = Trackers.CreateIterator(); It; ++It)
+	{
+		if (!It.Value().Inventory.IsValid())
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	FCraftingTracker& Tracker = Trackers.Add(Inventory);
+	Tracker.Inventory = Inventory;
+	Inventory->OnItemCountChanged.AddUObject(this, &UCraftingSubsystem::HandleItemCountChanged);
+
+	BuildTracker(Tracker);
+	return &Tracker;
+}
+
+void UCraftingSubsystem::BuildTracker(FCraftingTracker& Tracker)
+{
+	const int32 NumRecipes = Catalog->GetNumRecipes();
+
+	Tracker.IngredientCounts.Reset();
+	Tracker.DirtyIngredients.Reset();
+	Tracker.CatalogVersion = Catalog->GetIndexVersion();
+	Tracker.SatisfiedIngredients.Init(0, NumRecipes);
+	Tracker.Craftable.Init(false, NumRecipes);
+
+	for (int32 RecipeIndex = 0; RecipeIndex < NumRecipes; ++RecipeIndex)
+	{
+		Tracker.Craftable[RecipeIndex] = Catalog->GetNumIngredients(RecipeIndex) == 0;
+	}
+
+	/** Count the whole inventory once, after this only changes are applied */
+	TMap<FItemDataId, int32> Counts;
+	for (const UItemInstance* Item : Tracker.Inventory->GetItemInstances())
+	{
+		const UItemData* ItemData = Item ? Item->GetData() : nullptr;
+		if (ItemData && Catalog->FindIngredientUses(ItemData->GetItemDataId()))
+		{
+			++Counts.FindOrAdd(ItemData->GetItemDataId());
+		}
+	}
+	for (const FInventoryStackEntry& Stack : Tracker.Inventory->GetItemStacks())
+	{
+		if (Stack.ItemData && Catalog->FindIngredientUses(Stack.ItemData->GetItemDataId()))
+		{
+			Counts.FindOrAdd(Stack.ItemData->GetItemDataId()) += Stack.Count;
+		}
+	}
+
+	for (const TPair<FItemDataId, int32>& Pair : Counts)
+	{
+		ApplyIngredientCount(Tracker, Pair.Key, 0, Pair.Value);
+	}
+}
+
+void UCraftingSubsystem::UpdateTracker(FCraftingTracker& Tracker)
+{
+	UInventoryComponent* Inventory = Tracker.Inventory.Get();
+	if (!Inventory)
+	{
+		return;
+	}
+
+	for (const TPair<FItemDataId, const UItemData*>& Pair : Tracker.DirtyIngredients)
+	{
+		ApplyIngredientCount(Tracker, Pair.Key, Tracker.IngredientCounts.FindRef(Pair.Key), Inventory->GetItemCountByData(Pair.Value));
+	}
+	Tracker.DirtyIngredients.Reset();
+}
+
+void UCraftingSubsystem::ApplyIngredientCount(FCraftingTracker& Tracker, FItemDataId Id, int32 OldCount, int32 NewCount)
+{
+	if (OldCount == NewCount)
+	{
+		return;
+	}
+
+	if (const TArray<FCraftingIngredientUse>* Uses = Catalog->FindIngredientUses(Id))
+	{
+		for (const FCraftingIngredientUse& Use : *Uses)
+		{
+			const bool bWasSatisfied = OldCount >= Use.Count;
+			const bool bIsSatisfied = NewCount >= Use.Count;
+			if (bWasSatisfied == bIsSatisfied)
+			{
+				continue;
+			}
+
+			int32& Satisfied = Tracker.SatisfiedIngredients[Use.RecipeIndex];
+			Satisfied += bIsSatisfied ? 1 : -1;
+			Tracker.Craftable[Use.RecipeIndex] = Satisfied == Catalog->GetNumIngredients(Use.RecipeIndex);
+		}
+	}
+
+	if (NewCount > 0)
+	{
+		Tracker.IngredientCounts.Add(Id, NewCount);
+	}
+	else
+	{
+		Tracker.IngredientCounts.Remove(Id);
+	}
+}
+
+void UCraftingSubsystem::HandleItemCountChanged(UInventoryComponent* Inventory, const UItemData* ItemData)
+{
+	if (!ItemData || !Catalog)
+	{
+		return;
+	}
+
+	FCraftingTracker* Tracker = Trackers.Find(Inventory);
+	const FItemDataId Id = ItemData->GetItemDataId();
+	if (Tracker && Catalog->FindIngredientUses(Id))
+	{
+		Tracker->DirtyIngredients.Add(Id, ItemData);
+	}
+}
+
+void UCraftingSubsystem::ResetTrackers()
+{
+	for (const TPair<TObjectKey<UInventoryComponent>, FCraftingTracker>& Pair : Trackers)
+	{
+		if (UInventoryComponent* Inventory = Pair.Value.Inventory.Get())
+		{
+			Inventory->OnItemCountChanged.RemoveAll(this);
+		}
+	}
+	Trackers.Reset();
+}
@@ -0,0 +1,119 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ItemDataId.h"
+#include "UObject/ObjectKey.h"
+#include "CraftingSubsystem.generated.h"
+
+class UCraftingCatalog;
+class UCraftingRecipe;
+class UInventoryComponent;
+class UItemData;
+
+/**
+ * Which recipes of the catalog an inventory can craft, kept up to date incrementally.
+ */
+struct FCraftingTracker
+{
+	TWeakObjectPtr<UInventoryComponent> Inventory;
+
+	/** Units held of every item that is an ingredient of some recipe, as of the last update */
+	TMap<FItemDataId, int32> IngredientCounts;
+
+	/** Per recipe, number of its ingredients the inventory holds enough of */
+	TArray<int32> SatisfiedIngredients;
+
+	/** Per recipe, whether every ingredient is satisfied */
+	TBitArray<> Craftable;
+
+	/** Ingredients whose count may have changed since the last update, the pointer is only used as a lookup key */
+	TMap<FItemDataId, const UItemData*> DirtyIngredients;
+
+	/** UCraftingCatalog::GetIndexVersion the tracker was built against, it is rebuilt once the catalog's index changes */
+	uint32 CatalogVersion = 0;
+};
+
+/**
+ * Crafting against a UCraftingCatalog.
+ *
+ * "Which recipes can I craft" is tracked per inventory: the first query counts the ingredients
+ * once, after that only recipes using an item whose count changed are re-evaluated (through the
+ * catalog's ingredient -> recipe index), lazily on the next query. If the catalog's index is rebuilt
+ * (e.g., it was edited), every tracker is counted from scratch again on its next query.
+ *
+ * The catalog is DefaultCatalog from the game config, e.g.,
+ * [/Script/InvTest.CraftingSubsystem] DefaultCatalog=/Game/Crafting/DA_Catalog.DA_Catalog
+ */
+UCLASS(Config = Game)
+class INVTEST_API UCraftingSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Max number of crafts in a single Craft call */
+	static constexpr int32 MaxCraftTimes = 100;
+
+	//~ Begin USubsystem Interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	//~ End USubsystem Interface
+
+	UFUNCTION(BlueprintCallable, Category = "Crafting")
+	UCraftingCatalog* GetCatalog() const { return Catalog; }
+
+	/** Replaces the catalog, every inventory is re-evaluated on its next query */
+	UFUNCTION(BlueprintCallable, Category = "Crafting")
+	void SetCatalog(UCraftingCatalog* InCatalog);
+
+	/** Every recipe Inventory can craft at least once right now */
+	UFUNCTION(BlueprintCallable, Category = "Crafting")
+	TArray<UCraftingRecipe*> GetCraftableRecipes(UInventoryComponent* Inventory);
+
+	/** Whether Inventory can craft Recipe at least once right now, O(1) after the first query */
+	UFUNCTION(BlueprintCallable, Category = "Crafting")
+	bool IsRecipeCraftable(UInventoryComponent* Inventory, const UCraftingRecipe* Recipe);
+
+	/**
+	 * @brief Consumes the ingredients and creates the outputs of Recipe, Times times, as one transaction.
+	 *
+	 * Nothing is consumed unless the inventory holds all ingredients and can take all outputs
+	 * (checked against its current contents, before the ingredients are taken out).
+	 * Output data that was not prefetched is loaded synchronously.
+	 *
+	 * Authority only, clients use UInventoryComponent::ServerCraftRecipe.
+	 * @return true if the recipe was crafted
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Crafting")
+	bool Craft(UInventoryComponent* Inventory, const UCraftingRecipe* Recipe, int32 Times = 1);
+
+protected:
+	//~ Begin UWorldSubsystem Interface
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	//~ End UWorldSubsystem Interface
+
+private:
+	/** Tracker of Inventory, created (and fully counted) on first use, brought up to date */
+	FCraftingTracker* GetUpdatedTracker(UInventoryComponent* Inventory);
+
+	void BuildTracker(FCraftingTracker& Tracker);
+	void UpdateTracker(FCraftingTracker& Tracker);
+
+	/** Moves an ingredient's count from OldCount to NewCount, re-evaluating only the recipes that use it */
+	void ApplyIngredientCount(FCraftingTracker& Tracker, FItemDataId Id, int32 OldCount, int32 NewCount);
+
+	void HandleItemCountChanged(UInventoryComponent* Inventory, const UItemData* ItemData);
+
+	/** Unbinds from every tracked inventory and forgets about them */
+	void ResetTrackers();
+
+	UPROPERTY(Config)
+	TSoftObjectPtr<UCraftingCatalog> DefaultCatalog;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UCraftingCatalog> Catalog = nullptr;
+
+	TMap<TObjectKey<UInventoryComponent>, FCraftingTracker> Trackers;
+};
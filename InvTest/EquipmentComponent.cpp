@@ -0,0 +1,323 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "EquipmentComponent.h"
+#include "InvTest.h"
+#include "InventoryComponent.h"
+#include "Net/UnrealNetwork.h"
+#include "Net/Core/PushModel/PushModel.h"
+
+UEquipmentComponent::UEquipmentComponent()
+{
+	SetIsReplicatedByDefault(true);
+}
+
+void UEquipmentComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	Inventory = GetOwner()->FindComponentByClass<UInventoryComponent>();
+	if (!Inventory)
+	{
+		UE_LOG(LogInventory, Warning, TEXT("UEquipmentComponent on %s needs a UInventoryComponent on the same actor"), *GetNameSafe(GetOwner()));
+		return;
+	}
+
+	if (GetOwner()->HasAuthority())
+	{
+		Inventory->OnItemLeaving.AddUObject(this, &UEquipmentComponent::HandleItemLeaving);
+	}
+}
+
+void UEquipmentComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (Inventory)
+	{
+		Inventory->OnItemLeaving.RemoveAll(this);
+	}
+
+	for (const FEquippedItem& Entry : EquippedItems)
+	{
+		UnbindItemStats(Entry.Item);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UEquipmentComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	/** Everyone sees what is equipped, the instances themselves are made visible on equip */
+	FDoRepLifetimeParams Params;
+	Params.bIsPushBased = true;
+
+	DOREPLIFETIME_WITH_PARAMS_FAST(UEquipmentComponent, EquippedItems, Params);
+}
+
+void UEquipmentComponent::EquipItem(UItemInstance* InItemInstance, FName SlotName)
+{
+	const int32 SlotIndex = FindSlotIndex(SlotName);
+	if (!InItemInstance || SlotIndex == INDEX_NONE)
+	{
+		UE_LOG(LogInventory, Warning, TEXT("UEquipmentComponent::EquipItem: no item, or %s is not a slot"), *SlotName.ToString());
+		return;
+	}
+
+	if (GetOwner()->HasAuthority())
+	{
+		InternalEquip(InItemInstance, SlotIndex);
+	}
+	else
+	{
+		ServerEquipItem(InItemInstance, static_cast<uint8>(SlotIndex));
+	}
+}
+
+void UEquipmentComponent::UnequipSlot(FName SlotName)
+{
+	const int32 SlotIndex = FindSlotIndex(SlotName);
+	if (SlotIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	if (GetOwner()->HasAuthority())
+	{
+		InternalUnequip(SlotIndex);
+	}
+	else
+	{
+		ServerUnequipSlot(static_cast<uint8>(SlotIndex));
+	}
+}
+
+void UEquipmentComponent::ServerEquipItem_Implementation(UItemInstance* InItemInstance, uint8 SlotIndex)
+{
+	if (Inventory && Inventory->ConsumeRpcTokens(TEXT("ServerEquipItem")))
+	{
+		InternalEquip(InItemInstance, SlotIndex);
+	}
+}
+
+void UEquipmentComponent::ServerUnequipSlot_Implementation(uint8 SlotIndex)
+{
+	if (Inventory && Inventory->ConsumeRpcTokens(TEXT("ServerUnequipSlot")))
+	{
+		InternalUnequip(SlotIndex);
+	}
+}
+
+bool UEquipmentComponent::CanEquipInSlot(const UItemInstance* InItemInstance, FName SlotName) const
+{
+	return CanEquipInSlotIndex(InItemInstance, FindSlotIndex(SlotName));
+}
+
+bool UEquipmentComponent::CanEquipInSlotIndex(const UItemInstance* InItemInstance, int32 SlotIndex) const
+{
+	if (!InItemInstance || !InItemInstance->GetData() || !SlotDefinitions.IsValidIndex(SlotIndex))
+	{
+		return false;
+	}
+
+	const FGameplayTagQuery& ItemQuery = SlotDefinitions[SlotIndex].ItemQuery;
+	return ItemQuery.IsEmpty() || ItemQuery.Matches(InItemInstance->GetData()->ItemTags);
+}
+
+UItemInstance* UEquipmentComponent::GetEquippedItem(FName SlotName) const
+{
+	const int32 EntryIndex = FindEntryIndex(FindSlotIndex(SlotName));
+	return EntryIndex != INDEX_NONE ? EquippedItems[EntryIndex].Item.Get() : nullptr;
+}
+
+FName UEquipmentComponent::GetSlotOfItem(const UItemInstance* InItemInstance) const
+{
+	for (const FEquippedItem& Entry : EquippedItems)
+	{
+		if (InItemInstance && Entry.Item == InItemInstance && SlotDefinitions.IsValidIndex(Entry.SlotIndex))
+		{
+			return SlotDefinitions[Entry.SlotIndex].SlotName;
+		}
+	}
+	return NAME_None;
+}
+
+const FItemCombatStats& UEquipmentComponent::GetEquippedStats() const
+{
+	if (bStatsDirty)
+	{
+		const FItemCombatStats Defaults;
+		CachedStats = Defaults;
+
+		for (const FEquippedItem& Entry : EquippedItems)
+		{
+			if (!Entry.Item)
+			{
+				continue;
+			}
+
+			/** Item stats are cached themselves, so this is a few adds per equipped item */
+			const FItemCombatStats ItemStats = Entry.Item->GetFinalStats();
+			for (int32 StatIndex = 0; StatIndex < static_cast<int32>(EItemStat::MAX); ++StatIndex)
+			{
+				const EItemStat Stat = static_cast<EItemStat>(StatIndex);
+				CachedStats.Set(Stat, CachedStats.Get(Stat) + ItemStats.Get(Stat) - Defaults.Get(Stat));
+			}
+		}
+
+		bStatsDirty = false;
+	}
+	return CachedStats;
+}
+
+int32 UEquipmentComponent::FindSlotIndex(FName SlotName) const
+{
+	return SlotDefinitions.IndexOfByPredicate([SlotName](const FEquipmentSlotDefinition& Slot)
+	{
+		return Slot.SlotName == SlotName;
+	});
+}
+
+int32 UEquipmentComponent::FindEntryIndex(int32 SlotIndex) const
+{
+	return EquippedItems.IndexOfByPredicate([SlotIndex](const FEquippedItem& Entry)
+	{
+		return Entry.SlotIndex == SlotIndex;
+	});
+}
+
+void UEquipmentComponent::InternalEquip(UItemInstance* InItemInstance, int32 SlotIndex)
+{
+	if (!Inventory || !Inventory->ContainsItem(InItemInstance))
+	{
+		UE_LOG(LogInventory, Warning, TEXT("Tried to equip an item that is not in %s's inventory"), *GetNameSafe(GetOwner()));
+		return;
+	}
+
+	if (!CanEquipInSlotIndex(InItemInstance, SlotIndex))
+	{
+		UE_LOG(LogInventory, Warning, TEXT("%s does not fit into slot %d"), *GetNameSafe(InItemInstance->GetData()), SlotIndex);
+		return;
+	}
+
+	const int32 ExistingIndex = FindEntryIndex(SlotIndex);
+	if (ExistingIndex != INDEX_NONE && EquippedItems[ExistingIndex].Item == InItemInstance)
+	{
+		return;
+	}
+
+	/** Moving between slots keeps the item actor, it is the same item */
+	const int32 PreviousSlotIndex = FindSlotIndex(GetSlotOfItem(InItemInstance));
+	if (PreviousSlotIndex != INDEX_NONE)
+	{
+		InternalUnequip(PreviousSlotIndex, false);
+	}
+
+	if (FindEntryIndex(SlotIndex) != INDEX_NONE)
+	{
+		InternalUnequip(SlotIndex);
+	}
+
+	FEquippedItem& Entry = EquippedItems.AddDefaulted_GetRef();
+	Entry.SlotIndex = static_cast<uint8>(SlotIndex);
+	Entry.Item = InItemInstance;
+
+	/** Locked, so the owner's client can't take the actor (and the item's visibility) away while it is equipped */
+	Inventory->SetItemActorLocked(InItemInstance, true);
+	Inventory->RequestItemActorSpawned(InItemInstance, true);
+
+	BindItemStats(InItemInstance);
+	bStatsDirty = true;
+
+	MARK_PROPERTY_DIRTY_FROM_NAME(UEquipmentComponent, EquippedItems, this);
+	OnEquipmentChanged.Broadcast(SlotDefinitions[SlotIndex].SlotName, InItemInstance);
+}
+
+void UEquipmentComponent::InternalUnequip(int32 SlotIndex, bool bDestroyItemActor)
+{
+	const int32 EntryIndex = FindEntryIndex(SlotIndex);
+	if (EntryIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	UItemInstance* Item = EquippedItems[EntryIndex].Item;
+	EquippedItems.RemoveAtSwap(EntryIndex);
+
+	if (Item && Inventory && Inventory->ContainsItem(Item))
+	{
+		Inventory->SetItemActorLocked(Item, false);
+		if (bDestroyItemActor)
+		{
+			Inventory->RequestItemActorSpawned(Item, false);
+			Inventory->SetItemVisibleToOthers(Item, false);
+		}
+	}
+
+	UnbindItemStats(Item);
+	bStatsDirty = true;
+
+	MARK_PROPERTY_DIRTY_FROM_NAME(UEquipmentComponent, EquippedItems, this);
+	OnEquipmentChanged.Broadcast(SlotDefinitions[SlotIndex].SlotName, nullptr);
+}
+
+void UEquipmentComponent::HandleItemLeaving(UItemInstance* InItemInstance)
+{
+	const int32 SlotIndex = FindSlotIndex(GetSlotOfItem(InItemInstance));
+	if (SlotIndex != INDEX_NONE)
+	{
+		InternalUnequip(SlotIndex, false);
+	}
+}
+
+void UEquipmentComponent::BindItemStats(UItemInstance* InItemInstance)
+{
+	if (InItemInstance)
+	{
+		InItemInstance->OnStatsChanged.AddUObject(this, &UEquipmentComponent::HandleItemStatsChanged);
+	}
+}
+
+void UEquipmentComponent::UnbindItemStats(UItemInstance* InItemInstance)
+{
+	if (InItemInstance)
+	{
+		InItemInstance->OnStatsChanged.RemoveAll(this);
+	}
+}
+
+void UEquipmentComponent::HandleItemStatsChanged(UItemInstance* InItemInstance)
+{
+	bStatsDirty = true;
+}
+
+void UEquipmentComponent::OnRep_EquippedItems(const TArray<FEquippedItem>& OldEquippedItems)
+{
+	/** Unbind everything first, an item that moved between slots has to stay bound */
+	for (const FEquippedItem& Entry : OldEquippedItems)
+	{
+		UnbindItemStats(Entry.Item);
+	}
+	for (const FEquippedItem& Entry : EquippedItems)
+	{
+		BindItemStats(Entry.Item);
+	}
+
+	/** Also runs again once an instance that was not resolved yet arrives, so compare every slot */
+	for (int32 SlotIndex = 0; SlotIndex < SlotDefinitions.Num(); ++SlotIndex)
+	{
+		const FEquippedItem* OldEntry = OldEquippedItems.FindByPredicate([SlotIndex](const FEquippedItem& Entry) { return Entry.SlotIndex == SlotIndex; });
+		const int32 NewIndex = FindEntryIndex(SlotIndex);
+
+		UItemInstance* OldItem = OldEntry ? OldEntry->Item.Get() : nullptr;
+		UItemInstance* NewItem = NewIndex != INDEX_NONE ? EquippedItems[NewIndex].Item.Get() : nullptr;
+		if (OldItem == NewItem)
+		{
+			continue;
+		}
+
+		OnEquipmentChanged.Broadcast(SlotDefinitions[SlotIndex].SlotName, NewItem);
+	}
+
+	bStatsDirty = true;
+}
@@ -0,0 +1,167 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "GameplayTagContainer.h"
+#include "ItemInstance.h"
+#include "EquipmentComponent.generated.h"
+
+class UInventoryComponent;
+
+/**
+ * A named equipment slot, e.g., "MainHand".
+ */
+USTRUCT(BlueprintType)
+struct FEquipmentSlotDefinition
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	FName SlotName;
+
+	/** Item tags an item has to match to go into this slot, empty accepts any item */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	FGameplayTagQuery ItemQuery;
+};
+
+/**
+ * An item in a slot, the slot is referred to by its index in SlotDefinitions so only a byte is sent.
+ */
+USTRUCT(BlueprintType)
+struct FEquippedItem
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	uint8 SlotIndex = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	TObjectPtr<UItemInstance> Item = nullptr;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnEquipmentChanged, FName, SlotName, UItemInstance*, Item);
+
+/**
+ * Equipment slots on top of the owner's UInventoryComponent.
+ *
+ * Equipped items stay in the inventory; equipping one spawns its item actor and makes it visible
+ * to other players, unequipping destroys it again. While equipped, the item is locked in the inventory
+ * (see UInventoryComponent::SetItemActorLocked), so the owner's client can't hide it by destroying its actor.
+ * Only the slot -> instance mapping replicates.
+ *
+ * The combined stats of everything equipped are cached and only recomputed after the equipment,
+ * or the modifiers of an equipped item, changed, so combat code can read them every hit.
+ */
+UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
+class INVTEST_API UEquipmentComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UEquipmentComponent();
+
+	//~ Begin UActorComponent Interface
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	//~ End UActorComponent Interface
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	/** Slots of this component, at most 256. Must not change at runtime, slots replicate as indices into this */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Equipment")
+	TArray<FEquipmentSlotDefinition> SlotDefinitions;
+
+	//--------------------------------------------
+	// Equipping
+	//--------------------------------------------
+	/**
+	 * @brief Puts an item from the owner's inventory into a slot.
+	 *
+	 * Whatever was in the slot is unequipped first, an item that is already in another slot moves.
+	 * Clients forward the request to the server.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Equipment")
+	void EquipItem(UItemInstance* InItemInstance, FName SlotName);
+
+	/** Empties a slot, clients forward the request to the server */
+	UFUNCTION(BlueprintCallable, Category = "Equipment")
+	void UnequipSlot(FName SlotName);
+
+	UFUNCTION(Server, Reliable)
+	void ServerEquipItem(UItemInstance* InItemInstance, uint8 SlotIndex);
+
+	UFUNCTION(Server, Reliable)
+	void ServerUnequipSlot(uint8 SlotIndex);
+
+	/** Whether InItemInstance's tags are accepted by the slot */
+	UFUNCTION(BlueprintCallable, Category = "Equipment")
+	bool CanEquipInSlot(const UItemInstance* InItemInstance, FName SlotName) const;
+
+	//--------------------------------------------
+	// Queries
+	//--------------------------------------------
+	/** Item in a slot, or nullptr if it is empty */
+	UFUNCTION(BlueprintCallable, Category = "Equipment")
+	UItemInstance* GetEquippedItem(FName SlotName) const;
+
+	/** Slot holding InItemInstance, or None if it is not equipped */
+	UFUNCTION(BlueprintCallable, Category = "Equipment")
+	FName GetSlotOfItem(const UItemInstance* InItemInstance) const;
+
+	UFUNCTION(BlueprintCallable, Category = "Equipment")
+	const TArray<FEquippedItem>& GetEquippedItems() const { return EquippedItems; }
+
+	/**
+	 * @brief Combined final stats of all equipped items.
+	 *
+	 * Every stat is its default plus the sum of each item's difference to that default,
+	 * i.e., damage adds up and critical strike multipliers add their bonus over 1.
+	 * Cached, recomputed on the first call after the equipment changed.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Equipment|Stats")
+	const FItemCombatStats& GetEquippedStats() const;
+
+	/** A single combined stat, see GetEquippedStats */
+	UFUNCTION(BlueprintCallable, Category = "Equipment|Stats")
+	float GetEquippedStat(EItemStat Stat) const { return GetEquippedStats().Get(Stat); }
+
+	/** Broadcast on server and clients when a slot changed, Item is nullptr if it was emptied */
+	UPROPERTY(BlueprintAssignable, Category = "Equipment")
+	FOnEquipmentChanged OnEquipmentChanged;
+
+private:
+	/** Index of SlotName in SlotDefinitions, or INDEX_NONE */
+	int32 FindSlotIndex(FName SlotName) const;
+	/** Index of the slot's entry in EquippedItems, or INDEX_NONE if the slot is empty */
+	int32 FindEntryIndex(int32 SlotIndex) const;
+
+	bool CanEquipInSlotIndex(const UItemInstance* InItemInstance, int32 SlotIndex) const;
+
+	/** Server side equip/unequip, validated */
+	void InternalEquip(UItemInstance* InItemInstance, int32 SlotIndex);
+	void InternalUnequip(int32 SlotIndex, bool bDestroyItemActor = true);
+
+	/** Unequips items that are leaving the inventory, their actors are handled by the inventory */
+	void HandleItemLeaving(UItemInstance* InItemInstance);
+
+	/** Starts or stops listening to an equipped item's stat changes */
+	void BindItemStats(UItemInstance* InItemInstance);
+	void UnbindItemStats(UItemInstance* InItemInstance);
+	void HandleItemStatsChanged(UItemInstance* InItemInstance);
+
+	UFUNCTION()
+	void OnRep_EquippedItems(const TArray<FEquippedItem>& OldEquippedItems);
+
+	/** Filled slots only, a handful of entries so a plain array is cheaper than a fast array here */
+	UPROPERTY(ReplicatedUsing = OnRep_EquippedItems)
+	TArray<FEquippedItem> EquippedItems;
+
+	/** The owner's inventory, equipped items must be in it */
+	UPROPERTY(Transient)
+	TObjectPtr<UInventoryComponent> Inventory = nullptr;
+
+	mutable FItemCombatStats CachedStats;
+	mutable bool bStatsDirty = true;
+};
@@ -0,0 +1,586 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GridInventoryComponent.h"
+#include "InvTest.h"
+#include "InventoryStats.h"
+#include "Net/UnrealNetwork.h"
+#include "Net/Core/PushModel/PushModel.h"
+
+DECLARE_CYCLE_STAT(TEXT("Grid Find Free Space"), STAT_Inventory_GridFindFreeSpace, STATGROUP_Inventory);
+DECLARE_CYCLE_STAT(TEXT("Grid Auto Sort"), STAT_Inventory_GridAutoSort, STATGROUP_Inventory);
+
+void FGridItemPlacementList::PreReplicatedRemove(const TArrayView<int32> RemovedIndices, int32 FinalSize)
+{
+	INVENTORY_SCOPE(STAT_Inventory_ReplicationCallbacks);
+
+	if (!OwnerComponent)
+	{
+		return;
+	}
+
+	for (const int32 Index : RemovedIndices)
+	{
+		OwnerComponent->ClearOccupancy(Entries[Index]);
+	}
+	OwnerComponent->OnGridLayoutChanged.Broadcast();
+}
+
+void FGridItemPlacementList::PostReplicatedAdd(const TArrayView<int32> AddedIndices, int32 FinalSize)
+{
+	INVENTORY_SCOPE(STAT_Inventory_ReplicationCallbacks);
+
+	if (!OwnerComponent)
+	{
+		return;
+	}
+
+	for (const int32 Index : AddedIndices)
+	{
+		OwnerComponent->SyncOccupancy(Entries[Index]);
+	}
+	OwnerComponent->OnGridLayoutChanged.Broadcast();
+}
+
+void FGridItemPlacementList::PostReplicatedChange(const TArrayView<int32> ChangedIndices, int32 FinalSize)
+{
+	INVENTORY_SCOPE(STAT_Inventory_ReplicationCallbacks);
+
+	if (!OwnerComponent)
+	{
+		return;
+	}
+
+	/** Clear all first, a swap of two items arrives as two changes and must not collide with itself */
+	for (const int32 Index : ChangedIndices)
+	{
+		OwnerComponent->ClearOccupancy(Entries[Index]);
+	}
+	for (const int32 Index : ChangedIndices)
+	{
+		OwnerComponent->SyncOccupancy(Entries[Index]);
+	}
+	OwnerComponent->OnGridLayoutChanged.Broadcast();
+}
+
+UGridInventoryComponent::UGridInventoryComponent()
+{
+	bWantsInitializeComponent = true;
+
+	Placements.OwnerComponent = this;
+}
+
+void UGridInventoryComponent::InitializeComponent()
+{
+	Super::InitializeComponent();
+
+	ResetGrid();
+}
+
+void UGridInventoryComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	/** Same as Items, the layout is only interesting to the owner */
+	FDoRepLifetimeParams Params;
+	Params.bIsPushBased = true;
+	Params.Condition = COND_OwnerOnly;
+
+	DOREPLIFETIME_WITH_PARAMS_FAST(UGridInventoryComponent, Placements, Params);
+}
+
+void UGridInventoryComponent::ResetGrid()
+{
+	GridWidth = FMath::Clamp(GridWidth, 1, 64);
+	GridHeight = FMath::Max(GridHeight, 1);
+
+	RowOccupancy.SetNumZeroed(GridHeight);
+	FMemory::Memzero(RowOccupancy.GetData(), RowOccupancy.Num() * sizeof(uint64));
+
+	CellOwners.SetNumZeroed(GridWidth * GridHeight);
+	FMemory::Memzero(CellOwners.GetData(), CellOwners.Num() * sizeof(UItemInstance*));
+}
+
+FIntPoint UGridInventoryComponent::GetItemSize(const UItemInstance* InItemInstance)
+{
+	const UItemData* ItemData = InItemInstance ? InItemInstance->GetData() : nullptr;
+	return ItemData ? ItemData->GridSize.ComponentMax(FIntPoint(1, 1)) : FIntPoint(1, 1);
+}
+
+uint64 UGridInventoryComponent::GetRowMask(int32 X, int32 Width)
+{
+	const uint64 Bits = Width >= 64 ? ~0ull : (1ull << Width) - 1;
+	return Bits << X;
+}
+
+bool UGridInventoryComponent::CanPlaceAt(FIntPoint Size, FIntPoint Position, const UItemInstance* IgnoredItem) const
+{
+	if (Position.X < 0 || Position.Y < 0 || Size.X < 1 || Size.Y < 1
+		|| Position.X + Size.X > GridWidth || Position.Y + Size.Y > GridHeight)
+	{
+		return false;
+	}
+
+	const uint64 Mask = GetRowMask(Position.X, Size.X);
+
+	for (int32 Y = Position.Y; Y < Position.Y + Size.Y; ++Y)
+	{
+		if ((RowOccupancy[Y] & Mask) == 0)
+		{
+			continue;
+		}
+
+		if (!IgnoredItem)
+		{
+			return false;
+		}
+
+		/** Row overlaps something, it is still free if all of it is IgnoredItem */
+		for (int32 X = Position.X; X < Position.X + Size.X; ++X)
+		{
+			const UItemInstance* CellOwner = CellOwners[Y * GridWidth + X];
+			if (CellOwner && CellOwner != IgnoredItem)
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool UGridInventoryComponent::FindFreeSpace(FIntPoint Size, FIntPoint& OutPosition) const
+{
+	INVENTORY_SCOPE(STAT_Inventory_GridFindFreeSpace);
+
+	return FindFreeSpaceIn(RowOccupancy, GridWidth, Size, OutPosition);
+}
+
+bool UGridInventoryComponent::FindFreeSpaceIn(TConstArrayView<uint64> Rows, int32 Width, FIntPoint Size, FIntPoint& OutPosition)
+{
+	const int32 Height = Rows.Num();
+
+	if (Size.X < 1 || Size.Y < 1 || Size.X > Width || Size.Y > Height)
+	{
+		return false;
+	}
+
+	const uint64 WidthMask = GetRowMask(0, Width);
+
+	for (int32 Y = 0; Y + Size.Y <= Height; ++Y)
+	{
+		/** Columns that are free in every row the item would span */
+		uint64 Occupied = 0;
+		for (int32 Row = Y; Row < Y + Size.Y; ++Row)
+		{
+			Occupied |= Rows[Row];
+		}
+		const uint64 Free = ~Occupied & WidthMask;
+
+		/** Bit X of Runs is set if columns X .. X + Length - 1 are all free, double Length until it covers Size.X */
+		uint64 Runs = Free;
+		for (int32 Length = 1; Length < Size.X && Runs != 0;)
+		{
+			const int32 Shift = FMath::Min(Length, Size.X - Length);
+			Runs &= Runs >> Shift;
+			Length += Shift;
+		}
+
+		if (Runs != 0)
+		{
+			OutPosition = FIntPoint(static_cast<int32>(FMath::CountTrailingZeros64(Runs)), Y);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+UItemInstance* UGridInventoryComponent::GetItemAt(FIntPoint Cell) const
+{
+	if (Cell.X < 0 || Cell.Y < 0 || Cell.X >= GridWidth || Cell.Y >= GridHeight)
+	{
+		return nullptr;
+	}
+
+	return CellOwners[Cell.Y * GridWidth + Cell.X];
+}
+
+bool UGridInventoryComponent::GetItemPosition(const UItemInstance* InItemInstance, FIntPoint& OutPosition) const
+{
+	if (const int32* Index = PlacementIndices.Find(InItemInstance))
+	{
+		OutPosition = Placements.Entries[*Index].Position;
+		return true;
+	}
+
+	/** Clients don't have the index, but their placement list is as small as the grid */
+	const FGridItemPlacement* Placement = Placements.Entries.FindByPredicate([InItemInstance](const FGridItemPlacement& Entry) { return Entry.Instance == InItemInstance; });
+	if (Placement)
+	{
+		OutPosition = Placement->Position;
+		return true;
+	}
+
+	return false;
+}
+
+void UGridInventoryComponent::SetCells(FIntPoint Position, FIntPoint Size, UItemInstance* CellOwner)
+{
+	const uint64 Mask = GetRowMask(Position.X, Size.X);
+
+	for (int32 Y = Position.Y; Y < Position.Y + Size.Y; ++Y)
+	{
+		if (CellOwner)
+		{
+			RowOccupancy[Y] |= Mask;
+		}
+		else
+		{
+			RowOccupancy[Y] &= ~Mask;
+		}
+
+		for (int32 X = Position.X; X < Position.X + Size.X; ++X)
+		{
+			CellOwners[Y * GridWidth + X] = CellOwner;
+		}
+	}
+}
+
+void UGridInventoryComponent::SyncOccupancy(FGridItemPlacement& Placement)
+{
+	const FIntPoint Size = GetItemSize(Placement.Instance);
+
+	if (Placement.OccupyingInstance == Placement.Instance && Placement.OccupiedPosition == Placement.Position && Placement.OccupiedSize == Size)
+	{
+		return;
+	}
+
+	ClearOccupancy(Placement);
+
+	/** Instance may not have resolved yet, it is synced again once it does */
+	if (!Placement.Instance || !CanPlaceAt(Size, Placement.Position, Placement.Instance))
+	{
+		return;
+	}
+
+	SetCells(Placement.Position, Size, Placement.Instance);
+	Placement.OccupyingInstance = Placement.Instance;
+	Placement.OccupiedPosition = Placement.Position;
+	Placement.OccupiedSize = Size;
+}
+
+void UGridInventoryComponent::ClearOccupancy(FGridItemPlacement& Placement)
+{
+	if (!Placement.OccupyingInstance)
+	{
+		return;
+	}
+
+	SetCells(Placement.OccupiedPosition, Placement.OccupiedSize, nullptr);
+	Placement.OccupyingInstance = nullptr;
+}
+
+bool UGridInventoryComponent::CanAddItem(const UItemData* ItemData) const
+{
+	FIntPoint Position;
+	return ItemData && FindFreeSpace(ItemData->GridSize.ComponentMax(FIntPoint(1, 1)), Position);
+}
+
+bool UGridInventoryComponent::CanAddItems(TConstArrayView<const UItemData*> ItemDatas) const
+{
+	INVENTORY_SCOPE(STAT_Inventory_GridFindFreeSpace);
+
+	/** Place the items one after another on a scratch copy, in the same order PostItemAdded will place them */
+	TArray<uint64, TInlineAllocator<32>> ScratchRows(RowOccupancy);
+
+	for (const UItemData* ItemData : ItemDatas)
+	{
+		if (!ItemData)
+		{
+			return false;
+		}
+
+		const FIntPoint Size = ItemData->GridSize.ComponentMax(FIntPoint(1, 1));
+
+		FIntPoint Position;
+		if (!FindFreeSpaceIn(ScratchRows, GridWidth, Size, Position))
+		{
+			return false;
+		}
+
+		const uint64 Mask = GetRowMask(Position.X, Size.X);
+		for (int32 Y = Position.Y; Y < Position.Y + Size.Y; ++Y)
+		{
+			ScratchRows[Y] |= Mask;
+		}
+	}
+
+	return true;
+}
+
+void UGridInventoryComponent::PostItemAdded(UItemInstance* InItemInstance)
+{
+	Super::PostItemAdded(InItemInstance);
+
+	FIntPoint Position;
+	if (!FindFreeSpace(GetItemSize(InItemInstance), Position))
+	{
+		/** CanAddItem passed, so this only happens if a subclass added items without checking it */
+		UE_LOG(LogInventory, Warning, TEXT("UGridInventoryComponent::PostItemAdded: no space left for %s"), *InItemInstance->GetName());
+		return;
+	}
+
+	PlacementIndices.Add(InItemInstance, Placements.Entries.Num());
+
+	FGridItemPlacement& Placement = Placements.Entries.AddDefaulted_GetRef();
+	Placement.Instance = InItemInstance;
+	Placement.Position = Position;
+	Placements.MarkItemDirty(Placement);
+	SyncOccupancy(Placement);
+
+	MARK_PROPERTY_DIRTY_FROM_NAME(UGridInventoryComponent, Placements, this);
+}
+
+void UGridInventoryComponent::PreItemRemoved(UItemInstance* InItemInstance)
+{
+	int32 PlacementIndex = INDEX_NONE;
+	if (PlacementIndices.RemoveAndCopyValue(InItemInstance, PlacementIndex))
+	{
+		ClearOccupancy(Placements.Entries[PlacementIndex]);
+
+		/** Swap-remove, the last placement takes the removed placement's place */
+		const int32 LastIndex = Placements.Entries.Num() - 1;
+		if (PlacementIndex != LastIndex)
+		{
+			PlacementIndices.FindChecked(Placements.Entries[LastIndex].Instance) = PlacementIndex;
+		}
+		Placements.Entries.RemoveAtSwap(PlacementIndex, 1, EAllowShrinking::No);
+		Placements.MarkArrayDirty();
+
+		MARK_PROPERTY_DIRTY_FROM_NAME(UGridInventoryComponent, Placements, this);
+	}
+
+	Super::PreItemRemoved(InItemInstance);
+}
+
+void UGridInventoryComponent::SaveItemLayout(FArchive& Ar, TConstArrayView<const UItemInstance*> SavedItems) const
+{
+	int32 NumItems = SavedItems.Num();
+	Ar << NumItems;
+
+	for (const UItemInstance* Item : SavedItems)
+	{
+		FIntPoint Position = FIntPoint::ZeroValue;
+		GetItemPosition(Item, Position);
+
+		uint32 X = static_cast<uint32>(Position.X);
+		uint32 Y = static_cast<uint32>(Position.Y);
+		Ar.SerializeIntPacked(X);
+		Ar.SerializeIntPacked(Y);
+	}
+}
+
+void UGridInventoryComponent::LoadItemLayout(FArchive& Ar, TConstArrayView<UItemInstance*> LoadedItems)
+{
+	int32 NumItems = 0;
+	Ar << NumItems;
+
+	if (Ar.IsError() || NumItems != LoadedItems.Num())
+	{
+		UE_LOG(LogInventory, Warning, TEXT("UGridInventoryComponent::LoadItemLayout: saved layout does not match the loaded items, keeping the packed layout"));
+		return;
+	}
+
+	TArray<FIntPoint> SavedPositions;
+	SavedPositions.SetNumUninitialized(NumItems);
+	for (FIntPoint& Position : SavedPositions)
+	{
+		uint32 X = 0;
+		uint32 Y = 0;
+		Ar.SerializeIntPacked(X);
+		Ar.SerializeIntPacked(Y);
+		/** Clamped so a corrupt position can't overflow the bounds checks, it is rejected by CanPlaceAt either way */
+		Position = FIntPoint(static_cast<int32>(FMath::Min<uint32>(X, MAX_uint16)), static_cast<int32>(FMath::Min<uint32>(Y, MAX_uint16)));
+	}
+
+	if (Ar.IsError())
+	{
+		UE_LOG(LogInventory, Warning, TEXT("UGridInventoryComponent::LoadItemLayout: saved layout is malformed, keeping the packed layout"));
+		return;
+	}
+
+	/** Like AutoSortGrid, lay the items out on a clear grid first and only commit if all of them fit where they were */
+	TArray<int32> LoadedIndices;
+	LoadedIndices.Reserve(NumItems);
+	for (UItemInstance* Item : LoadedItems)
+	{
+		const int32* PlacementIndex = Item ? PlacementIndices.Find(Item) : nullptr;
+		LoadedIndices.Add(PlacementIndex ? *PlacementIndex : INDEX_NONE);
+		if (PlacementIndex)
+		{
+			ClearOccupancy(Placements.Entries[*PlacementIndex]);
+		}
+	}
+
+	bool bFits = true;
+	for (int32 Index = 0; Index < NumItems && bFits; ++Index)
+	{
+		if (LoadedIndices[Index] == INDEX_NONE)
+		{
+			continue;
+		}
+
+		const FIntPoint Size = GetItemSize(LoadedItems[Index]);
+		bFits = CanPlaceAt(Size, SavedPositions[Index]);
+		if (bFits)
+		{
+			SetCells(SavedPositions[Index], Size, LoadedItems[Index]);
+		}
+	}
+
+	ResetGrid();
+
+	for (int32 Index = 0; Index < NumItems; ++Index)
+	{
+		if (bFits && LoadedIndices[Index] != INDEX_NONE)
+		{
+			FGridItemPlacement& Placement = Placements.Entries[LoadedIndices[Index]];
+			if (Placement.Position != SavedPositions[Index])
+			{
+				Placement.Position = SavedPositions[Index];
+				Placements.MarkItemDirty(Placement);
+			}
+		}
+	}
+
+	/** ResetGrid cleared every cell, not just the ones of the loaded items */
+	for (FGridItemPlacement& Placement : Placements.Entries)
+	{
+		Placement.OccupyingInstance = nullptr;
+		SyncOccupancy(Placement);
+	}
+
+	if (!bFits)
+	{
+		UE_LOG(LogInventory, Warning, TEXT("UGridInventoryComponent::LoadItemLayout: saved layout does not fit %s (grid size changed?), keeping the packed layout"), *GetName());
+		return;
+	}
+
+	MARK_PROPERTY_DIRTY_FROM_NAME(UGridInventoryComponent, Placements, this);
+}
+
+void UGridInventoryComponent::ServerMoveGridItem_Implementation(UItemInstance* InItemInstance, FIntPoint NewPosition)
+{
+	if (!ConsumeRpcTokens(TEXT("ServerMoveGridItem")))
+	{
+		return;
+	}
+
+	const int32* PlacementIndex = PlacementIndices.Find(InItemInstance);
+	if (!PlacementIndex)
+	{
+		UE_LOG(LogInventory, Warning, TEXT("Tried to move an item that is not on this grid"));
+		return;
+	}
+
+	FGridItemPlacement& Placement = Placements.Entries[*PlacementIndex];
+	if (Placement.Position == NewPosition)
+	{
+		return;
+	}
+
+	if (!CanPlaceAt(GetItemSize(InItemInstance), NewPosition, InItemInstance))
+	{
+		UE_LOG(LogInventory, Warning, TEXT("Tried to move %s to (%d, %d), but it does not fit there"), *InItemInstance->GetName(), NewPosition.X, NewPosition.Y);
+		return;
+	}
+
+	Placement.Position = NewPosition;
+	Placements.MarkItemDirty(Placement);
+	SyncOccupancy(Placement);
+
+	MARK_PROPERTY_DIRTY_FROM_NAME(UGridInventoryComponent, Placements, this);
+}
+
+void UGridInventoryComponent::ServerAutoSortGrid_Implementation()
+{
+	/** Re-packs the whole grid, charge it like a handful of moves */
+	if (!ConsumeRpcTokens(TEXT("ServerAutoSortGrid"), 5.f))
+	{
+		return;
+	}
+
+	AutoSortGrid();
+}
+
+bool UGridInventoryComponent::AutoSortGrid()
+{
+	INVENTORY_SCOPE(STAT_Inventory_GridAutoSort);
+
+	if (!GetOwner()->HasAuthority())
+	{
+		UE_LOG(LogInventory, Warning, TEXT("UGridInventoryComponent::AutoSortGrid was called on non-authoritative machine, must be on authority."));
+		return false;
+	}
+
+	/** Largest first packs tightest with a first fit allocator, ties keep the current order so sorting twice is stable */
+	TArray<int32> Order;
+	Order.Reserve(Placements.Entries.Num());
+	for (int32 Index = 0; Index < Placements.Entries.Num(); ++Index)
+	{
+		Order.Add(Index);
+	}
+
+	Order.StableSort([this](int32 A, int32 B)
+	{
+		const FIntPoint SizeA = GetItemSize(Placements.Entries[A].Instance);
+		const FIntPoint SizeB = GetItemSize(Placements.Entries[B].Instance);
+		if (SizeA.Y != SizeB.Y)
+		{
+			return SizeA.Y > SizeB.Y;
+		}
+		return SizeA.X > SizeB.X;
+	});
+
+	/** Lay everything out on a clear grid first, only commit if all items found a place */
+	for (FGridItemPlacement& Placement : Placements.Entries)
+	{
+		ClearOccupancy(Placement);
+	}
+
+	TArray<FIntPoint> NewPositions;
+	NewPositions.SetNumUninitialized(Placements.Entries.Num());
+
+	bool bFits = true;
+	for (const int32 Index : Order)
+	{
+		const FIntPoint Size = GetItemSize(Placements.Entries[Index].Instance);
+		if (!FindFreeSpace(Size, NewPositions[Index]))
+		{
+			bFits = false;
+			break;
+		}
+		SetCells(NewPositions[Index], Size, Placements.Entries[Index].Instance);
+	}
+
+	ResetGrid();
+
+	for (int32 Index = 0; Index < Placements.Entries.Num(); ++Index)
+	{
+		FGridItemPlacement& Placement = Placements.Entries[Index];
+		if (bFits && Placement.Position != NewPositions[Index])
+		{
+			Placement.Position = NewPositions[Index];
+			Placements.MarkItemDirty(Placement);
+		}
+		SyncOccupancy(Placement);
+	}
+
+	if (bFits)
+	{
+		MARK_PROPERTY_DIRTY_FROM_NAME(UGridInventoryComponent, Placements, this);
+	}
+
+	return bFits;
+}
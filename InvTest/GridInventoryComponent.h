@@ -0,0 +1,206 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "InventoryComponent.h"
+#include "GridInventoryComponent.generated.h"
+
+class UGridInventoryComponent;
+
+/**
+ * Where an item sits in a grid inventory.
+ */
+USTRUCT(BlueprintType)
+struct FGridItemPlacement : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	TObjectPtr<UItemInstance> Instance = nullptr;
+
+	/** Top left cell of the item */
+	UPROPERTY(BlueprintReadOnly)
+	FIntPoint Position = FIntPoint::ZeroValue;
+
+private:
+	friend class UGridInventoryComponent;
+
+	/** Cells this placement currently occupies, lags behind on clients until the instance resolves */
+	UItemInstance* OccupyingInstance = nullptr;
+	FIntPoint OccupiedPosition = FIntPoint::ZeroValue;
+	FIntPoint OccupiedSize = FIntPoint::ZeroValue;
+};
+
+/**
+ * Delta-replicated placements of all items in a grid inventory.
+ */
+USTRUCT(BlueprintType)
+struct FGridItemPlacementList : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	//~ Begin FFastArraySerializer contract
+	void PreReplicatedRemove(const TArrayView<int32> RemovedIndices, int32 FinalSize);
+	void PostReplicatedAdd(const TArrayView<int32> AddedIndices, int32 FinalSize);
+	void PostReplicatedChange(const TArrayView<int32> ChangedIndices, int32 FinalSize);
+	//~ End FFastArraySerializer contract
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FGridItemPlacement, FGridItemPlacementList>(Entries, DeltaParms, *this);
+	}
+
+	UPROPERTY()
+	TArray<FGridItemPlacement> Entries;
+
+	/** Component that owns this list, used to route the replication callbacks */
+	UPROPERTY(NotReplicated)
+	TObjectPtr<UGridInventoryComponent> OwnerComponent = nullptr;
+};
+
+template<>
+struct TStructOpsTypeTraits<FGridItemPlacementList> : public TStructOpsTypeTraitsBase2<FGridItemPlacementList>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnGridLayoutChanged);
+
+/**
+ * Inventory where every item instance takes up UItemData::GridSize cells of a fixed size grid.
+ *
+ * Occupancy is kept as one 64 bit mask per row, so testing whether an item fits at a position
+ * costs one AND per row it spans, and finding free space tests a whole row of positions at once.
+ *
+ * Items that don't fit are rejected when they are created. Stacks take no cells, they are held
+ * next to the grid, so MaxStacks is what bounds how many stackable units it holds.
+ *
+ * Placements are saved with the inventory snapshot, so a loaded grid looks the way it was left.
+ */
+UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
+class INVTEST_API UGridInventoryComponent : public UInventoryComponent
+{
+	GENERATED_BODY()
+
+public:
+	UGridInventoryComponent();
+
+	//~ Begin UActorComponent Interface
+	virtual void InitializeComponent() override;
+	//~ End UActorComponent Interface
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	//--------------------------------------------
+	// Grid: Queries
+	//--------------------------------------------
+	/** Max width is 64, one bit per cell in a row mask */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Items|Grid", meta = (ClampMin = "1", ClampMax = "64"))
+	int32 GridWidth = 10;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Items|Grid", meta = (ClampMin = "1"))
+	int32 GridHeight = 6;
+
+	/** Max number of stacks, each holds up to UItemData::MaxStackSize units */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Items|Grid", meta = (ClampMin = "0"))
+	int32 MaxStacks = 8;
+
+	/**
+	 * @brief Finds the first free area of Size cells, scanning rows top to bottom and cells left to right.
+	 * @return false if there is no free area that large
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Items|Grid")
+	bool FindFreeSpace(FIntPoint Size, FIntPoint& OutPosition) const;
+
+	/** Whether Size cells at Position are inside the grid and free, cells taken by IgnoredItem count as free */
+	UFUNCTION(BlueprintCallable, Category = "Items|Grid")
+	bool CanPlaceAt(FIntPoint Size, FIntPoint Position, const UItemInstance* IgnoredItem = nullptr) const;
+
+	/** Item occupying Cell, or nullptr if it is free */
+	UFUNCTION(BlueprintCallable, Category = "Items|Grid")
+	UItemInstance* GetItemAt(FIntPoint Cell) const;
+
+	/**
+	 * @brief Top left cell of an item.
+	 * @return false if the item is not placed on this grid
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Items|Grid")
+	bool GetItemPosition(const UItemInstance* InItemInstance, FIntPoint& OutPosition) const;
+
+	UFUNCTION(BlueprintCallable, Category = "Items|Grid")
+	const TArray<FGridItemPlacement>& GetPlacements() const { return Placements.Entries; }
+
+	/** Broadcast on clients when the placements changed */
+	UPROPERTY(BlueprintAssignable, Category = "Items|Grid")
+	FOnGridLayoutChanged OnGridLayoutChanged;
+
+public:
+	//--------------------------------------------
+	// Grid: Moving
+	//--------------------------------------------
+	/**
+	 * @brief Moves an item so its top left cell is NewPosition, if the cells it would cover are free.
+	 */
+	UFUNCTION(BlueprintCallable, Server, Reliable, Category = "Items|Grid")
+	void ServerMoveGridItem(UItemInstance* InItemInstance, FIntPoint NewPosition);
+
+	UFUNCTION(BlueprintCallable, Server, Reliable, Category = "Items|Grid")
+	void ServerAutoSortGrid();
+
+	/**
+	 * @brief Re-packs the grid, placing the largest items first.
+	 *
+	 * Authority only.
+	 * @return false if the packed layout did not fit, the current layout is kept in that case
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Items|Grid")
+	bool AutoSortGrid();
+
+protected:
+	//~ Begin UInventoryComponent Interface
+	virtual bool CanAddItem(const UItemData* ItemData) const override;
+	virtual bool CanAddItems(TConstArrayView<const UItemData*> ItemDatas) const override;
+	virtual void PostItemAdded(UItemInstance* InItemInstance) override;
+	virtual void PreItemRemoved(UItemInstance* InItemInstance) override;
+	virtual int32 GetMaxStacks() const override { return MaxStacks; }
+	virtual void SaveItemLayout(FArchive& Ar, TConstArrayView<const UItemInstance*> SavedItems) const override;
+	virtual void LoadItemLayout(FArchive& Ar, TConstArrayView<UItemInstance*> LoadedItems) override;
+	//~ End UInventoryComponent Interface
+
+private:
+	friend struct FGridItemPlacementList;
+
+	static FIntPoint GetItemSize(const UItemInstance* InItemInstance);
+
+	/** Mask of Width bits starting at column X */
+	static uint64 GetRowMask(int32 X, int32 Width);
+
+	/** FindFreeSpace on an arbitrary occupancy, used to try out placements without touching the grid */
+	static bool FindFreeSpaceIn(TConstArrayView<uint64> Rows, int32 Width, FIntPoint Size, FIntPoint& OutPosition);
+
+	/** Sets or clears the occupancy bits and cell owners of an area */
+	void SetCells(FIntPoint Position, FIntPoint Size, UItemInstance* CellOwner);
+
+	/** Brings the occupancy up to date with the placement if it changed since it was last applied */
+	void SyncOccupancy(FGridItemPlacement& Placement);
+	void ClearOccupancy(FGridItemPlacement& Placement);
+
+	/** Resizes the occupancy to GridWidth x GridHeight and clears it */
+	void ResetGrid();
+
+	/** One mask per row, bit X set if cell (X, row) is occupied */
+	TArray<uint64> RowOccupancy;
+
+	/** Item occupying each cell, row major */
+	TArray<UItemInstance*> CellOwners;
+
+	/** Index of every item's placement in Placements.Entries (server only) */
+	TMap<const UItemInstance*, int32> PlacementIndices;
+
+	UPROPERTY(Replicated)
+	FGridItemPlacementList Placements;
+};
@@ -1,9 +1,24 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "InvTest.h"
+#include "InventoryStats.h"
 #include "Modules/ModuleManager.h"
 
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, InvTest, "InvTest" );
 
 DEFINE_LOG_CATEGORY(LogInvTest)
+DEFINE_LOG_CATEGORY(LogInventory);
+
+DEFINE_STAT(STAT_Inventory_CreateItem);
+DEFINE_STAT(STAT_Inventory_RemoveItem);
+DEFINE_STAT(STAT_Inventory_SpawnItemActor);
+DEFINE_STAT(STAT_Inventory_DestroyItemActor);
+DEFINE_STAT(STAT_Inventory_ReplicationCallbacks);
+DEFINE_STAT(STAT_Inventory_Lookup);
+DEFINE_STAT(STAT_Inventory_TransferItems);
+
+DEFINE_STAT(STAT_Inventory_LiveItemInstances);
+DEFINE_STAT(STAT_Inventory_LiveItemActors);
+DEFINE_STAT(STAT_Inventory_Inventories);
+DEFINE_STAT(STAT_Inventory_ItemsInInventories);
  
\ No newline at end of file
@@ -5,3 +5,15 @@
 #include "CoreMinimal.h"
 
 DECLARE_LOG_CATEGORY_EXTERN(LogInvTest, Log, All);
+
+/**
+ * Inventory and item instance logging.
+ *
+ * Per-call logs are Verbose, and compiled out entirely (including their
+ * string formatting) in Test and Shipping builds.
+ */
+#if UE_BUILD_SHIPPING || UE_BUILD_TEST
+DECLARE_LOG_CATEGORY_EXTERN(LogInventory, Log, Warning);
+#else
+DECLARE_LOG_CATEGORY_EXTERN(LogInventory, Log, All);
+#endif
@@ -1,6 +1,7 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "InvTestCharacter.h"
+#include "InvTest.h"
 #include "UObject/ConstructorHelpers.h"
 #include "Camera/CameraComponent.h"
 #include "Components/DecalComponent.h"
@@ -11,6 +12,9 @@
 #include "Materials/Material.h"
 #include "Engine/World.h"
 #include "InventoryComponent.h"
+#include "EquipmentComponent.h"
+#include "ItemAssetLoader.h"
+#include "InventoryGrantSubsystem.h"
 
 
 AInvTestCharacter::AInvTestCharacter()
@@ -50,6 +54,11 @@ AInvTestCharacter::AInvTestCharacter()
 	Inventory = CreateDefaultSubobject<UInventoryComponent>(TEXT("InventoryComponent"));
 	Inventory->SetIsReplicated(true);
 
+	// Create equipment slots on top of the inventory
+	Equipment = CreateDefaultSubobject<UEquipmentComponent>(TEXT("EquipmentComponent"));
+	Equipment->SlotDefinitions.Add({ TEXT("MainHand") });
+	Equipment->SlotDefinitions.Add({ TEXT("OffHand") });
+
 }
 
 void AInvTestCharacter::Tick(float DeltaSeconds)
@@ -67,19 +76,30 @@ void AInvTestCharacter::BeginPlay()
 {
 	Super::BeginPlay();
 
-	if (Inventory && !HasAuthority())
+	if (!Inventory)
+	{
+		UE_LOG(LogInventory, Verbose, TEXT("Inventory undefined!"));
+	}
+	else if (HasAuthority())
 	{
-		UE_LOG(LogTemp, Log, TEXT("Length of items to grant: %d"), ItemsToGrant.Num());
+		UE_LOG(LogInventory, Verbose, TEXT("Length of items to grant: %d"), ItemsToGrant.Num());
 
-		// Grant item instances!
-		for (const FItemInstanceInitializer& ItemInitializer : ItemsToGrant)
+		// Grant on the server, clients are not allowed to create items. Batched with the grants of every other character spawned this frame
+		if (UInventoryGrantSubsystem* GrantSubsystem = GetWorld()->GetSubsystem<UInventoryGrantSubsystem>())
 		{
-			UE_LOG(LogTemp, Log, TEXT("Creating new item!"));
-			Inventory->CreateItemInInventory(ItemInitializer.ItemClass, ItemInitializer.ItemData);
+			GrantSubsystem->QueueGrant(Inventory, ItemsToGrant);
+		}
+		// Stream in the item data and actor classes, then grant item instances as one batch
+		else if (UItemAssetLoader* AssetLoader = UItemAssetLoader::Get())
+		{
+			AssetLoader->PrefetchItemAssets(ItemsToGrant, FStreamableDelegate::CreateWeakLambda(this, [this]()
+			{
+				Inventory->CreateItemsInInventory(ItemsToGrant);
+			}));
+		}
+		else
+		{
+			Inventory->CreateItemsInInventory(ItemsToGrant);
 		}
-	}
-	else
-	{
-		UE_LOG(LogTemp, Log, TEXT("Inventory undefined!"));
 	}
 }
\ No newline at end of file
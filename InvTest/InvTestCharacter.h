@@ -29,6 +29,9 @@ public:
 	/** Returns InventoryComponent subobject **/
 	FORCEINLINE class UInventoryComponent* GetInventory() const { return Inventory; }
 
+	/** Returns EquipmentComponent subobject **/
+	FORCEINLINE class UEquipmentComponent* GetEquipment() const { return Equipment; }
+
 	/**
 	 * @brief Items that should be granted after creating the inventory
 	 */
@@ -49,5 +52,9 @@ private:
 	/** Inventory */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Inventory", meta = (AllowPrivateAccess = "true"))
 	class UInventoryComponent* Inventory;
+
+	/** Equipment slots, backed by Inventory */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Inventory", meta = (AllowPrivateAccess = "true"))
+	class UEquipmentComponent* Equipment;
 };
 
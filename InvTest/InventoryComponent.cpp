@@ -2,106 +2,2107 @@
 
 
 #include "InventoryComponent.h"
+#include "InvTest.h"
+#include "InventoryStats.h"
+#include "ItemActorSpawnQueue.h"
+#include "ItemAssetLoader.h"
+#include "ItemDataRegistry.h"
+#include "InventoryRpcLimiter.h"
+#include "CraftingSubsystem.h"
+#include "InventoryJournal.h"
 #include "Net/UnrealNetwork.h"
+#include "Net/Core/PushModel/PushModel.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "TimerManager.h"
+
+namespace InventorySnapshot
+{
+	/** "INVS" */
+	constexpr uint32 Magic = 0x494E5653;
+
+	constexpr uint16 Version = 1;
+
+	/** Writes Value as a variable length integer, most counts and indices fit in a single byte */
+	void WritePacked(FArchive& Ar, int32 Value)
+	{
+		uint32 Packed = static_cast<uint32>(Value);
+		Ar.SerializeIntPacked(Packed);
+	}
+
+	/** Reads a variable length integer, flagging the archive as errored if it is negative or above Max */
+	int32 ReadPacked(FArchive& Ar, int32 Max)
+	{
+		uint32 Packed = 0;
+		Ar.SerializeIntPacked(Packed);
+		if (Packed > static_cast<uint32>(Max))
+		{
+			Ar.SetError();
+			return 0;
+		}
+		return static_cast<int32>(Packed);
+	}
+}
+
+namespace InventoryItemViews
+{
+	const FString& GetSortName(const FInventoryItemView& View)
+	{
+		static const FString Empty;
+		return View.ItemData ? View.ItemData->GetSortName() : Empty;
+	}
+
+	const FGameplayTagContainer& GetItemTags(const FInventoryItemView& View)
+	{
+		return View.ItemData ? View.ItemData->ItemTags : FGameplayTagContainer::EmptyContainer;
+	}
+}
+
+void FInventoryItemList::PreReplicatedRemove(const TArrayView<int32> RemovedIndices, int32 FinalSize)
+{
+	INVENTORY_SCOPE(STAT_Inventory_ReplicationCallbacks);
+
+	if (!OwnerComponent)
+	{
+		return;
+	}
+
+	for (const int32 Index : RemovedIndices)
+	{
+		OwnerComponent->HandleReplicatedItemRemoved(Entries[Index].Instance);
+		OwnerComponent->UnindexItem(Entries[Index]);
+	}
+}
+
+void FInventoryItemList::PostReplicatedAdd(const TArrayView<int32> AddedIndices, int32 FinalSize)
+{
+	INVENTORY_SCOPE(STAT_Inventory_ReplicationCallbacks);
+
+	if (!OwnerComponent)
+	{
+		return;
+	}
+
+	for (const int32 Index : AddedIndices)
+	{
+		OwnerComponent->SyncItemIndex(Entries[Index]);
+		OwnerComponent->HandleReplicatedItemAdded(Entries[Index].Instance);
+	}
+}
+
+void FInventoryItemList::PostReplicatedChange(const TArrayView<int32> ChangedIndices, int32 FinalSize)
+{
+	INVENTORY_SCOPE(STAT_Inventory_ReplicationCallbacks);
+
+	if (!OwnerComponent)
+	{
+		return;
+	}
+
+	for (const int32 Index : ChangedIndices)
+	{
+		OwnerComponent->SyncItemIndex(Entries[Index]);
+		OwnerComponent->HandleReplicatedItemChanged(Entries[Index].Instance);
+	}
+}
+
+void FInventoryStackList::PreReplicatedRemove(const TArrayView<int32> RemovedIndices, int32 FinalSize)
+{
+	INVENTORY_SCOPE(STAT_Inventory_ReplicationCallbacks);
+
+	if (!OwnerComponent)
+	{
+		return;
+	}
+
+	for (const int32 Index : RemovedIndices)
+	{
+		OwnerComponent->HandleReplicatedStackRemoved(Entries[Index]);
+		OwnerComponent->UnindexStack(Entries[Index]);
+		OwnerComponent->RemoveStackView(Entries[Index].StackId);
+	}
+}
+
+void FInventoryStackList::PostReplicatedAdd(const TArrayView<int32> AddedIndices, int32 FinalSize)
+{
+	INVENTORY_SCOPE(STAT_Inventory_ReplicationCallbacks);
+
+	if (!OwnerComponent)
+	{
+		return;
+	}
+
+	for (const int32 Index : AddedIndices)
+	{
+		OwnerComponent->ResolveStackItemData(Entries[Index]);
+		OwnerComponent->SyncStackIndex(Entries[Index]);
+		OwnerComponent->HandleReplicatedStackAdded(Entries[Index]);
+	}
+}
+
+void FInventoryStackList::PostReplicatedChange(const TArrayView<int32> ChangedIndices, int32 FinalSize)
+{
+	INVENTORY_SCOPE(STAT_Inventory_ReplicationCallbacks);
+
+	if (!OwnerComponent)
+	{
+		return;
+	}
+
+	for (const int32 Index : ChangedIndices)
+	{
+		OwnerComponent->ResolveStackItemData(Entries[Index]);
+		OwnerComponent->SyncStackIndex(Entries[Index]);
+		OwnerComponent->HandleReplicatedStackChanged(Entries[Index]);
+	}
+}
 
 UInventoryComponent::UInventoryComponent()
 {
 	SetIsReplicatedByDefault(true);
 	bReplicateUsingRegisteredSubObjectList = true;
+
+	Items.OwnerComponent = this;
+	VisibleItems.OwnerComponent = this;
+	Stacks.OwnerComponent = this;
+}
+
+void UInventoryComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	INC_DWORD_STAT(STAT_Inventory_Inventories);
+}
+
+void UInventoryComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	DEC_DWORD_STAT(STAT_Inventory_Inventories);
+
+	if (UItemAssetLoader* AssetLoader = UItemAssetLoader::Get())
+	{
+		for (const UItemData* ItemData : RetainedActorClassData)
+		{
+			AssetLoader->ReleaseItemActorClass(ItemData);
+		}
+	}
+	RetainedActorClassData.Reset();
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void UInventoryComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME(UInventoryComponent, Items);
+	/**
+	 * Items is push based: when push model is enabled (net.IsPushModelEnabled=1) the net driver
+	 * only compares it after MARK_PROPERTY_DIRTY, otherwise it falls back to being compared every update.
+	 *
+	 * The full contents only go to the owner, everyone else gets the visible subset.
+	 */
+	FDoRepLifetimeParams OwnerOnlyParams;
+	OwnerOnlyParams.bIsPushBased = true;
+	OwnerOnlyParams.Condition = COND_OwnerOnly;
+
+	FDoRepLifetimeParams SkipOwnerParams;
+	SkipOwnerParams.bIsPushBased = true;
+	SkipOwnerParams.Condition = COND_SkipOwner;
+
+	DOREPLIFETIME_WITH_PARAMS_FAST(UInventoryComponent, Items, OwnerOnlyParams);
+	DOREPLIFETIME_WITH_PARAMS_FAST(UInventoryComponent, Stacks, OwnerOnlyParams);
+	DOREPLIFETIME_WITH_PARAMS_FAST(UInventoryComponent, VisibleItems, SkipOwnerParams);
 }
 
 
 const UItemInstance* UInventoryComponent::CreateItemInInventory(TSubclassOf<UItemInstance> ItemClass, UItemData* ItemData)
 {
-	UE_LOG(LogTemp, Log, TEXT("UInventoryComponent::CreateItemInInventory called with role: %s"), *UEnum::GetValueAsString(GetOwnerRole()));
+	INVENTORY_SCOPE(STAT_Inventory_CreateItem);
+
+	UE_LOG(LogInventory, Verbose, TEXT("UInventoryComponent::CreateItemInInventory called with role: %s"), *UEnum::GetValueAsString(GetOwnerRole()));
 
 	// If called on client, make a server rpc to ServerCreateItemInInventory
 	if (!GetOwner()->HasAuthority())
 	{
-		UE_LOG(LogTemp, Log, TEXT("Forwarding CreateItemInInventory call to ServerCreateItemInInventory"));
-		ServerCreateItemInInventory(ItemClass, ItemData);
+		UE_LOG(LogInventory, Verbose, TEXT("Forwarding CreateItemInInventory call to ServerCreateItemInInventory"));
+		ServerCreateItemInInventory(ItemClass, ItemData ? ItemData->GetItemDataId() : FItemDataId());
 		return nullptr;
 	}
 
+	UItemInstance* Item = InternalCreateItem(ItemClass, ItemData);
+	if (Item)
+	{
+		MARK_PROPERTY_DIRTY_FROM_NAME(UInventoryComponent, Items, this);
+	}
+
+	return Item;
+}
+
+void UInventoryComponent::ServerCreateItemInInventory_Implementation(TSubclassOf<UItemInstance> ItemClass, FItemDataId ItemDataId)
+{
+	if (!bAllowClientItemCreation || !ConsumeRpcTokens(TEXT("ServerCreateItemInInventory")))
+	{
+		return;
+	}
+
+	/** Cheap checks first, only resolve (and maybe load) data the client is allowed to ask for */
+	UItemDataRegistry* Registry = UItemDataRegistry::Get();
+	if (!Registry || !Registry->IsRegistered(ItemDataId))
+	{
+		UE_LOG(LogInventory, Warning, TEXT("ServerCreateItemInInventory: unknown item data id %s"), *ItemDataId.ToString());
+		return;
+	}
+
+	UItemData* ItemData = Registry->ResolveItemData(ItemDataId);
+	if (!IsValidItemRequest(ItemClass, ItemData))
+	{
+		UE_LOG(LogInventory, Warning, TEXT("ServerCreateItemInInventory: %s can't be created as %s"), *GetNameSafe(ItemData), *GetNameSafe(ItemClass));
+		return;
+	}
+
+	CreateItemInInventory(ItemClass, ItemData);
+}
+
+TArray<UItemInstance*> UInventoryComponent::CreateItemsInInventory(const TArray<FItemInstanceInitializer>& ItemInitializers)
+{
+	INVENTORY_SCOPE(STAT_Inventory_CreateItem);
+
+	TArray<UItemInstance*> CreatedItems;
+
+	if (ItemInitializers.Num() == 0)
+	{
+		return CreatedItems;
+	}
+
+	// If called on client, forward the whole batch in one server rpc
+	if (!GetOwner()->HasAuthority())
+	{
+		TArray<FItemCreateRequest> Requests;
+		Requests.Reserve(FMath::Min(ItemInitializers.Num(), MaxRequestsPerRpc));
+		for (const FItemInstanceInitializer& ItemInitializer : ItemInitializers)
+		{
+			FItemCreateRequest& Request = Requests.AddDefaulted_GetRef();
+			Request.ItemClass = ItemInitializer.ItemClass;
+			Request.ItemDataId = FItemDataId::FromPath(ItemInitializer.ItemData.ToSoftObjectPath());
+
+			if (Requests.Num() == MaxRequestsPerRpc)
+			{
+				ServerCreateItemsInInventory(Requests);
+				Requests.Reset();
+			}
+		}
+
+		if (Requests.Num() > 0)
+		{
+			ServerCreateItemsInInventory(Requests);
+		}
+		return CreatedItems;
+	}
+
+	CreatedItems.Reserve(ItemInitializers.Num());
+	Items.Entries.Reserve(Items.Entries.Num() + ItemInitializers.Num());
+
+	UItemAssetLoader* AssetLoader = UItemAssetLoader::Get();
+
+	for (const FItemInstanceInitializer& ItemInitializer : ItemInitializers)
+	{
+		/** Only blocks if the data was not prefetched */
+		UItemData* ItemData = AssetLoader ? AssetLoader->ResolveItemData(ItemInitializer.ItemData) : ItemInitializer.ItemData.Get();
+
+		if (!IsValidItemRequest(ItemInitializer.ItemClass, ItemData))
+		{
+			UE_LOG(LogInventory, Warning, TEXT("UInventoryComponent::CreateItemsInInventory skipped an initializer whose ItemClass and ItemData are missing or incompatible"));
+			continue;
+		}
+
+		if (UItemInstance* Item = InternalCreateItem(ItemInitializer.ItemClass, ItemData, ItemInitializer.bRollAffixes))
+		{
+			CreatedItems.Add(Item);
+		}
+	}
+
+	MARK_PROPERTY_DIRTY_FROM_NAME(UInventoryComponent, Items, this);
+
+	return CreatedItems;
+}
+
+void UInventoryComponent::ServerCreateItemsInInventory_Implementation(const TArray<FItemCreateRequest>& Requests)
+{
+	if (!bAllowClientItemCreation || !ConsumeBatchRpcTokens(TEXT("ServerCreateItemsInInventory"), Requests.Num()))
+	{
+		return;
+	}
+
+	UItemDataRegistry* Registry = UItemDataRegistry::Get();
+	if (!Registry)
+	{
+		return;
+	}
+
+	TArray<FItemInstanceInitializer> ItemInitializers;
+	ItemInitializers.Reserve(Requests.Num());
+	for (const FItemCreateRequest& Request : Requests)
+	{
+		const TSoftObjectPtr<UItemData> ItemData = Registry->GetItemData(Request.ItemDataId);
+		if (ItemData.IsNull() || !Request.ItemClass || Request.ItemClass->HasAnyClassFlags(CLASS_Abstract))
+		{
+			UE_LOG(LogInventory, Warning, TEXT("ServerCreateItemsInInventory: unknown item data id %s"), *Request.ItemDataId.ToString());
+			continue;
+		}
+
+		FItemInstanceInitializer& ItemInitializer = ItemInitializers.AddDefaulted_GetRef();
+		ItemInitializer.ItemClass = Request.ItemClass;
+		ItemInitializer.ItemData = ItemData;
+	}
+
+	UItemAssetLoader* AssetLoader = UItemAssetLoader::Get();
+	if (!AssetLoader)
+	{
+		CreateItemsInInventory(ItemInitializers);
+		return;
+	}
+
+	/** Client only sent ids, stream the data in instead of blocking the server tick on it */
+	AssetLoader->PrefetchItemAssets(ItemInitializers, FStreamableDelegate::CreateWeakLambda(this, [this, ItemInitializers]()
+	{
+		CreateItemsInInventory(ItemInitializers);
+	}));
+}
+
+UItemInstance* UInventoryComponent::InternalCreateItem(TSubclassOf<UItemInstance> ItemClass, UItemData* ItemData, bool bRollAffixes)
+{
 	FItemInstanceInitializer ItemInitializer;
 	ItemInitializer.Outer = this;
 	ItemInitializer.OwnerActor = GetOwner();
 	ItemInitializer.ItemClass = ItemClass;
 	ItemInitializer.ItemData = ItemData;
+	ItemInitializer.bRollAffixes = bRollAffixes;
+
+	return InternalCreateItem(ItemInitializer);
+}
+
+UItemInstance* UInventoryComponent::InternalCreateItem(const FItemInstanceInitializer& ItemInitializer)
+{
+	check(ItemInitializer.Outer == this);
+
+	const UItemData* ItemData = ItemInitializer.ItemData.Get();
+	if (!CanAddItem(ItemData))
+	{
+		UE_LOG(LogInventory, Verbose, TEXT("UInventoryComponent::InternalCreateItem: %s does not fit into %s"), *GetNameSafe(ItemData), *GetName());
+		return nullptr;
+	}
 
 	UItemInstance* Item = UItemInstance::CreateItemInstance(ItemInitializer);
 
+	InternalAddItem(Item);
+	JournalItemOp(EInventoryJournalOp::Create, Item);
+
+	return Item;
+}
+
+void UInventoryComponent::InternalAddItem(UItemInstance* InItemInstance)
+{
+	check(InItemInstance->GetOuter() == this);
+
 	/** Important: Add item to the replicated subobjects list, otherwise it wont be replicated*/
-	/** The item Items array itself will replicate, but the UItemInstance* inside of them will be nullptr.*/
-	// TODO: We will need to manually remove items from this whenever the item is removed from the inventroy
-	AddReplicatedSubObject(Item);
+	/** The Items list itself will replicate, but the UItemInstance* inside of them will be nullptr.*/
+	/** InternalRemoveItem takes care of removing it from the list again */
+	/** Owner only, like Items, SetItemVisibleToOthers opens it up to everyone */
+	AddReplicatedSubObject(InItemInstance, COND_OwnerOnly);
 
-	Items.Add(Item);
+	ItemEntryIndices.Add(InItemInstance, Items.Entries.Num());
 
-	return Item;
+	FInventoryItemEntry& Entry = Items.Entries.AddDefaulted_GetRef();
+	Entry.Instance = InItemInstance;
+	Items.MarkItemDirty(Entry);
+	SyncItemIndex(Entry);
+
+	PostItemAdded(InItemInstance);
 }
 
-void UInventoryComponent::ServerCreateItemInInventory_Implementation(TSubclassOf<UItemInstance> ItemClass, UItemData* ItemData)
+bool UInventoryComponent::CanAddItems(TConstArrayView<const UItemData*> ItemDatas) const
 {
-	CreateItemInInventory(ItemClass, ItemData);
+	for (const UItemData* ItemData : ItemDatas)
+	{
+		if (!CanAddItem(ItemData))
+		{
+			return false;
+		}
+	}
+	return true;
 }
 
-void UInventoryComponent::ServerSpawnItemActor_Implementation(UItemInstance* InItemInstance)
+bool UInventoryComponent::TransferItemTo(UInventoryComponent* Target, UItemInstance* InItemInstance, bool bKeepItemActors)
 {
-	if (IsItemActorSpawned(InItemInstance))
+	return TransferItemsTo(Target, { InItemInstance }, bKeepItemActors);
+}
+
+bool UInventoryComponent::TransferAllItemsTo(UInventoryComponent* Target, bool bKeepItemActors)
+{
+	return TransferItemsTo(Target, GetItemInstances(), bKeepItemActors);
+}
+
+bool UInventoryComponent::TransferItemsTo(UInventoryComponent* Target, const TArray<UItemInstance*>& InItemInstances, bool bKeepItemActors)
+{
+	INVENTORY_SCOPE(STAT_Inventory_TransferItems);
+
+	if (!GetOwner()->HasAuthority())
 	{
-		UE_LOG(LogTemp, Warning, TEXT("Tried to spawn an ItemActor, but the instance's ItemActor is already spawned"));
-		return;
+		UE_LOG(LogInventory, Warning, TEXT("UInventoryComponent::TransferItemsTo was called on non-authoritative machine, must be on authority."));
+		return false;
 	}
 
-	AActor* SpawnedItemActor = InItemInstance->TrySpawnItemActor();
+	if (!Target || Target == this || !Target->GetOwner()->HasAuthority())
+	{
+		UE_LOG(LogInventory, Warning, TEXT("UInventoryComponent::TransferItemsTo: invalid target inventory %s"), *GetNameSafe(Target));
+		return false;
+	}
 
-	if (!SpawnedItemActor)
+	/** Validate everything before touching anything, so a failed transfer leaves both inventories as they were */
+	TSet<UItemInstance*> UniqueItems;
+	TArray<const UItemData*> ItemDatas;
+	UniqueItems.Reserve(InItemInstances.Num());
+	ItemDatas.Reserve(InItemInstances.Num());
+
+	for (UItemInstance* Item : InItemInstances)
 	{
-		return;
+		bool bAlreadyInSet = false;
+		UniqueItems.Add(Item, &bAlreadyInSet);
+
+		if (!Item || bAlreadyInSet || !ItemEntryIndices.Contains(Item))
+		{
+			UE_LOG(LogInventory, Warning, TEXT("UInventoryComponent::TransferItemsTo: %s is not in %s, or listed twice"), *GetNameSafe(Item), *GetName());
+			return false;
+		}
+
+		ItemDatas.Add(Item->GetData());
 	}
 
-	SpawnedItemActors.Add(InItemInstance);
+	if (!Target->CanAddItems(ItemDatas))
+	{
+		UE_LOG(LogInventory, Verbose, TEXT("UInventoryComponent::TransferItemsTo: %s can't take %d items"), *Target->GetName(), ItemDatas.Num());
+		return false;
+	}
 
-}
+	Target->Items.Entries.Reserve(Target->Items.Entries.Num() + InItemInstances.Num());
 
+	for (UItemInstance* Item : InItemInstances)
+	{
+		const bool bHadItemActor = SpawnedItemActors.Contains(Item);
+		const bool bMoveItemActor = bKeepItemActors && bHadItemActor;
 
-void UInventoryComponent::ServerDestroyItemActor_Implementation(UItemInstance* InItemInstance)
+		JournalItemOp(EInventoryJournalOp::TransferOut, Item, Target);
+		InternalRemoveItem(Item, !bMoveItemActor);
+
+		Item->Reparent(Target);
+		Target->InternalAddItem(Item);
+		Target->JournalItemOp(EInventoryJournalOp::TransferIn, Item, this);
+
+		if (bMoveItemActor)
+		{
+			Target->SpawnedItemActors.Add(Item);
+			Target->SetItemVisibleToOthers(Item, true);
+			Target->JournalItemOp(EInventoryJournalOp::SpawnActor, Item);
+		}
+	}
+
+	MARK_PROPERTY_DIRTY_FROM_NAME(UInventoryComponent, Items, this);
+	MARK_PROPERTY_DIRTY_FROM_NAME(UInventoryComponent, Items, Target);
+
+	return true;
+}
+
+bool UInventoryComponent::RemoveItemFromInventory(UItemInstance* InItemInstance)
 {
-	if (!IsItemActorSpawned(InItemInstance))
+	INVENTORY_SCOPE(STAT_Inventory_RemoveItem);
+
+	if (!GetOwner()->HasAuthority())
 	{
-		UE_LOG(LogTemp, Warning, TEXT("Tried to destroy an ItemActor, but the instance had no ItemActor spawned"));
-		return;
+		UE_LOG(LogInventory, Warning, TEXT("UInventoryComponent::RemoveItemFromInventory was called on non-authoritative machine, must be on authority."));
+		return false;
 	}
 
-	InItemInstance->TryDestroyItemActor();
+	if (!InternalRemoveItem(InItemInstance))
+	{
+		return false;
+	}
 
-	SpawnedItemActors.Remove(InItemInstance);
-}
+	JournalItemOp(EInventoryJournalOp::Remove, InItemInstance);
+	InItemInstance->MarkAsGarbage();
+	MARK_PROPERTY_DIRTY_FROM_NAME(UInventoryComponent, Items, this);
 
+	return true;
+}
 
-bool UInventoryComponent::IsItemActorSpawned(UItemInstance* InItemInstance) const
+int32 UInventoryComponent::RemoveItemsFromInventory(const TArray<UItemInstance*>& InItemInstances)
 {
-	if (SpawnedItemActors.Find(InItemInstance))
+	INVENTORY_SCOPE(STAT_Inventory_RemoveItem);
+
+	if (!GetOwner()->HasAuthority())
 	{
-		return true;
+		UE_LOG(LogInventory, Warning, TEXT("UInventoryComponent::RemoveItemsFromInventory was called on non-authoritative machine, must be on authority."));
+		return 0;
 	}
-	return false;
+
+	int32 NumRemoved = 0;
+	for (UItemInstance* Item : InItemInstances)
+	{
+		if (InternalRemoveItem(Item))
+		{
+			JournalItemOp(EInventoryJournalOp::Remove, Item);
+			Item->MarkAsGarbage();
+			++NumRemoved;
+		}
+	}
+
+	if (NumRemoved > 0)
+	{
+		MARK_PROPERTY_DIRTY_FROM_NAME(UInventoryComponent, Items, this);
+	}
+
+	return NumRemoved;
 }
 
-void UInventoryComponent::OnRep_Items()
+void UInventoryComponent::SaveInventoryToBytes(TArray<uint8>& OutBytes) const
 {
-	UE_LOG(LogTemp, Log, TEXT("OnRep_Items!"));
-	for (const auto& Item : Items)
+	OutBytes.Reset();
+	FMemoryWriter Writer(OutBytes);
+
+	/** Gather the class and data tables, so each is only written once */
+	TArray<const UClass*> ClassTable;
+	TArray<const UItemData*> DataTable;
+	TMap<const UClass*, int32> ClassIndices;
+	TMap<const UItemData*, int32> DataIndices;
+
+	auto GetDataIndex = [&DataTable, &DataIndices](const UItemData* ItemData)
+	{
+		if (const int32* Index = DataIndices.Find(ItemData))
+		{
+			return *Index;
+		}
+		return DataIndices.Add(ItemData, DataTable.Add(ItemData));
+	};
+
+	for (const FInventoryItemEntry& Entry : Items.Entries)
 	{
-		UE_LOG(LogTemp, Log, TEXT("\t - Item: %s"), Item ? *Item->GetName() : TEXT("nullptr"));
+		if (!ClassIndices.Contains(Entry.Instance->GetClass()))
+		{
+			ClassIndices.Add(Entry.Instance->GetClass(), ClassTable.Add(Entry.Instance->GetClass()));
+		}
+		GetDataIndex(Entry.Instance->Data.Get());
+	}
+	for (const FInventoryStackEntry& Stack : Stacks.Entries)
+	{
+		GetDataIndex(Stack.ItemData.Get());
+	}
+
+	uint32 Magic = InventorySnapshot::Magic;
+	uint16 Version = InventorySnapshot::Version;
+	Writer << Magic;
+	Writer << Version;
+
+	InventorySnapshot::WritePacked(Writer, ClassTable.Num());
+	for (const UClass* Class : ClassTable)
+	{
+		FString Path = FSoftClassPath(Class).ToString();
+		Writer << Path;
+	}
+
+	InventorySnapshot::WritePacked(Writer, DataTable.Num());
+	for (const UItemData* ItemData : DataTable)
+	{
+		FItemDataId Id = ItemData->GetItemDataId();
+		Writer << Id;
+	}
+
+	/** Per-instance state is length prefixed, so it can be skipped if an item class fails to load */
+	TArray<uint8> StateBytes;
+	TArray<const UItemInstance*> SavedItems;
+	SavedItems.Reserve(Items.Entries.Num());
+	InventorySnapshot::WritePacked(Writer, Items.Entries.Num());
+	for (const FInventoryItemEntry& Entry : Items.Entries)
+	{
+		SavedItems.Add(Entry.Instance);
+
+		InventorySnapshot::WritePacked(Writer, ClassIndices.FindChecked(Entry.Instance->GetClass()));
+		InventorySnapshot::WritePacked(Writer, DataIndices.FindChecked(Entry.Instance->Data.Get()));
+
+		FGuid ItemGuid = Entry.Instance->ItemGuid;
+		Writer << ItemGuid;
+
+		StateBytes.Reset();
+		FMemoryWriter StateWriter(StateBytes);
+		Entry.Instance->SerializeInstanceState(StateWriter);
+
+		InventorySnapshot::WritePacked(Writer, StateBytes.Num());
+		Writer.Serialize(StateBytes.GetData(), StateBytes.Num());
+	}
+
+	InventorySnapshot::WritePacked(Writer, Stacks.Entries.Num());
+	for (const FInventoryStackEntry& Stack : Stacks.Entries)
+	{
+		InventorySnapshot::WritePacked(Writer, DataIndices.FindChecked(Stack.ItemData.Get()));
+		InventorySnapshot::WritePacked(Writer, Stack.Count);
 	}
-}
 
+	/** Length prefixed as well, so a snapshot can be loaded into an inventory with a different layout */
+	TArray<uint8> LayoutBytes;
+	FMemoryWriter LayoutWriter(LayoutBytes);
+	SaveItemLayout(LayoutWriter, SavedItems);
+
+	InventorySnapshot::WritePacked(Writer, LayoutBytes.Num());
+	Writer.Serialize(LayoutBytes.GetData(), LayoutBytes.Num());
+}
+
+bool UInventoryComponent::LoadInventoryFromBytes(const TArray<uint8>& Bytes)
+{
+	INVENTORY_SCOPE(STAT_Inventory_CreateItem);
+
+	if (!GetOwner()->HasAuthority())
+	{
+		UE_LOG(LogInventory, Warning, TEXT("UInventoryComponent::LoadInventoryFromBytes was called on non-authoritative machine, must be on authority."));
+		return false;
+	}
+
+	FMemoryReader Reader(Bytes);
+
+	uint32 Magic = 0;
+	uint16 Version = 0;
+	Reader << Magic;
+	Reader << Version;
+
+	if (Reader.IsError() || Magic != InventorySnapshot::Magic || Version != InventorySnapshot::Version)
+	{
+		UE_LOG(LogInventory, Error, TEXT("UInventoryComponent::LoadInventoryFromBytes: not an inventory snapshot, or unsupported version %d"), Version);
+		return false;
+	}
+
+	/** No table or list can have more entries than there are bytes left, this keeps corrupt data from allocating huge arrays */
+	const int32 MaxCount = Bytes.Num();
+
+	TArray<UClass*> ClassTable;
+	ClassTable.SetNumZeroed(InventorySnapshot::ReadPacked(Reader, MaxCount));
+	for (UClass*& Class : ClassTable)
+	{
+		FString Path;
+		Reader << Path;
+		Class = FSoftClassPath(Path).TryLoadClass<UItemInstance>();
+	}
+
+	UItemDataRegistry* Registry = UItemDataRegistry::Get();
+
+	TArray<UItemData*> DataTable;
+	DataTable.SetNumZeroed(InventorySnapshot::ReadPacked(Reader, MaxCount));
+	for (UItemData*& ItemData : DataTable)
+	{
+		FItemDataId Id;
+		Reader << Id;
+		ItemData = Registry ? Registry->ResolveItemData(Id) : nullptr;
+	}
+
+	/** The whole payload is read before anything is touched, so a malformed snapshot leaves the inventory as it was */
+	struct FSavedItem
+	{
+		UClass* ItemClass = nullptr;
+		UItemData* ItemData = nullptr;
+		FGuid ItemGuid;
+		TArray<uint8> StateBytes;
+	};
+
+	TArray<FSavedItem> SavedItems;
+	SavedItems.SetNum(InventorySnapshot::ReadPacked(Reader, MaxCount));
+	for (FSavedItem& SavedItem : SavedItems)
+	{
+		const int32 ClassIndex = InventorySnapshot::ReadPacked(Reader, MaxCount);
+		const int32 DataIndex = InventorySnapshot::ReadPacked(Reader, MaxCount);
+		Reader << SavedItem.ItemGuid;
+
+		SavedItem.StateBytes.SetNumUninitialized(InventorySnapshot::ReadPacked(Reader, MaxCount));
+		Reader.Serialize(SavedItem.StateBytes.GetData(), SavedItem.StateBytes.Num());
+
+		if (Reader.IsError() || !ClassTable.IsValidIndex(ClassIndex) || !DataTable.IsValidIndex(DataIndex))
+		{
+			Reader.SetError();
+			break;
+		}
+
+		SavedItem.ItemClass = ClassTable[ClassIndex];
+		SavedItem.ItemData = DataTable[DataIndex];
+	}
+
+	TArray<TPair<UItemData*, int32>> SavedStacks;
+	SavedStacks.SetNum(Reader.IsError() ? 0 : InventorySnapshot::ReadPacked(Reader, MaxCount));
+	for (TPair<UItemData*, int32>& SavedStack : SavedStacks)
+	{
+		const int32 DataIndex = InventorySnapshot::ReadPacked(Reader, MaxCount);
+		SavedStack.Value = InventorySnapshot::ReadPacked(Reader, MAX_int32);
+
+		if (Reader.IsError() || !DataTable.IsValidIndex(DataIndex))
+		{
+			Reader.SetError();
+			break;
+		}
+		SavedStack.Key = DataTable[DataIndex];
+	}
+
+	TArray<uint8> LayoutBytes;
+	LayoutBytes.SetNumUninitialized(Reader.IsError() ? 0 : InventorySnapshot::ReadPacked(Reader, MaxCount));
+	Reader.Serialize(LayoutBytes.GetData(), LayoutBytes.Num());
+
+	if (Reader.IsError())
+	{
+		UE_LOG(LogInventory, Error, TEXT("UInventoryComponent::LoadInventoryFromBytes: snapshot is malformed"));
+		return false;
+	}
+
+	/** The whole load is journaled as a single snapshot at the end instead */
+	UInventoryJournal* Journal = GetJournal();
+	TGuardValue<bool> SuspendJournal(bJournalSuspended, true);
+
+	InternalClearInventory();
+
+	Items.Entries.Reserve(SavedItems.Num());
+	ItemEntryIndices.Reserve(SavedItems.Num());
+
+	TArray<UItemInstance*> LoadedItems;
+	LoadedItems.Reserve(SavedItems.Num());
+	for (const FSavedItem& SavedItem : SavedItems)
+	{
+		UItemInstance*& Item = LoadedItems.Add_GetRef(nullptr);
+		if (!SavedItem.ItemClass || !SavedItem.ItemData)
+		{
+			UE_LOG(LogInventory, Warning, TEXT("UInventoryComponent::LoadInventoryFromBytes: skipped an item whose class or data could not be loaded"));
+			continue;
+		}
+
+		/** Affixes were rolled when the item was first created, they are part of the saved state */
+		Item = InternalCreateItem(SavedItem.ItemClass, SavedItem.ItemData, false);
+		if (!Item)
+		{
+			continue;
+		}
+
+		Item->ItemGuid = SavedItem.ItemGuid;
+		UpdateItemView(Item);
+
+		FMemoryReader StateReader(SavedItem.StateBytes);
+		Item->SerializeInstanceState(StateReader);
+	}
+
+	for (const TPair<UItemData*, int32>& SavedStack : SavedStacks)
+	{
+		UItemData* ItemData = SavedStack.Key;
+		int32 Count = SavedStack.Value;
+		if (!ItemData || !ItemData->IsStackable())
+		{
+			continue;
+		}
+
+		/** MaxStackSize may have been lowered since the snapshot was taken */
+		while (Count > 0)
+		{
+			if (GetNumFreeStacks() <= 0)
+			{
+				UE_LOG(LogInventory, Warning, TEXT("UInventoryComponent::LoadInventoryFromBytes: %s is at its stack limit, dropped %d units of %s"), *GetName(), Count, *ItemData->GetName());
+				break;
+			}
+
+			const int32 StackCount = FMath::Min(Count, ItemData->MaxStackSize);
+			InternalAddStack(ItemData, StackCount);
+			Count -= StackCount;
+		}
+	}
+
+	/** A layout that does not fit is the subclass's to handle, the items are loaded either way */
+	FMemoryReader LayoutReader(LayoutBytes);
+	LoadItemLayout(LayoutReader, LoadedItems);
+
+	MARK_PROPERTY_DIRTY_FROM_NAME(UInventoryComponent, Items, this);
+	MARK_PROPERTY_DIRTY_FROM_NAME(UInventoryComponent, Stacks, this);
+
+	if (Journal)
+	{
+		Journal->RequestSnapshot(this);
+	}
+
+	return true;
+}
+
+void UInventoryComponent::InternalClearInventory()
+{
+	TArray<UItemInstance*> AllItems = GetItemInstances();
+	RemoveItemsFromInventory(AllItems);
+
+	for (int32 StackIndex = Stacks.Entries.Num() - 1; StackIndex >= 0; --StackIndex)
+	{
+		InternalRemoveStackAt(StackIndex);
+	}
+	MARK_PROPERTY_DIRTY_FROM_NAME(UInventoryComponent, Stacks, this);
+}
+
+bool UInventoryComponent::InternalRemoveItem(UItemInstance* InItemInstance, bool bDestroyItemActor)
+{
+	int32 EntryIndex = INDEX_NONE;
+	if (!InItemInstance || !ItemEntryIndices.RemoveAndCopyValue(InItemInstance, EntryIndex))
+	{
+		return false;
+	}
+
+	PreItemRemoved(InItemInstance);
+	OnItemLeaving.Broadcast(InItemInstance);
+
+	/** Not GetSpawnQueue, requests may have been queued before bDeferItemActorRequests was turned off */
+	if (UItemActorSpawnQueue* SpawnQueue = GetWorld() ? GetWorld()->GetSubsystem<UItemActorSpawnQueue>() : nullptr)
+	{
+		SpawnQueue->CancelRequest(InItemInstance);
+	}
+
+	if (SpawnedItemActors.Remove(InItemInstance) > 0 && bDestroyItemActor)
+	{
+		/** Bypass CanDestroyItemActor, the actor must not outlive its instance */
+		InItemInstance->InternalDestroyItemActor();
+	}
+
+	LockedItemActors.Remove(InItemInstance);
+
+	if (VisibleEntryIndices.Contains(InItemInstance))
+	{
+		InternalSetItemVisible(InItemInstance, false);
+	}
+
+	RemoveReplicatedSubObject(InItemInstance);
+
+	UnindexItem(Items.Entries[EntryIndex]);
+
+	/** Swap-remove, the last entry takes the removed entry's place */
+	const int32 LastIndex = Items.Entries.Num() - 1;
+	if (EntryIndex != LastIndex)
+	{
+		ItemEntryIndices.FindChecked(Items.Entries[LastIndex].Instance) = EntryIndex;
+	}
+	Items.Entries.RemoveAtSwap(EntryIndex, 1, EAllowShrinking::No);
+	Items.MarkArrayDirty();
+
+	return true;
+}
+
+int32 UInventoryComponent::AddStackableItem(UItemData* ItemData, int32 Count)
+{
+	if (!ItemData || Count <= 0)
+	{
+		return 0;
+	}
+
+	if (!ItemData->IsStackable())
+	{
+		UE_LOG(LogInventory, Warning, TEXT("UInventoryComponent::AddStackableItem: %s is not stackable, use CreateItemInInventory instead"), *ItemData->GetName());
+		return 0;
+	}
+
+	// If called on client, make a server rpc to ServerAddStackableItem
+	if (!GetOwner()->HasAuthority())
+	{
+		ServerAddStackableItem(ItemData->GetItemDataId(), Count);
+		return 0;
+	}
+
+	int32 Remaining = Count;
+
+	/** Top up existing stacks first */
+	for (FInventoryStackEntry& Stack : Stacks.Entries)
+	{
+		if (Remaining == 0)
+		{
+			break;
+		}
+
+		if (Stack.ItemData != ItemData || Stack.Count >= ItemData->MaxStackSize)
+		{
+			continue;
+		}
+
+		const int32 Added = FMath::Min(Remaining, ItemData->MaxStackSize - Stack.Count);
+		Stack.Count += Added;
+		Remaining -= Added;
+		MarkStackDirty(Stack);
+	}
+
+	/** Then open new stacks for whatever is left, as far as the stack limit allows */
+	for (int32 FreeStacks = GetNumFreeStacks(); Remaining > 0 && FreeStacks > 0; --FreeStacks)
+	{
+		const int32 Added = FMath::Min(Remaining, ItemData->MaxStackSize);
+		InternalAddStack(ItemData, Added);
+		Remaining -= Added;
+	}
+
+	if (Remaining > 0)
+	{
+		UE_LOG(LogInventory, Warning, TEXT("UInventoryComponent::AddStackableItem: %s is at its stack limit, %d units of %s were not added"), *GetName(), Remaining, *ItemData->GetName());
+	}
+
+	MARK_PROPERTY_DIRTY_FROM_NAME(UInventoryComponent, Stacks, this);
+	JournalStackDelta(ItemData, Count - Remaining);
+
+	return Count - Remaining;
+}
+
+void UInventoryComponent::ServerAddStackableItem_Implementation(FItemDataId ItemDataId, int32 Count)
+{
+	if (!bAllowClientItemCreation || Count <= 0 || !ConsumeRpcTokens(TEXT("ServerAddStackableItem")))
+	{
+		return;
+	}
+
+	UItemDataRegistry* Registry = UItemDataRegistry::Get();
+	UItemData* ItemData = Registry && Registry->IsRegistered(ItemDataId) ? Registry->ResolveItemData(ItemDataId) : nullptr;
+	if (!ItemData)
+	{
+		UE_LOG(LogInventory, Warning, TEXT("ServerAddStackableItem: unknown item data id %s"), *ItemDataId.ToString());
+		return;
+	}
+
+	AddStackableItem(ItemData, Count);
+}
+
+int32 UInventoryComponent::RemoveStackableItem(UItemData* ItemData, int32 Count)
+{
+	if (!GetOwner()->HasAuthority() || !ItemData || Count <= 0)
+	{
+		return 0;
+	}
+
+	int32 Remaining = Count;
+
+	while (Remaining > 0)
+	{
+		/** Take from the smallest stack so partial stacks get consolidated away */
+		int32 SmallestIndex = INDEX_NONE;
+		for (int32 Index = 0; Index < Stacks.Entries.Num(); ++Index)
+		{
+			const FInventoryStackEntry& Stack = Stacks.Entries[Index];
+			if (Stack.ItemData == ItemData && (SmallestIndex == INDEX_NONE || Stack.Count < Stacks.Entries[SmallestIndex].Count))
+			{
+				SmallestIndex = Index;
+			}
+		}
+
+		if (SmallestIndex == INDEX_NONE)
+		{
+			break;
+		}
+
+		FInventoryStackEntry& Stack = Stacks.Entries[SmallestIndex];
+		const int32 Removed = FMath::Min(Remaining, Stack.Count);
+		Remaining -= Removed;
+
+		if (Removed == Stack.Count)
+		{
+			InternalRemoveStackAt(SmallestIndex);
+		}
+		else
+		{
+			Stack.Count -= Removed;
+			MarkStackDirty(Stack);
+		}
+	}
+
+	MARK_PROPERTY_DIRTY_FROM_NAME(UInventoryComponent, Stacks, this);
+	JournalStackDelta(ItemData, Remaining - Count);
+
+	return Count - Remaining;
+}
+
+void UInventoryComponent::ServerSplitStack_Implementation(int32 StackId, int32 SplitCount)
+{
+	if (!ConsumeRpcTokens(TEXT("ServerSplitStack")))
+	{
+		return;
+	}
+
+	const int32 StackIndex = FindStackIndex(StackId);
+	if (StackIndex == INDEX_NONE)
+	{
+		UE_LOG(LogInventory, Warning, TEXT("Tried to split stack %d, but it does not exist"), StackId);
+		return;
+	}
+
+	FInventoryStackEntry& Stack = Stacks.Entries[StackIndex];
+	if (SplitCount <= 0 || SplitCount >= Stack.Count)
+	{
+		UE_LOG(LogInventory, Warning, TEXT("Tried to split %d units off stack %d, which has %d units"), SplitCount, StackId, Stack.Count);
+		return;
+	}
+
+	if (GetNumFreeStacks() <= 0)
+	{
+		UE_LOG(LogInventory, Warning, TEXT("Tried to split stack %d, but %s is at its stack limit"), StackId, *GetName());
+		return;
+	}
+
+	Stack.Count -= SplitCount;
+	MarkStackDirty(Stack);
+
+	/** Stack may be invalidated by adding the new entry */
+	UItemData* ItemData = Stack.ItemData;
+	InternalAddStack(ItemData, SplitCount);
+
+	MARK_PROPERTY_DIRTY_FROM_NAME(UInventoryComponent, Stacks, this);
+}
+
+void UInventoryComponent::ServerMergeStacks_Implementation(int32 SourceStackId, int32 TargetStackId)
+{
+	if (!ConsumeRpcTokens(TEXT("ServerMergeStacks")))
+	{
+		return;
+	}
+
+	const int32 SourceIndex = FindStackIndex(SourceStackId);
+	const int32 TargetIndex = FindStackIndex(TargetStackId);
+	if (SourceIndex == INDEX_NONE || TargetIndex == INDEX_NONE || SourceIndex == TargetIndex)
+	{
+		UE_LOG(LogInventory, Warning, TEXT("Tried to merge stack %d into %d, but one of them does not exist"), SourceStackId, TargetStackId);
+		return;
+	}
+
+	FInventoryStackEntry& Source = Stacks.Entries[SourceIndex];
+	FInventoryStackEntry& Target = Stacks.Entries[TargetIndex];
+	if (Source.ItemData != Target.ItemData)
+	{
+		UE_LOG(LogInventory, Warning, TEXT("Tried to merge stack %d into %d, but they hold different items"), SourceStackId, TargetStackId);
+		return;
+	}
+
+	const int32 Moved = FMath::Min(Source.Count, Target.ItemData->MaxStackSize - Target.Count);
+	if (Moved <= 0)
+	{
+		return;
+	}
+
+	Target.Count += Moved;
+	MarkStackDirty(Target);
+
+	Source.Count -= Moved;
+	if (Source.Count == 0)
+	{
+		InternalRemoveStackAt(SourceIndex);
+	}
+	else
+	{
+		MarkStackDirty(Source);
+	}
+
+	MARK_PROPERTY_DIRTY_FROM_NAME(UInventoryComponent, Stacks, this);
+}
+
+UItemInstance* UInventoryComponent::PromoteStackToInstance(int32 StackId, TSubclassOf<UItemInstance> ItemClass)
+{
+	if (!GetOwner()->HasAuthority())
+	{
+		return nullptr;
+	}
+
+	const int32 StackIndex = FindStackIndex(StackId);
+	if (StackIndex == INDEX_NONE)
+	{
+		return nullptr;
+	}
+
+	UItemData* ItemData = Stacks.Entries[StackIndex].ItemData;
+
+	if (!IsValidItemRequest(ItemClass, ItemData))
+	{
+		UE_LOG(LogInventory, Warning, TEXT("UInventoryComponent::PromoteStackToInstance: %s can't be created as %s"), *GetNameSafe(ItemData), *GetNameSafe(ItemClass));
+		return nullptr;
+	}
+
+	if (!CanAddItem(ItemData))
+	{
+		return nullptr;
+	}
+
+	/** The unit only leaves the stack once it exists as an instance, so a failed create loses nothing */
+	UItemInstance* Item = InternalCreateItem(ItemClass, ItemData);
+	if (!Item)
+	{
+		return nullptr;
+	}
+	MARK_PROPERTY_DIRTY_FROM_NAME(UInventoryComponent, Items, this);
+
+	FInventoryStackEntry& Stack = Stacks.Entries[StackIndex];
+	if (--Stack.Count == 0)
+	{
+		InternalRemoveStackAt(StackIndex);
+	}
+	else
+	{
+		MarkStackDirty(Stack);
+	}
+	JournalStackDelta(ItemData, -1);
+
+	MARK_PROPERTY_DIRTY_FROM_NAME(UInventoryComponent, Stacks, this);
+
+	return Item;
+}
+
+int32 UInventoryComponent::GetNumStacksNeeded(const UItemData* ItemData, int32 Count) const
+{
+	if (!ItemData || !ItemData->IsStackable() || Count <= 0)
+	{
+		return 0;
+	}
+
+	int32 Remaining = Count;
+	for (const FInventoryStackEntry& Stack : Stacks.Entries)
+	{
+		if (Stack.ItemData == ItemData)
+		{
+			Remaining -= FMath::Max(ItemData->MaxStackSize - Stack.Count, 0);
+		}
+	}
+
+	return Remaining > 0 ? FMath::DivideAndRoundUp(Remaining, ItemData->MaxStackSize) : 0;
+}
+
+int32 UInventoryComponent::GetNumFreeStacks() const
+{
+	const int32 MaxStacks = GetMaxStacks();
+	return MaxStacks == INDEX_NONE ? MAX_int32 : FMath::Max(MaxStacks - Stacks.Entries.Num(), 0);
+}
+
+int32 UInventoryComponent::GetStackableItemCount(const UItemData* ItemData) const
+{
+	INVENTORY_SCOPE(STAT_Inventory_Lookup);
+
+	const int32* Count = StackCountByData.Find(ItemData);
+	return Count ? *Count : 0;
+}
+
+int32 UInventoryComponent::FindStackIndex(int32 StackId) const
+{
+	return Stacks.Entries.IndexOfByPredicate([StackId](const FInventoryStackEntry& Stack) { return Stack.StackId == StackId; });
+}
+
+FInventoryStackEntry& UInventoryComponent::InternalAddStack(UItemData* ItemData, int32 Count)
+{
+	FInventoryStackEntry& Stack = Stacks.Entries.AddDefaulted_GetRef();
+	Stack.StackId = NextStackId++;
+	Stack.ItemDataId = ItemData->GetItemDataId();
+	Stack.ItemData = ItemData;
+	Stack.Count = Count;
+	MarkStackDirty(Stack);
+
+	return Stack;
+}
+
+void UInventoryComponent::InternalRemoveStackAt(int32 StackIndex)
+{
+	UnindexStack(Stacks.Entries[StackIndex]);
+	RemoveStackView(Stacks.Entries[StackIndex].StackId);
+	Stacks.Entries.RemoveAtSwap(StackIndex, 1, EAllowShrinking::No);
+	Stacks.MarkArrayDirty();
+}
+
+void UInventoryComponent::MarkStackDirty(FInventoryStackEntry& Stack)
+{
+	Stacks.MarkItemDirty(Stack);
+	SyncStackIndex(Stack);
+}
+
+const TArray<UItemInstance*>& UInventoryComponent::FindItemsByData(const UItemData* ItemData) const
+{
+	INVENTORY_SCOPE(STAT_Inventory_Lookup);
+
+	static const TArray<UItemInstance*> Empty;
+	const FInventoryItemBucket* Found = ItemsByData.Find(ItemData);
+	return Found ? Found->Items : Empty;
+}
+
+const TArray<UItemInstance*>& UInventoryComponent::FindItemsByClass(TSubclassOf<UItemInstance> ItemClass) const
+{
+	INVENTORY_SCOPE(STAT_Inventory_Lookup);
+
+	static const TArray<UItemInstance*> Empty;
+	const FInventoryItemBucket* Found = ItemsByClass.Find(ItemClass.Get());
+	return Found ? Found->Items : Empty;
+}
+
+const TArray<UItemInstance*>& UInventoryComponent::FindItemsByTag(FGameplayTag Tag) const
+{
+	INVENTORY_SCOPE(STAT_Inventory_Lookup);
+
+	static const TArray<UItemInstance*> Empty;
+	const FInventoryItemBucket* Found = ItemsByTag.Find(Tag);
+	return Found ? Found->Items : Empty;
+}
+
+int32 UInventoryComponent::GetItemCountByData(const UItemData* ItemData) const
+{
+	return FindItemsByData(ItemData).Num() + GetStackableItemCount(ItemData);
+}
+
+void UInventoryComponent::SyncItemIndex(FInventoryItemEntry& Entry)
+{
+	const UItemData* Data = Entry.Instance ? Entry.Instance->Data.Get() : nullptr;
+	if (Entry.IndexedInstance == Entry.Instance && Entry.IndexedData == Data)
+	{
+		return;
+	}
+
+	RemoveFromIndices(Entry.IndexedInstance, Entry.IndexedData);
+	AddToIndices(Entry.Instance);
+
+	/** Same instance with data that resolved late keeps its view, and its place in the view list */
+	if (Entry.IndexedInstance != Entry.Instance)
+	{
+		RemoveItemView(Entry.IndexedInstance);
+	}
+	if (Entry.Instance)
+	{
+		UpdateItemView(Entry.Instance);
+	}
+
+	Entry.IndexedInstance = Entry.Instance;
+	Entry.IndexedData = Data;
+}
+
+void UInventoryComponent::UnindexItem(FInventoryItemEntry& Entry)
+{
+	RemoveFromIndices(Entry.IndexedInstance, Entry.IndexedData);
+	RemoveItemView(Entry.IndexedInstance);
+	Entry.IndexedInstance = nullptr;
+	Entry.IndexedData = nullptr;
+}
+
+void UInventoryComponent::HandleItemDataReplicated(UItemInstance* InItemInstance)
+{
+	/** Clients don't keep entry indices, but this only runs once or twice per item */
+	for (FInventoryItemList* List : { &Items, &VisibleItems })
+	{
+		for (FInventoryItemEntry& Entry : List->Entries)
+		{
+			if (Entry.Instance == InItemInstance)
+			{
+				SyncItemIndex(Entry);
+			}
+		}
+	}
+}
+
+void UInventoryComponent::SyncStackIndex(FInventoryStackEntry& Stack)
+{
+	if (Stack.IndexedData == Stack.ItemData && Stack.IndexedCount == Stack.Count)
+	{
+		return;
+	}
+
+	UnindexStack(Stack);
+
+	if (Stack.ItemData)
+	{
+		StackCountByData.FindOrAdd(Stack.ItemData.Get()) += Stack.Count;
+		Stack.IndexedData = Stack.ItemData.Get();
+		Stack.IndexedCount = Stack.Count;
+
+		OnItemCountChanged.Broadcast(this, Stack.IndexedData);
+	}
+
+	UpdateStackView(Stack);
+}
+
+void UInventoryComponent::ResolveStackItemData(FInventoryStackEntry& Stack)
+{
+	if (Stack.ItemData && Stack.ItemData->GetItemDataId() == Stack.ItemDataId)
+	{
+		return;
+	}
+
+	UItemDataRegistry* Registry = UItemDataRegistry::Get();
+	Stack.ItemData = Registry ? Registry->ResolveItemData(Stack.ItemDataId) : nullptr;
+}
+
+void UInventoryComponent::UnindexStack(FInventoryStackEntry& Stack)
+{
+	if (Stack.IndexedData)
+	{
+		int32& Count = StackCountByData.FindChecked(Stack.IndexedData);
+		Count -= Stack.IndexedCount;
+		if (Count <= 0)
+		{
+			StackCountByData.Remove(Stack.IndexedData);
+		}
+
+		OnItemCountChanged.Broadcast(this, Stack.IndexedData);
+	}
+
+	Stack.IndexedData = nullptr;
+	Stack.IndexedCount = 0;
+}
+
+void UInventoryComponent::AddToIndices(UItemInstance* InItemInstance)
+{
+	if (!InItemInstance)
+	{
+		return;
+	}
+
+	INC_DWORD_STAT(STAT_Inventory_ItemsInInventories);
+
+	const UItemData* ItemData = InItemInstance->Data.Get();
+	ItemsByData.FindOrAdd(ItemData).Add(InItemInstance);
+	OnItemCountChanged.Broadcast(this, ItemData);
+
+	/** The item only soft references its actor class, keep it loaded for as long as items of this data are here */
+	if (ItemData && !RetainedActorClassData.Contains(ItemData))
+	{
+		if (UItemAssetLoader* AssetLoader = UItemAssetLoader::Get())
+		{
+			RetainedActorClassData.Add(ItemData);
+			AssetLoader->RetainItemActorClass(ItemData);
+		}
+	}
+
+	/** Not UItemInstance itself, that bucket would hold every item */
+	for (const UClass* Class = InItemInstance->GetClass(); Class && Class != UItemInstance::StaticClass(); Class = Class->GetSuperClass())
+	{
+		ItemsByClass.FindOrAdd(Class).Add(InItemInstance);
+	}
+
+	if (InItemInstance->Data)
+	{
+		for (const FGameplayTag& Tag : InItemInstance->Data->ItemTags.GetGameplayTagParents())
+		{
+			ItemsByTag.FindOrAdd(Tag).Add(InItemInstance);
+		}
+	}
+}
+
+void UInventoryComponent::RemoveFromIndices(UItemInstance* InItemInstance, const UItemData* IndexedData)
+{
+	if (!InItemInstance)
+	{
+		return;
+	}
+
+	DEC_DWORD_STAT(STAT_Inventory_ItemsInInventories);
+
+	if (FInventoryItemBucket* DataItems = ItemsByData.Find(IndexedData))
+	{
+		DataItems->Remove(InItemInstance);
+
+		if (DataItems->Items.Num() == 0 && RetainedActorClassData.Remove(IndexedData) > 0)
+		{
+			if (UItemAssetLoader* AssetLoader = UItemAssetLoader::Get())
+			{
+				AssetLoader->ReleaseItemActorClass(IndexedData);
+			}
+		}
+	}
+	OnItemCountChanged.Broadcast(this, IndexedData);
+
+	for (const UClass* Class = InItemInstance->GetClass(); Class && Class != UItemInstance::StaticClass(); Class = Class->GetSuperClass())
+	{
+		if (FInventoryItemBucket* ClassItems = ItemsByClass.Find(Class))
+		{
+			ClassItems->Remove(InItemInstance);
+		}
+	}
+
+	if (IndexedData)
+	{
+		for (const FGameplayTag& Tag : IndexedData->ItemTags.GetGameplayTagParents())
+		{
+			if (FInventoryItemBucket* TagItems = ItemsByTag.Find(Tag))
+			{
+				TagItems->Remove(InItemInstance);
+			}
+		}
+	}
+}
+
+bool UInventoryComponent::ShouldKeepItemViews() const
+{
+	/** Nothing draws them on a dedicated server */
+	return !IsNetMode(NM_DedicatedServer);
+}
+
+void UInventoryComponent::FillItemView(FInventoryItemView& View, UItemData* ItemData)
+{
+	View.ItemData = ItemData;
+	View.ItemDataId = ItemData ? ItemData->GetItemDataId() : FItemDataId();
+	View.Value = ItemData ? ItemData->Value : 0;
+}
+
+void UInventoryComponent::UpdateItemView(UItemInstance* InItemInstance)
+{
+	if (!ShouldKeepItemViews())
+	{
+		return;
+	}
+
+	FInventoryItemView* View = nullptr;
+	if (const int32* ViewIndex = ItemViewIndices.Find(InItemInstance))
+	{
+		View = &ItemViews[*ViewIndex];
+	}
+	else
+	{
+		ItemViewIndices.Add(InItemInstance, ItemViews.Num());
+		View = &ItemViews.AddDefaulted_GetRef();
+		View->Item = InItemInstance;
+	}
+
+	View->ItemGuid = InItemInstance->GetItemGuid();
+	FillItemView(*View, InItemInstance->Data.Get());
+
+	MarkItemViewsChanged();
+}
+
+void UInventoryComponent::RemoveItemView(const UItemInstance* InItemInstance)
+{
+	int32 ViewIndex = INDEX_NONE;
+	if (ItemViewIndices.RemoveAndCopyValue(InItemInstance, ViewIndex))
+	{
+		RemoveItemViewAt(ViewIndex);
+	}
+}
+
+void UInventoryComponent::UpdateStackView(const FInventoryStackEntry& Stack)
+{
+	if (!ShouldKeepItemViews())
+	{
+		return;
+	}
+
+	/** A client may not have resolved the data yet, the stack shows up once it has */
+	if (!Stack.ItemData)
+	{
+		RemoveStackView(Stack.StackId);
+		return;
+	}
+
+	FInventoryItemView* View = nullptr;
+	if (const int32* ViewIndex = StackViewIndices.Find(Stack.StackId))
+	{
+		View = &ItemViews[*ViewIndex];
+	}
+	else
+	{
+		StackViewIndices.Add(Stack.StackId, ItemViews.Num());
+		View = &ItemViews.AddDefaulted_GetRef();
+		View->StackId = Stack.StackId;
+	}
+
+	if (View->ItemDataId != Stack.ItemData->GetItemDataId())
+	{
+		FillItemView(*View, Stack.ItemData);
+	}
+	View->Count = Stack.Count;
+
+	MarkItemViewsChanged();
+}
+
+void UInventoryComponent::RemoveStackView(int32 StackId)
+{
+	int32 ViewIndex = INDEX_NONE;
+	if (StackViewIndices.RemoveAndCopyValue(StackId, ViewIndex))
+	{
+		RemoveItemViewAt(ViewIndex);
+	}
+}
+
+void UInventoryComponent::RemoveItemViewAt(int32 ViewIndex)
+{
+	ItemViews.RemoveAtSwap(ViewIndex, 1, EAllowShrinking::No);
+
+	if (ItemViews.IsValidIndex(ViewIndex))
+	{
+		const FInventoryItemView& Moved = ItemViews[ViewIndex];
+		if (Moved.IsStack())
+		{
+			StackViewIndices.FindChecked(Moved.StackId) = ViewIndex;
+		}
+		else
+		{
+			ItemViewIndices.FindChecked(Moved.Item.Get()) = ViewIndex;
+		}
+	}
+
+	MarkItemViewsChanged();
+}
+
+void UInventoryComponent::MarkItemViewsChanged()
+{
+	++ItemViewsVersion;
+
+	/** Only the first change since the last broadcast schedules one, the rest of the frame (e.g., a whole replication batch) joins it */
+	if (ItemViewsVersion - 1 != BroadcastItemViewsVersion)
+	{
+		return;
+	}
+
+	UWorld* World = GetWorld();
+	if (!World)
+	{
+		BroadcastItemViewsChanged();
+		return;
+	}
+
+	World->GetTimerManager().SetTimerForNextTick(FTimerDelegate::CreateWeakLambda(this, [this]()
+	{
+		BroadcastItemViewsChanged();
+	}));
+}
+
+void UInventoryComponent::BroadcastItemViewsChanged()
+{
+	BroadcastItemViewsVersion = ItemViewsVersion;
+	OnItemViewsChanged.Broadcast(this);
+}
+
+TArray<FInventoryItemView> UInventoryComponent::QueryItemViews(const FInventoryViewQuery& Query, int32 PageIndex, int32 PageSize, int32& OutNumResults) const
+{
+	const TConstArrayView<int32> PageIndices = QueryItemViewIndices(Query, PageIndex, PageSize, OutNumResults);
+
+	TArray<FInventoryItemView> Page;
+	Page.Reserve(PageIndices.Num());
+	for (const int32 ViewIndex : PageIndices)
+	{
+		Page.Add(ItemViews[ViewIndex]);
+	}
+	return Page;
+}
+
+TConstArrayView<int32> UInventoryComponent::QueryItemViewIndices(const FInventoryViewQuery& Query, int32 PageIndex, int32 PageSize, int32& OutNumResults) const
+{
+	INVENTORY_SCOPE(STAT_Inventory_Lookup);
+
+	if (CachedViewVersion != ItemViewsVersion || CachedViewQuery != Query)
+	{
+		CachedViewOrder.Reset();
+		for (int32 ViewIndex = 0; ViewIndex < ItemViews.Num(); ++ViewIndex)
+		{
+			const FInventoryItemView& View = ItemViews[ViewIndex];
+			if ((!Query.bIncludeStacks && View.IsStack())
+				|| (!Query.NameFilter.IsEmpty() && !InventoryItemViews::GetSortName(View).Contains(Query.NameFilter, ESearchCase::IgnoreCase))
+				|| (!Query.TagQuery.IsEmpty() && !Query.TagQuery.Matches(InventoryItemViews::GetItemTags(View))))
+			{
+				continue;
+			}
+			CachedViewOrder.Add(ViewIndex);
+		}
+
+		if (Query.SortBy != EInventoryViewSort::None)
+		{
+			auto Compare = [](auto A, auto B) -> int32 { return A < B ? -1 : (B < A ? 1 : 0); };
+
+			CachedViewOrder.Sort([this, &Query, &Compare](int32 IndexA, int32 IndexB)
+			{
+				const FInventoryItemView& A = ItemViews[IndexA];
+				const FInventoryItemView& B = ItemViews[IndexB];
+
+				int32 Order = 0;
+				switch (Query.SortBy)
+				{
+				case EInventoryViewSort::Value:      Order = Compare(A.Value, B.Value); break;
+				case EInventoryViewSort::TotalValue: Order = Compare(A.Value * A.Count, B.Value * B.Count); break;
+				case EInventoryViewSort::Count:      Order = Compare(A.Count, B.Count); break;
+				default: break;
+				}
+
+				/** Ties are broken by name, then data, stack id and item guid, which are the same on every machine and across queries */
+				if (Order == 0)
+				{
+					Order = InventoryItemViews::GetSortName(A).Compare(InventoryItemViews::GetSortName(B), ESearchCase::IgnoreCase);
+				}
+				if (Order == 0)
+				{
+					Order = Compare(A.ItemDataId.GetValue(), B.ItemDataId.GetValue());
+				}
+				if (Order == 0)
+				{
+					Order = Compare(A.StackId, B.StackId);
+				}
+				if (Order == 0)
+				{
+					Order = Compare(A.ItemGuid, B.ItemGuid);
+				}
+
+				return Query.bDescending ? Order > 0 : Order < 0;
+			});
+		}
+
+		CachedViewQuery = Query;
+		CachedViewVersion = ItemViewsVersion;
+	}
+
+	OutNumResults = CachedViewOrder.Num();
+
+	int32 First = 0;
+	int32 NumInPage = OutNumResults;
+	if (PageSize > 0)
+	{
+		const int64 PageStart = static_cast<int64>(FMath::Max(PageIndex, 0)) * PageSize;
+		First = static_cast<int32>(FMath::Min<int64>(PageStart, OutNumResults));
+		NumInPage = FMath::Min(PageSize, OutNumResults - First);
+	}
+
+	return TConstArrayView<int32>(CachedViewOrder.GetData() + First, NumInPage);
+}
+
+void UInventoryComponent::ServerSpawnItemActor_Implementation(UItemInstance* InItemInstance)
+{
+	if (!ConsumeRpcTokens(TEXT("ServerSpawnItemActor")))
+	{
+		return;
+	}
+
+	if (!ContainsItem(InItemInstance))
+	{
+		UE_LOG(LogInventory, Warning, TEXT("Tried to spawn an ItemActor for an instance that is not in this inventory"));
+		return;
+	}
+
+	if (IsItemActorSpawned(InItemInstance))
+	{
+		UE_LOG(LogInventory, Warning, TEXT("Tried to spawn an ItemActor, but the instance's ItemActor is already spawned"));
+		return;
+	}
+
+	if (UItemActorSpawnQueue* SpawnQueue = GetSpawnQueue())
+	{
+		SpawnQueue->EnqueueRequest(this, InItemInstance, EItemActorRequestType::Spawn);
+		return;
+	}
+
+	ExecuteSpawnItemActor(InItemInstance);
+}
+
+
+void UInventoryComponent::ServerDestroyItemActor_Implementation(UItemInstance* InItemInstance)
+{
+	if (!ConsumeRpcTokens(TEXT("ServerDestroyItemActor")))
+	{
+		return;
+	}
+
+	if (!ContainsItem(InItemInstance))
+	{
+		UE_LOG(LogInventory, Warning, TEXT("Tried to destroy an ItemActor for an instance that is not in this inventory"));
+		return;
+	}
+
+	if (!IsItemActorSpawned(InItemInstance))
+	{
+		UE_LOG(LogInventory, Warning, TEXT("Tried to destroy an ItemActor, but the instance had no ItemActor spawned"));
+		return;
+	}
+
+	if (IsItemActorLocked(InItemInstance))
+	{
+		UE_LOG(LogInventory, Warning, TEXT("Tried to destroy the ItemActor of a locked instance (e.g., an equipped item)"));
+		return;
+	}
+
+	if (UItemActorSpawnQueue* SpawnQueue = GetSpawnQueue())
+	{
+		SpawnQueue->EnqueueRequest(this, InItemInstance, EItemActorRequestType::Destroy);
+		return;
+	}
+
+	ExecuteDestroyItemActor(InItemInstance);
+}
+
+void UInventoryComponent::ExecuteSpawnItemActor(UItemInstance* InItemInstance)
+{
+	INVENTORY_SCOPE(STAT_Inventory_SpawnItemActor);
+
+	if (SpawnedItemActors.Contains(InItemInstance) || !ItemEntryIndices.Contains(InItemInstance))
+	{
+		return;
+	}
+
+	AActor* SpawnedItemActor = InItemInstance->TrySpawnItemActor();
+
+	if (!SpawnedItemActor)
+	{
+		return;
+	}
+
+	SpawnedItemActors.Add(InItemInstance);
+	JournalItemOp(EInventoryJournalOp::SpawnActor, InItemInstance);
+
+	/** The actor is in the world, so other players need the instance too */
+	SetItemVisibleToOthers(InItemInstance, true);
+}
+
+void UInventoryComponent::ExecuteDestroyItemActor(UItemInstance* InItemInstance)
+{
+	INVENTORY_SCOPE(STAT_Inventory_DestroyItemActor);
+
+	if (!SpawnedItemActors.Contains(InItemInstance))
+	{
+		return;
+	}
+
+	InItemInstance->TryDestroyItemActor();
+
+	SpawnedItemActors.Remove(InItemInstance);
+	JournalItemOp(EInventoryJournalOp::DestroyActor, InItemInstance);
+
+	/** A locked item is still shown without its actor (e.g., equipped), others keep seeing it */
+	if (!IsItemActorLocked(InItemInstance))
+	{
+		SetItemVisibleToOthers(InItemInstance, false);
+	}
+}
+
+void UInventoryComponent::RequestItemActorSpawned(UItemInstance* InItemInstance, bool bSpawned)
+{
+	if (!InItemInstance)
+	{
+		return;
+	}
+
+	if (GetOwner()->HasAuthority())
+	{
+		/** Server side gameplay code, not charged against the owner's rpc limit */
+		if (ContainsItem(InItemInstance))
+		{
+			ApplyItemActorRequest(InItemInstance, bSpawned, GetSpawnQueue());
+		}
+		return;
+	}
+
+	/** Only the last request per item matters, the first one this frame schedules the flush */
+	if (PendingItemActorRequests.Num() == 0)
+	{
+		GetWorld()->GetTimerManager().SetTimerForNextTick(FTimerDelegate::CreateWeakLambda(this, [this]()
+		{
+			FlushItemActorRequests();
+		}));
+	}
+	PendingItemActorRequests.Add(InItemInstance, bSpawned);
+}
+
+void UInventoryComponent::FlushItemActorRequests()
+{
+	TArray<FItemActorSpawnRequest> Requests;
+	Requests.Reserve(FMath::Min(PendingItemActorRequests.Num(), MaxRequestsPerRpc));
+
+	for (const TPair<TWeakObjectPtr<UItemInstance>, bool>& Pair : PendingItemActorRequests)
+	{
+		if (UItemInstance* Item = Pair.Key.Get())
+		{
+			FItemActorSpawnRequest& Request = Requests.AddDefaulted_GetRef();
+			Request.Item = Item;
+			Request.bSpawned = Pair.Value;
+
+			if (Requests.Num() == MaxRequestsPerRpc)
+			{
+				ServerSetItemActorsSpawned(Requests);
+				Requests.Reset();
+			}
+		}
+	}
+	PendingItemActorRequests.Reset();
+
+	if (Requests.Num() > 0)
+	{
+		ServerSetItemActorsSpawned(Requests);
+	}
+}
+
+void UInventoryComponent::ServerSetItemActorsSpawned_Implementation(const TArray<FItemActorSpawnRequest>& Requests)
+{
+	if (!ConsumeBatchRpcTokens(TEXT("ServerSetItemActorsSpawned"), Requests.Num()))
+	{
+		return;
+	}
+
+	UItemActorSpawnQueue* SpawnQueue = GetSpawnQueue();
+
+	for (const FItemActorSpawnRequest& Request : Requests)
+	{
+		/** Locked items (e.g., equipped ones) keep their actor until the server unlocks them */
+		if (ContainsItem(Request.Item) && (Request.bSpawned || !IsItemActorLocked(Request.Item)))
+		{
+			ApplyItemActorRequest(Request.Item, Request.bSpawned, SpawnQueue);
+		}
+	}
+}
+
+void UInventoryComponent::ApplyItemActorRequest(UItemInstance* InItemInstance, bool bSpawned, UItemActorSpawnQueue* SpawnQueue)
+{
+	/** Requests describe the desired state, so ones that are already satisfied are skipped silently */
+	if (IsItemActorSpawned(InItemInstance) == bSpawned)
+	{
+		return;
+	}
+
+	if (SpawnQueue)
+	{
+		SpawnQueue->EnqueueRequest(this, InItemInstance, bSpawned ? EItemActorRequestType::Spawn : EItemActorRequestType::Destroy);
+	}
+	else if (bSpawned)
+	{
+		ExecuteSpawnItemActor(InItemInstance);
+	}
+	else
+	{
+		ExecuteDestroyItemActor(InItemInstance);
+	}
+}
+
+void UInventoryComponent::ServerCraftRecipe_Implementation(UCraftingRecipe* Recipe, int32 Times)
+{
+	/** Each craft consumes and creates items, charge it per craft */
+	if (!ConsumeRpcTokens(TEXT("ServerCraftRecipe"), FMath::Clamp(Times, 1, UCraftingSubsystem::MaxCraftTimes)))
+	{
+		return;
+	}
+
+	if (UCraftingSubsystem* Crafting = GetWorld()->GetSubsystem<UCraftingSubsystem>())
+	{
+		Crafting->Craft(this, Recipe, Times);
+	}
+}
+
+bool UInventoryComponent::ConsumeRpcTokens(const TCHAR* RpcName, float Cost) const
+{
+	const UWorld* World = GetWorld();
+	UInventoryRpcLimiter* Limiter = World ? World->GetSubsystem<UInventoryRpcLimiter>() : nullptr;
+	if (!Limiter)
+	{
+		return true;
+	}
+
+	if (!Limiter->ConsumeTokens(GetOwner()->GetNetConnection(), Cost))
+	{
+		UE_LOG(LogInventory, Verbose, TEXT("%s on %s was rate limited"), RpcName, *GetName());
+		return false;
+	}
+	return true;
+}
+
+bool UInventoryComponent::ConsumeBatchRpcTokens(const TCHAR* RpcName, int32 NumRequests) const
+{
+	/** Well behaved clients split their batches, a bigger one is never worth the work */
+	if (NumRequests > MaxRequestsPerRpc)
+	{
+		UE_LOG(LogInventory, Warning, TEXT("%s on %s dropped a batch of %d requests, at most %d are allowed"), RpcName, *GetName(), NumRequests, MaxRequestsPerRpc);
+		return false;
+	}
+
+	/** One token per request, the whole batch is dropped if the connection can't pay for it */
+	return ConsumeRpcTokens(RpcName, FMath::Max(NumRequests, 1));
+}
+
+bool UInventoryComponent::IsValidItemRequest(TSubclassOf<UItemInstance> ItemClass, const UItemData* ItemData)
+{
+	return ItemData && ItemData->IsCompatibleWith(ItemClass);
+}
+
+bool UInventoryComponent::ContainsItem(const UItemInstance* InItemInstance) const
+{
+	return InItemInstance && ItemEntryIndices.Contains(InItemInstance);
+}
+
+void UInventoryComponent::SetJournalKey(const FString& Key)
+{
+	if (!GetOwner()->HasAuthority() || Key == JournalKey)
+	{
+		return;
+	}
+
+	JournalKey = Key;
+
+	/** The journal starts from a snapshot of what is in the inventory now */
+	if (UInventoryJournal* Journal = GetJournal())
+	{
+		Journal->OpenJournal(Key);
+		Journal->RequestSnapshot(this);
+	}
+}
+
+UInventoryJournal* UInventoryComponent::GetJournal() const
+{
+	if (JournalKey.IsEmpty() || bJournalSuspended || !GetOwner()->HasAuthority())
+	{
+		return nullptr;
+	}
+
+	const UWorld* World = GetWorld();
+	return World ? World->GetSubsystem<UInventoryJournal>() : nullptr;
+}
+
+void UInventoryComponent::JournalItemOp(EInventoryJournalOp Op, UItemInstance* InItemInstance, const UInventoryComponent* Other) const
+{
+	if (UInventoryJournal* Journal = GetJournal())
+	{
+		Journal->RecordItemOp(const_cast<UInventoryComponent*>(this), Op, InItemInstance, Other);
+	}
+}
+
+void UInventoryComponent::JournalStackDelta(const UItemData* ItemData, int32 Delta) const
+{
+	if (UInventoryJournal* Journal = GetJournal())
+	{
+		Journal->RecordStackDelta(const_cast<UInventoryComponent*>(this), ItemData, Delta);
+	}
+}
+
+UItemActorSpawnQueue* UInventoryComponent::GetSpawnQueue() const
+{
+	if (!bDeferItemActorRequests)
+	{
+		return nullptr;
+	}
+
+	const UWorld* World = GetWorld();
+	return World ? World->GetSubsystem<UItemActorSpawnQueue>() : nullptr;
+}
+
+bool UInventoryComponent::IsItemActorSpawned(UItemInstance* InItemInstance) const
+{
+	if (const UItemActorSpawnQueue* SpawnQueue = GetSpawnQueue())
+	{
+		EItemActorRequestType PendingType;
+		if (SpawnQueue->GetPendingRequest(InItemInstance, PendingType))
+		{
+			return PendingType == EItemActorRequestType::Spawn;
+		}
+	}
+
+	if (SpawnedItemActors.Find(InItemInstance))
+	{
+		return true;
+	}
+	return false;
+}
+
+void UInventoryComponent::SetItemVisibleToOthers(UItemInstance* InItemInstance, bool bVisible)
+{
+	if (!GetOwner()->HasAuthority() || !InItemInstance || !ItemEntryIndices.Contains(InItemInstance))
+	{
+		return;
+	}
+
+	if (bVisible == VisibleEntryIndices.Contains(InItemInstance))
+	{
+		return;
+	}
+
+	InternalSetItemVisible(InItemInstance, bVisible);
+}
+
+void UInventoryComponent::SetItemActorLocked(UItemInstance* InItemInstance, bool bLocked)
+{
+	if (!GetOwner()->HasAuthority() || !InItemInstance || !ItemEntryIndices.Contains(InItemInstance))
+	{
+		return;
+	}
+
+	if (bLocked)
+	{
+		LockedItemActors.Add(InItemInstance);
+		SetItemVisibleToOthers(InItemInstance, true);
+	}
+	else
+	{
+		LockedItemActors.Remove(InItemInstance);
+	}
+}
+
+void UInventoryComponent::InternalSetItemVisible(UItemInstance* InItemInstance, bool bVisible)
+{
+	/** Re-register the subobject, the condition of a registered subobject can't be changed in place */
+	RemoveReplicatedSubObject(InItemInstance);
+	AddReplicatedSubObject(InItemInstance, bVisible ? COND_None : COND_OwnerOnly);
+
+	if (bVisible)
+	{
+		VisibleEntryIndices.Add(InItemInstance, VisibleItems.Entries.Num());
+
+		FInventoryItemEntry& Entry = VisibleItems.Entries.AddDefaulted_GetRef();
+		Entry.Instance = InItemInstance;
+		VisibleItems.MarkItemDirty(Entry);
+	}
+	else
+	{
+		const int32 EntryIndex = VisibleEntryIndices.FindAndRemoveChecked(InItemInstance);
+
+		/** Swap-remove, the last entry takes the removed entry's place */
+		const int32 LastIndex = VisibleItems.Entries.Num() - 1;
+		if (EntryIndex != LastIndex)
+		{
+			VisibleEntryIndices.FindChecked(VisibleItems.Entries[LastIndex].Instance) = EntryIndex;
+		}
+		VisibleItems.Entries.RemoveAtSwap(EntryIndex, 1, EAllowShrinking::No);
+		VisibleItems.MarkArrayDirty();
+	}
+
+	MARK_PROPERTY_DIRTY_FROM_NAME(UInventoryComponent, VisibleItems, this);
+}
+
+bool UInventoryComponent::IsItemVisibleToOthers(const UItemInstance* InItemInstance) const
+{
+	if (GetOwner()->HasAuthority())
+	{
+		return VisibleEntryIndices.Contains(InItemInstance);
+	}
+
+	return VisibleItems.Entries.ContainsByPredicate([InItemInstance](const FInventoryItemEntry& Entry) { return Entry.Instance == InItemInstance; });
+}
+
+const FInventoryItemList& UInventoryComponent::GetKnownItems() const
+{
+	/** A client only ever receives one of the two lists, Items if it owns this inventory and VisibleItems otherwise */
+	return GetOwner()->HasAuthority() || Items.Entries.Num() > 0 ? Items : VisibleItems;
+}
+
+TArray<UItemInstance*> UInventoryComponent::GetItemInstances() const
+{
+	const FInventoryItemList& KnownItems = GetKnownItems();
+
+	TArray<UItemInstance*> Result;
+	Result.Reserve(KnownItems.Entries.Num());
+
+	for (const FInventoryItemEntry& Entry : KnownItems.Entries)
+	{
+		Result.Add(Entry.Instance);
+	}
+
+	return Result;
+}
+
+void UInventoryComponent::HandleReplicatedItemAdded(UItemInstance* InItemInstance)
+{
+	UE_LOG(LogInventory, Verbose, TEXT("Item added: %s"), InItemInstance ? *InItemInstance->GetName() : TEXT("nullptr"));
+	OnItemAdded.Broadcast(InItemInstance);
+}
+
+void UInventoryComponent::HandleReplicatedItemChanged(UItemInstance* InItemInstance)
+{
+	UE_LOG(LogInventory, Verbose, TEXT("Item changed: %s"), InItemInstance ? *InItemInstance->GetName() : TEXT("nullptr"));
+	OnItemChanged.Broadcast(InItemInstance);
+}
+
+void UInventoryComponent::HandleReplicatedItemRemoved(UItemInstance* InItemInstance)
+{
+	UE_LOG(LogInventory, Verbose, TEXT("Item removed: %s"), InItemInstance ? *InItemInstance->GetName() : TEXT("nullptr"));
+	OnItemRemoved.Broadcast(InItemInstance);
+}
+
+void UInventoryComponent::HandleReplicatedStackAdded(const FInventoryStackEntry& Stack)
+{
+	OnStackAdded.Broadcast(Stack);
+}
+
+void UInventoryComponent::HandleReplicatedStackChanged(const FInventoryStackEntry& Stack)
+{
+	OnStackChanged.Broadcast(Stack);
+}
+
+void UInventoryComponent::HandleReplicatedStackRemoved(const FInventoryStackEntry& Stack)
+{
+	OnStackRemoved.Broadcast(Stack);
+}
\ No newline at end of file
@@ -5,8 +5,218 @@
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
 #include "ItemInstance.h"
+#include "ItemDataId.h"
+#include "InventoryJournal.h"
+#include "InventoryItemView.h"
+#include "Net/Serialization/FastArraySerializer.h"
 #include "InventoryComponent.generated.h"
 
+class UInventoryComponent;
+class UItemActorSpawnQueue;
+class UCraftingRecipe;
+class UInventoryJournal;
+
+/**
+ * A single replicated entry in an inventory.
+ *
+ * Wraps the UItemInstance pointer so the fast array serializer
+ * can track it by ReplicationID and only send entries that changed.
+ */
+USTRUCT(BlueprintType)
+struct FInventoryItemEntry : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	TObjectPtr<UItemInstance> Instance = nullptr;
+
+private:
+	friend class UInventoryComponent;
+
+	/** Instance this entry is currently indexed under, lags behind Instance on clients until it resolves */
+	UItemInstance* IndexedInstance = nullptr;
+	/** Data IndexedInstance had when it was indexed, on clients Data can resolve after the instance did */
+	const UItemData* IndexedData = nullptr;
+};
+
+/**
+ * Delta-replicated list of all items in an inventory.
+ *
+ * Only entries that were added, changed or removed since the last
+ * net update are sent, so the cost of an update does not depend on
+ * the size of the inventory.
+ */
+USTRUCT(BlueprintType)
+struct FInventoryItemList : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	//~ Begin FFastArraySerializer contract
+	void PreReplicatedRemove(const TArrayView<int32> RemovedIndices, int32 FinalSize);
+	void PostReplicatedAdd(const TArrayView<int32> AddedIndices, int32 FinalSize);
+	void PostReplicatedChange(const TArrayView<int32> ChangedIndices, int32 FinalSize);
+	//~ End FFastArraySerializer contract
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FInventoryItemEntry, FInventoryItemList>(Entries, DeltaParms, *this);
+	}
+
+	UPROPERTY()
+	TArray<FInventoryItemEntry> Entries;
+
+	/** Component that owns this list, used to route the replication callbacks */
+	UPROPERTY(NotReplicated)
+	TObjectPtr<UInventoryComponent> OwnerComponent = nullptr;
+};
+
+template<>
+struct TStructOpsTypeTraits<FInventoryItemList> : public TStructOpsTypeTraitsBase2<FInventoryItemList>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+/**
+ * A stack of fungible items, e.g., 999 arrows.
+ *
+ * Stacks are plain data, they don't create a UItemInstance (or a replicated
+ * subobject) per unit.
+ */
+USTRUCT(BlueprintType)
+struct FInventoryStackEntry : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	/** Server assigned id, stable for the lifetime of the stack, used to refer to it from rpcs */
+	UPROPERTY(BlueprintReadOnly)
+	int32 StackId = INDEX_NONE;
+
+	/** Replicated instead of ItemData, clients resolve it through the UItemDataRegistry */
+	UPROPERTY(BlueprintReadOnly)
+	FItemDataId ItemDataId;
+
+	UPROPERTY(NotReplicated, BlueprintReadOnly)
+	TObjectPtr<UItemData> ItemData = nullptr;
+
+	/** Number of units in this stack, always within [1, ItemData->MaxStackSize] */
+	UPROPERTY(BlueprintReadOnly)
+	int32 Count = 0;
+
+private:
+	friend class UInventoryComponent;
+
+	/** ItemData and Count this entry is currently indexed under */
+	UItemData* IndexedData = nullptr;
+	int32 IndexedCount = 0;
+};
+
+/**
+ * Delta-replicated list of all item stacks in an inventory.
+ */
+USTRUCT(BlueprintType)
+struct FInventoryStackList : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	//~ Begin FFastArraySerializer contract
+	void PreReplicatedRemove(const TArrayView<int32> RemovedIndices, int32 FinalSize);
+	void PostReplicatedAdd(const TArrayView<int32> AddedIndices, int32 FinalSize);
+	void PostReplicatedChange(const TArrayView<int32> ChangedIndices, int32 FinalSize);
+	//~ End FFastArraySerializer contract
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FInventoryStackEntry, FInventoryStackList>(Entries, DeltaParms, *this);
+	}
+
+	UPROPERTY()
+	TArray<FInventoryStackEntry> Entries;
+
+	/** Component that owns this list, used to route the replication callbacks */
+	UPROPERTY(NotReplicated)
+	TObjectPtr<UInventoryComponent> OwnerComponent = nullptr;
+};
+
+template<>
+struct TStructOpsTypeTraits<FInventoryStackList> : public TStructOpsTypeTraitsBase2<FInventoryStackList>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+/**
+ * Compact form of an FItemInstanceInitializer, sent from clients to the server.
+ */
+USTRUCT()
+struct FItemCreateRequest
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TSubclassOf<UItemInstance> ItemClass;
+
+	UPROPERTY()
+	FItemDataId ItemDataId;
+};
+
+/**
+ * Desired item actor state of an item, sent from clients to the server.
+ */
+USTRUCT()
+struct FItemActorSpawnRequest
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TObjectPtr<UItemInstance> Item = nullptr;
+
+	UPROPERTY()
+	bool bSpawned = false;
+};
+
+/**
+ * Items of one lookup index key (a data asset, class or tag), with each item's position.
+ *
+ * Removal swaps the last item into the removed one's slot and patches its position, so it
+ * does not search the bucket.
+ */
+struct FInventoryItemBucket
+{
+	TArray<UItemInstance*> Items;
+	TMap<UItemInstance*, int32> Indices;
+
+	void Add(UItemInstance* Item)
+	{
+		Indices.Add(Item, Items.Add(Item));
+	}
+
+	void Remove(UItemInstance* Item)
+	{
+		int32 Index = INDEX_NONE;
+		if (!Indices.RemoveAndCopyValue(Item, Index))
+		{
+			return;
+		}
+
+		Items.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+		if (Items.IsValidIndex(Index))
+		{
+			Indices.FindChecked(Items[Index]) = Index;
+		}
+	}
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnInventoryItemEvent, UItemInstance*, Item);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnInventoryStackEvent, const FInventoryStackEntry&, Stack);
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnInventoryItemLeaving, UItemInstance*);
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnInventoryItemCountChanged, UInventoryComponent*, const UItemData*);
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnInventoryItemViewsChanged, UInventoryComponent*);
+
 UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
 class INVTEST_API UInventoryComponent : public UActorComponent
 {
@@ -16,6 +226,11 @@ public:
 	// Sets default values for this component's properties
 	UInventoryComponent();
 
+	//~ Begin UActorComponent Interface
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	//~ End UActorComponent Interface
+
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 	//--------------------------------------------
 	// Item instances: Creating
@@ -30,13 +245,362 @@ public:
 	const UItemInstance* CreateItemInInventory(TSubclassOf<UItemInstance> ItemClass, UItemData* ItemData);
 
 	UFUNCTION(Server, Reliable)
-	void ServerCreateItemInInventory(TSubclassOf<UItemInstance> ItemClass, UItemData* ItemData);
+	void ServerCreateItemInInventory(TSubclassOf<UItemInstance> ItemClass, FItemDataId ItemDataId);
 
 	/**
-	 * @brief Get const reference to all items in the inventory
+	 * @brief Creates an item instance for every initializer, adding all of them to this inventory in one go
+	 *
+	 * On clients the whole batch is forwarded with a single ServerCreateItemsInInventory RPC, and on the
+	 * server the Items list is only marked dirty once, so the batch costs one replication update.
+	 *
+	 * Note: Outer and OwnerActor of the initializers are ignored, this inventory and its owner are used instead.
+	 * @param ItemInitializers ItemClass/ItemData pairs to create instances of
+	 * @return if executed on server, the newly created instances, or an empty array if on client
 	 */
 	UFUNCTION(BlueprintCallable)
-	const TArray<UItemInstance*>& GetItemInstances() { return Items; }
+	TArray<UItemInstance*> CreateItemsInInventory(const TArray<FItemInstanceInitializer>& ItemInitializers);
+
+	/** Clients split larger batches into several ServerCreateItemsInInventory rpcs, the server drops batches over this */
+	static constexpr int32 MaxRequestsPerRpc = 32;
+
+	UFUNCTION(Server, Reliable)
+	void ServerCreateItemsInInventory(const TArray<FItemCreateRequest>& Requests);
+
+	/**
+	 * @brief Whether clients may create items in this inventory through the create rpcs.
+	 *
+	 * Off by default, items should be granted by server side gameplay code (loot, rewards, ...).
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Items")
+	bool bAllowClientItemCreation = false;
+
+	//--------------------------------------------
+	// Item instances: Removing
+	//--------------------------------------------
+	/**
+	 * @brief Removes an item instance from this inventory and marks it for garbage collection.
+	 *
+	 * Destroys the item's actor if it has one spawned, and unregisters the instance from the
+	 * replicated subobject list. Runs in constant time regardless of inventory size, see FInventoryItemBucket.
+	 *
+	 * Authority only.
+	 * @return true if the item was in this inventory and got removed
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Items")
+	bool RemoveItemFromInventory(UItemInstance* InItemInstance);
+
+	/**
+	 * @brief Removes multiple item instances, marking Items dirty once for the whole batch.
+	 *
+	 * Authority only.
+	 * @return the number of items that were removed
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Items")
+	int32 RemoveItemsFromInventory(const TArray<UItemInstance*>& InItemInstances);
+
+public:
+	//--------------------------------------------
+	// Item instances: Transferring
+	//--------------------------------------------
+	/**
+	 * @brief Moves items from this inventory into Target, as one all-or-nothing transaction.
+	 *
+	 * The existing instances are re-parented (outer, OwnerActor and replicated subobject registration),
+	 * nothing is destroyed or recreated, so rolled stats and other instance state carry over.
+	 * If Target can't take all of the items (see CanAddItems), nothing is moved.
+	 *
+	 * Authority only.
+	 * @param bKeepItemActors if true spawned item actors stay spawned and are handed to Target's owner, otherwise they are destroyed
+	 * @return true if all items were moved
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Items|Transfer")
+	bool TransferItemsTo(UInventoryComponent* Target, const TArray<UItemInstance*>& InItemInstances, bool bKeepItemActors = false);
+
+	/** Moves a single item, see TransferItemsTo */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Items|Transfer")
+	bool TransferItemTo(UInventoryComponent* Target, UItemInstance* InItemInstance, bool bKeepItemActors = false);
+
+	/** Moves every item in this inventory into Target (e.g., looting a whole chest), see TransferItemsTo */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Items|Transfer")
+	bool TransferAllItemsTo(UInventoryComponent* Target, bool bKeepItemActors = false);
+
+	/**
+	 * @brief Get all items in the inventory
+	 *
+	 * Note: This builds a new array from the replicated item list, avoid calling it every frame.
+	 */
+	UFUNCTION(BlueprintCallable)
+	TArray<UItemInstance*> GetItemInstances() const;
+
+	/** Number of items in the inventory */
+	UFUNCTION(BlueprintCallable)
+	int32 GetNumItems() const { return GetKnownItems().Entries.Num(); }
+
+public:
+	//--------------------------------------------
+	// Item instances: Visibility
+	//--------------------------------------------
+	/**
+	 * @brief Sets whether an item replicates to connections other than the owner's.
+	 *
+	 * The full inventory only replicates to the owning connection, other players only receive
+	 * the visible subset (e.g., equipped items, items with a spawned actor), so bandwidth scales
+	 * with what is shown rather than what is carried. Items with a spawned item actor are made visible automatically.
+	 * On those other clients the lookup functions only see the visible items.
+	 *
+	 * Authority only.
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Items|Visibility")
+	void SetItemVisibleToOthers(UItemInstance* InItemInstance, bool bVisible);
+
+	UFUNCTION(BlueprintCallable, Category = "Items|Visibility")
+	bool IsItemVisibleToOthers(const UItemInstance* InItemInstance) const;
+
+	/**
+	 * @brief Keeps an item visible to others, and its actor from being destroyed by clients, while it is locked (e.g., equipped).
+	 *
+	 * Server side code can still destroy the actor of a locked item, the item stays visible then.
+	 * The lock is dropped when the item leaves this inventory.
+	 *
+	 * Authority only.
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Items|Visibility")
+	void SetItemActorLocked(UItemInstance* InItemInstance, bool bLocked);
+
+	UFUNCTION(BlueprintCallable, Category = "Items|Visibility")
+	bool IsItemActorLocked(const UItemInstance* InItemInstance) const { return LockedItemActors.Contains(InItemInstance); }
+
+public:
+	//--------------------------------------------
+	// Persistence
+	//--------------------------------------------
+	/**
+	 * @brief Writes every item instance and stack in this inventory to a compact, versioned binary snapshot.
+	 *
+	 * Item classes and data assets are written once to a table and referred to by index,
+	 * followed by each instance's own state (see UItemInstance::SerializeInstanceState).
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Items|Persistence")
+	void SaveInventoryToBytes(TArray<uint8>& OutBytes) const;
+
+	/**
+	 * @brief Replaces the contents of this inventory with a snapshot written by SaveInventoryToBytes.
+	 *
+	 * All instances are created in a single pass and the replicated lists are marked dirty once,
+	 * instead of one CreateItemInInventory call per item.
+	 *
+	 * Authority only.
+	 * @return false if the snapshot is malformed or from an unsupported version, the inventory is left empty in that case
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Items|Persistence")
+	bool LoadInventoryFromBytes(const TArray<uint8>& Bytes);
+
+	/**
+	 * @brief Starts recording this inventory's operations to the UInventoryJournal under Key.
+	 *
+	 * Key has to identify the inventory across server restarts (e.g., a player's account id),
+	 * an empty key stops journaling. If Key has a journal from an earlier run, call
+	 * UInventoryJournal::RecoverInventory next, the inventory is not snapshotted before that. Authority only.
+	 * Reads the key's files on disk once, on the calling thread, so recording never blocks on them.
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Items|Persistence")
+	void SetJournalKey(const FString& Key);
+
+	UFUNCTION(BlueprintCallable, Category = "Items|Persistence")
+	const FString& GetJournalKey() const { return JournalKey; }
+
+public:
+	//--------------------------------------------
+	// Item instances: Lookup
+	//--------------------------------------------
+	/**
+	 * @brief All item instances created from ItemData
+	 *
+	 * Backed by an index that is kept up to date on the server and on clients, so this is O(1).
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Items|Lookup")
+	const TArray<UItemInstance*>& FindItemsByData(const UItemData* ItemData) const;
+
+	/**
+	 * @brief All item instances that are of ItemClass or one of its subclasses, O(1)
+	 *
+	 * UItemInstance itself is not indexed, every item is of it, see GetItemInstances.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Items|Lookup")
+	const TArray<UItemInstance*>& FindItemsByClass(TSubclassOf<UItemInstance> ItemClass) const;
+
+	/** All item instances whose data has Tag (or a child of Tag), O(1) */
+	UFUNCTION(BlueprintCallable, Category = "Items|Lookup")
+	const TArray<UItemInstance*>& FindItemsByTag(FGameplayTag Tag) const;
+
+	/** Number of units of ItemData in the inventory, counting both instances and stacks, O(1) */
+	UFUNCTION(BlueprintCallable, Category = "Items|Lookup")
+	int32 GetItemCountByData(const UItemData* ItemData) const;
+
+	/** Number of item instances that are of ItemClass or one of its subclasses, O(1) */
+	UFUNCTION(BlueprintCallable, Category = "Items|Lookup")
+	int32 GetItemCountByClass(TSubclassOf<UItemInstance> ItemClass) const { return ItemClass == UItemInstance::StaticClass() ? GetNumItems() : FindItemsByClass(ItemClass).Num(); }
+
+	/** Number of item instances whose data has Tag (or a child of Tag), O(1) */
+	UFUNCTION(BlueprintCallable, Category = "Items|Lookup")
+	int32 GetItemCountByTag(FGameplayTag Tag) const { return FindItemsByTag(Tag).Num(); }
+
+	/** Whether InItemInstance is in this inventory, O(1) (server only, clients don't index entries) */
+	UFUNCTION(BlueprintCallable, Category = "Items|Lookup")
+	bool ContainsItem(const UItemInstance* InItemInstance) const;
+
+	/** Whether the inventory holds at least one unit of ItemData, O(1) */
+	UFUNCTION(BlueprintCallable, Category = "Items|Lookup")
+	bool HasItem(const UItemData* ItemData) const { return GetItemCountByData(ItemData) > 0; }
+
+	/**
+	 * @brief Broadcast on server and clients whenever GetItemCountByData(ItemData) may have changed.
+	 *
+	 * Fires once per index update, so a batch can fire it many times for the same data, listeners
+	 * should only remember the data and read the count later (see UCraftingSubsystem).
+	 */
+	FOnInventoryItemCountChanged OnItemCountChanged;
+
+public:
+	//--------------------------------------------
+	// Item views: Flat data for UI
+	//--------------------------------------------
+	/**
+	 * @brief Every item instance and stack as a flat FInventoryItemView, in no particular order.
+	 *
+	 * Kept up to date from the same updates as the lookup indices (replication callbacks on clients),
+	 * one view is added, changed or removed per item. Not kept on dedicated servers.
+	 */
+	const TArray<FInventoryItemView>& GetItemViews() const { return ItemViews; }
+
+	/**
+	 * @brief Filters and sorts the item views with Query, then returns page PageIndex of PageSize views.
+	 *
+	 * Copies the views of the page, see QueryItemViewIndices to read them in place.
+	 * @param PageSize Views per page, everything if not positive
+	 * @param OutNumResults Number of views that passed the filter, over all pages
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Items|View")
+	TArray<FInventoryItemView> QueryItemViews(const FInventoryViewQuery& Query, int32 PageIndex, int32 PageSize, int32& OutNumResults) const;
+
+	/**
+	 * @brief Like QueryItemViews, but returns the page as indices into GetItemViews() instead of copies.
+	 *
+	 * The filtered and sorted order is cached until the views or the query change, so drawing the same
+	 * page every frame costs nothing. The returned view is valid until the next query or view change.
+	 */
+	TConstArrayView<int32> QueryItemViewIndices(const FInventoryViewQuery& Query, int32 PageIndex, int32 PageSize, int32& OutNumResults) const;
+
+	/**
+	 * @brief Broadcast when item views were added, changed or removed, listeners should only mark their UI for a redraw.
+	 *
+	 * Every change of a frame is coalesced into a single broadcast on the next tick.
+	 */
+	FOnInventoryItemViewsChanged OnItemViewsChanged;
+
+public:
+	//--------------------------------------------
+	// Crafting
+	//--------------------------------------------
+	/**
+	 * @brief Asks the server to craft a recipe Times times with this inventory's items, see UCraftingSubsystem::Craft.
+	 */
+	UFUNCTION(BlueprintCallable, Server, Reliable, Category = "Items|Crafting")
+	void ServerCraftRecipe(UCraftingRecipe* Recipe, int32 Times = 1);
+
+public:
+	//--------------------------------------------
+	// Item stacks: Fungible items
+	//--------------------------------------------
+	/**
+	 * @brief Adds Count units of a stackable item, filling existing stacks before creating new ones.
+	 *
+	 * If ItemData is not stackable, nothing is added, use CreateItemInInventory instead.
+	 * New stacks are only opened while the inventory is below its stack limit, see GetNumFreeStacks.
+	 * @return if executed on server, the number of units added (less than Count if the limit was hit), or 0 if on client
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Items|Stacks")
+	int32 AddStackableItem(UItemData* ItemData, int32 Count);
+
+	UFUNCTION(Server, Reliable)
+	void ServerAddStackableItem(FItemDataId ItemDataId, int32 Count);
+
+	/**
+	 * @brief Removes up to Count units of a stackable item, emptying the smallest stacks first.
+	 *
+	 * Authority only.
+	 * @return the number of units removed
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Items|Stacks")
+	int32 RemoveStackableItem(UItemData* ItemData, int32 Count);
+
+	/**
+	 * @brief Moves SplitCount units out of a stack into a new stack of the same item.
+	 */
+	UFUNCTION(BlueprintCallable, Server, Reliable, Category = "Items|Stacks")
+	void ServerSplitStack(int32 StackId, int32 SplitCount);
+
+	/**
+	 * @brief Moves as many units as fit from the source stack into the target stack.
+	 *
+	 * The source stack is removed if it becomes empty.
+	 */
+	UFUNCTION(BlueprintCallable, Server, Reliable, Category = "Items|Stacks")
+	void ServerMergeStacks(int32 SourceStackId, int32 TargetStackId);
+
+	/**
+	 * @brief Takes one unit out of a stack and turns it into a UItemInstance, for units that need unique state.
+	 *
+	 * Authority only. The stack is left as it was if the instance can't be created.
+	 * @return the new instance, or nullptr if the stack does not exist or ItemClass is not compatible with its data
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Items|Stacks")
+	UItemInstance* PromoteStackToInstance(int32 StackId, TSubclassOf<UItemInstance> ItemClass);
+
+	/** Number of new stacks AddStackableItem(ItemData, Count) would open, after topping up the existing ones */
+	UFUNCTION(BlueprintCallable, Category = "Items|Stacks")
+	int32 GetNumStacksNeeded(const UItemData* ItemData, int32 Count) const;
+
+	/** Number of stacks that can still be opened, MAX_int32 if this inventory has no stack limit */
+	UFUNCTION(BlueprintCallable, Category = "Items|Stacks")
+	int32 GetNumFreeStacks() const;
+
+	/** Total number of units of ItemData across all stacks */
+	UFUNCTION(BlueprintCallable, Category = "Items|Stacks")
+	int32 GetStackableItemCount(const UItemData* ItemData) const;
+
+	/** All stacks in the inventory */
+	UFUNCTION(BlueprintCallable, Category = "Items|Stacks")
+	const TArray<FInventoryStackEntry>& GetItemStacks() const { return Stacks.Entries; }
+
+	/** Broadcast on clients when a stack was added, changed or is about to be removed */
+	UPROPERTY(BlueprintAssignable, Category = "Items|Stacks")
+	FOnInventoryStackEvent OnStackAdded;
+
+	UPROPERTY(BlueprintAssignable, Category = "Items|Stacks")
+	FOnInventoryStackEvent OnStackChanged;
+
+	UPROPERTY(BlueprintAssignable, Category = "Items|Stacks")
+	FOnInventoryStackEvent OnStackRemoved;
+
+public:
+	//--------------------------------------------
+	// Item instances: Replication callbacks
+	//--------------------------------------------
+	/** Broadcast on clients when an item was replicated into this inventory */
+	UPROPERTY(BlueprintAssignable, Category = "Items")
+	FOnInventoryItemEvent OnItemAdded;
+
+	/** Broadcast on clients when an existing item entry changed (e.g., its instance finished resolving) */
+	UPROPERTY(BlueprintAssignable, Category = "Items")
+	FOnInventoryItemEvent OnItemChanged;
+
+	/** Broadcast on clients right before an item is removed from this inventory */
+	UPROPERTY(BlueprintAssignable, Category = "Items")
+	FOnInventoryItemEvent OnItemRemoved;
+
+	/** Broadcast on the server right before an item leaves this inventory, removed or transferred out */
+	FOnInventoryItemLeaving OnItemLeaving;
 
 public:
 	//--------------------------------------------
@@ -45,27 +609,267 @@ public:
 	/**
 	 * @brief Performs authority checks and validation before spawning
 	 * an ItemActor.
+	 *
+	 * If bDeferItemActorRequests is set the spawn is queued on the world's UItemActorSpawnQueue
+	 * and happens within the next few frames.
 	 */
 	UFUNCTION(BlueprintCallable, Server, Reliable, Category = "Items")
 	virtual void ServerSpawnItemActor(UItemInstance* InItemInstance);
 	/**
 	 * @brief Performs authority checks and validation before destroying
 	 * an ItemActor.
+	 *
+	 * Queued like ServerSpawnItemActor, a destroy cancels a spawn that is still pending.
 	 */
 	UFUNCTION(BlueprintCallable, Server, Reliable, Category = "Items")
 	virtual void ServerDestroyItemActor(UItemInstance* InItemInstance);
 
-	/** Indicates whether or not the ItemActor is already in the scene (true if yes, false if not)*/
+	/**
+	 * Indicates whether or not the ItemActor is already in the scene (true if yes, false if not)
+	 *
+	 * Pending requests count as done, i.e., true if a spawn is queued and false if a destroy is queued.
+	 */
 	virtual bool IsItemActorSpawned(UItemInstance* InItemInstance) const;
+
+	/**
+	 * @brief Asks for the item's actor to be spawned or destroyed.
+	 *
+	 * On clients requests are coalesced, only the last state per item is kept, and sent with a single
+	 * unreliable rpc at the end of the frame. The request is idempotent, if it is lost just request again.
+	 * On the server it is applied right away.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Items")
+	void RequestItemActorSpawned(UItemInstance* InItemInstance, bool bSpawned);
+
+	/** Sent in batches of at most MaxRequestsPerRpc requests */
+	UFUNCTION(Server, Unreliable)
+	void ServerSetItemActorsSpawned(const TArray<FItemActorSpawnRequest>& Requests);
+
+	/** Whether item actor spawns/destroys go through the UItemActorSpawnQueue instead of happening right away */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Items")
+	bool bDeferItemActorRequests = true;
+protected:
+	friend class UItemActorSpawnQueue;
+	friend class UCraftingSubsystem;
+	friend class UInventoryJournal;
+	friend class UInventoryGrantSubsystem;
+	friend class UItemInstance;
+	friend class UEquipmentComponent;
+
+	/** Spawns the item's actor right away, called by the spawn queue or ServerSpawnItemActor */
+	void ExecuteSpawnItemActor(UItemInstance* InItemInstance);
+	/** Destroys the item's actor right away, called by the spawn queue or ServerDestroyItemActor */
+	void ExecuteDestroyItemActor(UItemInstance* InItemInstance);
 private:
+	/** The world's spawn queue if requests should be deferred, nullptr otherwise */
+	UItemActorSpawnQueue* GetSpawnQueue() const;
+
+	/** Sends the coalesced RequestItemActorSpawned requests */
+	void FlushItemActorRequests();
+
+	/** The world's journal if this inventory is journaled, nullptr otherwise (server only) */
+	UInventoryJournal* GetJournal() const;
+
+	/** Records an operation in the journal, if this inventory is journaled */
+	void JournalItemOp(EInventoryJournalOp Op, UItemInstance* InItemInstance, const UInventoryComponent* Other = nullptr) const;
+	void JournalStackDelta(const UItemData* ItemData, int32 Delta) const;
+
+	/** See SetJournalKey */
+	UPROPERTY()
+	FString JournalKey;
+
+	/** Set while loading a snapshot or replaying the journal, operations are not journaled then */
+	bool bJournalSuspended = false;
+
+	/** Brings the item's actor to the requested state, through SpawnQueue if set (server only) */
+	void ApplyItemActorRequest(UItemInstance* InItemInstance, bool bSpawned, UItemActorSpawnQueue* SpawnQueue);
+
+	/** Latest requested state per item, waiting for FlushItemActorRequests (clients only) */
+	TMap<TWeakObjectPtr<UItemInstance>, bool> PendingItemActorRequests;
+
 	/**
 	 * @brief Set of all item instances that have a currently spawned actor
 	 */
 	TSet<UItemInstance*> SpawnedItemActors;
+
+	/** Items whose actor clients can't destroy and that stay visible to others, see SetItemActorLocked (server only) */
+	TSet<const UItemInstance*> LockedItemActors;
 private:
-	UPROPERTY(ReplicatedUsing = OnRep_Items)
-	TArray<TObjectPtr<UItemInstance>> Items;
+	/**
+	 * @brief Creates an item instance, registers it as a replicated subobject and adds an entry for it.
+	 *
+	 * Does not mark the Items property dirty, callers are expected to do that once they are done adding items.
+	 * @return the new instance, or nullptr if CanAddItem rejected it
+	 */
+	UItemInstance* InternalCreateItem(TSubclassOf<UItemInstance> ItemClass, UItemData* ItemData, bool bRollAffixes = true);
+
+	/** Same as above, for an initializer whose Outer is this inventory and whose ItemData is loaded */
+	UItemInstance* InternalCreateItem(const FItemInstanceInitializer& ItemInitializer);
+
+	/** Registers an instance already outered to this inventory as a replicated subobject and adds an entry for it */
+	void InternalAddItem(UItemInstance* InItemInstance);
+
+	/**
+	 * @brief Destroys the item's actor, unregisters the subobject and swap-removes its entry.
+	 *
+	 * Does not mark the Items property dirty, or the instance as garbage.
+	 * @param bDestroyItemActor if false a spawned item actor is left alone, only this inventory forgets about it
+	 * @return false if the item is not in this inventory
+	 */
+	bool InternalRemoveItem(UItemInstance* InItemInstance, bool bDestroyItemActor = true);
+
+	/** Index of every item's entry in Items.Entries, so removal does not need to search (server only) */
+	TMap<UItemInstance*, int32> ItemEntryIndices;
+
+	/** Index of every visible item's entry in VisibleItems.Entries (server only) */
+	TMap<const UItemInstance*, int32> VisibleEntryIndices;
+
+	/** Adds or removes the item's VisibleItems entry and re-registers its subobject with the matching condition */
+	void InternalSetItemVisible(UItemInstance* InItemInstance, bool bVisible);
+
+	/**
+	 * @brief The item list this machine knows about.
+	 *
+	 * Items on the server and the owning client, VisibleItems on every other client.
+	 */
+	const FInventoryItemList& GetKnownItems() const;
+
+	/** Removes every item instance and stack, used before loading a snapshot */
+	void InternalClearInventory();
+	/** Finds the index of the stack with StackId in Stacks.Entries, or INDEX_NONE */
+	int32 FindStackIndex(int32 StackId) const;
+	/** Adds a new stack entry, Count must already be clamped to the max stack size */
+	FInventoryStackEntry& InternalAddStack(UItemData* ItemData, int32 Count);
+	void InternalRemoveStackAt(int32 StackIndex);
+	/** Marks a stack dirty for replication and brings the lookup indices up to date with it */
+	void MarkStackDirty(FInventoryStackEntry& Stack);
+private:
+	//--------------------------------------------
+	// Lookup indices
+	//--------------------------------------------
+	/** Re-indexes an entry if its instance, or the instance's data, changed since it was last indexed */
+	void SyncItemIndex(FInventoryItemEntry& Entry);
+	void UnindexItem(FInventoryItemEntry& Entry);
+	/** Re-indexes a stack if its data or count changed since it was last indexed */
+	void SyncStackIndex(FInventoryStackEntry& Stack);
+	/** Resolves ItemData from the replicated ItemDataId (clients only) */
+	void ResolveStackItemData(FInventoryStackEntry& Stack);
+	void UnindexStack(FInventoryStackEntry& Stack);
+
+	/** Re-indexes the entry of an item whose Data replicated after the item itself (clients only) */
+	void HandleItemDataReplicated(UItemInstance* InItemInstance);
+
+	void AddToIndices(UItemInstance* InItemInstance);
+	/** Removes an item from the indices, IndexedData is the data it was indexed under */
+	void RemoveFromIndices(UItemInstance* InItemInstance, const UItemData* IndexedData);
+
+	/** Instances by the UItemData they were created from */
+	TMap<const UItemData*, FInventoryItemBucket> ItemsByData;
+	/** Instances by their class, and every super class below UItemInstance */
+	TMap<const UClass*, FInventoryItemBucket> ItemsByClass;
+	/** Instances by every tag (and parent tag) of their data */
+	TMap<FGameplayTag, FInventoryItemBucket> ItemsByTag;
+	/** Total units held in stacks by UItemData */
+	TMap<const UItemData*, int32> StackCountByData;
+	/** Data whose item actor class this inventory retains with the UItemAssetLoader, while it has instances of it */
+	TSet<const UItemData*> RetainedActorClassData;
+
+	//--------------------------------------------
+	// Item views
+	//--------------------------------------------
+	bool ShouldKeepItemViews() const;
+	/** Adds the instance's view, or fills it in again from the instance's current data */
+	void UpdateItemView(UItemInstance* InItemInstance);
+	void RemoveItemView(const UItemInstance* InItemInstance);
+	/** Adds or updates the view of a stack, removes it if the stack has no data (yet) */
+	void UpdateStackView(const FInventoryStackEntry& Stack);
+	void RemoveStackView(int32 StackId);
+	/** Swap-removes a view and fixes up the index of the one moved into its place */
+	void RemoveItemViewAt(int32 ViewIndex);
+	/** Bumps ItemViewsVersion, the first change since the last broadcast schedules one for the next tick */
+	void MarkItemViewsChanged();
+	void BroadcastItemViewsChanged();
+
+	static void FillItemView(FInventoryItemView& View, UItemData* ItemData);
+
+	TArray<FInventoryItemView> ItemViews;
+	/** Index into ItemViews by instance, and by stack id */
+	TMap<const UItemInstance*, int32> ItemViewIndices;
+	TMap<int32, int32> StackViewIndices;
+	/** Bumped whenever ItemViews changes, invalidates the cached query */
+	uint32 ItemViewsVersion = 1;
+	/** ItemViewsVersion of the last OnItemViewsChanged broadcast */
+	uint32 BroadcastItemViewsVersion = 1;
+
+	/** Filtered and sorted order of the last query, as indices into ItemViews */
+	mutable FInventoryViewQuery CachedViewQuery;
+	mutable TArray<int32> CachedViewOrder;
+	mutable uint32 CachedViewVersion = 0;
+protected:
+	//--------------------------------------------
+	// Server hooks
+	//--------------------------------------------
+	/** Whether an instance of ItemData fits into this inventory, checked before the instance is created (server only) */
+	virtual bool CanAddItem(const UItemData* ItemData) const { return true; }
+	/** Whether instances of all of ItemDatas fit into this inventory at once, checked before a transfer (server only) */
+	virtual bool CanAddItems(TConstArrayView<const UItemData*> ItemDatas) const;
+	/** Invoked on the server after an item was added to this inventory */
+	virtual void PostItemAdded(UItemInstance* InItemInstance) {}
+	/** Invoked on the server before an item is removed from this inventory */
+	virtual void PreItemRemoved(UItemInstance* InItemInstance) {}
+	/** Max number of stacks this inventory holds, INDEX_NONE for no limit */
+	virtual int32 GetMaxStacks() const { return INDEX_NONE; }
+
+	/**
+	 * @brief Writes the layout of the saved items (e.g., grid positions) into a snapshot.
+	 *
+	 * SavedItems are in the order they are written to the snapshot. The base inventory has no layout.
+	 */
+	virtual void SaveItemLayout(FArchive& Ar, TConstArrayView<const UItemInstance*> SavedItems) const {}
+	/** Reads what SaveItemLayout wrote, after all items were created. LoadedItems is null for items that failed to load. */
+	virtual void LoadItemLayout(FArchive& Ar, TConstArrayView<UItemInstance*> LoadedItems) {}
+protected:
+	//--------------------------------------------
+	// Rpc validation
+	//--------------------------------------------
+	/**
+	 * @brief Charges a server rpc against the calling connection's rate limit, see UInventoryRpcLimiter.
+	 * @return false if the rpc should be dropped
+	 */
+	bool ConsumeRpcTokens(const TCHAR* RpcName, float Cost = 1.f) const;
+
+	/** Like ConsumeRpcTokens for a batched rpc, drops batches of more than MaxRequestsPerRpc requests outright */
+	bool ConsumeBatchRpcTokens(const TCHAR* RpcName, int32 NumRequests) const;
+
+	/** Whether an instance of ItemClass may be created from ItemData */
+	static bool IsValidItemRequest(TSubclassOf<UItemInstance> ItemClass, const UItemData* ItemData);
+
+protected:
+	friend struct FInventoryItemList;
+	friend struct FInventoryStackList;
+
+	/** Invoked on clients for every entry added by replication */
+	virtual void HandleReplicatedItemAdded(UItemInstance* InItemInstance);
+	/** Invoked on clients for every entry changed by replication */
+	virtual void HandleReplicatedItemChanged(UItemInstance* InItemInstance);
+	/** Invoked on clients for every entry about to be removed by replication */
+	virtual void HandleReplicatedItemRemoved(UItemInstance* InItemInstance);
+	/** Invoked on clients for every stack added, changed or about to be removed by replication */
+	virtual void HandleReplicatedStackAdded(const FInventoryStackEntry& Stack);
+	virtual void HandleReplicatedStackChanged(const FInventoryStackEntry& Stack);
+	virtual void HandleReplicatedStackRemoved(const FInventoryStackEntry& Stack);
+private:
+	/** Every item, replicated to the owning connection only */
+	UPROPERTY(Replicated)
+	FInventoryItemList Items;
+
+	/** Items other players can see, replicated to every connection except the owner's */
+	UPROPERTY(Replicated)
+	FInventoryItemList VisibleItems;
+
+	UPROPERTY(Replicated)
+	FInventoryStackList Stacks;
 
-	UFUNCTION()
-	virtual void OnRep_Items();
+	/** Next id handed out to a new stack (server only) */
+	int32 NextStackId = 0;
 };
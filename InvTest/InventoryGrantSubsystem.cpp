@@ -0,0 +1,188 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InventoryGrantSubsystem.h"
+#include "InvTest.h"
+#include "InventoryComponent.h"
+#include "InventoryStats.h"
+#include "ItemAssetLoader.h"
+#include "ItemStatTable.h"
+#include "Async/ParallelFor.h"
+#include "Net/Core/PushModel/PushModel.h"
+
+DECLARE_CYCLE_STAT(TEXT("Grant Items"), STAT_Inventory_GrantItems, STATGROUP_Inventory);
+DECLARE_CYCLE_STAT(TEXT("Prepare Grants"), STAT_Inventory_PrepareGrants, STATGROUP_Inventory);
+
+bool UInventoryGrantSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UInventoryGrantSubsystem::QueueGrant(UInventoryComponent* Inventory, const TArray<FItemInstanceInitializer>& ItemInitializers)
+{
+	if (!Inventory || ItemInitializers.Num() == 0)
+	{
+		return;
+	}
+
+	if (!Inventory->GetOwner()->HasAuthority())
+	{
+		UE_LOG(LogInventory, Warning, TEXT("UInventoryGrantSubsystem::QueueGrant called on a client for %s, clients are not allowed to create items"), *Inventory->GetName());
+		return;
+	}
+
+	FItemGrant& Grant = PendingGrants.AddDefaulted_GetRef();
+	Grant.Inventory = Inventory;
+	Grant.ItemInitializers = ItemInitializers;
+}
+
+void UInventoryGrantSubsystem::Tick(float DeltaTime)
+{
+	TSharedRef<TArray<FItemGrant>> Grants = MakeShared<TArray<FItemGrant>>(MoveTemp(PendingGrants));
+
+	UItemAssetLoader* AssetLoader = UItemAssetLoader::Get();
+	if (!AssetLoader)
+	{
+		GrantItems(*Grants);
+		return;
+	}
+
+	/** One prefetch for the whole batch, most characters grant the same handful of assets */
+	TSet<FSoftObjectPath> Paths;
+	TArray<TSoftObjectPtr<UItemData>> ItemData;
+	for (const FItemGrant& Grant : *Grants)
+	{
+		for (const FItemInstanceInitializer& ItemInitializer : Grant.ItemInitializers)
+		{
+			bool bAlreadyQueued = false;
+			Paths.Add(ItemInitializer.ItemData.ToSoftObjectPath(), &bAlreadyQueued);
+			if (!bAlreadyQueued && !ItemInitializer.ItemData.IsNull())
+			{
+				ItemData.Add(ItemInitializer.ItemData);
+			}
+		}
+	}
+
+	AssetLoader->PrefetchItemData(ItemData, FStreamableDelegate::CreateWeakLambda(this, [this, Grants]()
+	{
+		GrantItems(*Grants);
+	}));
+}
+
+bool UInventoryGrantSubsystem::IsTickable() const
+{
+	return PendingGrants.Num() > 0;
+}
+
+TStatId UInventoryGrantSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UInventoryGrantSubsystem, STATGROUP_Tickables);
+}
+
+void UInventoryGrantSubsystem::GrantItems(TArray<FItemGrant>& Grants)
+{
+	INVENTORY_SCOPE(STAT_Inventory_GrantItems);
+
+	UItemAssetLoader* AssetLoader = UItemAssetLoader::Get();
+	UItemStatTable* StatTable = UItemStatTable::Get();
+
+	struct FPreparedItem
+	{
+		const FItemInstanceInitializer* ItemInitializer = nullptr;
+
+		/** Null if the initializer is invalid */
+		UItemData* ItemData = nullptr;
+		TArray<FItemModifier> Affixes;
+	};
+
+	/**
+	 * Resolve every distinct asset once on the game thread, the workers only read this map.
+	 * Their stat table rows are registered here as well, so creating the instances only looks them up.
+	 */
+	TMap<FSoftObjectPath, UItemData*> ResolvedData;
+	TArray<FPreparedItem> PreparedItems;
+	for (const FItemGrant& Grant : Grants)
+	{
+		for (const FItemInstanceInitializer& ItemInitializer : Grant.ItemInitializers)
+		{
+			PreparedItems.AddDefaulted_GetRef().ItemInitializer = &ItemInitializer;
+
+			const FSoftObjectPath& Path = ItemInitializer.ItemData.ToSoftObjectPath();
+			if (!ResolvedData.Contains(Path))
+			{
+				UItemData* ItemData = AssetLoader ? AssetLoader->ResolveItemData(ItemInitializer.ItemData) : ItemInitializer.ItemData.LoadSynchronous();
+				ResolvedData.Add(Path, ItemData);
+
+				if (ItemData && StatTable)
+				{
+					StatTable->RegisterItemData(ItemData);
+				}
+			}
+		}
+	}
+
+	/** Seeded per item from one batch seed, so the result does not depend on which worker rolled it */
+	const uint32 BatchSeed = static_cast<uint32>(FMath::Rand());
+
+	{
+		INVENTORY_SCOPE(STAT_Inventory_PrepareGrants);
+
+		ParallelFor(TEXT("InventoryGrant.Prepare"), PreparedItems.Num(), PrepareBatchSize, [&PreparedItems, &ResolvedData, BatchSeed](int32 Index)
+		{
+			FPreparedItem& PreparedItem = PreparedItems[Index];
+			const FItemInstanceInitializer& ItemInitializer = *PreparedItem.ItemInitializer;
+
+			UItemData* const* ItemData = ResolvedData.Find(ItemInitializer.ItemData.ToSoftObjectPath());
+			if (!ItemData || !UInventoryComponent::IsValidItemRequest(ItemInitializer.ItemClass, *ItemData))
+			{
+				return;
+			}
+
+			PreparedItem.ItemData = *ItemData;
+			if (ItemInitializer.bRollAffixes)
+			{
+				PreparedItem.ItemData->RollAffixes(FRandomStream(static_cast<int32>(HashCombineFast(BatchSeed, static_cast<uint32>(Index)))), PreparedItem.Affixes);
+			}
+		});
+	}
+
+	/** Create everything in one pass, marking each inventory dirty once */
+	int32 ItemIndex = 0;
+	for (const FItemGrant& Grant : Grants)
+	{
+		const int32 FirstItemIndex = ItemIndex;
+		ItemIndex += Grant.ItemInitializers.Num();
+
+		UInventoryComponent* Inventory = Grant.Inventory.Get();
+		if (!Inventory)
+		{
+			continue;
+		}
+
+		Inventory->Items.Entries.Reserve(Inventory->Items.Entries.Num() + Grant.ItemInitializers.Num());
+		Inventory->ItemEntryIndices.Reserve(Inventory->ItemEntryIndices.Num() + Grant.ItemInitializers.Num());
+
+		for (int32 Index = FirstItemIndex; Index < ItemIndex; ++Index)
+		{
+			FPreparedItem& PreparedItem = PreparedItems[Index];
+			if (!PreparedItem.ItemData)
+			{
+				UE_LOG(LogInventory, Warning, TEXT("UInventoryGrantSubsystem skipped an initializer for %s whose ItemClass and ItemData are missing or incompatible"), *Inventory->GetName());
+				continue;
+			}
+
+			FItemInstanceInitializer ItemInitializer;
+			ItemInitializer.Outer = Inventory;
+			ItemInitializer.OwnerActor = Inventory->GetOwner();
+			ItemInitializer.ItemClass = PreparedItem.ItemInitializer->ItemClass;
+			ItemInitializer.ItemData = PreparedItem.ItemData;
+			/** Already rolled, an item that rolled no affixes must not roll again */
+			ItemInitializer.bRollAffixes = PreparedItem.Affixes.Num() > 0;
+			ItemInitializer.PreRolledAffixes = MoveTemp(PreparedItem.Affixes);
+
+			Inventory->InternalCreateItem(ItemInitializer);
+		}
+
+		MARK_PROPERTY_DIRTY_FROM_NAME(UInventoryComponent, Items, Inventory);
+	}
+}
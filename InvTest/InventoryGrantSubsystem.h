@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ItemInstance.h"
+#include "InventoryGrantSubsystem.generated.h"
+
+class UInventoryComponent;
+
+/**
+ * Grants items to many inventories at once, e.g., every character's ItemsToGrant at match start.
+ *
+ * Grants queued during a frame are collected and handled as one batch at the end of the frame:
+ * the item data of the whole batch is streamed in with a single prefetch, then everything that
+ * does not touch UObjects (mapping initializers to their data, class/data validation and rolling
+ * affixes) runs in a ParallelFor, and finally all instances are created in one pass on the game
+ * thread, marking each inventory's Items dirty once.
+ *
+ * Server only, like UInventoryComponent::CreateItemsInInventory.
+ */
+UCLASS()
+class INVTEST_API UInventoryGrantSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin FTickableGameObject Interface
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	//~ End FTickableGameObject Interface
+
+	/** Queues ItemInitializers to be created in Inventory with the batch of this frame, authority only */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Items")
+	void QueueGrant(UInventoryComponent* Inventory, const TArray<FItemInstanceInitializer>& ItemInitializers);
+
+	/** Number of items per ParallelFor task when preparing a batch */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Items", meta = (ClampMin = "1"))
+	int32 PrepareBatchSize = 64;
+
+protected:
+	//~ Begin UWorldSubsystem Interface
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	//~ End UWorldSubsystem Interface
+
+private:
+	struct FItemGrant
+	{
+		TWeakObjectPtr<UInventoryComponent> Inventory;
+		TArray<FItemInstanceInitializer> ItemInitializers;
+	};
+
+	/** Creates the items of Grants, their data must be loaded */
+	void GrantItems(TArray<FItemGrant>& Grants);
+
+	/** Grants queued this frame */
+	TArray<FItemGrant> PendingGrants;
+};
@@ -0,0 +1,106 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
+#include "ItemDataId.h"
+#include "InventoryItemView.generated.h"
+
+class UItemData;
+class UItemInstance;
+
+/**
+ * Flat, display ready entry of an item instance or stack in an inventory.
+ *
+ * Filled in when the item enters the inventory, and again when its data resolves on a client or
+ * a stack's count changes, so UI can sort and filter without touching the instance.
+ * Only holds numbers and pointers, so views are cheap to copy. Name, description and tags are
+ * read from ItemData rather than copied into every view.
+ * See UInventoryComponent::QueryItemViews.
+ */
+USTRUCT(BlueprintType)
+struct FInventoryItemView
+{
+	GENERATED_BODY()
+
+	/** The instance, to act on the item (e.g., equip it), null for stacks */
+	UPROPERTY(BlueprintReadOnly)
+	TObjectPtr<UItemInstance> Item = nullptr;
+
+	/** Data of the item, for its name, description and tags. Null while a client has not resolved it yet */
+	UPROPERTY(BlueprintReadOnly)
+	TObjectPtr<UItemData> ItemData = nullptr;
+
+	/** Id of the stack, INDEX_NONE for instances */
+	UPROPERTY(BlueprintReadOnly)
+	int32 StackId = INDEX_NONE;
+
+	/** UItemInstance::GetItemGuid of the instance, invalid for stacks */
+	UPROPERTY(BlueprintReadOnly)
+	FGuid ItemGuid;
+
+	UPROPERTY(BlueprintReadOnly)
+	FItemDataId ItemDataId;
+
+	/** Value of a single unit */
+	UPROPERTY(BlueprintReadOnly)
+	int64 Value = 0;
+
+	/** Units, always 1 for instances */
+	UPROPERTY(BlueprintReadOnly)
+	int32 Count = 1;
+
+	bool IsStack() const { return StackId != INDEX_NONE; }
+};
+
+UENUM(BlueprintType)
+enum class EInventoryViewSort : uint8
+{
+	/** Storage order, changes whenever an item is removed */
+	None,
+	Name,
+	/** Value of a single unit */
+	Value,
+	/** Value of all units */
+	TotalValue,
+	Count,
+};
+
+/**
+ * Filter, sort order and page of a UInventoryComponent::QueryItemViews call.
+ */
+USTRUCT(BlueprintType)
+struct FInventoryViewQuery
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	EInventoryViewSort SortBy = EInventoryViewSort::Name;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bDescending = false;
+
+	/** Only items whose name contains this (ignoring case), empty matches everything */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FString NameFilter;
+
+	/** Only items whose tags match this query, empty matches everything */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FGameplayTagQuery TagQuery;
+
+	/** Whether stacks are included, or only item instances */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bIncludeStacks = true;
+
+	bool operator==(const FInventoryViewQuery& Other) const
+	{
+		return SortBy == Other.SortBy
+			&& bDescending == Other.bDescending
+			&& bIncludeStacks == Other.bIncludeStacks
+			&& NameFilter.Equals(Other.NameFilter, ESearchCase::IgnoreCase)
+			&& TagQuery == Other.TagQuery;
+	}
+
+	bool operator!=(const FInventoryViewQuery& Other) const { return !(*this == Other); }
+};
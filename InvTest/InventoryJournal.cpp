@@ -0,0 +1,701 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InventoryJournal.h"
+#include "InvTest.h"
+#include "InventoryComponent.h"
+#include "InventoryStats.h"
+#include "ItemDataRegistry.h"
+#include "HAL/Event.h"
+#include "HAL/FileManager.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+DECLARE_CYCLE_STAT(TEXT("Journal Record"), STAT_Inventory_JournalRecord, STATGROUP_Inventory);
+DECLARE_CYCLE_STAT(TEXT("Journal Snapshot"), STAT_Inventory_JournalSnapshot, STATGROUP_Inventory);
+DECLARE_CYCLE_STAT(TEXT("Journal Replay"), STAT_Inventory_JournalReplay, STATGROUP_Inventory);
+
+namespace InventoryJournal
+{
+	/** "INVJ" */
+	constexpr uint32 SnapshotMagic = 0x494E564A;
+
+	constexpr uint16 SnapshotVersion = 1;
+
+	/** Reads the item data id of a record */
+	UItemData* ReadItemData(FArchive& Ar, const UItemDataRegistry* Registry)
+	{
+		FItemDataId ItemDataId;
+		Ar << ItemDataId;
+
+		return Registry && !Ar.IsError() ? Registry->ResolveItemData(ItemDataId) : nullptr;
+	}
+
+	/** Number of the last complete record in a journal file, 0 if it has none */
+	uint64 ReadLastSequence(const TArray<uint8>& Bytes)
+	{
+		uint64 LastSequence = 0;
+		FMemoryReader Reader(Bytes);
+
+		while (Reader.Tell() + static_cast<int64>(sizeof(uint32)) <= Reader.TotalSize())
+		{
+			uint32 Size = 0;
+			Reader << Size;
+
+			const int64 RecordStart = Reader.Tell();
+			if (Size < sizeof(uint64) || Size > Reader.TotalSize() - RecordStart)
+			{
+				break;
+			}
+
+			uint64 Sequence = 0;
+			Reader << Sequence;
+			LastSequence = FMath::Max(LastSequence, Sequence);
+
+			Reader.Seek(RecordStart + Size);
+		}
+
+		return LastSequence;
+	}
+}
+
+//--------------------------------------------
+// FInventoryJournalWriter
+//--------------------------------------------
+FInventoryJournalWriter::FInventoryJournalWriter(const FString& InDirectory, float InFlushIntervalSeconds)
+	: Directory(InDirectory)
+	, FlushIntervalSeconds(InFlushIntervalSeconds)
+{
+	IFileManager::Get().MakeDirectory(*Directory, true);
+
+	WakeEvent = FPlatformProcess::GetSynchEventFromPool(false);
+	Thread = FRunnableThread::Create(this, TEXT("InventoryJournalWriter"), 0, TPri_BelowNormal);
+}
+
+FInventoryJournalWriter::~FInventoryJournalWriter()
+{
+	if (Thread)
+	{
+		/** Stops the loop, Run writes whatever is still queued before it returns */
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+	}
+	else
+	{
+		ProcessCommands();
+	}
+
+	OpenJournals.Reset();
+	FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+}
+
+void FInventoryJournalWriter::Append(const FString& Key, TArray<uint8>&& Record)
+{
+	FCommand Command;
+	Command.Key = Key;
+	Command.Bytes = MoveTemp(Record);
+	Enqueue(MoveTemp(Command));
+}
+
+void FInventoryJournalWriter::WriteSnapshot(const FString& Key, TArray<uint8>&& Snapshot)
+{
+	FCommand Command;
+	Command.Key = Key;
+	Command.Bytes = MoveTemp(Snapshot);
+	Command.bSnapshot = true;
+	Enqueue(MoveTemp(Command));
+}
+
+void FInventoryJournalWriter::Enqueue(FCommand&& Command)
+{
+	Commands.Enqueue(MoveTemp(Command));
+	++NumEnqueued;
+}
+
+void FInventoryJournalWriter::Flush()
+{
+	if (!Thread)
+	{
+		ProcessCommands();
+		return;
+	}
+
+	const uint64 Target = NumEnqueued;
+	WakeEvent->Trigger();
+	while (NumProcessed < Target)
+	{
+		FPlatformProcess::Sleep(0.001f);
+	}
+}
+
+FString FInventoryJournalWriter::GetJournalPath(const FString& Key) const
+{
+	return Directory / FPaths::MakeValidFileName(Key) + TEXT(".journal");
+}
+
+FString FInventoryJournalWriter::GetSnapshotPath(const FString& Key) const
+{
+	return Directory / FPaths::MakeValidFileName(Key) + TEXT(".snapshot");
+}
+
+uint32 FInventoryJournalWriter::Run()
+{
+	while (!bStopping)
+	{
+		WakeEvent->Wait(FTimespan::FromSeconds(FlushIntervalSeconds));
+		ProcessCommands();
+	}
+
+	ProcessCommands();
+	return 0;
+}
+
+void FInventoryJournalWriter::Stop()
+{
+	bStopping = true;
+	WakeEvent->Trigger();
+}
+
+void FInventoryJournalWriter::ProcessCommands()
+{
+	TSet<FArchive*> TouchedJournals;
+	uint64 Processed = 0;
+
+	FCommand Command;
+	while (Commands.Dequeue(Command))
+	{
+		++Processed;
+
+		if (Command.bSnapshot)
+		{
+			/** The snapshot replaces the journal, close it so it can be started over */
+			if (TUniquePtr<FArchive>* Journal = OpenJournals.Find(Command.Key))
+			{
+				TouchedJournals.Remove(Journal->Get());
+				OpenJournals.Remove(Command.Key);
+			}
+
+			/** Write next to the old snapshot and swap, a crash mid-write keeps the old snapshot and journal */
+			const FString SnapshotPath = GetSnapshotPath(Command.Key);
+			const FString TempPath = SnapshotPath + TEXT(".tmp");
+			if (FFileHelper::SaveArrayToFile(Command.Bytes, *TempPath) && IFileManager::Get().Move(*SnapshotPath, *TempPath, true, true))
+			{
+				IFileManager::Get().Delete(*GetJournalPath(Command.Key), false, true, true);
+			}
+			else
+			{
+				UE_LOG(LogInventory, Error, TEXT("FInventoryJournalWriter: failed to write snapshot %s"), *SnapshotPath);
+			}
+			continue;
+		}
+
+		TUniquePtr<FArchive>& Journal = OpenJournals.FindOrAdd(Command.Key);
+		if (!Journal)
+		{
+			Journal.Reset(IFileManager::Get().CreateFileWriter(*GetJournalPath(Command.Key), FILEWRITE_Append | FILEWRITE_AllowRead));
+		}
+
+		if (!Journal)
+		{
+			UE_LOG(LogInventory, Error, TEXT("FInventoryJournalWriter: failed to open %s, a record was lost"), *GetJournalPath(Command.Key));
+			continue;
+		}
+
+		Journal->Serialize(Command.Bytes.GetData(), Command.Bytes.Num());
+		TouchedJournals.Add(Journal.Get());
+	}
+
+	/** One flush per file per batch, not per record */
+	for (FArchive* Journal : TouchedJournals)
+	{
+		Journal->Flush();
+	}
+
+	NumProcessed += Processed;
+}
+
+//--------------------------------------------
+// UInventoryJournal
+//--------------------------------------------
+bool UInventoryJournal::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UInventoryJournal::Deinitialize()
+{
+	/** Don't lose snapshots that were due this frame */
+	Tick(0.f);
+
+	/** Writes everything that is still queued, then stops the thread */
+	Writer.Reset();
+
+	Super::Deinitialize();
+}
+
+void UInventoryJournal::Tick(float DeltaTime)
+{
+	TSet<TWeakObjectPtr<UInventoryComponent>> Snapshots = MoveTemp(PendingSnapshots);
+	for (const TWeakObjectPtr<UInventoryComponent>& Inventory : Snapshots)
+	{
+		if (Inventory.IsValid())
+		{
+			WriteSnapshot(Inventory.Get());
+		}
+	}
+}
+
+bool UInventoryJournal::IsTickable() const
+{
+	return PendingSnapshots.Num() > 0;
+}
+
+TStatId UInventoryJournal::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UInventoryJournal, STATGROUP_Tickables);
+}
+
+FInventoryJournalWriter& UInventoryJournal::GetWriter()
+{
+	if (!Writer)
+	{
+		Writer = MakeUnique<FInventoryJournalWriter>(FPaths::ProjectSavedDir() / TEXT("InventoryJournal"), FlushIntervalSeconds);
+	}
+	return *Writer;
+}
+
+void UInventoryJournal::OpenJournal(const FString& Key)
+{
+	if (!Key.IsEmpty())
+	{
+		OpenState(Key);
+	}
+}
+
+UInventoryJournal::FJournalState& UInventoryJournal::OpenState(const FString& Key)
+{
+	if (FJournalState* JournalState = States.Find(Key))
+	{
+		return *JournalState;
+	}
+
+	FJournalState& JournalState = States.Add(Key);
+
+	/** Anything of this key written by an earlier run (or world) has to be on disk before it is read */
+	FInventoryJournalWriter& JournalWriter = GetWriter();
+	JournalWriter.Flush();
+
+	uint64 LastSequence = 0;
+
+	TArray<uint8> Bytes;
+	if (FFileHelper::LoadFileToArray(Bytes, *JournalWriter.GetSnapshotPath(Key), FILEREAD_Silent))
+	{
+		FMemoryReader Reader(Bytes);
+
+		uint32 Magic = 0;
+		uint16 Version = 0;
+		uint64 SnapshotSequence = 0;
+		Reader << Magic << Version << SnapshotSequence;
+
+		if (!Reader.IsError() && Magic == InventoryJournal::SnapshotMagic)
+		{
+			LastSequence = SnapshotSequence;
+		}
+		JournalState.bNeedsRecovery = true;
+	}
+
+	if (FFileHelper::LoadFileToArray(Bytes, *JournalWriter.GetJournalPath(Key), FILEREAD_Silent))
+	{
+		LastSequence = FMath::Max(LastSequence, InventoryJournal::ReadLastSequence(Bytes));
+		JournalState.bNeedsRecovery = true;
+	}
+
+	JournalState.NextSequence = LastSequence + 1;
+	return JournalState;
+}
+
+UInventoryJournal::FJournalState* UInventoryJournal::FindState(UInventoryComponent* Inventory)
+{
+	FJournalState* JournalState = States.Find(Inventory->GetJournalKey());
+	if (!JournalState)
+	{
+		UE_LOG(LogInventory, Warning, TEXT("UInventoryJournal: %s was never opened, set it with UInventoryComponent::SetJournalKey"), *Inventory->GetJournalKey());
+	}
+	return JournalState;
+}
+
+void UInventoryJournal::BeginRecord(FJournalState& JournalState, FArchive& Ar, EInventoryJournalOp Op)
+{
+	/** Size is patched in by EndRecord */
+	uint32 Size = 0;
+	uint64 Sequence = JournalState.NextSequence++;
+	int64 Ticks = FDateTime::UtcNow().GetTicks();
+	uint8 OpValue = static_cast<uint8>(Op);
+	Ar << Size << Sequence << Ticks << OpValue;
+}
+
+void UInventoryJournal::EndRecord(UInventoryComponent* Inventory, FJournalState& JournalState, TArray<uint8>&& Record)
+{
+	const uint32 Size = Record.Num() - sizeof(uint32);
+	FMemory::Memcpy(Record.GetData(), &Size, sizeof(uint32));
+
+	GetWriter().Append(Inventory->GetJournalKey(), MoveTemp(Record));
+
+	if (++JournalState.RecordsSinceSnapshot >= SnapshotInterval)
+	{
+		RequestSnapshot(Inventory);
+	}
+}
+
+void UInventoryJournal::RecordItemOp(UInventoryComponent* Inventory, EInventoryJournalOp Op, UItemInstance* Item, const UInventoryComponent* Other)
+{
+	INVENTORY_SCOPE(STAT_Inventory_JournalRecord);
+
+	FJournalState* JournalState = Inventory && Item ? FindState(Inventory) : nullptr;
+	if (!JournalState)
+	{
+		return;
+	}
+
+	TArray<uint8> Record;
+	FMemoryWriter Ar(Record);
+	BeginRecord(*JournalState, Ar, Op);
+
+	FGuid ItemGuid = Item->GetItemGuid();
+	Ar << ItemGuid;
+
+	FString OtherKey = Other ? Other->GetJournalKey() : FString();
+
+	switch (Op)
+	{
+	case EInventoryJournalOp::Create:
+	case EInventoryJournalOp::TransferIn:
+	{
+		/** Everything needed to recreate the item as it is now, including its rolled affixes */
+		FString ClassPath = FSoftClassPath(Item->GetClass()).ToString();
+		FItemDataId ItemDataId = Item->GetData() ? Item->GetData()->GetItemDataId() : FItemDataId();
+
+		TArray<uint8> StateBytes;
+		FMemoryWriter StateWriter(StateBytes);
+		Item->SerializeInstanceState(StateWriter);
+
+		Ar << ClassPath << ItemDataId << OtherKey << StateBytes;
+		break;
+	}
+	case EInventoryJournalOp::Remove:
+	case EInventoryJournalOp::TransferOut:
+		Ar << OtherKey;
+		break;
+	default:
+		break;
+	}
+
+	EndRecord(Inventory, *JournalState, MoveTemp(Record));
+}
+
+void UInventoryJournal::RecordStackDelta(UInventoryComponent* Inventory, const UItemData* ItemData, int32 Delta)
+{
+	INVENTORY_SCOPE(STAT_Inventory_JournalRecord);
+
+	FJournalState* JournalState = Inventory && ItemData && Delta != 0 ? FindState(Inventory) : nullptr;
+	if (!JournalState)
+	{
+		return;
+	}
+
+	TArray<uint8> Record;
+	FMemoryWriter Ar(Record);
+	BeginRecord(*JournalState, Ar, EInventoryJournalOp::StackDelta);
+
+	FItemDataId ItemDataId = ItemData->GetItemDataId();
+	Ar << ItemDataId << Delta;
+
+	EndRecord(Inventory, *JournalState, MoveTemp(Record));
+}
+
+void UInventoryJournal::RequestSnapshot(UInventoryComponent* Inventory)
+{
+	if (!Inventory || Inventory->GetJournalKey().IsEmpty())
+	{
+		return;
+	}
+
+	const FJournalState* JournalState = FindState(Inventory);
+	if (!JournalState)
+	{
+		return;
+	}
+
+	/** The inventory does not hold what is on disk yet, a snapshot of it would replace the saved state */
+	if (JournalState->bNeedsRecovery)
+	{
+		UE_LOG(LogInventory, Verbose, TEXT("UInventoryJournal: not snapshotting %s, it has not been recovered yet"), *Inventory->GetJournalKey());
+		return;
+	}
+
+	PendingSnapshots.Add(Inventory);
+}
+
+void UInventoryJournal::WriteSnapshot(UInventoryComponent* Inventory)
+{
+	INVENTORY_SCOPE(STAT_Inventory_JournalSnapshot);
+
+	const FString& Key = Inventory->GetJournalKey();
+	if (Key.IsEmpty())
+	{
+		return;
+	}
+
+	FJournalState* JournalState = FindState(Inventory);
+	if (!JournalState || JournalState->bNeedsRecovery)
+	{
+		return;
+	}
+
+	TArray<uint8> SnapshotBytes;
+	Inventory->SaveInventoryToBytes(SnapshotBytes);
+
+	TArray<uint8> File;
+	FMemoryWriter Ar(File);
+
+	uint32 Magic = InventoryJournal::SnapshotMagic;
+	uint16 Version = InventoryJournal::SnapshotVersion;
+	uint64 LastSequence = JournalState->NextSequence - 1;
+	Ar << Magic << Version << LastSequence << SnapshotBytes;
+
+	GetWriter().WriteSnapshot(Key, MoveTemp(File));
+	JournalState->RecordsSinceSnapshot = 0;
+
+	/** Snapshots don't hold item actors, start the new journal with the ones that are (about to be) spawned */
+	for (UItemInstance* Item : Inventory->GetItemInstances())
+	{
+		if (Inventory->IsItemActorSpawned(Item))
+		{
+			RecordItemOp(Inventory, EInventoryJournalOp::SpawnActor, Item);
+		}
+	}
+}
+
+bool UInventoryJournal::RecoverInventory(UInventoryComponent* Inventory)
+{
+	INVENTORY_SCOPE(STAT_Inventory_JournalReplay);
+
+	if (!Inventory || !Inventory->GetOwner()->HasAuthority() || Inventory->GetJournalKey().IsEmpty())
+	{
+		UE_LOG(LogInventory, Warning, TEXT("UInventoryJournal::RecoverInventory needs an inventory with a journal key on the authority"));
+		return false;
+	}
+
+	const FString& Key = Inventory->GetJournalKey();
+	const double StartTime = FPlatformTime::Seconds();
+
+	/** Records of this inventory may still be queued */
+	FInventoryJournalWriter& JournalWriter = GetWriter();
+	JournalWriter.Flush();
+
+	bool bFoundAnything = false;
+	uint64 LastSequence = 0;
+	int32 NumRecords = 0;
+	{
+		/** Replaying must not journal the replayed operations again */
+		TGuardValue<bool> SuspendJournal(Inventory->bJournalSuspended, true);
+
+		TArray<uint8> Bytes;
+		if (FFileHelper::LoadFileToArray(Bytes, *JournalWriter.GetSnapshotPath(Key), FILEREAD_Silent))
+		{
+			FMemoryReader Reader(Bytes);
+
+			uint32 Magic = 0;
+			uint16 Version = 0;
+			TArray<uint8> SnapshotBytes;
+			Reader << Magic << Version << LastSequence << SnapshotBytes;
+
+			if (Reader.IsError() || Magic != InventoryJournal::SnapshotMagic || Version != InventoryJournal::SnapshotVersion)
+			{
+				UE_LOG(LogInventory, Error, TEXT("UInventoryJournal::RecoverInventory: snapshot of %s is malformed"), *Key);
+				return false;
+			}
+
+			if (!Inventory->LoadInventoryFromBytes(SnapshotBytes))
+			{
+				return false;
+			}
+			bFoundAnything = true;
+		}
+		else
+		{
+			/** No snapshot yet, the journal starts from an empty inventory */
+			Inventory->InternalClearInventory();
+		}
+
+		if (FFileHelper::LoadFileToArray(Bytes, *JournalWriter.GetJournalPath(Key), FILEREAD_Silent))
+		{
+			LastSequence = ReplayJournal(Inventory, Bytes, LastSequence, NumRecords);
+			bFoundAnything = true;
+		}
+	}
+
+	if (!bFoundAnything)
+	{
+		return false;
+	}
+
+	FJournalState& JournalState = OpenState(Key);
+	JournalState.NextSequence = FMath::Max(JournalState.NextSequence, LastSequence + 1);
+	JournalState.bNeedsRecovery = false;
+
+	UE_LOG(LogInventory, Log, TEXT("UInventoryJournal: recovered %s, replayed %d records in %.2f ms"), *Key, NumRecords, (FPlatformTime::Seconds() - StartTime) * 1000.0);
+
+	/** Compact right away, the next recovery only has to load the snapshot */
+	WriteSnapshot(Inventory);
+
+	return true;
+}
+
+uint64 UInventoryJournal::ReplayJournal(UInventoryComponent* Inventory, const TArray<uint8>& Bytes, uint64 AfterSequence, int32& OutNumRecords)
+{
+	UItemDataRegistry* Registry = UItemDataRegistry::Get();
+
+	TMap<FGuid, UItemInstance*> ItemsByGuid;
+	for (UItemInstance* Item : Inventory->GetItemInstances())
+	{
+		ItemsByGuid.Add(Item->GetItemGuid(), Item);
+	}
+
+	/** Only the final state of each item actor matters, it is applied once at the end */
+	TMap<FGuid, bool> ItemActorStates;
+
+	uint64 LastSequence = AfterSequence;
+	FMemoryReader Reader(Bytes);
+	TArray<uint8> RecordBytes;
+
+	while (Reader.Tell() + static_cast<int64>(sizeof(uint32)) <= Reader.TotalSize())
+	{
+		uint32 Size = 0;
+		Reader << Size;
+		if (Size > Reader.TotalSize() - Reader.Tell())
+		{
+			UE_LOG(LogInventory, Warning, TEXT("UInventoryJournal: the last record of %s was torn, it is ignored"), *Inventory->GetJournalKey());
+			break;
+		}
+
+		RecordBytes.SetNumUninitialized(Size, EAllowShrinking::No);
+		Reader.Serialize(RecordBytes.GetData(), Size);
+
+		FMemoryReader Record(RecordBytes);
+
+		uint64 Sequence = 0;
+		int64 Ticks = 0;
+		uint8 OpValue = 0;
+		Record << Sequence << Ticks << OpValue;
+
+		if (Record.IsError())
+		{
+			break;
+		}
+
+		/** Already part of the snapshot */
+		if (Sequence <= AfterSequence)
+		{
+			continue;
+		}
+
+		LastSequence = Sequence;
+		++OutNumRecords;
+
+		FGuid ItemGuid;
+		switch (static_cast<EInventoryJournalOp>(OpValue))
+		{
+		case EInventoryJournalOp::Create:
+		case EInventoryJournalOp::TransferIn:
+		{
+			FString ClassPath;
+			FString OtherKey;
+			TArray<uint8> StateBytes;
+			Record << ItemGuid << ClassPath;
+			UItemData* ItemData = InventoryJournal::ReadItemData(Record, Registry);
+			Record << OtherKey << StateBytes;
+
+			UClass* ItemClass = FSoftClassPath(ClassPath).TryLoadClass<UItemInstance>();
+			if (Record.IsError() || !ItemClass || !ItemData)
+			{
+				UE_LOG(LogInventory, Warning, TEXT("UInventoryJournal: skipped record %llu, its item class or data could not be loaded"), Sequence);
+				break;
+			}
+
+			UItemInstance* Item = Inventory->InternalCreateItem(ItemClass, ItemData, false);
+			if (!Item)
+			{
+				break;
+			}
+
+			Item->ItemGuid = ItemGuid;
+			Inventory->UpdateItemView(Item);
+
+			FMemoryReader StateReader(StateBytes);
+			Item->SerializeInstanceState(StateReader);
+
+			ItemsByGuid.Add(ItemGuid, Item);
+			break;
+		}
+		case EInventoryJournalOp::Remove:
+		case EInventoryJournalOp::TransferOut:
+		{
+			Record << ItemGuid;
+
+			UItemInstance* Item = nullptr;
+			if (ItemsByGuid.RemoveAndCopyValue(ItemGuid, Item) && Inventory->InternalRemoveItem(Item))
+			{
+				Item->MarkAsGarbage();
+			}
+			ItemActorStates.Remove(ItemGuid);
+			break;
+		}
+		case EInventoryJournalOp::SpawnActor:
+		case EInventoryJournalOp::DestroyActor:
+			Record << ItemGuid;
+			ItemActorStates.Add(ItemGuid, static_cast<EInventoryJournalOp>(OpValue) == EInventoryJournalOp::SpawnActor);
+			break;
+		case EInventoryJournalOp::StackDelta:
+		{
+			UItemData* ItemData = InventoryJournal::ReadItemData(Record, Registry);
+			int32 Delta = 0;
+			Record << Delta;
+			if (Record.IsError() || !ItemData)
+			{
+				break;
+			}
+
+			if (Delta > 0)
+			{
+				Inventory->AddStackableItem(ItemData, Delta);
+			}
+			else
+			{
+				Inventory->RemoveStackableItem(ItemData, -Delta);
+			}
+			break;
+		}
+		default:
+			UE_LOG(LogInventory, Warning, TEXT("UInventoryJournal: skipped record %llu with unknown op %d"), Sequence, OpValue);
+			break;
+		}
+	}
+
+	for (const TPair<FGuid, bool>& ItemActorState : ItemActorStates)
+	{
+		if (UItemInstance* const* Item = ItemsByGuid.Find(ItemActorState.Key))
+		{
+			Inventory->RequestItemActorSpawned(*Item, ItemActorState.Value);
+		}
+	}
+
+	MARK_PROPERTY_DIRTY_FROM_NAME(UInventoryComponent, Items, Inventory);
+	MARK_PROPERTY_DIRTY_FROM_NAME(UInventoryComponent, Stacks, Inventory);
+
+	return LastSequence;
+}
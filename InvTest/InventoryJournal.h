@@ -0,0 +1,212 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "HAL/Runnable.h"
+#include "Containers/Queue.h"
+#include "InventoryJournal.generated.h"
+
+class UInventoryComponent;
+class UItemInstance;
+class UItemData;
+class FRunnableThread;
+class FEvent;
+
+/**
+ * Operations recorded in the inventory journal.
+ */
+UENUM(BlueprintType)
+enum class EInventoryJournalOp : uint8
+{
+	/** An item was created in (or promoted from a stack into) the inventory */
+	Create,
+	Remove,
+	/** An item arrived from another inventory */
+	TransferIn,
+	/** An item left for another inventory */
+	TransferOut,
+	SpawnActor,
+	DestroyActor,
+	/** Units of a stackable item were added (positive) or removed (negative) */
+	StackDelta,
+};
+
+/**
+ * Appends journal records and writes snapshots on a background thread.
+ *
+ * The game thread only pushes finished byte buffers onto a queue. The thread wakes up every
+ * FlushInterval seconds, writes everything queued since the last time, and flushes every
+ * touched file once per batch.
+ */
+class FInventoryJournalWriter : public FRunnable
+{
+public:
+	FInventoryJournalWriter(const FString& InDirectory, float InFlushIntervalSeconds);
+	virtual ~FInventoryJournalWriter() override;
+
+	/** Queues a record for the journal of Key, game thread only */
+	void Append(const FString& Key, TArray<uint8>&& Record);
+
+	/** Queues a snapshot for Key, the journal of Key is started over once the snapshot is on disk, game thread only */
+	void WriteSnapshot(const FString& Key, TArray<uint8>&& Snapshot);
+
+	/** Blocks until everything queued so far is on disk, only for recovery and shutdown */
+	void Flush();
+
+	FString GetJournalPath(const FString& Key) const;
+	FString GetSnapshotPath(const FString& Key) const;
+
+	//~ Begin FRunnable Interface
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+	//~ End FRunnable Interface
+
+private:
+	struct FCommand
+	{
+		FString Key;
+		TArray<uint8> Bytes;
+		bool bSnapshot = false;
+	};
+
+	/** Writes everything that is queued, runs on the writer thread */
+	void ProcessCommands();
+
+	void Enqueue(FCommand&& Command);
+
+	TQueue<FCommand, EQueueMode::Spsc> Commands;
+
+	/** Journal files that are open for appending, by key (writer thread only) */
+	TMap<FString, TUniquePtr<FArchive>> OpenJournals;
+
+	FString Directory;
+	float FlushIntervalSeconds;
+
+	FEvent* WakeEvent = nullptr;
+	FRunnableThread* Thread = nullptr;
+	TAtomic<bool> bStopping { false };
+
+	/** Commands queued and written so far, Flush waits for these to match */
+	TAtomic<uint64> NumEnqueued { 0 };
+	TAtomic<uint64> NumProcessed { 0 };
+};
+
+/**
+ * Append-only binary journal of inventory operations, for auditing and crash recovery.
+ *
+ * Every inventory with a journal key (see UInventoryComponent::SetJournalKey) records creates,
+ * removes, transfers, item actor spawns/destroys and stack changes on the server. Every
+ * SnapshotInterval records the inventory is snapshotted with SaveInventoryToBytes and its journal
+ * starts over, so recovery loads the last snapshot and replays at most that many records.
+ *
+ * Records are numbered per key and snapshots store the last number they contain, so a crash
+ * between writing a snapshot and starting the journal over does not replay anything twice.
+ * Numbering continues from the files on disk across runs, they are read when the key is opened by
+ * SetJournalKey or RecoverInventory, never while recording. Records are length prefixed, a record
+ * torn by a crash ends the replay.
+ *
+ * A key with files on disk is not snapshotted until RecoverInventory has read them, so setting
+ * the key on a fresh (empty) inventory can't overwrite the saved state. Operations recorded
+ * before the recovery are appended to the journal and replayed on top of it.
+ *
+ * Runtime changes to an item's modifiers are not journaled, they are picked up by the next snapshot.
+ */
+UCLASS()
+class INVTEST_API UInventoryJournal : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem Interface
+	virtual void Deinitialize() override;
+	//~ End USubsystem Interface
+
+	//~ Begin FTickableGameObject Interface
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	//~ End FTickableGameObject Interface
+
+	/**
+	 * @brief Reads where the numbering of Key left off in the files on disk.
+	 *
+	 * Blocks on disk I/O, called by UInventoryComponent::SetJournalKey so recording never has to.
+	 * Records of keys that were not opened are dropped.
+	 */
+	void OpenJournal(const FString& Key);
+
+	/** Records an item operation of Inventory, Other is the other inventory of a transfer */
+	void RecordItemOp(UInventoryComponent* Inventory, EInventoryJournalOp Op, UItemInstance* Item, const UInventoryComponent* Other = nullptr);
+
+	/** Records Delta units of a stackable item being added to (or removed from) Inventory */
+	void RecordStackDelta(UInventoryComponent* Inventory, const UItemData* ItemData, int32 Delta);
+
+	/**
+	 * @brief Snapshots Inventory at the end of the frame, starting its journal over.
+	 *
+	 * Ignored while the inventory's key has files on disk that RecoverInventory has not read yet.
+	 */
+	void RequestSnapshot(UInventoryComponent* Inventory);
+
+	/**
+	 * @brief Rebuilds Inventory from its last snapshot and journal, then snapshots the result.
+	 *
+	 * Reads from disk on the game thread, meant to be called once when the inventory's owner is set up.
+	 * Authority only.
+	 * @return false if nothing was found for the inventory's journal key, or the snapshot could not be loaded
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Items|Journal")
+	bool RecoverInventory(UInventoryComponent* Inventory);
+
+	/** Number of records after which an inventory is snapshotted */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Items|Journal", meta = (ClampMin = "1"))
+	int32 SnapshotInterval = 500;
+
+	/** Seconds between batched writes of the background writer */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Items|Journal", meta = (ClampMin = "0.01"))
+	float FlushIntervalSeconds = 0.5f;
+
+protected:
+	//~ Begin UWorldSubsystem Interface
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	//~ End UWorldSubsystem Interface
+
+private:
+	/** Per journal key bookkeeping */
+	struct FJournalState
+	{
+		/** Number of the next record, continues after the last one on disk */
+		uint64 NextSequence = 1;
+		int32 RecordsSinceSnapshot = 0;
+
+		/** Whether the key has a snapshot or journal on disk that was not recovered yet, it must not be snapshotted over */
+		bool bNeedsRecovery = false;
+	};
+
+	/** State of Key, read from the files on disk the first time so numbering continues where the last run left off, blocks */
+	FJournalState& OpenState(const FString& Key);
+
+	/** State of Inventory's key if it was opened, never touches the disk */
+	FJournalState* FindState(UInventoryComponent* Inventory);
+
+	/** The writer, started on first use so clients never start a thread */
+	FInventoryJournalWriter& GetWriter();
+
+	/** Assigns the next record number of the key and writes the record header */
+	void BeginRecord(FJournalState& JournalState, FArchive& Ar, EInventoryJournalOp Op);
+	void EndRecord(UInventoryComponent* Inventory, FJournalState& State, TArray<uint8>&& Record);
+
+	void WriteSnapshot(UInventoryComponent* Inventory);
+
+	/** Applies the records of Bytes newer than AfterSequence, returns the number of the last applied record */
+	uint64 ReplayJournal(UInventoryComponent* Inventory, const TArray<uint8>& Bytes, uint64 AfterSequence, int32& OutNumRecords);
+
+	TUniquePtr<FInventoryJournalWriter> Writer;
+
+	TMap<FString, FJournalState> States;
+
+	/** Inventories to snapshot at the end of the frame */
+	TSet<TWeakObjectPtr<UInventoryComponent>> PendingSnapshots;
+};
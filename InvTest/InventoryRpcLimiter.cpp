@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InventoryRpcLimiter.h"
+#include "InvTest.h"
+#include "Engine/NetConnection.h"
+
+namespace InventoryRpcLimiter
+{
+	/** Buckets are pruned once every this many calls */
+	constexpr int32 PruneInterval = 1024;
+}
+
+bool UInventoryRpcLimiter::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+bool UInventoryRpcLimiter::ConsumeTokens(const UNetConnection* Connection, float Cost)
+{
+	/** Local calls (listen server host, standalone) are not limited */
+	if (!Connection)
+	{
+		return true;
+	}
+
+	const double Now = FPlatformTime::Seconds();
+
+	if (++CallsSincePrune >= InventoryRpcLimiter::PruneInterval)
+	{
+		PruneBuckets(Now);
+	}
+
+	FInventoryRpcBucket* Bucket = Buckets.Find(Connection);
+	if (!Bucket)
+	{
+		Bucket = &Buckets.Add(Connection);
+		Bucket->Tokens = BurstSize;
+		Bucket->LastRefillTime = Now;
+	}
+
+	Bucket->Tokens = FMath::Min(BurstSize, Bucket->Tokens + static_cast<float>(Now - Bucket->LastRefillTime) * TokensPerSecond);
+	Bucket->LastRefillTime = Now;
+
+	/** A batch costing more than a full bucket takes the whole bucket, rather than never getting through */
+	Cost = FMath::Min(Cost, BurstSize);
+
+	if (Bucket->Tokens < Cost)
+	{
+		++NumRejected;
+		UE_LOG(LogInventory, Verbose, TEXT("UInventoryRpcLimiter: dropped an rpc from %s"), *Connection->LowLevelGetRemoteAddress());
+		return false;
+	}
+
+	Bucket->Tokens -= Cost;
+	return true;
+}
+
+void UInventoryRpcLimiter::PruneBuckets(double Now)
+{
+	CallsSincePrune = 0;
+
+	const double RefillSeconds = TokensPerSecond > 0.f ? BurstSize / TokensPerSecond : UE_DOUBLE_BIG_NUMBER;
+
+	for (auto It = Buckets.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().ResolveObjectPtr() || Now - It.Value().LastRefillTime >= RefillSeconds)
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
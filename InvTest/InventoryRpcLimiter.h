@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "InventoryRpcLimiter.generated.h"
+
+class UNetConnection;
+
+/**
+ * Token bucket of a single connection.
+ */
+struct FInventoryRpcBucket
+{
+	float Tokens = 0.f;
+	double LastRefillTime = 0.0;
+};
+
+/**
+ * Per-connection token bucket rate limiting for inventory server rpcs.
+ *
+ * Every connection gets BurstSize tokens, refilled at TokensPerSecond. Each rpc costs
+ * tokens (more for expensive ones), an rpc that can't pay is dropped before doing any work.
+ * Shared by every inventory in the world, so spreading spam over several inventories doesn't help.
+ *
+ * Only exists in game worlds, and is only used on the authority.
+ */
+UCLASS()
+class INVTEST_API UInventoryRpcLimiter : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * @brief Takes Cost tokens from Connection's bucket, at most BurstSize.
+	 * @return false if the bucket does not hold enough tokens, the rpc should be dropped
+	 */
+	bool ConsumeTokens(const UNetConnection* Connection, float Cost = 1.f);
+
+	/** Number of rpcs dropped so far */
+	UFUNCTION(BlueprintPure, Category = "Items|Rpc Limits")
+	int32 GetNumRejected() const { return NumRejected; }
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Items|Rpc Limits", meta = (ClampMin = "0"))
+	float TokensPerSecond = 20.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Items|Rpc Limits", meta = (ClampMin = "1"))
+	float BurstSize = 40.f;
+
+protected:
+	//~ Begin UWorldSubsystem Interface
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	//~ End UWorldSubsystem Interface
+
+private:
+	/** Drops buckets of connections that have been quiet long enough to be full again (or are gone) */
+	void PruneBuckets(double Now);
+
+	TMap<TObjectKey<UNetConnection>, FInventoryRpcBucket> Buckets;
+
+	int32 NumRejected = 0;
+	int32 CallsSincePrune = 0;
+};
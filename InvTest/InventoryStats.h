@@ -0,0 +1,33 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+/**
+ * Stats for inventory and item instance operations, view them with "stat Inventory".
+ */
+DECLARE_STATS_GROUP(TEXT("Inventory"), STATGROUP_Inventory, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Create Item"), STAT_Inventory_CreateItem, STATGROUP_Inventory, INVTEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Remove Item"), STAT_Inventory_RemoveItem, STATGROUP_Inventory, INVTEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Spawn Item Actor"), STAT_Inventory_SpawnItemActor, STATGROUP_Inventory, INVTEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Destroy Item Actor"), STAT_Inventory_DestroyItemActor, STATGROUP_Inventory, INVTEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Replication Callbacks"), STAT_Inventory_ReplicationCallbacks, STATGROUP_Inventory, INVTEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Lookup"), STAT_Inventory_Lookup, STATGROUP_Inventory, INVTEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Transfer Items"), STAT_Inventory_TransferItems, STATGROUP_Inventory, INVTEST_API);
+
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Live Item Instances"), STAT_Inventory_LiveItemInstances, STATGROUP_Inventory, INVTEST_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Live Item Actors"), STAT_Inventory_LiveItemActors, STATGROUP_Inventory, INVTEST_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Inventories"), STAT_Inventory_Inventories, STATGROUP_Inventory, INVTEST_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Items In Inventories"), STAT_Inventory_ItemsInInventories, STATGROUP_Inventory, INVTEST_API);
+
+/**
+ * Times the enclosing scope with a STATGROUP_Inventory cycle counter, and emits
+ * an Unreal Insights CPU event of the same name. Compiles out with stats/tracing.
+ */
+#define INVENTORY_SCOPE(StatName) \
+	SCOPE_CYCLE_COUNTER(StatName); \
+	TRACE_CPUPROFILER_EVENT_SCOPE(StatName)
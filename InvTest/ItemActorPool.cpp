@@ -0,0 +1,184 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ItemActorPool.h"
+#include "InvTest.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+
+DECLARE_STATS_GROUP(TEXT("ItemActorPool"), STATGROUP_ItemActorPool, STATCAT_Advanced);
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pool Hits"), STAT_ItemActorPool_Hits, STATGROUP_ItemActorPool);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pool Misses"), STAT_ItemActorPool_Misses, STATGROUP_ItemActorPool);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled Actors"), STAT_ItemActorPool_PooledActors, STATGROUP_ItemActorPool);
+
+void UItemActorPool::Deinitialize()
+{
+	for (TPair<TSubclassOf<AActor>, FItemActorPoolBucket>& Pair : Buckets)
+	{
+		DEC_DWORD_STAT_BY(STAT_ItemActorPool_PooledActors, Pair.Value.InactiveActors.Num());
+	}
+	Buckets.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UItemActorPool::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+AActor* UItemActorPool::AcquireItemActor(TSubclassOf<AActor> ItemActorClass, const FTransform& SpawnTransform, AActor* Owner)
+{
+	if (!ItemActorClass)
+	{
+		return nullptr;
+	}
+
+	AActor* ItemActor = nullptr;
+
+	if (FItemActorPoolBucket* Bucket = Buckets.Find(ItemActorClass))
+	{
+		/** Pooled actors may have been destroyed from outside (e.g., level cleanup), skip those */
+		while (!ItemActor && Bucket->InactiveActors.Num() > 0)
+		{
+			ItemActor = Bucket->InactiveActors.Pop(EAllowShrinking::No);
+			DEC_DWORD_STAT(STAT_ItemActorPool_PooledActors);
+
+			if (!IsValid(ItemActor))
+			{
+				ItemActor = nullptr;
+			}
+		}
+	}
+
+	if (ItemActor)
+	{
+		++NumHits;
+		INC_DWORD_STAT(STAT_ItemActorPool_Hits);
+	}
+	else
+	{
+		++NumMisses;
+		INC_DWORD_STAT(STAT_ItemActorPool_Misses);
+
+		ItemActor = SpawnInactiveActor(ItemActorClass);
+		if (!ItemActor)
+		{
+			return nullptr;
+		}
+	}
+
+	ActivateActor(ItemActor, SpawnTransform, Owner);
+
+	return ItemActor;
+}
+
+void UItemActorPool::ReleaseItemActor(AActor* ItemActor)
+{
+	if (!IsValid(ItemActor))
+	{
+		return;
+	}
+
+	FItemActorPoolBucket& Bucket = Buckets.FindOrAdd(ItemActor->GetClass());
+
+	if (Bucket.InactiveActors.Num() >= GetCapacity(Bucket))
+	{
+		ItemActor->Destroy();
+		return;
+	}
+
+	DeactivateActor(ItemActor);
+	Bucket.InactiveActors.Add(ItemActor);
+	INC_DWORD_STAT(STAT_ItemActorPool_PooledActors);
+}
+
+void UItemActorPool::PrewarmPool(TSubclassOf<AActor> ItemActorClass, int32 Count)
+{
+	if (!ItemActorClass)
+	{
+		return;
+	}
+
+	FItemActorPoolBucket& Bucket = Buckets.FindOrAdd(ItemActorClass);
+	const int32 TargetCount = FMath::Min(Count, GetCapacity(Bucket));
+
+	Bucket.InactiveActors.Reserve(TargetCount);
+	while (Bucket.InactiveActors.Num() < TargetCount)
+	{
+		AActor* ItemActor = SpawnInactiveActor(ItemActorClass);
+		if (!ItemActor)
+		{
+			break;
+		}
+
+		Bucket.InactiveActors.Add(ItemActor);
+		INC_DWORD_STAT(STAT_ItemActorPool_PooledActors);
+	}
+}
+
+void UItemActorPool::SetPoolCapacity(TSubclassOf<AActor> ItemActorClass, int32 Capacity)
+{
+	if (!ItemActorClass)
+	{
+		return;
+	}
+
+	FItemActorPoolBucket& Bucket = Buckets.FindOrAdd(ItemActorClass);
+	Bucket.Capacity = FMath::Max(0, Capacity);
+
+	while (Bucket.InactiveActors.Num() > Bucket.Capacity)
+	{
+		if (AActor* ItemActor = Bucket.InactiveActors.Pop(EAllowShrinking::No))
+		{
+			ItemActor->Destroy();
+		}
+		DEC_DWORD_STAT(STAT_ItemActorPool_PooledActors);
+	}
+}
+
+AActor* UItemActorPool::SpawnInactiveActor(TSubclassOf<AActor> ItemActorClass)
+{
+	UWorld* World = GetWorld();
+	check(World);
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	AActor* ItemActor = World->SpawnActor<AActor>(ItemActorClass, FTransform::Identity, SpawnParams);
+	if (!ItemActor)
+	{
+		UE_LOG(LogInventory, Error, TEXT("UItemActorPool failed to spawn an actor of class %s"), *GetNameSafe(ItemActorClass));
+		return nullptr;
+	}
+
+	DeactivateActor(ItemActor);
+
+	return ItemActor;
+}
+
+void UItemActorPool::ActivateActor(AActor* ItemActor, const FTransform& SpawnTransform, AActor* Owner)
+{
+	ItemActor->SetActorTransform(SpawnTransform, false, nullptr, ETeleportType::ResetPhysics);
+	ItemActor->SetOwner(Owner);
+	ItemActor->SetActorHiddenInGame(false);
+	ItemActor->SetActorEnableCollision(true);
+	ItemActor->SetActorTickEnabled(true);
+	ItemActor->SetReplicates(true);
+}
+
+void UItemActorPool::DeactivateActor(AActor* ItemActor)
+{
+	/** Stop replicating first so clients drop the actor instead of receiving the hidden state */
+	ItemActor->SetReplicates(false);
+	ItemActor->SetActorHiddenInGame(true);
+	ItemActor->SetActorEnableCollision(false);
+	ItemActor->SetActorTickEnabled(false);
+	ItemActor->SetOwner(nullptr);
+}
+
+int32 UItemActorPool::GetCapacity(const FItemActorPoolBucket& Bucket) const
+{
+	return Bucket.Capacity == INDEX_NONE ? DefaultCapacity : Bucket.Capacity;
+}
@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ItemActorPool.generated.h"
+
+/**
+ * Inactive item actors of a single class.
+ */
+USTRUCT()
+struct FItemActorPoolBucket
+{
+	GENERATED_BODY()
+
+	/** Hidden, non-replicating actors ready to be reused */
+	UPROPERTY()
+	TArray<TObjectPtr<AActor>> InactiveActors;
+
+	/** Max number of inactive actors kept for this class, INDEX_NONE uses the pool's DefaultCapacity */
+	int32 Capacity = INDEX_NONE;
+};
+
+/**
+ * Per-world pool of item actors, keyed by UItemData::GetItemActorClass().
+ *
+ * Instead of destroying item actors, they are hidden, have collision/ticking
+ * disabled and stop replicating. The next request for the same class reuses them,
+ * which avoids the SpawnActor/Destroy churn (and the actor channel setup/teardown)
+ * when players swap items constantly.
+ *
+ * Only exists in game worlds, and should only be used on the authority.
+ */
+UCLASS()
+class INVTEST_API UItemActorPool : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem Interface
+	virtual void Deinitialize() override;
+	//~ End USubsystem Interface
+
+	/**
+	 * @brief Takes an actor of ItemActorClass out of the pool, or spawns a new one if the pool is empty.
+	 *
+	 * The returned actor is visible, collides, ticks and replicates.
+	 * @return the activated actor, or nullptr if spawning failed
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Items|Pool")
+	AActor* AcquireItemActor(TSubclassOf<AActor> ItemActorClass, const FTransform& SpawnTransform, AActor* Owner);
+
+	/**
+	 * @brief Returns an actor to the pool. If the pool for its class is full the actor is destroyed.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Items|Pool")
+	void ReleaseItemActor(AActor* ItemActor);
+
+	/**
+	 * @brief Spawns inactive actors until the pool for ItemActorClass holds Count actors (clamped to capacity)
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Items|Pool")
+	void PrewarmPool(TSubclassOf<AActor> ItemActorClass, int32 Count);
+
+	/**
+	 * @brief Sets how many inactive actors are kept for ItemActorClass, destroying any excess.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Items|Pool")
+	void SetPoolCapacity(TSubclassOf<AActor> ItemActorClass, int32 Capacity);
+
+	/** Number of AcquireItemActor calls served from the pool */
+	UFUNCTION(BlueprintPure, Category = "Items|Pool")
+	int32 GetNumHits() const { return NumHits; }
+
+	/** Number of AcquireItemActor calls that had to spawn a new actor */
+	UFUNCTION(BlueprintPure, Category = "Items|Pool")
+	int32 GetNumMisses() const { return NumMisses; }
+
+	/** Capacity used for classes that were not given one through SetPoolCapacity */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Items|Pool")
+	int32 DefaultCapacity = 16;
+
+protected:
+	//~ Begin UWorldSubsystem Interface
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	//~ End UWorldSubsystem Interface
+
+private:
+	AActor* SpawnInactiveActor(TSubclassOf<AActor> ItemActorClass);
+	void ActivateActor(AActor* ItemActor, const FTransform& SpawnTransform, AActor* Owner);
+	void DeactivateActor(AActor* ItemActor);
+	int32 GetCapacity(const FItemActorPoolBucket& Bucket) const;
+
+	UPROPERTY()
+	TMap<TSubclassOf<AActor>, FItemActorPoolBucket> Buckets;
+
+	int32 NumHits = 0;
+	int32 NumMisses = 0;
+};
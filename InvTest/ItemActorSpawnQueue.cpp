@@ -0,0 +1,237 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ItemActorSpawnQueue.h"
+#include "InvTest.h"
+#include "InventoryComponent.h"
+#include "InventoryStats.h"
+#include "ItemInstance.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+
+DECLARE_CYCLE_STAT(TEXT("Process Item Actor Requests"), STAT_Inventory_ProcessItemActorRequests, STATGROUP_Inventory);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pending Item Actor Requests"), STAT_Inventory_PendingItemActorRequests, STATGROUP_Inventory);
+
+void UItemActorSpawnQueue::Deinitialize()
+{
+	DEC_DWORD_STAT_BY(STAT_Inventory_PendingItemActorRequests, PendingRequests.Num());
+	PendingRequests.Empty();
+	RequestHeap.Empty();
+	RelevanceByOwner.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UItemActorSpawnQueue::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+bool UItemActorSpawnQueue::IsTickable() const
+{
+	return PendingRequests.Num() > 0;
+}
+
+TStatId UItemActorSpawnQueue::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UItemActorSpawnQueue, STATGROUP_Tickables);
+}
+
+bool UItemActorSpawnQueue::EnqueueRequest(UInventoryComponent* Inventory, UItemInstance* Item, EItemActorRequestType Type)
+{
+	if (!Inventory || !Item)
+	{
+		return false;
+	}
+
+	if (const FItemActorRequest* Pending = PendingRequests.Find(Item))
+	{
+		if (Pending->Type == Type)
+		{
+			return false;
+		}
+
+		/** Spawn then destroy (or destroy then spawn) leaves the item as it is now */
+		CancelRequest(Item);
+		return true;
+	}
+
+	FItemActorRequest& Request = PendingRequests.Add(Item);
+	Request.Inventory = Inventory;
+	Request.Item = Item;
+	Request.Type = Type;
+	Request.Sequence = NextSequence++;
+	INC_DWORD_STAT(STAT_Inventory_PendingItemActorRequests);
+
+	FQueuedRequest Queued;
+	Queued.Key = Item;
+	Queued.Sequence = Request.Sequence;
+	Queued.Type = Type;
+	Queued.Relevance = Type == EItemActorRequestType::Spawn ? GetOwnerRelevance(Inventory) : 0;
+	RequestHeap.HeapPush(Queued, FQueuedRequestOrder());
+
+	return true;
+}
+
+void UItemActorSpawnQueue::CancelRequest(const UItemInstance* Item)
+{
+	if (PendingRequests.Remove(Item) > 0)
+	{
+		DEC_DWORD_STAT(STAT_Inventory_PendingItemActorRequests);
+
+		/** The heap entry stays until it is popped, unless nothing is left to pop it */
+		if (PendingRequests.Num() == 0)
+		{
+			RequestHeap.Reset();
+		}
+	}
+}
+
+bool UItemActorSpawnQueue::GetPendingRequest(const UItemInstance* Item, EItemActorRequestType& OutType) const
+{
+	if (const FItemActorRequest* Pending = PendingRequests.Find(Item))
+	{
+		OutType = Pending->Type;
+		return true;
+	}
+	return false;
+}
+
+bool UItemActorSpawnQueue::FQueuedRequestOrder::operator()(const FQueuedRequest& A, const FQueuedRequest& B) const
+{
+	if (A.Type != B.Type)
+	{
+		return A.Type == EItemActorRequestType::Destroy;
+	}
+	if (A.Relevance != B.Relevance)
+	{
+		return A.Relevance > B.Relevance;
+	}
+	return A.Sequence < B.Sequence;
+}
+
+void UItemActorSpawnQueue::Tick(float DeltaTime)
+{
+	INVENTORY_SCOPE(STAT_Inventory_ProcessItemActorRequests);
+
+	/** Everything below counts against the budget, including the occasional relevance update */
+	const double StartTime = FPlatformTime::Seconds();
+	const double Budget = MaxMillisecondsPerFrame / 1000.0;
+
+	TimeSinceRelevanceUpdate += DeltaTime;
+	if (TimeSinceRelevanceUpdate >= RelevanceUpdateInterval)
+	{
+		UpdateRelevance();
+	}
+
+	int32 NumProcessed = 0;
+	while (RequestHeap.Num() > 0)
+	{
+		if (NumProcessed > 0 && (NumProcessed >= MaxRequestsPerFrame || FPlatformTime::Seconds() - StartTime >= Budget))
+		{
+			break;
+		}
+
+		FQueuedRequest Queued;
+		RequestHeap.HeapPop(Queued, FQueuedRequestOrder(), EAllowShrinking::No);
+
+		/** Cancelled, or cancelled and queued again (which pushed a new entry) */
+		const FItemActorRequest* Pending = PendingRequests.Find(Queued.Key);
+		if (!Pending || Pending->Sequence != Queued.Sequence)
+		{
+			continue;
+		}
+
+		const FItemActorRequest Request = *Pending;
+
+		/** Remove first, IsItemActorSpawned must see the actual state while the request executes */
+		PendingRequests.Remove(Queued.Key);
+		DEC_DWORD_STAT(STAT_Inventory_PendingItemActorRequests);
+		++NumProcessed;
+
+		UInventoryComponent* Inventory = Request.Inventory.Get();
+		UItemInstance* Item = Request.Item.Get();
+		if (!Inventory || !Item)
+		{
+			continue;
+		}
+
+		if (Request.Type == EItemActorRequestType::Spawn)
+		{
+			Inventory->ExecuteSpawnItemActor(Item);
+		}
+		else
+		{
+			Inventory->ExecuteDestroyItemActor(Item);
+		}
+	}
+
+	if (PendingRequests.Num() == 0)
+	{
+		RequestHeap.Reset();
+	}
+}
+
+void UItemActorSpawnQueue::UpdateRelevance()
+{
+	TimeSinceRelevanceUpdate = 0.f;
+	RelevanceByOwner.Reset();
+
+	/** Rebuilding also drops the entries of cancelled requests */
+	RequestHeap.Reset();
+	for (const TPair<TObjectKey<UItemInstance>, FItemActorRequest>& Pair : PendingRequests)
+	{
+		FQueuedRequest& Queued = RequestHeap.AddDefaulted_GetRef();
+		Queued.Key = Pair.Key;
+		Queued.Sequence = Pair.Value.Sequence;
+		Queued.Type = Pair.Value.Type;
+		Queued.Relevance = Pair.Value.Type == EItemActorRequestType::Spawn ? GetOwnerRelevance(Pair.Value.Inventory.Get()) : 0;
+	}
+	RequestHeap.Heapify(FQueuedRequestOrder());
+}
+
+int32 UItemActorSpawnQueue::GetOwnerRelevance(const UInventoryComponent* Inventory)
+{
+	const AActor* Owner = Inventory ? Inventory->GetOwner() : nullptr;
+	if (!Owner)
+	{
+		return 0;
+	}
+
+	if (const int32* Relevance = RelevanceByOwner.Find(Owner))
+	{
+		return *Relevance;
+	}
+	return RelevanceByOwner.Add(Owner, GetRelevance(Owner));
+}
+
+int32 UItemActorSpawnQueue::GetRelevance(const AActor* Owner) const
+{
+	if (!Owner)
+	{
+		return 0;
+	}
+
+	const FVector OwnerLocation = Owner->GetActorLocation();
+
+	int32 Relevance = 0;
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		if (!PlayerController)
+		{
+			continue;
+		}
+
+		FVector ViewLocation;
+		FRotator ViewRotation;
+		PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+		if (FVector::DistSquared(ViewLocation, OwnerLocation) <= Owner->GetNetCullDistanceSquared())
+		{
+			++Relevance;
+		}
+	}
+
+	return Relevance;
+}
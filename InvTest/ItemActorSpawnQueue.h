@@ -0,0 +1,141 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "ItemActorSpawnQueue.generated.h"
+
+class UInventoryComponent;
+class UItemInstance;
+
+UENUM(BlueprintType)
+enum class EItemActorRequestType : uint8
+{
+	Spawn,
+	Destroy,
+};
+
+/**
+ * A queued item actor spawn or destroy.
+ */
+struct FItemActorRequest
+{
+	TWeakObjectPtr<UInventoryComponent> Inventory;
+	TWeakObjectPtr<UItemInstance> Item;
+	EItemActorRequestType Type = EItemActorRequestType::Spawn;
+
+	/** Order the request was queued in, breaks priority ties so requests are otherwise FIFO */
+	uint64 Sequence = 0;
+};
+
+/**
+ * Per-world queue that spreads item actor spawns and destroys over multiple frames.
+ *
+ * Requests are processed every tick until either MaxRequestsPerFrame or MaxMillisecondsPerFrame
+ * is used up, so a wave of players equipping at once (round start, respawns) doesn't put dozens
+ * of SpawnActor calls into a single server frame.
+ *
+ * Each item has at most one pending request: a spawn and a destroy for the same item cancel out,
+ * and duplicate requests are ignored. Destroys go first (they return actors to the UItemActorPool
+ * for the spawns to reuse), then spawns ordered by how many players the owner is relevant to.
+ *
+ * Requests are kept in a heap in that order, so a tick only pops the requests it processes.
+ * An owner's relevance is computed when its first request is queued and refreshed every
+ * RelevanceUpdateInterval seconds, the refresh re-sorts the heap and counts against the frame budget.
+ *
+ * Only exists in game worlds, and should only be used on the authority.
+ */
+UCLASS()
+class INVTEST_API UItemActorSpawnQueue : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem Interface
+	virtual void Deinitialize() override;
+	//~ End USubsystem Interface
+
+	//~ Begin FTickableGameObject Interface
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	//~ End FTickableGameObject Interface
+
+	/**
+	 * @brief Queues a request for Item's actor, or cancels the pending opposite request.
+	 * @return true if a request was queued or cancelled, false if an identical request was already pending
+	 */
+	bool EnqueueRequest(UInventoryComponent* Inventory, UItemInstance* Item, EItemActorRequestType Type);
+
+	/** Drops any pending request for Item, e.g., because it is being removed from its inventory */
+	void CancelRequest(const UItemInstance* Item);
+
+	/**
+	 * @brief Finds the request pending for Item.
+	 * @return false if there is none
+	 */
+	bool GetPendingRequest(const UItemInstance* Item, EItemActorRequestType& OutType) const;
+
+	/** Number of requests waiting to be processed */
+	UFUNCTION(BlueprintPure, Category = "Items|Spawn Queue")
+	int32 GetNumPendingRequests() const { return PendingRequests.Num(); }
+
+	/** Max number of requests processed per frame */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Items|Spawn Queue", meta = (ClampMin = "1"))
+	int32 MaxRequestsPerFrame = 8;
+
+	/** Time budget per frame in milliseconds, at least one request is always processed */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Items|Spawn Queue", meta = (ClampMin = "0"))
+	float MaxMillisecondsPerFrame = 1.f;
+
+	/** Seconds between relevance updates of the owners with pending spawns */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Items|Spawn Queue", meta = (ClampMin = "0"))
+	float RelevanceUpdateInterval = 0.5f;
+
+protected:
+	//~ Begin UWorldSubsystem Interface
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	//~ End UWorldSubsystem Interface
+
+private:
+	/**
+	 * A pending request's place in RequestHeap.
+	 *
+	 * Cancelled requests leave their entry behind, it is skipped once popped (its Sequence no longer
+	 * matches a pending request) or dropped when the heap is rebuilt.
+	 */
+	struct FQueuedRequest
+	{
+		TObjectKey<UItemInstance> Key;
+		uint64 Sequence = 0;
+		EItemActorRequestType Type = EItemActorRequestType::Spawn;
+		int32 Relevance = 0;
+	};
+
+	/** Destroys first, then spawns by relevance, then FIFO */
+	struct FQueuedRequestOrder
+	{
+		bool operator()(const FQueuedRequest& A, const FQueuedRequest& B) const;
+	};
+
+	/** Updates the owners' relevance and rebuilds RequestHeap from PendingRequests */
+	void UpdateRelevance();
+
+	/** Cached relevance of Inventory's owner, computed on first use until the next UpdateRelevance */
+	int32 GetOwnerRelevance(const UInventoryComponent* Inventory);
+
+	/** Number of player controllers whose view point is within the owner's net cull distance */
+	int32 GetRelevance(const AActor* Owner) const;
+
+	TMap<TObjectKey<UItemInstance>, FItemActorRequest> PendingRequests;
+
+	/** Pending requests in processing order, see FQueuedRequestOrder */
+	TArray<FQueuedRequest> RequestHeap;
+
+	TMap<TObjectKey<AActor>, int32> RelevanceByOwner;
+	float TimeSinceRelevanceUpdate = 0.f;
+
+	uint64 NextSequence = 0;
+};
@@ -0,0 +1,198 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ItemAssetLoader.h"
+#include "InvTest.h"
+#include "Engine/AssetManager.h"
+#include "Engine/Engine.h"
+
+UItemAssetLoader* UItemAssetLoader::Get()
+{
+	return GEngine ? GEngine->GetEngineSubsystem<UItemAssetLoader>() : nullptr;
+}
+
+TSharedPtr<FStreamableHandle> UItemAssetLoader::PrefetchItemAssets(const TArray<FItemInstanceInitializer>& ItemInitializers, FStreamableDelegate OnComplete, bool bIncludeItemActors)
+{
+	TArray<TSoftObjectPtr<UItemData>> ItemData;
+	ItemData.Reserve(ItemInitializers.Num());
+
+	for (const FItemInstanceInitializer& ItemInitializer : ItemInitializers)
+	{
+		ItemData.Add(ItemInitializer.ItemData);
+	}
+
+	return PrefetchItemData(ItemData, MoveTemp(OnComplete), bIncludeItemActors);
+}
+
+TSharedPtr<FStreamableHandle> UItemAssetLoader::PrefetchItemData(const TArray<TSoftObjectPtr<UItemData>>& ItemData, FStreamableDelegate OnComplete, bool bIncludeItemActors)
+{
+	const double StartTime = FPlatformTime::Seconds();
+	++Metrics.NumPrefetches;
+
+	TArray<FSoftObjectPath> DataPaths;
+	DataPaths.Reserve(ItemData.Num());
+
+	for (const TSoftObjectPtr<UItemData>& Data : ItemData)
+	{
+		if (!Data.IsNull())
+		{
+			DataPaths.AddUnique(Data.ToSoftObjectPath());
+		}
+	}
+
+	/** The data phase's handle roots the data until the consumer is done with it, not just until the actor classes are in */
+	TSharedRef<FPrefetchHandles> Handles = MakeShared<FPrefetchHandles>();
+
+	/** Phase 2: once the data is in, stream the actor classes it references */
+	FStreamableDelegate OnDataLoaded = FStreamableDelegate::CreateWeakLambda(this, [this, ItemData, OnComplete, bIncludeItemActors, StartTime, Handles]()
+	{
+		TArray<FSoftObjectPath> ActorClassPaths;
+
+		if (bIncludeItemActors)
+		{
+			for (const TSoftObjectPtr<UItemData>& Data : ItemData)
+			{
+				if (const UItemData* LoadedData = Data.Get())
+				{
+					const TSoftClassPtr<AActor> ActorClass = LoadedData->GetItemActorSoftClass();
+					if (!ActorClass.IsNull())
+					{
+						ActorClassPaths.AddUnique(ActorClass.ToSoftObjectPath());
+					}
+				}
+			}
+		}
+
+		TSharedPtr<FStreamableHandle> ActorClassHandle = RequestLoad(MoveTemp(ActorClassPaths), FStreamableDelegate::CreateWeakLambda(this, [this, OnComplete, StartTime, Handles]()
+		{
+			RecordPrefetch(StartTime);
+			OnComplete.ExecuteIfBound();
+			Handles->Release();
+		}));
+
+		if (!Handles->bComplete)
+		{
+			Handles->ActorClassHandle = MoveTemp(ActorClassHandle);
+		}
+	});
+
+	TSharedPtr<FStreamableHandle> DataHandle = RequestLoad(MoveTemp(DataPaths), MoveTemp(OnDataLoaded));
+
+	/** Completed already if everything was loaded, nothing left to keep */
+	if (!Handles->bComplete)
+	{
+		Handles->DataHandle = DataHandle;
+	}
+	return DataHandle;
+}
+
+UItemData* UItemAssetLoader::ResolveItemData(const TSoftObjectPtr<UItemData>& ItemData)
+{
+	if (UItemData* LoadedData = ItemData.Get())
+	{
+		return LoadedData;
+	}
+
+	if (ItemData.IsNull())
+	{
+		return nullptr;
+	}
+
+	UE_LOG(LogInventory, Warning, TEXT("UItemAssetLoader: %s was needed before it was prefetched, loading it synchronously"), *ItemData.ToString());
+
+	const double StartTime = FPlatformTime::Seconds();
+	UItemData* LoadedData = ItemData.LoadSynchronous();
+
+	++Metrics.NumSyncLoads;
+	Metrics.TotalSyncLoadSeconds += FPlatformTime::Seconds() - StartTime;
+
+	return LoadedData;
+}
+
+TSubclassOf<AActor> UItemAssetLoader::ResolveItemActorClass(const UItemData* ItemData)
+{
+	if (!ItemData)
+	{
+		return nullptr;
+	}
+
+	if (TSubclassOf<AActor> LoadedClass = ItemData->GetItemActorClass())
+	{
+		return LoadedClass;
+	}
+
+	const TSoftClassPtr<AActor> ActorClass = ItemData->GetItemActorSoftClass();
+	if (ActorClass.IsNull())
+	{
+		return nullptr;
+	}
+
+	UE_LOG(LogInventory, Warning, TEXT("UItemAssetLoader: %s was needed before it was prefetched, loading it synchronously"), *ActorClass.ToString());
+
+	const double StartTime = FPlatformTime::Seconds();
+	TSubclassOf<AActor> LoadedClass = ActorClass.LoadSynchronous();
+
+	++Metrics.NumSyncLoads;
+	Metrics.TotalSyncLoadSeconds += FPlatformTime::Seconds() - StartTime;
+
+	return LoadedClass;
+}
+
+void UItemAssetLoader::RetainItemActorClass(const UItemData* ItemData)
+{
+	const FSoftObjectPath ClassPath = ItemData ? ItemData->GetItemActorSoftClass().ToSoftObjectPath() : FSoftObjectPath();
+	if (ClassPath.IsNull())
+	{
+		return;
+	}
+
+	/** A handle roots what it loaded as long as it is held, even if the class was loaded already */
+	FRetainedActorClass& Retained = RetainedActorClasses.FindOrAdd(ClassPath);
+	if (Retained.NumRefs++ == 0)
+	{
+		Retained.Handle = UAssetManager::GetStreamableManager().RequestAsyncLoad(ClassPath);
+	}
+}
+
+void UItemAssetLoader::ReleaseItemActorClass(const UItemData* ItemData)
+{
+	const FSoftObjectPath ClassPath = ItemData ? ItemData->GetItemActorSoftClass().ToSoftObjectPath() : FSoftObjectPath();
+
+	FRetainedActorClass* Retained = RetainedActorClasses.Find(ClassPath);
+	if (!Retained || --Retained->NumRefs > 0)
+	{
+		return;
+	}
+
+	if (Retained->Handle.IsValid())
+	{
+		Retained->Handle->ReleaseHandle();
+	}
+	RetainedActorClasses.Remove(ClassPath);
+}
+
+TSharedPtr<FStreamableHandle> UItemAssetLoader::RequestLoad(TArray<FSoftObjectPath> Paths, FStreamableDelegate OnLoaded)
+{
+	Paths.RemoveAllSwap([](const FSoftObjectPath& Path) { return Path.ResolveObject() != nullptr; });
+
+	if (Paths.Num() == 0)
+	{
+		OnLoaded.ExecuteIfBound();
+		return nullptr;
+	}
+
+	Metrics.NumAssetsStreamed += Paths.Num();
+
+	return UAssetManager::GetStreamableManager().RequestAsyncLoad(MoveTemp(Paths), MoveTemp(OnLoaded));
+}
+
+void UItemAssetLoader::RecordPrefetch(double StartTime)
+{
+	const float Seconds = static_cast<float>(FPlatformTime::Seconds() - StartTime);
+
+	Metrics.TotalPrefetchSeconds += Seconds;
+	Metrics.MaxPrefetchSeconds = FMath::Max(Metrics.MaxPrefetchSeconds, Seconds);
+
+	UE_LOG(LogInventory, Log, TEXT("UItemAssetLoader: prefetch finished in %.2f ms (%d prefetches, %d assets streamed, %d sync loads so far)"),
+		Seconds * 1000.f, Metrics.NumPrefetches, Metrics.NumAssetsStreamed, Metrics.NumSyncLoads);
+}
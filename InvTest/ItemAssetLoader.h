@@ -0,0 +1,120 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/EngineSubsystem.h"
+#include "Engine/StreamableManager.h"
+#include "ItemInstance.h"
+#include "ItemAssetLoader.generated.h"
+
+/**
+ * Load-time metrics for item data and item actor classes.
+ */
+USTRUCT(BlueprintType)
+struct FItemAssetLoadMetrics
+{
+	GENERATED_BODY()
+
+	/** Number of prefetches requested */
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumPrefetches = 0;
+
+	/** Number of assets that had to be streamed in by prefetches (already loaded assets are not counted) */
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumAssetsStreamed = 0;
+
+	/** Number of times an asset was needed before it was prefetched, and had to be loaded synchronously */
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumSyncLoads = 0;
+
+	/** Wall time from requesting a prefetch to it completing, summed over all prefetches */
+	UPROPERTY(BlueprintReadOnly)
+	float TotalPrefetchSeconds = 0.f;
+
+	/** Longest single prefetch */
+	UPROPERTY(BlueprintReadOnly)
+	float MaxPrefetchSeconds = 0.f;
+
+	/** Time spent blocked in synchronous fallback loads */
+	UPROPERTY(BlueprintReadOnly)
+	float TotalSyncLoadSeconds = 0.f;
+};
+
+/**
+ * Streams soft-referenced UItemData assets and their item actor classes in
+ * ahead of time, so CreateItemInInventory and TrySpawnItemActor don't have to
+ * load them synchronously.
+ *
+ * Assets that are still needed before a prefetch finished are loaded
+ * synchronously as a fallback, which is reported in the metrics.
+ */
+UCLASS()
+class INVTEST_API UItemAssetLoader : public UEngineSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static UItemAssetLoader* Get();
+
+	/**
+	 * @brief Streams in the ItemData of every initializer, then (optionally) the item actor classes they reference.
+	 *
+	 * OnComplete is invoked once everything is loaded, immediately if it already was. The loader keeps
+	 * both phases loaded until OnComplete has returned, so callers only need the returned handle to
+	 * cancel or wait for the data phase.
+	 */
+	TSharedPtr<FStreamableHandle> PrefetchItemAssets(const TArray<FItemInstanceInitializer>& ItemInitializers, FStreamableDelegate OnComplete, bool bIncludeItemActors = true);
+
+	/** @brief Streams in the given item data assets, then (optionally) the item actor classes they reference, see PrefetchItemAssets */
+	TSharedPtr<FStreamableHandle> PrefetchItemData(const TArray<TSoftObjectPtr<UItemData>>& ItemData, FStreamableDelegate OnComplete, bool bIncludeItemActors = true);
+
+	/** @brief Returns the item data if loaded, otherwise loads it synchronously */
+	UItemData* ResolveItemData(const TSoftObjectPtr<UItemData>& ItemData);
+
+	/** @brief Returns the item actor class of ItemData if loaded, otherwise loads it synchronously */
+	TSubclassOf<AActor> ResolveItemActorClass(const UItemData* ItemData);
+
+	/**
+	 * @brief Keeps the item actor class of ItemData loaded until the matching ReleaseItemActorClass.
+	 *
+	 * Items only soft reference their actor class, so without this it could be collected between the
+	 * prefetch and the spawn. Counted per class, starts streaming the class in if it is not loaded yet.
+	 */
+	void RetainItemActorClass(const UItemData* ItemData);
+	void ReleaseItemActorClass(const UItemData* ItemData);
+
+	UFUNCTION(BlueprintCallable, Category = "Items|Loading")
+	const FItemAssetLoadMetrics& GetLoadMetrics() const { return Metrics; }
+
+private:
+	struct FRetainedActorClass
+	{
+		TSharedPtr<FStreamableHandle> Handle;
+		int32 NumRefs = 0;
+	};
+
+	/** Handles of both phases of a prefetch, released once OnComplete has returned */
+	struct FPrefetchHandles
+	{
+		TSharedPtr<FStreamableHandle> DataHandle;
+		TSharedPtr<FStreamableHandle> ActorClassHandle;
+		bool bComplete = false;
+
+		void Release()
+		{
+			bComplete = true;
+			DataHandle.Reset();
+			ActorClassHandle.Reset();
+		}
+	};
+
+	/** Requests the paths that are not loaded yet, invoking OnLoaded when done */
+	TSharedPtr<FStreamableHandle> RequestLoad(TArray<FSoftObjectPath> Paths, FStreamableDelegate OnLoaded);
+	void RecordPrefetch(double StartTime);
+
+	FItemAssetLoadMetrics Metrics;
+
+	/** Item actor classes that are retained, by class path */
+	TMap<FSoftObjectPath, FRetainedActorClass> RetainedActorClasses;
+};
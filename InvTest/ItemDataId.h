@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ItemDataId.generated.h"
+
+/**
+ * Compact, stable id of a UItemData asset.
+ *
+ * A 64 bit hash (CityHash64) of the asset's lowercased path, so it is the same on every machine and
+ * across runs without a lookup table having to be replicated or saved. Sent as 8 bytes instead of a
+ * net GUID or a path string, see UItemDataRegistry for id <-> asset lookups.
+ *
+ * Since the id is derived from the path, renaming or moving an item data asset changes its id:
+ * snapshots and journals that refer to the old id no longer resolve it.
+ */
+USTRUCT(BlueprintType)
+struct INVTEST_API FItemDataId
+{
+	GENERATED_BODY()
+
+	FItemDataId() = default;
+
+	explicit FItemDataId(uint64 InValue)
+		: Value(InValue)
+	{
+	}
+
+	/** Id of the asset at Path, an invalid id for a null path */
+	static FItemDataId FromPath(const FSoftObjectPath& Path);
+
+	bool IsValid() const { return Value != 0; }
+
+	uint64 GetValue() const { return Value; }
+
+	FString ToString() const { return FString::Printf(TEXT("%016llX"), Value); }
+
+	bool operator==(const FItemDataId& Other) const { return Value == Other.Value; }
+	bool operator!=(const FItemDataId& Other) const { return Value != Other.Value; }
+
+	friend uint32 GetTypeHash(const FItemDataId& Id) { return ::GetTypeHash(Id.Value); }
+
+	friend FArchive& operator<<(FArchive& Ar, FItemDataId& Id)
+	{
+		Ar << Id.Value;
+		return Ar;
+	}
+
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+	{
+		Ar << Value;
+		bOutSuccess = true;
+		return true;
+	}
+
+private:
+	UPROPERTY()
+	uint64 Value = 0;
+};
+
+template<>
+struct TStructOpsTypeTraits<FItemDataId> : public TStructOpsTypeTraitsBase2<FItemDataId>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true,
+	};
+};
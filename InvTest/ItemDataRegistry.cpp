@@ -0,0 +1,132 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ItemDataRegistry.h"
+#include "InvTest.h"
+#include "ItemAssetLoader.h"
+#include "ItemInstance.h"
+#include "AssetRegistry/IAssetRegistry.h"
+#include "Engine/Engine.h"
+#include "Hash/CityHash.h"
+#include "Misc/Crc.h"
+
+FItemDataId FItemDataId::FromPath(const FSoftObjectPath& Path)
+{
+	if (Path.IsNull())
+	{
+		return FItemDataId();
+	}
+
+	/** Case insensitive like the paths themselves, hashed as UTF-8 so it does not depend on the size of TCHAR */
+	const FTCHARToUTF8 Utf8Path(*Path.ToString().ToLower());
+	const uint64 Hash = CityHash64(Utf8Path.Get(), Utf8Path.Length());
+
+	/** 0 is reserved for the invalid id */
+	return FItemDataId(Hash != 0 ? Hash : 1);
+}
+
+UItemDataRegistry* UItemDataRegistry::Get()
+{
+	return GEngine ? GEngine->GetEngineSubsystem<UItemDataRegistry>() : nullptr;
+}
+
+void UItemDataRegistry::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	IAssetRegistry* AssetRegistry = IAssetRegistry::Get();
+	if (!AssetRegistry)
+	{
+		UE_LOG(LogInventory, Error, TEXT("UItemDataRegistry: no asset registry, item data ids can't be resolved"));
+		return;
+	}
+
+	/** In the editor the initial scan may still be running, register what is there and the rest once it is done */
+	ScanAssetRegistry();
+	if (AssetRegistry->IsLoadingAssets())
+	{
+		FilesLoadedHandle = AssetRegistry->OnFilesLoaded().AddUObject(this, &UItemDataRegistry::ScanAssetRegistry);
+	}
+	AssetAddedHandle = AssetRegistry->OnAssetAdded().AddUObject(this, &UItemDataRegistry::HandleAssetAdded);
+}
+
+void UItemDataRegistry::Deinitialize()
+{
+	if (IAssetRegistry* AssetRegistry = IAssetRegistry::Get())
+	{
+		AssetRegistry->OnFilesLoaded().Remove(FilesLoadedHandle);
+		AssetRegistry->OnAssetAdded().Remove(AssetAddedHandle);
+	}
+	PathsById.Empty();
+
+	Super::Deinitialize();
+}
+
+void UItemDataRegistry::ScanAssetRegistry()
+{
+	const double StartTime = FPlatformTime::Seconds();
+
+	/** Only reads the registry's metadata, no item data is loaded */
+	TArray<FAssetData> Assets;
+	IAssetRegistry::GetChecked().GetAssetsByClass(UItemData::StaticClass()->GetClassPathName(), Assets, /*bSearchSubClasses*/ true);
+
+	PathsById.Reserve(PathsById.Num() + Assets.Num());
+	for (const FAssetData& AssetData : Assets)
+	{
+		RegisterItemData(AssetData.GetSoftObjectPath());
+	}
+
+	UE_LOG(LogInventory, Log, TEXT("UItemDataRegistry: registered %d item data assets in %.2f ms"), PathsById.Num(), (FPlatformTime::Seconds() - StartTime) * 1000.0);
+}
+
+void UItemDataRegistry::HandleAssetAdded(const FAssetData& AssetData)
+{
+	const UClass* AssetClass = AssetData.GetClass(EResolveClass::No);
+	if (AssetClass && AssetClass->IsChildOf(UItemData::StaticClass()))
+	{
+		RegisterItemData(AssetData.GetSoftObjectPath());
+	}
+}
+
+FItemDataId UItemDataRegistry::RegisterItemData(const FSoftObjectPath& Path)
+{
+	const FItemDataId Id = FItemDataId::FromPath(Path);
+	if (!Id.IsValid())
+	{
+		return Id;
+	}
+
+	if (const FSoftObjectPath* Existing = PathsById.Find(Id))
+	{
+		/** Snapshots, journals and rpcs would silently resolve to the wrong asset, this has to stop the cook or the game */
+		UE_CLOG(*Existing != Path, LogInventory, Fatal, TEXT("UItemDataRegistry: %s and %s have the same id %s, rename one of them"), *Existing->ToString(), *Path.ToString(), *Id.ToString());
+		return Id;
+	}
+
+	PathsById.Add(Id, Path);
+
+	return Id;
+}
+
+FSoftObjectPath UItemDataRegistry::GetItemDataPath(FItemDataId Id) const
+{
+	const FSoftObjectPath* Path = PathsById.Find(Id);
+	return Path ? *Path : FSoftObjectPath();
+}
+
+TSoftObjectPtr<UItemData> UItemDataRegistry::GetItemData(FItemDataId Id) const
+{
+	return TSoftObjectPtr<UItemData>(GetItemDataPath(Id));
+}
+
+UItemData* UItemDataRegistry::ResolveItemData(FItemDataId Id) const
+{
+	const TSoftObjectPtr<UItemData> ItemData = GetItemData(Id);
+	if (ItemData.IsNull())
+	{
+		return nullptr;
+	}
+
+	UItemAssetLoader* AssetLoader = UItemAssetLoader::Get();
+	return AssetLoader ? AssetLoader->ResolveItemData(ItemData) : ItemData.LoadSynchronous();
+}
@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/EngineSubsystem.h"
+#include "ItemDataId.h"
+#include "ItemDataRegistry.generated.h"
+
+class UItemData;
+struct FAssetData;
+
+/**
+ * Maps every UItemData asset to its FItemDataId and back.
+ *
+ * Built from the asset registry at startup without loading any item data, so it stays cheap
+ * with tens of thousands of items. Both directions are a single hash map lookup.
+ *
+ * Ids are 64 bit hashes of the asset path. Two assets hashing to the same id is a fatal error when
+ * the registry is built, so it fails the cook or the game at startup (rename one of them).
+ * Renaming an asset changes its id, saved snapshots and journals lose track of it.
+ */
+UCLASS()
+class INVTEST_API UItemDataRegistry : public UEngineSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem Interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	//~ End USubsystem Interface
+
+	/** Convenience accessor, nullptr before the engine is initialized */
+	static UItemDataRegistry* Get();
+
+	/** Path of the asset with Id, or an empty path if no such asset is registered */
+	FSoftObjectPath GetItemDataPath(FItemDataId Id) const;
+
+	/** Soft pointer to the asset with Id, null if no such asset is registered */
+	TSoftObjectPtr<UItemData> GetItemData(FItemDataId Id) const;
+
+	/**
+	 * @brief The asset with Id, loaded through the UItemAssetLoader.
+	 *
+	 * Only blocks if the asset was not prefetched.
+	 * @return nullptr if no such asset is registered, or it failed to load
+	 */
+	UItemData* ResolveItemData(FItemDataId Id) const;
+
+	/** Whether Id refers to a registered asset */
+	bool IsRegistered(FItemDataId Id) const { return PathsById.Contains(Id); }
+
+	/** Adds an asset that was not found by the asset registry scan (e.g., created at runtime) */
+	FItemDataId RegisterItemData(const FSoftObjectPath& Path);
+
+	UFUNCTION(BlueprintPure, Category = "Items|Registry")
+	int32 GetNumRegisteredItemData() const { return PathsById.Num(); }
+
+private:
+	/** Registers every UItemData asset known to the asset registry */
+	void ScanAssetRegistry();
+	void HandleAssetAdded(const FAssetData& AssetData);
+
+	TMap<FItemDataId, FSoftObjectPath> PathsById;
+
+	FDelegateHandle FilesLoadedHandle;
+	FDelegateHandle AssetAddedHandle;
+};
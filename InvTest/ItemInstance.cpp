@@ -2,40 +2,398 @@
 
 
 #include "ItemInstance.h"
+#include "InvTest.h"
 #include "InventoryComponent.h"
+#include "InventoryStats.h"
+#include "ItemActorPool.h"
+#include "ItemAssetLoader.h"
+#include "ItemStatTable.h"
 #include "Net/UnrealNetwork.h"
+#include "Net/Core/PushModel/PushModel.h"
+
+bool UItemData::IsCompatibleWith(TSubclassOf<UItemInstance> ItemClass) const
+{
+	if (!ItemClass || ItemClass->HasAnyClassFlags(CLASS_Abstract))
+	{
+		return false;
+	}
+
+	return !InstanceClass || ItemClass->IsChildOf(InstanceClass);
+}
+
+FItemDataId UItemData::GetItemDataId() const
+{
+	if (!CachedItemDataId.IsValid())
+	{
+		CachedItemDataId = FItemDataId::FromPath(FSoftObjectPath(this));
+	}
+	return CachedItemDataId;
+}
+
+const FString& UItemData::GetSortName() const
+{
+	if (!CachedSortName.IsSet())
+	{
+		CachedSortName = Name.ToString();
+	}
+	return CachedSortName.GetValue();
+}
+
+void UItemData::RollAffixes(const FRandomStream& Stream, TArray<FItemModifier>& OutModifiers) const
+{
+	for (const FItemAffixRange& Affix : PossibleAffixes)
+	{
+		if (Stream.FRand() >= Affix.RollChance)
+		{
+			continue;
+		}
+
+		FItemModifier& Modifier = OutModifiers.AddDefaulted_GetRef();
+		Modifier.Stat = Affix.Stat;
+		Modifier.Op = Affix.Op;
+		Modifier.Magnitude = Stream.FRandRange(Affix.MinMagnitude, Affix.MaxMagnitude);
+	}
+}
+
+void FItemModifierList::PreReplicatedRemove(const TArrayView<int32> RemovedIndices, int32 FinalSize)
+{
+	if (!OwnerItem)
+	{
+		return;
+	}
+
+	for (const int32 Index : RemovedIndices)
+	{
+		OwnerItem->UnapplyModifier(Entries[Index]);
+	}
+	OwnerItem->OnStatsChanged.Broadcast(OwnerItem);
+}
+
+void FItemModifierList::PostReplicatedAdd(const TArrayView<int32> AddedIndices, int32 FinalSize)
+{
+	if (!OwnerItem)
+	{
+		return;
+	}
+
+	for (const int32 Index : AddedIndices)
+	{
+		OwnerItem->ApplyModifier(Entries[Index]);
+	}
+	OwnerItem->OnStatsChanged.Broadcast(OwnerItem);
+}
+
+void FItemModifierList::PostReplicatedChange(const TArrayView<int32> ChangedIndices, int32 FinalSize)
+{
+	if (!OwnerItem)
+	{
+		return;
+	}
+
+	for (const int32 Index : ChangedIndices)
+	{
+		OwnerItem->ApplyModifier(Entries[Index]);
+	}
+	OwnerItem->OnStatsChanged.Broadcast(OwnerItem);
+}
+
+void UItemInstance::PostInitProperties()
+{
+	Super::PostInitProperties();
+
+	Modifiers.OwnerItem = this;
+
+	if (!HasAnyFlags(RF_ClassDefaultObject | RF_ArchetypeObject))
+	{
+		INC_DWORD_STAT(STAT_Inventory_LiveItemInstances);
+	}
+}
+
+void UItemInstance::BeginDestroy()
+{
+	if (!HasAnyFlags(RF_ClassDefaultObject | RF_ArchetypeObject))
+	{
+		DEC_DWORD_STAT(STAT_Inventory_LiveItemInstances);
+	}
+
+	Super::BeginDestroy();
+}
 
 void UItemInstance::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME(UItemInstance, ItemActor);
+	/** ItemActor is push based, see UInventoryComponent::GetLifetimeReplicatedProps */
+	FDoRepLifetimeParams Params;
+	Params.bIsPushBased = true;
+
+	DOREPLIFETIME_WITH_PARAMS_FAST(UItemInstance, ItemActor, Params);
+
+	/** Data and guid never change after creation, clients need them to index the item, resolve its stats and sort its view */
+	FDoRepLifetimeParams InitialOnlyParams;
+	InitialOnlyParams.bIsPushBased = true;
+	InitialOnlyParams.Condition = COND_InitialOnly;
+
+	DOREPLIFETIME_WITH_PARAMS_FAST(UItemInstance, Data, InitialOnlyParams);
+	DOREPLIFETIME_WITH_PARAMS_FAST(UItemInstance, ItemGuid, InitialOnlyParams);
+
+	DOREPLIFETIME_WITH_PARAMS_FAST(UItemInstance, Modifiers, Params);
 }
 
 UItemInstance* UItemInstance::CreateItemInstance(const FItemInstanceInitializer& ItemInitializer)
 {
-	UE_LOG(LogTemp, Log, TEXT("UItemInstance::CreateItemInstance called on %s"), ItemInitializer.OwnerActor->HasAuthority() ? TEXT("Server") : TEXT("Client"));
+	INVENTORY_SCOPE(STAT_Inventory_CreateItem);
+
+	UE_LOG(LogInventory, Verbose, TEXT("UItemInstance::CreateItemInstance called on %s"), ItemInitializer.OwnerActor->HasAuthority() ? TEXT("Server") : TEXT("Client"));
 	checkf(ItemInitializer.OwnerActor->HasAuthority(), TEXT("UItemInstance::CreateItemInstance was called on a client, this should only be called on the server."));
-	checkf(ItemInitializer.ItemData && ItemInitializer.ItemClass && ItemInitializer.Outer && ItemInitializer.OwnerActor, TEXT("Either ItemClass, ItemData, Outer, or OwnerActor was null. ItemClass defined?: %s, ItemData defined?: %s, Outer defined?: %s, OwnerActor defined?: %s"),
+	checkf(ItemInitializer.ItemData && ItemInitializer.ItemClass && ItemInitializer.Outer && ItemInitializer.OwnerActor, TEXT("Either ItemClass, ItemData, Outer, or OwnerActor was null (or ItemData was not loaded). ItemClass defined?: %s, ItemData defined?: %s, Outer defined?: %s, OwnerActor defined?: %s"),
 		ItemInitializer.ItemClass ? TEXT("True") : TEXT("False"),
 		ItemInitializer.ItemData ? TEXT("True") : TEXT("False"),
 		ItemInitializer.Outer ? TEXT("True") : TEXT("False"),
 		ItemInitializer.OwnerActor ? TEXT("True") : TEXT("False"));
 
 	UItemInstance* Item = NewObject<UItemInstance>(ItemInitializer.Outer, ItemInitializer.ItemClass);
-	Item->Data = ItemInitializer.ItemData;
+	Item->Data = ItemInitializer.ItemData.Get();
 	Item->OwnerActor = ItemInitializer.OwnerActor;
+	Item->ItemGuid = FGuid::NewGuid();
+	MARK_PROPERTY_DIRTY_FROM_NAME(UItemInstance, Data, Item);
+
+	/** Resolve the stat table row up front, so batch stat queries don't register rows mid-combat */
+	Item->GetStatIndex();
+
+	if (ItemInitializer.bRollAffixes && ItemInitializer.PreRolledAffixes.Num() > 0)
+	{
+		Item->AddModifiers(ItemInitializer.PreRolledAffixes);
+	}
+	else if (ItemInitializer.bRollAffixes && Item->Data->PossibleAffixes.Num() > 0)
+	{
+		TArray<FItemModifier> RolledAffixes;
+		Item->Data->RollAffixes(FRandomStream(FMath::Rand()), RolledAffixes);
+		Item->AddModifiers(RolledAffixes);
+	}
 
 	return Item;
 }
 
 
 
+void UItemInstance::OnRep_Data()
+{
+	if (UInventoryComponent* Inventory = Cast<UInventoryComponent>(GetOuter()))
+	{
+		Inventory->HandleItemDataReplicated(this);
+	}
+}
+
+int32 UItemInstance::GetStatIndex() const
+{
+	if (StatIndex == INDEX_NONE && Data)
+	{
+		if (UItemStatTable* StatTable = UItemStatTable::Get())
+		{
+			StatIndex = StatTable->RegisterItemData(Data);
+		}
+	}
+
+	return StatIndex;
+}
+
+void UItemInstance::SerializeInstanceState(FArchive& Ar)
+{
+	int32 NumModifiers = Modifiers.Entries.Num();
+	Ar << NumModifiers;
+
+	if (Ar.IsSaving())
+	{
+		for (FItemModifier& Modifier : Modifiers.Entries)
+		{
+			Ar << Modifier.Stat;
+			Ar << Modifier.Op;
+			Ar << Modifier.Magnitude;
+		}
+		return;
+	}
+
+	/** Loading replaces whatever modifiers the instance had */
+	for (FItemModifier& Modifier : Modifiers.Entries)
+	{
+		UnapplyModifier(Modifier);
+	}
+	Modifiers.Entries.Reset();
+	Modifiers.MarkArrayDirty();
+
+	for (int32 Index = 0; Index < NumModifiers && !Ar.IsError(); ++Index)
+	{
+		EItemStat Stat;
+		EItemModifierOp Op;
+		float Magnitude;
+		Ar << Stat;
+		Ar << Op;
+		Ar << Magnitude;
+
+		if (Stat < EItemStat::MAX)
+		{
+			InternalAddModifier(Stat, Op, Magnitude);
+		}
+	}
+
+	MARK_PROPERTY_DIRTY_FROM_NAME(UItemInstance, Modifiers, this);
+	OnStatsChanged.Broadcast(this);
+}
+
+float UItemInstance::GetStat(EItemStat Stat) const
+{
+	const int32 StatBit = 1 << static_cast<int32>(Stat);
+
+	if ((DirtyStats & StatBit) && Data)
+	{
+		const int32 Row = GetStatIndex();
+		const float Base = Row != INDEX_NONE ? UItemStatTable::Get()->GetStats(Row).Get(Stat) : Data->GetCombatStats().Get(Stat);
+		const int32 Index = static_cast<int32>(Stat);
+
+		CachedStats.Set(Stat, (Base + AdditiveTotals[Index]) * (1.f + MultiplicativeTotals[Index]));
+		DirtyStats &= ~StatBit;
+	}
+
+	return CachedStats.Get(Stat);
+}
+
+FItemCombatStats UItemInstance::GetFinalStats() const
+{
+	for (int32 Index = 0; Index < static_cast<int32>(EItemStat::MAX); ++Index)
+	{
+		GetStat(static_cast<EItemStat>(Index));
+	}
+
+	return CachedStats;
+}
+
+int32 UItemInstance::AddModifier(EItemStat Stat, EItemModifierOp Op, float Magnitude)
+{
+	if (!HasAuthority() || Stat >= EItemStat::MAX)
+	{
+		return INDEX_NONE;
+	}
+
+	const int32 ModifierId = InternalAddModifier(Stat, Op, Magnitude);
+
+	MARK_PROPERTY_DIRTY_FROM_NAME(UItemInstance, Modifiers, this);
+	OnStatsChanged.Broadcast(this);
+
+	return ModifierId;
+}
+
+void UItemInstance::AddModifiers(TConstArrayView<FItemModifier> InModifiers)
+{
+	if (!HasAuthority() || InModifiers.Num() == 0)
+	{
+		return;
+	}
+
+	Modifiers.Entries.Reserve(Modifiers.Entries.Num() + InModifiers.Num());
+	for (const FItemModifier& Modifier : InModifiers)
+	{
+		if (Modifier.Stat < EItemStat::MAX)
+		{
+			InternalAddModifier(Modifier.Stat, Modifier.Op, Modifier.Magnitude);
+		}
+	}
+
+	MARK_PROPERTY_DIRTY_FROM_NAME(UItemInstance, Modifiers, this);
+	OnStatsChanged.Broadcast(this);
+}
+
+bool UItemInstance::RemoveModifier(int32 ModifierId)
+{
+	if (!HasAuthority())
+	{
+		return false;
+	}
+
+	const int32 Index = Modifiers.Entries.IndexOfByPredicate([ModifierId](const FItemModifier& Modifier) { return Modifier.ModifierId == ModifierId; });
+	if (Index == INDEX_NONE)
+	{
+		return false;
+	}
+
+	UnapplyModifier(Modifiers.Entries[Index]);
+	Modifiers.Entries.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	Modifiers.MarkArrayDirty();
+
+	MARK_PROPERTY_DIRTY_FROM_NAME(UItemInstance, Modifiers, this);
+	OnStatsChanged.Broadcast(this);
+
+	return true;
+}
+
+int32 UItemInstance::InternalAddModifier(EItemStat Stat, EItemModifierOp Op, float Magnitude)
+{
+	FItemModifier& Modifier = Modifiers.Entries.AddDefaulted_GetRef();
+	Modifier.ModifierId = NextModifierId++;
+	Modifier.Stat = Stat;
+	Modifier.Op = Op;
+	Modifier.Magnitude = Magnitude;
+	Modifiers.MarkItemDirty(Modifier);
+
+	ApplyModifier(Modifier);
+
+	return Modifier.ModifierId;
+}
+
+void UItemInstance::ApplyModifier(FItemModifier& Modifier)
+{
+	UnapplyModifier(Modifier);
+
+	if (Modifier.Stat >= EItemStat::MAX)
+	{
+		return;
+	}
+
+	const int32 Index = static_cast<int32>(Modifier.Stat);
+	float* Totals = Modifier.Op == EItemModifierOp::Additive ? AdditiveTotals : MultiplicativeTotals;
+	Totals[Index] += Modifier.Magnitude;
+
+	Modifier.bApplied = true;
+	Modifier.AppliedStat = Modifier.Stat;
+	Modifier.AppliedOp = Modifier.Op;
+	Modifier.AppliedMagnitude = Modifier.Magnitude;
+
+	MarkStatDirty(Modifier.Stat);
+}
+
+void UItemInstance::UnapplyModifier(FItemModifier& Modifier)
+{
+	if (!Modifier.bApplied)
+	{
+		return;
+	}
+
+	const int32 Index = static_cast<int32>(Modifier.AppliedStat);
+	float* Totals = Modifier.AppliedOp == EItemModifierOp::Additive ? AdditiveTotals : MultiplicativeTotals;
+	Totals[Index] -= Modifier.AppliedMagnitude;
+
+	Modifier.bApplied = false;
+
+	MarkStatDirty(Modifier.AppliedStat);
+}
+
+void UItemInstance::MarkStatDirty(EItemStat Stat)
+{
+	DirtyStats |= 1 << static_cast<int32>(Stat);
+}
+
+bool UItemInstance::HasAuthority() const
+{
+	return OwnerActor && OwnerActor->HasAuthority();
+}
+
 AActor* UItemInstance::TrySpawnItemActor()
 {
+	INVENTORY_SCOPE(STAT_Inventory_SpawnItemActor);
+
 	if (!CanSpawnItemActor())
 	{
-		UE_LOG(LogTemp, Warning, TEXT("%s TrySpawnItemActor failed because CanSpawnItemActor() returned false!"), *GetName());
+		UE_LOG(LogInventory, Warning, TEXT("%s TrySpawnItemActor failed because CanSpawnItemActor() returned false!"), *GetName());
 		return nullptr;
 	}
 
@@ -44,9 +402,11 @@ AActor* UItemInstance::TrySpawnItemActor()
 
 bool UItemInstance::TryDestroyItemActor()
 {
+	INVENTORY_SCOPE(STAT_Inventory_DestroyItemActor);
+
 	if (!CanDestroyItemActor())
 	{
-		UE_LOG(LogTemp, Warning, TEXT("%s TryDestroyItemActor failed because CanDestroyItemActor() returned false!"), *GetName());
+		UE_LOG(LogInventory, Warning, TEXT("%s TryDestroyItemActor failed because CanDestroyItemActor() returned false!"), *GetName());
 		return false;
 	}
 
@@ -69,36 +429,53 @@ AActor* UItemInstance::InternalSpawnItemActor()
 
 	if (!Inventory->GetOwner()->HasAuthority())
 	{
-		UE_LOG(LogTemp, Warning, TEXT("UItemInstance::SpawnItemActor was called on non-authoritative machine, must be on authority."));
+		UE_LOG(LogInventory, Warning, TEXT("UItemInstance::SpawnItemActor was called on non-authoritative machine, must be on authority."));
 		return nullptr;
 	}
 
-	/** Use this struct to customize spawning behavior */
-	FActorSpawnParameters SpawnParams;
-	SpawnParams.Owner = OwnerActor;
-
 	/** Spawn the actor at the owner actor's location (if available) */
 	FTransform SpawnLocation = OwnerActor ? OwnerActor->GetTransform() : FTransform::Identity;
 
-	/** Get the UClass for this item's actor */
-	TSubclassOf<AActor> ItemActorClass = Data->GetItemActorClass();
+	/** Get the UClass for this item's actor, this only blocks if it was not prefetched */
+	UItemAssetLoader* AssetLoader = UItemAssetLoader::Get();
+	TSubclassOf<AActor> ItemActorClass = AssetLoader ? AssetLoader->ResolveItemActorClass(Data) : Data->GetItemActorClass();
 
 	if (ItemActorClass == nullptr)
 	{
-		UE_LOG(LogTemp, Error, TEXT("UItemInstance::SpawnItemActor failed, ItemActorClass was null"));
+		UE_LOG(LogInventory, Error, TEXT("UItemInstance::SpawnItemActor failed, ItemActorClass was null"));
 		return nullptr;
 	}
 
-	/** Spawn the ItemActor & set it to replicate */
-	AActor* SpawnedItemActor = World->SpawnActor<AActor>(ItemActorClass, SpawnLocation, SpawnParams);
+	/** Take the ItemActor from the world's pool (spawning one if needed), the pool sets it to replicate */
+	AActor* SpawnedItemActor = nullptr;
+	if (UItemActorPool* Pool = World->GetSubsystem<UItemActorPool>())
+	{
+		SpawnedItemActor = Pool->AcquireItemActor(ItemActorClass, SpawnLocation, OwnerActor);
+	}
+	else
+	{
+		/** Use this struct to customize spawning behavior */
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.Owner = OwnerActor;
+
+		SpawnedItemActor = World->SpawnActor<AActor>(ItemActorClass, SpawnLocation, SpawnParams);
+	}
+
+	if (!SpawnedItemActor)
+	{
+		UE_LOG(LogInventory, Error, TEXT("UItemInstance::SpawnItemActor failed, could not spawn an actor of class %s"), *GetNameSafe(ItemActorClass));
+		return nullptr;
+	}
 
 	/** Bind to item actor lifecycle delegates */
 	SpawnedItemActor->OnDestroyed.AddDynamic(this, &UItemInstance::HandleItemActorDestroyed);
 
 	ItemActor = SpawnedItemActor;
+	MARK_PROPERTY_DIRTY_FROM_NAME(UItemInstance, ItemActor, this);
+	INC_DWORD_STAT(STAT_Inventory_LiveItemActors);
 	SpawnedItemActor->SetReplicates(true);
 
-	UE_LOG(LogTemp, Log, TEXT("Spawned an ItemActor: ItemActor's owner: %s, ItemActor's outer: %s"), *SpawnedItemActor->Owner->GetName(), *SpawnedItemActor->GetOuter()->GetName());
+	UE_LOG(LogInventory, Verbose, TEXT("Spawned an ItemActor: ItemActor's owner: %s, ItemActor's outer: %s"), *GetNameSafe(SpawnedItemActor->GetOwner()), *SpawnedItemActor->GetOuter()->GetName());
 
 	return SpawnedItemActor;
 }
@@ -114,16 +491,45 @@ bool UItemInstance::InternalDestroyItemActor()
 
 	if (!Inventory->GetOwner()->HasAuthority())
 	{
-		UE_LOG(LogTemp, Warning, TEXT("UItemInstance::DestroyItemActor was called on non-authoritative machine, must be on authority."));
+		UE_LOG(LogInventory, Warning, TEXT("UItemInstance::DestroyItemActor was called on non-authoritative machine, must be on authority."));
+		return false;
+	}
+
+	if (!IsValid(ItemActor))
+	{
 		return false;
 	}
 
-	if (IsValid(ItemActor))
+	if (UItemActorPool* Pool = World->GetSubsystem<UItemActorPool>())
 	{
-		return ItemActor->Destroy();
+		/** Pooled actors are not destroyed, so HandleItemActorDestroyed won't fire. Clear the reference here instead. */
+		AActor* ReleasedItemActor = ItemActor;
+		ReleasedItemActor->OnDestroyed.RemoveDynamic(this, &UItemInstance::HandleItemActorDestroyed);
+
+		ItemActor = nullptr;
+		MARK_PROPERTY_DIRTY_FROM_NAME(UItemInstance, ItemActor, this);
+		DEC_DWORD_STAT(STAT_Inventory_LiveItemActors);
+
+		Pool->ReleaseItemActor(ReleasedItemActor);
+		return true;
 	}
 
-	return false;
+	return ItemActor->Destroy();
+}
+
+void UItemInstance::Reparent(UInventoryComponent* NewInventory)
+{
+	check(NewInventory);
+
+	/** Not transactional and no redirectors, this is a runtime object moving between inventories */
+	Rename(nullptr, NewInventory, REN_DontCreateRedirectors | REN_NonTransactional | REN_DoNotDirty);
+
+	OwnerActor = NewInventory->GetOwner();
+
+	if (ItemActor)
+	{
+		ItemActor->SetOwner(OwnerActor);
+	}
 }
 
 bool UItemInstance::CanSpawnItemActor()
@@ -138,6 +544,8 @@ bool UItemInstance::CanDestroyItemActor()
 
 void UItemInstance::HandleItemActorDestroyed(AActor* InActor)
 {
-	UE_LOG(LogTemp, Log, TEXT("UItemInstance::HandleItemActorDestroyed: %s was destroyed!"), *InActor->GetName());
+	UE_LOG(LogInventory, Verbose, TEXT("UItemInstance::HandleItemActorDestroyed: %s was destroyed!"), *InActor->GetName());
 	ItemActor = nullptr;
+	MARK_PROPERTY_DIRTY_FROM_NAME(UItemInstance, ItemActor, this);
+	DEC_DWORD_STAT(STAT_Inventory_LiveItemActors);
 }
@@ -4,8 +4,178 @@
 
 #include "CoreMinimal.h"
 #include "UObject/NoExportTypes.h"
+#include "GameplayTagContainer.h"
+#include "Net/Serialization/FastArraySerializer.h"
+#include "ItemDataId.h"
 #include "ItemInstance.generated.h"
 
+class UItemInstance;
+
+
+/**
+ * Stats an item can have, and that modifiers can change.
+ */
+UENUM(BlueprintType)
+enum class EItemStat : uint8
+{
+	Damage,
+	CriticalStrikeChance,
+	CriticalStrikeMultiplier,
+	AttackSpeed,
+
+	MAX UMETA(Hidden)
+};
+
+/**
+ * How a modifier's magnitude is applied.
+ *
+ * Final = (Base + sum of Additive) * (1 + sum of Multiplicative)
+ */
+UENUM(BlueprintType)
+enum class EItemModifierOp : uint8
+{
+	/** Flat amount added to the base value */
+	Additive,
+	/** Fraction of the (base + additive) value, e.g., 0.1 for +10% */
+	Multiplicative,
+};
+
+/**
+ * An affix that can be rolled onto new instances of an item.
+ */
+USTRUCT(BlueprintType)
+struct FItemAffixRange
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditDefaultsOnly)
+	EItemStat Stat = EItemStat::Damage;
+
+	UPROPERTY(EditDefaultsOnly)
+	EItemModifierOp Op = EItemModifierOp::Additive;
+
+	UPROPERTY(EditDefaultsOnly)
+	float MinMagnitude = 0.f;
+
+	UPROPERTY(EditDefaultsOnly)
+	float MaxMagnitude = 0.f;
+
+	/** Chance in [0, 1] that a new instance gets this affix */
+	UPROPERTY(EditDefaultsOnly, meta = (ClampMin = "0", ClampMax = "1"))
+	float RollChance = 1.f;
+};
+
+/**
+ * A rolled affix or runtime modifier on a single item instance.
+ */
+USTRUCT(BlueprintType)
+struct FItemModifier : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	/** Id unique within the owning instance, used to remove the modifier again */
+	UPROPERTY(BlueprintReadOnly)
+	int32 ModifierId = INDEX_NONE;
+
+	UPROPERTY(BlueprintReadOnly)
+	EItemStat Stat = EItemStat::Damage;
+
+	UPROPERTY(BlueprintReadOnly)
+	EItemModifierOp Op = EItemModifierOp::Additive;
+
+	UPROPERTY(BlueprintReadOnly)
+	float Magnitude = 0.f;
+
+private:
+	friend class UItemInstance;
+
+	/** What this modifier currently contributes to the instance's totals, lags behind on clients until applied */
+	bool bApplied = false;
+	EItemStat AppliedStat = EItemStat::Damage;
+	EItemModifierOp AppliedOp = EItemModifierOp::Additive;
+	float AppliedMagnitude = 0.f;
+};
+
+/**
+ * Delta-replicated modifiers of an item instance, only changed modifiers are sent.
+ */
+USTRUCT(BlueprintType)
+struct FItemModifierList : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	//~ Begin FFastArraySerializer contract
+	void PreReplicatedRemove(const TArrayView<int32> RemovedIndices, int32 FinalSize);
+	void PostReplicatedAdd(const TArrayView<int32> AddedIndices, int32 FinalSize);
+	void PostReplicatedChange(const TArrayView<int32> ChangedIndices, int32 FinalSize);
+	//~ End FFastArraySerializer contract
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FItemModifier, FItemModifierList>(Entries, DeltaParms, *this);
+	}
+
+	UPROPERTY()
+	TArray<FItemModifier> Entries;
+
+	/** Instance that owns this list, used to route the replication callbacks */
+	UPROPERTY(NotReplicated)
+	TObjectPtr<UItemInstance> OwnerItem = nullptr;
+};
+
+template<>
+struct TStructOpsTypeTraits<FItemModifierList> : public TStructOpsTypeTraitsBase2<FItemModifierList>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+/**
+ * Combat stats of an item, as read from its UItemData.
+ */
+USTRUCT(BlueprintType)
+struct FItemCombatStats
+{
+	GENERATED_BODY()
+
+	float Get(EItemStat Stat) const
+	{
+		switch (Stat)
+		{
+		case EItemStat::Damage:                   return Damage;
+		case EItemStat::CriticalStrikeChance:     return CriticalStrikeChance;
+		case EItemStat::CriticalStrikeMultiplier: return CriticalStrikeMultiplier;
+		case EItemStat::AttackSpeed:              return AttackSpeed;
+		default:                                  return 0.f;
+		}
+	}
+
+	void Set(EItemStat Stat, float Value)
+	{
+		switch (Stat)
+		{
+		case EItemStat::Damage:                   Damage = Value; break;
+		case EItemStat::CriticalStrikeChance:     CriticalStrikeChance = Value; break;
+		case EItemStat::CriticalStrikeMultiplier: CriticalStrikeMultiplier = Value; break;
+		case EItemStat::AttackSpeed:              AttackSpeed = Value; break;
+		default: break;
+		}
+	}
+
+	UPROPERTY(BlueprintReadOnly)
+	float Damage = 0.f;
+
+	UPROPERTY(BlueprintReadOnly)
+	float CriticalStrikeChance = 0.f;
+
+	UPROPERTY(BlueprintReadOnly)
+	float CriticalStrikeMultiplier = 1.f;
+
+	UPROPERTY(BlueprintReadOnly)
+	float AttackSpeed = 0.f;
+};
 
 /**
  * Stores data used to initialize items.
@@ -31,12 +201,83 @@ public:
 	UPROPERTY(EditDefaultsOnly)
 	uint32 Value;
 
+	/**
+	 * @brief Max number of units that fit in a single stack.
+	 *
+	 * Items with a MaxStackSize greater than 1 are fungible, they are stored as
+	 * (ItemData, Count) stacks in the inventory instead of one UItemInstance per unit,
+	 * and are only promoted to an instance when they need unique state.
+	 */
+	UPROPERTY(EditDefaultsOnly, meta = (ClampMin = "1"))
+	int32 MaxStackSize = 1;
+
+	bool IsStackable() const { return MaxStackSize > 1; }
+
+	/** Number of cells (width x height) an instance of this item takes up in a UGridInventoryComponent */
+	UPROPERTY(EditDefaultsOnly, meta = (ClampMin = "1"))
+	FIntPoint GridSize = FIntPoint(1, 1);
+
+	/**
+	 * @brief Tags used to query items, e.g., "Item.Consumable.Potion".
+	 *
+	 * Inventories index items under these tags and all of their parents.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	FGameplayTagContainer ItemTags;
+
+	/** Affixes that may be rolled onto each new instance of this item */
+	UPROPERTY(EditDefaultsOnly)
+	TArray<FItemAffixRange> PossibleAffixes;
+
+	/** Instance class (or base class) this item has to be created as, none allows any instance class */
+	UPROPERTY(EditDefaultsOnly)
+	TSubclassOf<UItemInstance> InstanceClass;
+
+	/** Whether an instance of ItemClass can be created from this data */
+	bool IsCompatibleWith(TSubclassOf<UItemInstance> ItemClass) const;
+
+	/**
+	 * @brief Rolls PossibleAffixes into modifiers.
+	 *
+	 * Only reads this data asset and the stream, so it is safe to call off the game thread.
+	 */
+	void RollAffixes(const FRandomStream& Stream, TArray<FItemModifier>& OutModifiers) const;
+
 	//~ Begin UItemData contract
+	/** The item actor class, or nullptr if it is not loaded (see UItemAssetLoader) */
 	virtual TSubclassOf<AActor> GetItemActorClass() const
 	{
 		return nullptr;
 	}
+
+	/** Soft reference to the item actor class, used to stream it in before it is needed */
+	virtual TSoftClassPtr<AActor> GetItemActorSoftClass() const
+	{
+		return TSoftClassPtr<AActor>();
+	}
+
+	/** Base combat stats of this item, copied into UItemStatTable. Items without combat stats keep the defaults. */
+	virtual FItemCombatStats GetCombatStats() const
+	{
+		return FItemCombatStats();
+	}
 	//~ EndUItemData contract
+
+	/** Row of this item in UItemStatTable, INDEX_NONE until it was registered */
+	mutable int32 StatTableIndex = INDEX_NONE;
+
+	/** Stable compact id of this asset, used instead of object references in rpcs and snapshots, see UItemDataRegistry */
+	FItemDataId GetItemDataId() const;
+
+	/** Name as a string, compared when item views are sorted and filtered by name */
+	const FString& GetSortName() const;
+
+private:
+	/** GetItemDataId hashes the path once, then returns this */
+	mutable FItemDataId CachedItemDataId;
+
+	/** GetSortName converts Name once, then returns this */
+	mutable TOptional<FString> CachedSortName;
 };
 
 UCLASS(BlueprintType)
@@ -47,38 +288,38 @@ class USwordItemData : public UItemData
 public:
 	// World actor/representation
 	// using static mesh actor for example purposes
+	// Soft reference, so the class (and its meshes) are only loaded once an item actually needs it
 	UPROPERTY(EditDefaultsOnly)
-	TSubclassOf<AActor> ItemActor;
+	TSoftClassPtr<AActor> ItemActor;
 
+	// Per-instance bonuses are modifiers on the UItemInstance, see UItemData::PossibleAffixes
 	// Damage
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Sword|Damage")
 	int32 BaseDamage;
 
-	//UPROPERTY(BlueprintReadWrite, Category = "Sword|Damage")
-	//int32 BonusDamage;
-
 	// Critical strikes
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Sword|Critical Strikes")
 	float BaseCriticalStrikeChance;
 
-	//UPROPERTY(BlueprintReadWrite, Category = "Sword|Critical Strikes")
-	//float BonusCriticalStrikeChance;
-
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Sword|Critical Strikes")
 	float BaseCriticalStrikeMultiplier;
 
-	/*UPROPERTY(BlueprintReadWrite, Category = "Sword|Critical Strikes")
-	float BonusCriticalStrikeMultiplier;*/
-
 	// Attack speed
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Sword|Attack Speed")
 	float BaseAttackSpeed;
 
-	//UPROPERTY(BlueprintReadWrite, Category = "Sword|Attack Speed")
-	//float BonusAttackSpeed;
-
 	//~ Begin UItemData contract
-	virtual TSubclassOf<AActor> GetItemActorClass() const override { return Cast<UClass>(ItemActor); }
+	virtual TSubclassOf<AActor> GetItemActorClass() const override { return ItemActor.Get(); }
+	virtual TSoftClassPtr<AActor> GetItemActorSoftClass() const override { return ItemActor; }
+	virtual FItemCombatStats GetCombatStats() const override
+	{
+		FItemCombatStats Stats;
+		Stats.Damage = BaseDamage;
+		Stats.CriticalStrikeChance = BaseCriticalStrikeChance;
+		Stats.CriticalStrikeMultiplier = BaseCriticalStrikeMultiplier;
+		Stats.AttackSpeed = BaseAttackSpeed;
+		return Stats;
+	}
 
 	//~ EndUItemData contract
 };
@@ -126,14 +367,18 @@ struct FItemInstanceInitializer
 
 	/**
 	 * The actor that will own the new ItemInstace
+	 *
+	 * Not replicated, the server always fills this in itself when initializers are sent through an rpc.
 	 */
-	UPROPERTY(BlueprintReadWrite)
+	UPROPERTY(BlueprintReadWrite, NotReplicated)
 	AActor* OwnerActor;
 
 	/**
 	 * The outer to use for the ItemInstance, can be the same object as the OwnerActor
+	 *
+	 * Not replicated, the server always fills this in itself when initializers are sent through an rpc.
 	 */
-	UPROPERTY(BlueprintReadWrite)
+	UPROPERTY(BlueprintReadWrite, NotReplicated)
 	UObject* Outer;
 
 	/**
@@ -148,15 +393,36 @@ struct FItemInstanceInitializer
 	/**
 	 * @brief Any UItemData which supports initializing the ItemClass
 	 *
+	 * Soft reference, so holding an initializer (e.g., in ItemsToGrant) does not load the asset.
+	 * It must be loaded before the instance is created, see UItemAssetLoader::PrefetchItemAssets.
+	 *
 	 * Example configurations:
 	 *    ItemClass: "USwordInstance", ItemData: "USwordItemData"
 	 *    ItemClass: "UConsumableInstance", ItemData: "UPotionItemData"
 	 *    ItemClass: "UCraftingMatInstance", ItemData: "UGearGemItemData"
 	 */
 	UPROPERTY(EditDefaultsOnly)
-	TObjectPtr<UItemData> ItemData;
+	TSoftObjectPtr<UItemData> ItemData;
+
+	/**
+	 * @brief Whether the new instance rolls the affixes of ItemData.
+	 *
+	 * Turned off when the instance state is restored from elsewhere (e.g., a snapshot).
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite)
+	bool bRollAffixes = true;
+
+	/**
+	 * @brief Affixes rolled ahead of time (e.g., off the game thread by UInventoryGrantSubsystem).
+	 *
+	 * Used instead of rolling when bRollAffixes is set and this is not empty.
+	 */
+	UPROPERTY(Transient)
+	TArray<FItemModifier> PreRolledAffixes;
 };
 
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnItemStatsChanged, UItemInstance*);
+
 
 /**
  * Runtime representation of an item.
@@ -171,6 +437,8 @@ class INVTEST_API UItemInstance : public UObject
 
 public:
 	//~ Begin UObject Interface.
+	virtual void PostInitProperties() override;
+	virtual void BeginDestroy() override;
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 	virtual bool IsSupportedForNetworking() const override { return true; }
 	//~ End UObject Interface.
@@ -185,18 +453,99 @@ public:
 	UFUNCTION(BlueprintCallable)
 	static UItemInstance* CreateItemInstance(const FItemInstanceInitializer& ItemInitializer);
 
+	/**
+	 * @brief Saves or loads the per-instance state of this item (anything not coming from Data).
+	 *
+	 * Used by inventory snapshots, override this in subclasses that have unique state
+	 * and call Super first. Must read exactly what it writes.
+	 */
+	virtual void SerializeInstanceState(FArchive& Ar);
+
+	/** The data this instance was created from */
+	UFUNCTION(BlueprintCallable, Category = "Item|Data")
+	UItemData* GetData() const { return Data; }
+
+	/**
+	 * @brief Identity of this item, assigned when it is first created and kept across transfers and snapshots.
+	 *
+	 * Used to refer to the item in the inventory journal (see UInventoryJournal). Replicated once with
+	 * the item, so clients can tell items apart by something that is the same on every machine.
+	 */
+	const FGuid& GetItemGuid() const { return ItemGuid; }
+
+	/**
+	 * @brief Row of this item's data in UItemStatTable, for use with its batch APIs.
+	 *
+	 * Resolved (and registered if needed) on first use, stable for the lifetime of the process.
+	 */
+	int32 GetStatIndex() const;
+
+public:
+	//--------------------------------------------
+	// Stats & modifiers
+	//--------------------------------------------
+	/**
+	 * @brief Final value of a stat, (Base + additive modifiers) * (1 + multiplicative modifiers).
+	 *
+	 * O(1): totals are updated incrementally when a modifier changes, and the final value
+	 * is cached until a modifier on that stat changes.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Item|Stats")
+	float GetStat(EItemStat Stat) const;
+
+	/** All final stats of this instance */
+	UFUNCTION(BlueprintCallable, Category = "Item|Stats")
+	FItemCombatStats GetFinalStats() const;
+
+	/**
+	 * @brief Adds a runtime modifier. Authority only.
+	 * @return id of the new modifier, or INDEX_NONE if not on authority
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Item|Stats")
+	int32 AddModifier(EItemStat Stat, EItemModifierOp Op, float Magnitude);
+
+	/**
+	 * @brief Removes a modifier added by AddModifier or rolled as an affix. Authority only.
+	 * @return true if the modifier existed
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Item|Stats")
+	bool RemoveModifier(int32 ModifierId);
+
+	/**
+	 * @brief Adds several modifiers at once (e.g., rolled affixes). Authority only.
+	 *
+	 * Ids of the passed modifiers are ignored, new ones are assigned.
+	 */
+	void AddModifiers(TConstArrayView<FItemModifier> InModifiers);
+
+	UFUNCTION(BlueprintCallable, Category = "Item|Stats")
+	const TArray<FItemModifier>& GetModifiers() const { return Modifiers.Entries; }
+
+	/** Broadcast on server and clients whenever this instance's modifiers (and so its final stats) changed */
+	FOnItemStatsChanged OnStatsChanged;
+
 
 protected:
 	friend class UInventoryComponent;
+	friend class UInventoryJournal;
+
+	/** See GetItemGuid */
+	UPROPERTY(Replicated)
+	FGuid ItemGuid;
+
 	/**
 	 * @brief All data needed for a particular UItemInstance subclass to function.
 	 *
 	 * For example, USwordInstance might need to store floats for its damage, a mesh
 	 * for the sword, etc.
 	 */
-	UPROPERTY(BlueprintReadWrite, Category = "Item|Data")
+	UPROPERTY(ReplicatedUsing = OnRep_Data, BlueprintReadWrite, Category = "Item|Data")
 	TObjectPtr<UItemData> Data;
 
+	/** Lets the owning inventory re-index the item, Data may only resolve after the item was indexed */
+	UFUNCTION()
+	void OnRep_Data();
+
 	/**
 	 * @brief Pointer to the actor that logically owns this instance
 	 */
@@ -226,6 +575,13 @@ protected:
 private:
 	virtual AActor* InternalSpawnItemActor();
 	virtual bool InternalDestroyItemActor();
+
+	/**
+	 * @brief Moves this instance under another inventory, keeping the object (and its state) as is.
+	 *
+	 * Changes the outer and OwnerActor, and hands a spawned item actor to the new owner.
+	 */
+	void Reparent(UInventoryComponent* NewInventory);
 private:
 	//--------------------------------------------
 	// Item actor spawn condition hook methods
@@ -253,4 +609,33 @@ private:
 private:
 	UPROPERTY(Replicated)
 	TObjectPtr<AActor> ItemActor;
+
+	/** Cached UItemStatTable row, see GetStatIndex */
+	mutable int32 StatIndex = INDEX_NONE;
+
+private:
+	friend struct FItemModifierList;
+
+	/** Adds a modifier entry and applies it, without marking Modifiers dirty */
+	int32 InternalAddModifier(EItemStat Stat, EItemModifierOp Op, float Magnitude);
+
+	/** Moves the modifier's contribution to the totals from what it was last applied as to what it is now */
+	void ApplyModifier(FItemModifier& Modifier);
+	void UnapplyModifier(FItemModifier& Modifier);
+	void MarkStatDirty(EItemStat Stat);
+
+	bool HasAuthority() const;
+
+	UPROPERTY(Replicated)
+	FItemModifierList Modifiers;
+
+	int32 NextModifierId = 0;
+
+	/** Running totals of all applied modifiers, per stat */
+	float AdditiveTotals[static_cast<int32>(EItemStat::MAX)] = {};
+	float MultiplicativeTotals[static_cast<int32>(EItemStat::MAX)] = {};
+
+	/** Final stats, a stat is only recomputed if its bit in DirtyStats is set */
+	mutable FItemCombatStats CachedStats;
+	mutable uint8 DirtyStats = 0xFF;
 };
@@ -0,0 +1,213 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ItemStatTable.h"
+#include "Engine/Engine.h"
+#include "Math/VectorRegister.h"
+#include "UObject/UObjectIterator.h"
+
+namespace ItemStatTable
+{
+	/** Clamped crit chance and the expected damage per hit for four rows at once */
+	FORCEINLINE VectorRegister4Float ExpectedDamage(VectorRegister4Float Damage, VectorRegister4Float CritChance, VectorRegister4Float CritMultiplier)
+	{
+		const VectorRegister4Float One = VectorOneFloat();
+		const VectorRegister4Float ClampedChance = VectorMin(VectorMax(CritChance, VectorZeroFloat()), One);
+
+		/** Damage * (1 + Chance * (Multiplier - 1)) */
+		return VectorMultiply(Damage, VectorMultiplyAdd(ClampedChance, VectorSubtract(CritMultiplier, One), One));
+	}
+
+	FORCEINLINE float ExpectedDamage(float Damage, float CritChance, float CritMultiplier)
+	{
+		return Damage * (1.f + FMath::Clamp(CritChance, 0.f, 1.f) * (CritMultiplier - 1.f));
+	}
+
+	/** DPS of Count contiguous rows, every stat is a straight vector load */
+	void ComputeDPS(const float* Damage, const float* CritChance, const float* CritMultiplier, const float* AttackSpeed, int32 Count, float* OutDPS)
+	{
+		int32 Index = 0;
+		for (; Index + 4 <= Count; Index += 4)
+		{
+			const VectorRegister4Float Expected = ExpectedDamage(VectorLoad(&Damage[Index]), VectorLoad(&CritChance[Index]), VectorLoad(&CritMultiplier[Index]));
+
+			VectorStore(VectorMultiply(Expected, VectorLoad(&AttackSpeed[Index])), &OutDPS[Index]);
+		}
+
+		for (; Index < Count; ++Index)
+		{
+			OutDPS[Index] = ExpectedDamage(Damage[Index], CritChance[Index], CritMultiplier[Index]) * AttackSpeed[Index];
+		}
+	}
+}
+
+UItemStatTable* UItemStatTable::Get()
+{
+	return GEngine ? GEngine->GetEngineSubsystem<UItemStatTable>() : nullptr;
+}
+
+void UItemStatTable::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	/** Build rows for everything that is already loaded, and add the rest as it loads */
+	for (TObjectIterator<UItemData> It(RF_ClassDefaultObject); It; ++It)
+	{
+		RegisterItemData(*It);
+	}
+
+	AssetLoadedHandle = FCoreUObjectDelegates::OnAssetLoaded.AddUObject(this, &UItemStatTable::HandleAssetLoaded);
+}
+
+void UItemStatTable::Deinitialize()
+{
+	FCoreUObjectDelegates::OnAssetLoaded.Remove(AssetLoadedHandle);
+
+	Super::Deinitialize();
+}
+
+int32 UItemStatTable::RegisterItemData(const UItemData* ItemData)
+{
+	if (!ItemData)
+	{
+		return INDEX_NONE;
+	}
+
+	if (ItemData->StatTableIndex != INDEX_NONE)
+	{
+		return ItemData->StatTableIndex;
+	}
+
+	const FSoftObjectPath Path(ItemData);
+	int32 Row = INDEX_NONE;
+
+	if (const int32* ExistingRow = RowsByPath.Find(Path))
+	{
+		Row = *ExistingRow;
+	}
+	else
+	{
+		const FItemCombatStats Stats = ItemData->GetCombatStats();
+
+		Row = Damage.Add(Stats.Damage);
+		CriticalStrikeChance.Add(Stats.CriticalStrikeChance);
+		CriticalStrikeMultiplier.Add(Stats.CriticalStrikeMultiplier);
+		AttackSpeed.Add(Stats.AttackSpeed);
+
+		RowsByPath.Add(Path, Row);
+	}
+
+	ItemData->StatTableIndex = Row;
+
+	return Row;
+}
+
+FItemCombatStats UItemStatTable::GetStats(int32 StatIndex) const
+{
+	FItemCombatStats Stats;
+
+	if (Damage.IsValidIndex(StatIndex))
+	{
+		Stats.Damage = Damage[StatIndex];
+		Stats.CriticalStrikeChance = CriticalStrikeChance[StatIndex];
+		Stats.CriticalStrikeMultiplier = CriticalStrikeMultiplier[StatIndex];
+		Stats.AttackSpeed = AttackSpeed[StatIndex];
+	}
+
+	return Stats;
+}
+
+void UItemStatTable::ComputeBaseExpectedDamage(TConstArrayView<int32> StatIndices, TArrayView<float> OutExpectedDamage) const
+{
+	check(StatIndices.Num() == OutExpectedDamage.Num());
+
+	const int32 Count = StatIndices.Num();
+	int32 Index = 0;
+
+	/** Gather four rows into lanes, then do the math for all of them at once */
+	for (; Index + 4 <= Count; Index += 4)
+	{
+		const int32 A = StatIndices[Index], B = StatIndices[Index + 1], C = StatIndices[Index + 2], D = StatIndices[Index + 3];
+
+		const VectorRegister4Float Result = ItemStatTable::ExpectedDamage(
+			MakeVectorRegisterFloat(Damage[A], Damage[B], Damage[C], Damage[D]),
+			MakeVectorRegisterFloat(CriticalStrikeChance[A], CriticalStrikeChance[B], CriticalStrikeChance[C], CriticalStrikeChance[D]),
+			MakeVectorRegisterFloat(CriticalStrikeMultiplier[A], CriticalStrikeMultiplier[B], CriticalStrikeMultiplier[C], CriticalStrikeMultiplier[D]));
+
+		VectorStore(Result, &OutExpectedDamage[Index]);
+	}
+
+	for (; Index < Count; ++Index)
+	{
+		const int32 Row = StatIndices[Index];
+		OutExpectedDamage[Index] = ItemStatTable::ExpectedDamage(Damage[Row], CriticalStrikeChance[Row], CriticalStrikeMultiplier[Row]);
+	}
+}
+
+void UItemStatTable::ComputeBaseDPS(TConstArrayView<int32> StatIndices, TArrayView<float> OutDPS) const
+{
+	check(StatIndices.Num() == OutDPS.Num());
+
+	ComputeBaseExpectedDamage(StatIndices, OutDPS);
+
+	const int32 Count = StatIndices.Num();
+	int32 Index = 0;
+
+	for (; Index + 4 <= Count; Index += 4)
+	{
+		const VectorRegister4Float Speed = MakeVectorRegisterFloat(
+			AttackSpeed[StatIndices[Index]], AttackSpeed[StatIndices[Index + 1]], AttackSpeed[StatIndices[Index + 2]], AttackSpeed[StatIndices[Index + 3]]);
+
+		VectorStore(VectorMultiply(VectorLoad(&OutDPS[Index]), Speed), &OutDPS[Index]);
+	}
+
+	for (; Index < Count; ++Index)
+	{
+		OutDPS[Index] *= AttackSpeed[StatIndices[Index]];
+	}
+}
+
+void UItemStatTable::ComputeAllBaseDPS(TArrayView<float> OutDPS) const
+{
+	check(OutDPS.Num() == Num());
+
+	ItemStatTable::ComputeDPS(Damage.GetData(), CriticalStrikeChance.GetData(), CriticalStrikeMultiplier.GetData(), AttackSpeed.GetData(), Num(), OutDPS.GetData());
+}
+
+TArray<float> UItemStatTable::ComputeItemsDPS(const TArray<UItemInstance*>& Items) const
+{
+	const int32 Count = Items.Num();
+
+	/** Final stats are cached on the instances, gathered into lanes so the math still runs four items at a time */
+	TArray<float> ItemDamage, ItemCritChance, ItemCritMultiplier, ItemAttackSpeed;
+	ItemDamage.SetNumZeroed(Count);
+	ItemCritChance.SetNumZeroed(Count);
+	ItemCritMultiplier.SetNumZeroed(Count);
+	ItemAttackSpeed.SetNumZeroed(Count);
+
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		if (const UItemInstance* Item = Items[Index])
+		{
+			const FItemCombatStats Stats = Item->GetFinalStats();
+			ItemDamage[Index] = Stats.Damage;
+			ItemCritChance[Index] = Stats.CriticalStrikeChance;
+			ItemCritMultiplier[Index] = Stats.CriticalStrikeMultiplier;
+			ItemAttackSpeed[Index] = Stats.AttackSpeed;
+		}
+	}
+
+	TArray<float> Result;
+	Result.SetNumUninitialized(Count);
+	ItemStatTable::ComputeDPS(ItemDamage.GetData(), ItemCritChance.GetData(), ItemCritMultiplier.GetData(), ItemAttackSpeed.GetData(), Count, Result.GetData());
+
+	return Result;
+}
+
+void UItemStatTable::HandleAssetLoaded(UObject* Asset)
+{
+	if (const UItemData* ItemData = Cast<UItemData>(Asset))
+	{
+		RegisterItemData(ItemData);
+	}
+}
@@ -0,0 +1,90 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/EngineSubsystem.h"
+#include "ItemInstance.h"
+#include "ItemStatTable.generated.h"
+
+/**
+ * Structure-of-arrays table of the combat stats of every loaded UItemData.
+ *
+ * Each stat lives in its own contiguous array, indexed by the item data's row
+ * (see UItemInstance::GetStatIndex). Bulk calculations like DPS or expected
+ * damage over thousands of items read straight from these arrays four lanes
+ * at a time, instead of chasing Instance -> Data -> stat pointers per item.
+ *
+ * Rows hold the base stats of the item data. Affixes and runtime modifiers of an instance are
+ * not in the table, only ComputeItemsDPS applies them (see UItemInstance::GetFinalStats).
+ *
+ * Rows are append-only, so an index stays valid for the lifetime of the process.
+ */
+UCLASS()
+class INVTEST_API UItemStatTable : public UEngineSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static UItemStatTable* Get();
+
+	//~ Begin USubsystem Interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	//~ End USubsystem Interface
+
+	/**
+	 * @brief Adds a row for ItemData if it has none yet.
+	 * @return the row of ItemData
+	 */
+	int32 RegisterItemData(const UItemData* ItemData);
+
+	/** Number of rows in the table */
+	int32 Num() const { return Damage.Num(); }
+
+	/** Stats stored in a single row */
+	FItemCombatStats GetStats(int32 StatIndex) const;
+
+	/**
+	 * @brief Expected damage per hit of the base stats, Damage * (1 + CritChance * (CritMultiplier - 1)), for every row in StatIndices.
+	 *
+	 * Every entry of StatIndices must be a valid row, and OutExpectedDamage must have the same number of elements.
+	 */
+	void ComputeBaseExpectedDamage(TConstArrayView<int32> StatIndices, TArrayView<float> OutExpectedDamage) const;
+
+	/**
+	 * @brief Expected damage per second of the base stats (expected damage * attack speed) for every row in StatIndices.
+	 *
+	 * OutDPS must have the same number of elements as StatIndices.
+	 */
+	void ComputeBaseDPS(TConstArrayView<int32> StatIndices, TArrayView<float> OutDPS) const;
+
+	/**
+	 * @brief Expected damage per second of the base stats of every row in the table, reading each stat array linearly.
+	 *
+	 * OutDPS must have Num() elements.
+	 */
+	void ComputeAllBaseDPS(TArrayView<float> OutDPS) const;
+
+	/**
+	 * @brief Expected damage per second of every item instance in Items, from their final stats.
+	 *
+	 * Includes affixes and runtime modifiers, so it agrees with UItemInstance::GetFinalStats. Null items get 0.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Items|Stats")
+	TArray<float> ComputeItemsDPS(const TArray<UItemInstance*>& Items) const;
+
+private:
+	void HandleAssetLoaded(UObject* Asset);
+
+	/** One array per stat, all of them always have the same length */
+	TArray<float> Damage;
+	TArray<float> CriticalStrikeChance;
+	TArray<float> CriticalStrikeMultiplier;
+	TArray<float> AttackSpeed;
+
+	/** Rows by asset path, so an asset that gets unloaded and loaded again keeps its row */
+	TMap<FSoftObjectPath, int32> RowsByPath;
+
+	FDelegateHandle AssetLoadedHandle;
+};
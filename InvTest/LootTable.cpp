@@ -0,0 +1,438 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LootTable.h"
+#include "InvTest.h"
+#include "InventoryComponent.h"
+#include "InventoryStats.h"
+#include "ItemAssetLoader.h"
+
+DECLARE_CYCLE_STAT(TEXT("Roll Loot"), STAT_Inventory_RollLoot, STATGROUP_Inventory);
+
+namespace LootTable
+{
+	/** Nested tables deeper than this are ignored */
+	constexpr int32 MaxDepth = 8;
+
+	/** Re-rolls before an entry with a failed condition falls back to the linear pass */
+	constexpr int32 MaxRejections = 4;
+
+	/** Entries picked per Roll call, across all nested tables. Every pick drops at most once, so this caps the drops as well */
+	constexpr int32 MaxPicks = 1 << 16;
+
+	/** Units dropped per Roll call or added per AddDropsToInventory call, non-stackable units are an instance each */
+	constexpr int32 MaxUnits = 1 << 16;
+
+	enum class EVisit : uint8
+	{
+		InProgress,
+		Done,
+	};
+
+	/** Depth first search over the nested tables, true if Table is part of a cycle or reaches one */
+	bool HasCycle(const ULootTable* Table, TMap<const ULootTable*, EVisit>& Visits)
+	{
+		if (const EVisit* Visit = Visits.Find(Table))
+		{
+			return *Visit == EVisit::InProgress;
+		}
+
+		Visits.Add(Table, EVisit::InProgress);
+		for (const FLootTableEntry& Entry : Table->Entries)
+		{
+			if (Entry.NestedTable && HasCycle(Entry.NestedTable, Visits))
+			{
+				return true;
+			}
+		}
+		Visits.Add(Table, EVisit::Done);
+
+		return false;
+	}
+}
+
+/** Bookkeeping of a single Roll call, shared by all nested tables it rolls */
+struct FLootRollState
+{
+	int32 PicksLeft = LootTable::MaxPicks;
+	int32 UnitsLeft = LootTable::MaxUnits;
+	bool bTruncated = false;
+};
+
+void ULootTable::PostLoad()
+{
+	Super::PostLoad();
+
+	BuildSampler();
+}
+
+#if WITH_EDITOR
+void ULootTable::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	BuildSampler();
+}
+#endif
+
+void ULootTable::BuildSampler()
+{
+	const int32 NumEntries = Entries.Num();
+
+	AliasProbabilities.SetNumZeroed(NumEntries);
+	Aliases.SetNumUninitialized(NumEntries);
+	bHasConditions = false;
+
+	/** Checked once here rather than on every roll, a cyclic table would otherwise only stop at MaxDepth */
+	TMap<const ULootTable*, LootTable::EVisit> Visits;
+	bHasCycle = LootTable::HasCycle(this, Visits);
+	if (bHasCycle)
+	{
+		UE_LOG(LogInventory, Error, TEXT("ULootTable::BuildSampler: %s contains itself through its nested tables, it won't drop anything until that is fixed"), *GetPathName());
+	}
+
+	double TotalWeight = 0.0;
+	for (const FLootTableEntry& Entry : Entries)
+	{
+		TotalWeight += FMath::Max(Entry.Weight, 0.f);
+		bHasConditions |= !Entry.Condition.IsEmpty();
+	}
+
+	if (NumEntries == 0 || TotalWeight <= 0.0)
+	{
+		AliasProbabilities.Reset();
+		Aliases.Reset();
+		return;
+	}
+
+	/** Vose's alias method: scale weights so the average is 1, then pair every small column with a large one */
+	TArray<double> Scaled;
+	Scaled.SetNumUninitialized(NumEntries);
+
+	TArray<int32> Small;
+	TArray<int32> Large;
+	Small.Reserve(NumEntries);
+	Large.Reserve(NumEntries);
+
+	for (int32 Index = 0; Index < NumEntries; ++Index)
+	{
+		Scaled[Index] = FMath::Max(Entries[Index].Weight, 0.f) * NumEntries / TotalWeight;
+		(Scaled[Index] < 1.0 ? Small : Large).Add(Index);
+	}
+
+	while (Small.Num() > 0 && Large.Num() > 0)
+	{
+		const int32 Less = Small.Pop(EAllowShrinking::No);
+		const int32 More = Large.Pop(EAllowShrinking::No);
+
+		AliasProbabilities[Less] = static_cast<float>(Scaled[Less]);
+		Aliases[Less] = More;
+
+		Scaled[More] = (Scaled[More] + Scaled[Less]) - 1.0;
+		(Scaled[More] < 1.0 ? Small : Large).Add(More);
+	}
+
+	/** Whatever is left is 1 up to rounding errors */
+	for (const int32 Index : Large)
+	{
+		AliasProbabilities[Index] = 1.f;
+		Aliases[Index] = Index;
+	}
+	for (const int32 Index : Small)
+	{
+		AliasProbabilities[Index] = 1.f;
+		Aliases[Index] = Index;
+	}
+}
+
+int32 ULootTable::PickEntry(const FRandomStream& Stream, const FGameplayTagContainer& ContextTags) const
+{
+	const int32 NumColumns = AliasProbabilities.Num();
+	if (NumColumns == 0)
+	{
+		return INDEX_NONE;
+	}
+
+	for (int32 Try = 0; Try <= LootTable::MaxRejections; ++Try)
+	{
+		const int32 Column = Stream.RandHelper(NumColumns);
+		const int32 Index = Stream.GetFraction() < AliasProbabilities[Column] ? Column : Aliases[Column];
+
+		if (!bHasConditions || Entries[Index].Condition.IsEmpty() || Entries[Index].Condition.Matches(ContextTags))
+		{
+			return Index;
+		}
+	}
+
+	/** Conditions reject most of the table, pick by weight among the entries that match */
+	float MatchingWeight = 0.f;
+	for (const FLootTableEntry& Entry : Entries)
+	{
+		if (Entry.Condition.IsEmpty() || Entry.Condition.Matches(ContextTags))
+		{
+			MatchingWeight += FMath::Max(Entry.Weight, 0.f);
+		}
+	}
+
+	if (MatchingWeight <= 0.f)
+	{
+		return INDEX_NONE;
+	}
+
+	float Pick = Stream.FRandRange(0.f, MatchingWeight);
+	int32 LastMatching = INDEX_NONE;
+	for (int32 Index = 0; Index < Entries.Num(); ++Index)
+	{
+		const FLootTableEntry& Entry = Entries[Index];
+		if (Entry.Weight <= 0.f || !(Entry.Condition.IsEmpty() || Entry.Condition.Matches(ContextTags)))
+		{
+			continue;
+		}
+
+		LastMatching = Index;
+		Pick -= Entry.Weight;
+		if (Pick <= 0.f)
+		{
+			return Index;
+		}
+	}
+
+	return LastMatching;
+}
+
+void ULootTable::Roll(const FRandomStream& Stream, const FGameplayTagContainer& ContextTags, TArray<FLootDrop>& OutDrops, int32 NumRolls) const
+{
+	INVENTORY_SCOPE(STAT_Inventory_RollLoot);
+
+	if (bHasCycle)
+	{
+		return;
+	}
+
+	FLootRollState State;
+	OutDrops.Reserve(OutDrops.Num() + static_cast<int32>(FMath::Min<int64>(static_cast<int64>(NumRolls) * RollsPerTable, LootTable::MaxPicks)));
+	RollRecursive(Stream, ContextTags, OutDrops, NumRolls, 0, State);
+
+	if (State.bTruncated)
+	{
+		UE_LOG(LogInventory, Warning, TEXT("ULootTable::Roll: rolling %s %d times hit the limit of %d picks, %d units or %d nested tables, the drops were cut short"), *GetName(), NumRolls, LootTable::MaxPicks, LootTable::MaxUnits, LootTable::MaxDepth);
+	}
+}
+
+void ULootTable::RollRecursive(const FRandomStream& Stream, const FGameplayTagContainer& ContextTags, TArray<FLootDrop>& OutDrops, int32 NumRolls, int32 Depth, FLootRollState& State) const
+{
+	/** A nested table may have become cyclic after its parent was built, so depth is still bounded */
+	if (Depth > LootTable::MaxDepth || bHasCycle)
+	{
+		State.bTruncated = true;
+		return;
+	}
+
+	const int64 NumPicks = static_cast<int64>(NumRolls) * RollsPerTable;
+	for (int64 RollIndex = 0; RollIndex < NumPicks; ++RollIndex)
+	{
+		if (State.PicksLeft <= 0)
+		{
+			State.bTruncated = true;
+			return;
+		}
+		--State.PicksLeft;
+
+		const int32 EntryIndex = PickEntry(Stream, ContextTags);
+		if (EntryIndex == INDEX_NONE)
+		{
+			continue;
+		}
+
+		const FLootTableEntry& Entry = Entries[EntryIndex];
+		const int32 Quantity = Stream.RandRange(Entry.MinQuantity, FMath::Max(Entry.MinQuantity, Entry.MaxQuantity));
+
+		if (Entry.NestedTable)
+		{
+			Entry.NestedTable->RollRecursive(Stream, ContextTags, OutDrops, Quantity, Depth + 1, State);
+		}
+		else if (!Entry.ItemData.IsNull())
+		{
+			/** A single entry with a huge quantity would otherwise expand into that many instances */
+			if (Quantity > State.UnitsLeft)
+			{
+				State.bTruncated = true;
+			}
+
+			const int32 DropQuantity = FMath::Min(Quantity, State.UnitsLeft);
+			if (DropQuantity <= 0)
+			{
+				return;
+			}
+			State.UnitsLeft -= DropQuantity;
+
+			FLootDrop& Drop = OutDrops.AddDefaulted_GetRef();
+			Drop.ItemData = Entry.ItemData;
+			Drop.ItemClass = Entry.ItemClass;
+			Drop.Quantity = DropQuantity;
+		}
+	}
+}
+
+TArray<FLootDrop> ULootTable::RollLoot(int32 Seed, const FGameplayTagContainer& ContextTags, int32 NumRolls) const
+{
+	TArray<FLootDrop> Drops;
+	Roll(FRandomStream(Seed), ContextTags, Drops, NumRolls);
+	return Drops;
+}
+
+void ULootTable::RollIntoInventory(UInventoryComponent* Inventory, int32 Seed, const FGameplayTagContainer& ContextTags, int32 NumRolls) const
+{
+	if (!Inventory || !Inventory->GetOwner()->HasAuthority())
+	{
+		UE_LOG(LogInventory, Warning, TEXT("ULootTable::RollIntoInventory needs an inventory on the authority"));
+		return;
+	}
+
+	TArray<FLootDrop> Drops;
+	Roll(FRandomStream(Seed), ContextTags, Drops, NumRolls);
+
+	AddDropsToInventory(Inventory, MoveTemp(Drops));
+}
+
+void ULootTable::AddDropsToInventory(UInventoryComponent* Inventory, TArray<FLootDrop> Drops, FOnLootDropsAdded OnAdded)
+{
+	if (!Inventory || Drops.Num() == 0)
+	{
+		OnAdded.ExecuteIfBound(Drops);
+		return;
+	}
+
+	/** Merge drops of the same item, so every item is resolved and added once. Units past the cap are left over right away */
+	TMap<TPair<FSoftObjectPath, UClass*>, int32> MergedIndices;
+	TArray<FLootDrop> Merged;
+	TArray<FLootDrop> Leftovers;
+	int32 UnitsLeft = LootTable::MaxUnits;
+	for (const FLootDrop& Drop : Drops)
+	{
+		const int32 Quantity = FMath::Clamp(Drop.Quantity, 0, UnitsLeft);
+		if (Quantity < Drop.Quantity)
+		{
+			FLootDrop& Leftover = Leftovers.Add_GetRef(Drop);
+			Leftover.Quantity = Drop.Quantity - Quantity;
+		}
+		if (Quantity == 0)
+		{
+			continue;
+		}
+		UnitsLeft -= Quantity;
+
+		const TPair<FSoftObjectPath, UClass*> Key(Drop.ItemData.ToSoftObjectPath(), Drop.ItemClass.Get());
+		if (const int32* Index = MergedIndices.Find(Key))
+		{
+			Merged[*Index].Quantity += Quantity;
+		}
+		else
+		{
+			FLootDrop& MergedDrop = Merged[Merged.Add(Drop)];
+			MergedDrop.Quantity = Quantity;
+			MergedIndices.Add(Key, Merged.Num() - 1);
+		}
+	}
+
+	auto AddMerged = [WeakInventory = TWeakObjectPtr<UInventoryComponent>(Inventory), Merged, Leftovers = MoveTemp(Leftovers), OnAdded]() mutable
+	{
+		UInventoryComponent* TargetInventory = WeakInventory.Get();
+		if (!TargetInventory)
+		{
+			Leftovers.Append(Merged);
+			OnAdded.ExecuteIfBound(Leftovers);
+			return;
+		}
+
+		UItemAssetLoader* Loader = UItemAssetLoader::Get();
+
+		TArray<FItemInstanceInitializer> Initializers;
+		/** Merged drops that became instances, with the number of units each asked for */
+		TArray<TPair<int32, UItemData*>> InstanceDrops;
+		for (int32 DropIndex = 0; DropIndex < Merged.Num(); ++DropIndex)
+		{
+			const FLootDrop& Drop = Merged[DropIndex];
+			UItemData* ItemData = Loader ? Loader->ResolveItemData(Drop.ItemData) : Drop.ItemData.LoadSynchronous();
+			if (!ItemData)
+			{
+				Leftovers.Add(Drop);
+				continue;
+			}
+
+			if (ItemData->IsStackable())
+			{
+				const int32 NumAdded = TargetInventory->AddStackableItem(ItemData, Drop.Quantity);
+				if (NumAdded < Drop.Quantity)
+				{
+					FLootDrop& Leftover = Leftovers.Add_GetRef(Drop);
+					Leftover.Quantity = Drop.Quantity - NumAdded;
+				}
+				continue;
+			}
+
+			if (!Drop.ItemClass)
+			{
+				UE_LOG(LogInventory, Warning, TEXT("ULootTable: dropped %s, which is not stackable, but its entry has no ItemClass"), *ItemData->GetName());
+				Leftovers.Add(Drop);
+				continue;
+			}
+
+			InstanceDrops.Emplace(DropIndex, ItemData);
+			for (int32 Unit = 0; Unit < Drop.Quantity; ++Unit)
+			{
+				FItemInstanceInitializer& Initializer = Initializers.AddDefaulted_GetRef();
+				Initializer.ItemClass = Drop.ItemClass;
+				Initializer.ItemData = ItemData;
+			}
+		}
+
+		/** Whatever the inventory had no room for is handed back, e.g., to be dropped on the ground */
+		TMap<const UItemData*, int32> NumCreated;
+		for (const UItemInstance* Item : TargetInventory->CreateItemsInInventory(Initializers))
+		{
+			++NumCreated.FindOrAdd(Item->GetData());
+		}
+		for (const TPair<int32, UItemData*>& InstanceDrop : InstanceDrops)
+		{
+			const FLootDrop& Drop = Merged[InstanceDrop.Key];
+			int32& NumCreatedOfData = NumCreated.FindOrAdd(InstanceDrop.Value);
+			const int32 NumAdded = FMath::Min(NumCreatedOfData, Drop.Quantity);
+			NumCreatedOfData -= NumAdded;
+
+			if (NumAdded < Drop.Quantity)
+			{
+				FLootDrop& Leftover = Leftovers.Add_GetRef(Drop);
+				Leftover.Quantity = Drop.Quantity - NumAdded;
+			}
+		}
+
+		if (Leftovers.Num() > 0)
+		{
+			int32 NumUnitsLeft = 0;
+			for (const FLootDrop& Leftover : Leftovers)
+			{
+				NumUnitsLeft += Leftover.Quantity;
+			}
+			UE_LOG(LogInventory, Log, TEXT("ULootTable: %d units of loot did not fit into %s"), NumUnitsLeft, *TargetInventory->GetName());
+		}
+		OnAdded.ExecuteIfBound(Leftovers);
+	};
+
+	UItemAssetLoader* AssetLoader = UItemAssetLoader::Get();
+	if (!AssetLoader)
+	{
+		AddMerged();
+		return;
+	}
+
+	TArray<TSoftObjectPtr<UItemData>> ItemData;
+	ItemData.Reserve(Merged.Num());
+	for (const FLootDrop& Drop : Merged)
+	{
+		ItemData.Add(Drop.ItemData);
+	}
+
+	/** Stacks never spawn actors, but most drops are instances that will, so stream the actor classes in too */
+	AssetLoader->PrefetchItemData(ItemData, FStreamableDelegate::CreateLambda(MoveTemp(AddMerged)));
+}
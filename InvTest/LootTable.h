@@ -0,0 +1,156 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "GameplayTagContainer.h"
+#include "ItemInstance.h"
+#include "LootTable.generated.h"
+
+class ULootTable;
+class UInventoryComponent;
+struct FLootRollState;
+
+/**
+ * A single weighted outcome of a loot table roll.
+ *
+ * Drops ItemData, or rolls NestedTable instead if set. An entry with neither is a "nothing" outcome.
+ */
+USTRUCT(BlueprintType)
+struct FLootTableEntry
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditDefaultsOnly)
+	TSoftObjectPtr<UItemData> ItemData;
+
+	/** Instance class created for non-stackable items */
+	UPROPERTY(EditDefaultsOnly)
+	TSubclassOf<UItemInstance> ItemClass;
+
+	/** Rolled instead of dropping ItemData, Quantity is the number of times it is rolled */
+	UPROPERTY(EditDefaultsOnly)
+	TObjectPtr<ULootTable> NestedTable = nullptr;
+
+	/** Relative chance of this entry, compared to the other entries of the table */
+	UPROPERTY(EditDefaultsOnly, meta = (ClampMin = "0"))
+	float Weight = 1.f;
+
+	UPROPERTY(EditDefaultsOnly, meta = (ClampMin = "1"))
+	int32 MinQuantity = 1;
+
+	UPROPERTY(EditDefaultsOnly, meta = (ClampMin = "1"))
+	int32 MaxQuantity = 1;
+
+	/** Tags the roll context has to match for this entry to drop, empty always matches */
+	UPROPERTY(EditDefaultsOnly)
+	FGameplayTagQuery Condition;
+};
+
+/**
+ * Result of a roll, Quantity units of ItemData.
+ */
+USTRUCT(BlueprintType)
+struct FLootDrop
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	TSoftObjectPtr<UItemData> ItemData;
+
+	UPROPERTY(BlueprintReadOnly)
+	TSubclassOf<UItemInstance> ItemClass;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Quantity = 0;
+};
+
+/** Called with the drops (or the part of them) that did not fit into the inventory, empty if everything was added */
+DECLARE_DELEGATE_OneParam(FOnLootDropsAdded, const TArray<FLootDrop>& /*Leftovers*/);
+
+/**
+ * Data driven item generation: weighted entries with quantity ranges, conditions and nested tables.
+ *
+ * Entries are sampled with a precomputed alias table (Vose's method), so a roll costs O(1)
+ * no matter how many entries the table has. Conditions are handled by rejection: an entry
+ * whose condition fails is re-rolled, after a few failed tries the roll falls back to a
+ * linear pass over the entries that do match.
+ *
+ * Rolling only reads the table, so it is safe to roll off the game thread once BuildSampler has run
+ * (it runs in PostLoad, and nested tables are loaded with their parent).
+ *
+ * A table that contains itself through its nested tables is reported by BuildSampler and drops nothing.
+ * A single Roll call picks at most 65536 entries across all nested tables, whatever NumRolls and the
+ * nested quantities multiply out to, and drops at most 65536 units in total.
+ */
+UCLASS(BlueprintType)
+class INVTEST_API ULootTable : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin UObject Interface
+	virtual void PostLoad() override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+	//~ End UObject Interface
+
+	UPROPERTY(EditDefaultsOnly, Category = "Loot")
+	TArray<FLootTableEntry> Entries;
+
+	/** Number of entries picked per roll of this table */
+	UPROPERTY(EditDefaultsOnly, Category = "Loot", meta = (ClampMin = "1"))
+	int32 RollsPerTable = 1;
+
+	/**
+	 * @brief Rolls this table NumRolls times, appending the results to OutDrops.
+	 *
+	 * Drops are not merged, the same item can show up several times.
+	 * @param ContextTags matched against the entries' conditions (e.g., difficulty, biome)
+	 */
+	void Roll(const FRandomStream& Stream, const FGameplayTagContainer& ContextTags, TArray<FLootDrop>& OutDrops, int32 NumRolls = 1) const;
+
+	UFUNCTION(BlueprintCallable, Category = "Loot")
+	TArray<FLootDrop> RollLoot(int32 Seed, const FGameplayTagContainer& ContextTags, int32 NumRolls = 1) const;
+
+	/**
+	 * @brief Rolls this table and adds the results to an inventory.
+	 *
+	 * Drops of the same item are merged first, item data is streamed in asynchronously, then stackable
+	 * items are added as stacks and everything else is created with a single CreateItemsInInventory call.
+	 *
+	 * Authority only.
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Loot")
+	void RollIntoInventory(UInventoryComponent* Inventory, int32 Seed, const FGameplayTagContainer& ContextTags, int32 NumRolls = 1) const;
+
+	/**
+	 * @brief Adds already rolled drops to an inventory, see RollIntoInventory.
+	 *
+	 * At most 65536 units are added per call. Units over that, units the inventory has no room for and
+	 * drops whose data fails to load are passed to OnAdded once the rest was added.
+	 */
+	static void AddDropsToInventory(UInventoryComponent* Inventory, TArray<FLootDrop> Drops, FOnLootDropsAdded OnAdded = FOnLootDropsAdded());
+
+	/** Rebuilds the alias table from Entries, call after changing Entries at runtime */
+	void BuildSampler();
+
+private:
+	/** Picks an entry index, or INDEX_NONE if no entry matches ContextTags */
+	int32 PickEntry(const FRandomStream& Stream, const FGameplayTagContainer& ContextTags) const;
+
+	void RollRecursive(const FRandomStream& Stream, const FGameplayTagContainer& ContextTags, TArray<FLootDrop>& OutDrops, int32 NumRolls, int32 Depth, FLootRollState& State) const;
+
+	/** Probability of keeping the sampled column, per entry */
+	TArray<float> AliasProbabilities;
+	/** Entry picked instead if the sampled column is not kept */
+	TArray<int32> Aliases;
+
+	/** Whether any entry has a condition, if not rejection sampling is skipped entirely */
+	bool bHasConditions = false;
+
+	/** Whether this table reaches itself through its nested tables, set by BuildSampler */
+	bool bHasCycle = false;
+};
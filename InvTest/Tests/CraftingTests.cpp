@@ -0,0 +1,220 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InventoryTestUtils.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "CraftingRecipe.h"
+#include "CraftingSubsystem.h"
+#include "InventoryComponent.h"
+#include "InventoryTestTypes.h"
+#include "ItemInstance.h"
+#include "UObject/StrongObjectPtr.h"
+
+/**
+ * UCraftingSubsystem: crafting as one transaction, and the incrementally tracked craftable list.
+ */
+namespace CraftingTests
+{
+	UCraftingRecipe* NewRecipe(UCraftingCatalog* Catalog, TArray<FCraftingIngredient> Ingredients, TArray<FCraftingOutput> Outputs)
+	{
+		UCraftingRecipe* Recipe = NewObject<UCraftingRecipe>(Catalog);
+		Recipe->Ingredients = MoveTemp(Ingredients);
+		Recipe->Outputs = MoveTemp(Outputs);
+		Catalog->Recipes.Add(Recipe);
+		return Recipe;
+	}
+
+	FCraftingIngredient MakeIngredient(UItemData* ItemData, int32 Count)
+	{
+		FCraftingIngredient Ingredient;
+		Ingredient.ItemData = ItemData;
+		Ingredient.Count = Count;
+		return Ingredient;
+	}
+
+	FCraftingOutput MakeOutput(UItemData* ItemData, int32 Count)
+	{
+		FCraftingOutput Output;
+		Output.ItemData = ItemData;
+		Output.ItemClass = UInventoryTestItemInstance::StaticClass();
+		Output.Count = Count;
+		return Output;
+	}
+
+	/** The linear scan the tracker replaces: every ingredient of every recipe, in catalog order like GetCraftableRecipes */
+	TArray<UCraftingRecipe*> ScanCraftableRecipes(const UCraftingCatalog* Catalog, const UInventoryComponent* Inventory)
+	{
+		TArray<UCraftingRecipe*> Craftable;
+		for (UCraftingRecipe* Recipe : Catalog->Recipes)
+		{
+			const bool bCraftable = Recipe->Ingredients.Num() > 0 && !Recipe->Ingredients.ContainsByPredicate([Inventory](const FCraftingIngredient& Ingredient)
+			{
+				return Inventory->GetItemCountByData(Ingredient.ItemData.Get()) < Ingredient.Count;
+			});
+			if (bCraftable)
+			{
+				Craftable.Add(Recipe);
+			}
+		}
+		return Craftable;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCraftingTransactionTest, "InvTest.Crafting.Craft", INVENTORY_TEST_FLAGS)
+bool FCraftingTransactionTest::RunTest(const FString& Parameters)
+{
+	using namespace CraftingTests;
+
+	InventoryTest::FTestWorld TestWorld;
+
+	UCraftingSubsystem* Crafting = TestWorld.GetWorld()->GetSubsystem<UCraftingSubsystem>();
+	if (!TestNotNull(TEXT("The world has a crafting subsystem"), Crafting))
+	{
+		return false;
+	}
+
+	UItemData* Ore = TestWorld.NewItemData(TEXT("CraftOre"), 50);
+	UItemData* Bar = TestWorld.NewItemData(TEXT("CraftBar"), 50);
+	UItemData* Wood = TestWorld.NewItemData(TEXT("CraftWood"), 50);
+	UItemData* Sword = TestWorld.NewItemData(TEXT("CraftSword"));
+
+	const TStrongObjectPtr<UCraftingCatalog> Catalog(NewObject<UCraftingCatalog>());
+	UCraftingRecipe* Smelt = NewRecipe(Catalog.Get(), { MakeIngredient(Ore, 3) }, { MakeOutput(Bar, 1) });
+	UCraftingRecipe* Forge = NewRecipe(Catalog.Get(), { MakeIngredient(Bar, 2), MakeIngredient(Wood, 1) }, { MakeOutput(Sword, 1) });
+	Catalog->BuildIndex();
+	Crafting->SetCatalog(Catalog.Get());
+
+	UInventoryComponent* Inventory = TestWorld.SpawnInventory();
+	TestEqual(TEXT("An empty inventory can craft nothing"), Crafting->GetCraftableRecipes(Inventory).Num(), 0);
+
+	Inventory->AddStackableItem(Ore, 6);
+	TestTrue(TEXT("Enough ore makes smelting craftable"), Crafting->GetCraftableRecipes(Inventory) == TArray<UCraftingRecipe*>{ Smelt });
+
+	TestTrue(TEXT("Smelting twice works"), Crafting->Craft(Inventory, Smelt, 2));
+	TestEqual(TEXT("Crafting consumes the ingredients"), Inventory->GetItemCountByData(Ore), 0);
+	TestEqual(TEXT("Crafting produces the outputs"), Inventory->GetItemCountByData(Bar), 2);
+	TestEqual(TEXT("Out of ore, and no wood for the sword"), Crafting->GetCraftableRecipes(Inventory).Num(), 0);
+
+	/** A failed craft leaves the inventory as it was */
+	TestFalse(TEXT("Forging without wood fails"), Crafting->Craft(Inventory, Forge));
+	TestEqual(TEXT("A failed craft consumes nothing"), Inventory->GetItemCountByData(Bar), 2);
+
+	Inventory->AddStackableItem(Wood, 1);
+	TestTrue(TEXT("Adding the missing ingredient makes forging craftable"), Crafting->IsRecipeCraftable(Inventory, Forge));
+
+	TestTrue(TEXT("Forging works"), Crafting->Craft(Inventory, Forge));
+	TestEqual(TEXT("The sword was created as an instance"), Inventory->GetNumItems(), 1);
+	TestEqual(TEXT("Bars were consumed"), Inventory->GetItemCountByData(Bar), 0);
+	TestEqual(TEXT("Wood was consumed"), Inventory->GetItemCountByData(Wood), 0);
+
+	/** Instances count as ingredients too, and a rebuilt index is picked up by existing trackers */
+	UCraftingRecipe* Salvage = NewRecipe(Catalog.Get(), { MakeIngredient(Sword, 1) }, { MakeOutput(Bar, 1) });
+	Catalog->BuildIndex();
+	TestTrue(TEXT("A recipe added to the catalog shows up"), Crafting->GetCraftableRecipes(Inventory) == TArray<UCraftingRecipe*>{ Salvage });
+
+	TestTrue(TEXT("Salvaging works"), Crafting->Craft(Inventory, Salvage));
+	TestEqual(TEXT("The sword instance was consumed"), Inventory->GetNumItems(), 0);
+
+	AddExpectedMessage(TEXT("can't be crafted"), ELogVerbosity::Warning, EAutomationExpectedMessageFlags::Contains, 1);
+	TestFalse(TEXT("Crafting more than MaxCraftTimes at once is rejected"), Crafting->Craft(Inventory, Smelt, UCraftingSubsystem::MaxCraftTimes + 1));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCraftingBenchmark, "InvTest.Benchmark.CraftableList", INVENTORY_TEST_FLAGS)
+bool FCraftingBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace CraftingTests;
+
+	InventoryTest::FTestWorld TestWorld;
+	InventoryTest::FBenchmarkResults Results(TEXT("CraftableList"));
+
+	UCraftingSubsystem* Crafting = TestWorld.GetWorld()->GetSubsystem<UCraftingSubsystem>();
+	if (!TestNotNull(TEXT("The world has a crafting subsystem"), Crafting))
+	{
+		return false;
+	}
+
+	constexpr int32 NumRecipes = 3000;
+	constexpr int32 NumIngredients = 500;
+	constexpr int32 NumQueries = 1000;
+
+	TArray<UItemData*> Ingredients;
+	for (int32 Index = 0; Index < NumIngredients; ++Index)
+	{
+		Ingredients.Add(TestWorld.NewItemData(FString::Printf(TEXT("CraftIngredient%d"), Index), 100));
+	}
+	UItemData* Product = TestWorld.NewItemData(TEXT("CraftProduct"), 100);
+
+	/** One to four ingredients per recipe, needing one to five units each */
+	const FRandomStream Stream(7);
+	const TStrongObjectPtr<UCraftingCatalog> Catalog(NewObject<UCraftingCatalog>());
+	for (int32 Index = 0; Index < NumRecipes; ++Index)
+	{
+		TArray<FCraftingIngredient> RecipeIngredients;
+		const int32 NumRecipeIngredients = Stream.RandRange(1, 4);
+		for (int32 Ingredient = 0; Ingredient < NumRecipeIngredients; ++Ingredient)
+		{
+			RecipeIngredients.Add(MakeIngredient(Ingredients[Stream.RandHelper(NumIngredients)], Stream.RandRange(1, 5)));
+		}
+		NewRecipe(Catalog.Get(), MoveTemp(RecipeIngredients), { MakeOutput(Product, 1) });
+	}
+	Catalog->BuildIndex();
+	Crafting->SetCatalog(Catalog.Get());
+
+	/** Half of the ingredients, in amounts that satisfy some recipes and not others */
+	UInventoryComponent* Inventory = TestWorld.SpawnInventory();
+	for (int32 Index = 0; Index < NumIngredients; Index += 2)
+	{
+		Inventory->AddStackableItem(Ingredients[Index], Stream.RandRange(1, 5));
+	}
+
+	TArray<UCraftingRecipe*> Craftable;
+	const double FirstSeconds = InventoryTest::TimeSeconds([&]()
+	{
+		Craftable = Crafting->GetCraftableRecipes(Inventory);
+	});
+
+	TestTrue(TEXT("The tracker agrees with a full scan"), Craftable == ScanCraftableRecipes(Catalog.Get(), Inventory));
+	TestTrue(TEXT("Some but not all recipes are craftable"), Craftable.Num() > 0 && Craftable.Num() < NumRecipes);
+
+	const double IdleSeconds = InventoryTest::TimeSeconds([&]()
+	{
+		for (int32 Query = 0; Query < NumQueries; ++Query)
+		{
+			Craftable = Crafting->GetCraftableRecipes(Inventory);
+		}
+	});
+
+	/** A pickup between queries, the common case during play */
+	const double ChangedSeconds = InventoryTest::TimeSeconds([&]()
+	{
+		for (int32 Query = 0; Query < NumQueries; ++Query)
+		{
+			Inventory->AddStackableItem(Ingredients[Query % NumIngredients], 1);
+			Craftable = Crafting->GetCraftableRecipes(Inventory);
+		}
+	});
+
+	TestTrue(TEXT("The tracker still agrees with a full scan after the changes"), Craftable == ScanCraftableRecipes(Catalog.Get(), Inventory));
+
+	TArray<UCraftingRecipe*> Scanned;
+	const double ScanSeconds = InventoryTest::TimeSeconds([&]()
+	{
+		for (int32 Query = 0; Query < NumQueries; ++Query)
+		{
+			Scanned = ScanCraftableRecipes(Catalog.Get(), Inventory);
+		}
+	});
+
+	Results.Add(TEXT("FirstQuery"), NumRecipes, FirstSeconds * 1e6, TEXT("us/query"));
+	Results.Add(TEXT("IdleQuery"), NumRecipes, IdleSeconds * 1e6 / NumQueries, TEXT("us/query"));
+	Results.Add(TEXT("QueryAfterPickup"), NumRecipes, ChangedSeconds * 1e6 / NumQueries, TEXT("us/query"));
+	Results.Add(TEXT("LinearScan"), NumRecipes, ScanSeconds * 1e6 / NumQueries, TEXT("us/query"));
+
+	return Results.Save(*this);
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,192 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InventoryTestUtils.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "EquipmentComponent.h"
+#include "InventoryComponent.h"
+#include "InventoryTestTypes.h"
+#include "ItemInstance.h"
+
+/**
+ * UEquipmentComponent slots, the item actors and locks they drive, and the cached stat aggregate.
+ */
+namespace EquipmentTests
+{
+	const FName MainHand(TEXT("MainHand"));
+	const FName OffHand(TEXT("OffHand"));
+
+	/** Equipment with SlotNames on the inventory's owner, any item fits any slot */
+	UEquipmentComponent* AddEquipment(InventoryTest::FTestWorld& TestWorld, UInventoryComponent* Inventory, TConstArrayView<FName> SlotNames)
+	{
+		return CastChecked<UEquipmentComponent>(TestWorld.AddComponent(Inventory->GetOwner(), UEquipmentComponent::StaticClass(), [SlotNames](UActorComponent& Component)
+		{
+			for (const FName SlotName : SlotNames)
+			{
+				CastChecked<UEquipmentComponent>(&Component)->SlotDefinitions.AddDefaulted_GetRef().SlotName = SlotName;
+			}
+		}));
+	}
+
+	USwordItemData* NewItemData(InventoryTest::FTestWorld& TestWorld, const FString& Name, int32 Damage, float CritMultiplier, float AttackSpeed)
+	{
+		USwordItemData* ItemData = TestWorld.NewItemData(Name);
+		ItemData->BaseDamage = Damage;
+		ItemData->BaseCriticalStrikeMultiplier = CritMultiplier;
+		ItemData->BaseAttackSpeed = AttackSpeed;
+		return ItemData;
+	}
+
+	UItemInstance* CreateItem(UInventoryComponent* Inventory, UItemData* ItemData)
+	{
+		FItemInstanceInitializer Initializer;
+		Initializer.ItemClass = UInventoryTestItemInstance::StaticClass();
+		Initializer.ItemData = ItemData;
+		Initializer.bRollAffixes = false;
+
+		const TArray<UItemInstance*> Items = Inventory->CreateItemsInInventory({ Initializer });
+		return Items.Num() == 1 ? Items[0] : nullptr;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FEquipmentSlotsTest, "InvTest.Equipment.Slots", INVENTORY_TEST_FLAGS)
+bool FEquipmentSlotsTest::RunTest(const FString& Parameters)
+{
+	using namespace EquipmentTests;
+
+	InventoryTest::FTestWorld TestWorld;
+
+	UInventoryComponent* Inventory = TestWorld.SpawnInventory();
+	UEquipmentComponent* Equipment = AddEquipment(TestWorld, Inventory, { MainHand, OffHand });
+
+	UItemInstance* Sword = CreateItem(Inventory, NewItemData(TestWorld, TEXT("EquipSword"), 10, 1.5f, 1.f));
+	UItemInstance* Dagger = CreateItem(Inventory, NewItemData(TestWorld, TEXT("EquipDagger"), 20, 2.f, 0.5f));
+	if (!TestNotNull(TEXT("The sword was created"), Sword) || !TestNotNull(TEXT("The dagger was created"), Dagger))
+	{
+		return false;
+	}
+
+	Equipment->EquipItem(Sword, MainHand);
+	Equipment->EquipItem(Dagger, OffHand);
+	TestWorld.Tick();
+
+	TestTrue(TEXT("The sword is in the main hand"), Equipment->GetEquippedItem(MainHand) == Sword);
+	TestEqual(TEXT("The dagger's slot is the off hand"), Equipment->GetSlotOfItem(Dagger), OffHand);
+	TestTrue(TEXT("Equipping spawns the item actor"), Inventory->IsItemActorSpawned(Sword));
+	TestTrue(TEXT("Equipped items are locked"), Inventory->IsItemActorLocked(Sword));
+
+	/** The owner's client can't hide an equipped item by destroying its actor */
+	AddExpectedMessage(TEXT("locked instance"), ELogVerbosity::Warning, EAutomationExpectedMessageFlags::Contains, 1);
+	Inventory->ServerDestroyItemActor(Sword);
+	TestWorld.Tick();
+	TestTrue(TEXT("A locked item's actor can't be destroyed by the client"), Inventory->IsItemActorSpawned(Sword));
+
+	/** Damage and attack speed add up, crit multipliers add their bonus over 1 */
+	FItemCombatStats Stats = Equipment->GetEquippedStats();
+	TestEqual(TEXT("Damage adds up"), Stats.Damage, 30.f);
+	TestEqual(TEXT("Crit multipliers add their bonus"), Stats.CriticalStrikeMultiplier, 2.5f);
+	TestEqual(TEXT("Attack speed adds up"), Stats.AttackSpeed, 1.5f);
+
+	/** Modifiers on an equipped item invalidate the cache */
+	Sword->AddModifier(EItemStat::Damage, EItemModifierOp::Additive, 5.f);
+	TestEqual(TEXT("A modifier on an equipped item shows up"), Equipment->GetEquippedStat(EItemStat::Damage), 35.f);
+
+	Equipment->UnequipSlot(OffHand);
+	TestWorld.Tick();
+	TestNull(TEXT("The off hand is empty"), Equipment->GetEquippedItem(OffHand));
+	TestFalse(TEXT("Unequipping destroys the item actor"), Inventory->IsItemActorSpawned(Dagger));
+	TestFalse(TEXT("Unequipping unlocks the item"), Inventory->IsItemActorLocked(Dagger));
+	TestEqual(TEXT("An unequipped item no longer counts"), Equipment->GetEquippedStat(EItemStat::Damage), 15.f);
+
+	/** Equipping an item that is already equipped moves it */
+	Equipment->EquipItem(Sword, OffHand);
+	TestNull(TEXT("Moving an item empties its old slot"), Equipment->GetEquippedItem(MainHand));
+	TestTrue(TEXT("Moving an item fills the new slot"), Equipment->GetEquippedItem(OffHand) == Sword);
+	TestEqual(TEXT("A moved item is counted once"), Equipment->GetEquippedStat(EItemStat::Damage), 15.f);
+
+	/** Items leaving the inventory are unequipped */
+	Inventory->RemoveItemFromInventory(Sword);
+	TestNull(TEXT("A removed item is unequipped"), Equipment->GetEquippedItem(OffHand));
+	TestEqual(TEXT("Nothing equipped, default stats"), Equipment->GetEquippedStat(EItemStat::Damage), 0.f);
+	TestEqual(TEXT("Nothing equipped, default crit multiplier"), Equipment->GetEquippedStat(EItemStat::CriticalStrikeMultiplier), 1.f);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FEquipmentBenchmark, "InvTest.Benchmark.EquippedStats", INVENTORY_TEST_FLAGS)
+bool FEquipmentBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace EquipmentTests;
+
+	InventoryTest::FTestWorld TestWorld;
+	InventoryTest::FBenchmarkResults Results(TEXT("EquippedStats"));
+
+	constexpr int32 NumSlots = 8;
+	constexpr int32 NumHits = 1000000;
+
+	TArray<FName> SlotNames;
+	for (int32 Index = 0; Index < NumSlots; ++Index)
+	{
+		SlotNames.Add(*FString::Printf(TEXT("Slot%d"), Index));
+	}
+
+	UItemData* ItemData = NewItemData(TestWorld, TEXT("BenchmarkSword"), 10, 1.5f, 1.f);
+
+	const int32 InventorySizes[] = { 100, 1000, 10000 };
+	for (const int32 NumItems : InventorySizes)
+	{
+		UInventoryComponent* Inventory = TestWorld.SpawnInventory();
+		UEquipmentComponent* Equipment = AddEquipment(TestWorld, Inventory, SlotNames);
+
+		TArray<FItemInstanceInitializer> Initializers;
+		Initializers.SetNum(NumItems);
+		for (FItemInstanceInitializer& Initializer : Initializers)
+		{
+			Initializer.ItemClass = UInventoryTestItemInstance::StaticClass();
+			Initializer.ItemData = ItemData;
+		}
+		const TArray<UItemInstance*> Items = Inventory->CreateItemsInInventory(Initializers);
+
+		for (int32 Slot = 0; Slot < NumSlots; ++Slot)
+		{
+			Equipment->EquipItem(Items[Slot * (NumItems / NumSlots)], SlotNames[Slot]);
+		}
+
+		double CachedDamage = 0.0;
+		const double CachedSeconds = InventoryTest::TimeSeconds([&]()
+		{
+			for (int32 Hit = 0; Hit < NumHits; ++Hit)
+			{
+				CachedDamage += Equipment->GetEquippedStat(EItemStat::Damage);
+			}
+		});
+
+		/** What combat code did before: walk the inventory for items with their actor out, every hit */
+		constexpr int32 NumWalks = 100;
+		double WalkedDamage = 0.0;
+		const double WalkSeconds = InventoryTest::TimeSeconds([&]()
+		{
+			for (int32 Hit = 0; Hit < NumWalks; ++Hit)
+			{
+				for (UItemInstance* Item : Items)
+				{
+					if (Inventory->IsItemActorSpawned(Item))
+					{
+						WalkedDamage += Item->GetStat(EItemStat::Damage);
+					}
+				}
+			}
+		});
+
+		TestEqual(FString::Printf(TEXT("[%d] both ways sum the same damage"), NumItems), CachedDamage / NumHits, WalkedDamage / NumWalks, 1e-3);
+
+		Results.Add(TEXT("CachedAggregate"), NumItems, CachedSeconds * 1e9 / NumHits, TEXT("ns/hit"));
+		Results.Add(TEXT("InventoryWalk"), NumItems, WalkSeconds * 1e9 / NumWalks, TEXT("ns/hit"));
+	}
+
+	return Results.Save(*this);
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,245 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InventoryTestUtils.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "GridInventoryComponent.h"
+#include "InventoryTestTypes.h"
+#include "ItemDataRegistry.h"
+#include "ItemInstance.h"
+
+/**
+ * UGridInventoryComponent placement, moves, capacity and auto-sort.
+ */
+namespace GridInventoryTests
+{
+	USwordItemData* NewItemData(InventoryTest::FTestWorld& TestWorld, FIntPoint GridSize)
+	{
+		USwordItemData* ItemData = TestWorld.NewItemData(FString::Printf(TEXT("GridSword%dx%d"), GridSize.X, GridSize.Y));
+		ItemData->GridSize = GridSize;
+		return ItemData;
+	}
+
+	UItemInstance* CreateItem(UGridInventoryComponent* Grid, UItemData* ItemData)
+	{
+		FItemInstanceInitializer Initializer;
+		Initializer.ItemClass = UInventoryTestItemInstance::StaticClass();
+		Initializer.ItemData = ItemData;
+
+		const TArray<UItemInstance*> Items = Grid->CreateItemsInInventory({ Initializer });
+		return Items.Num() == 1 ? Items[0] : nullptr;
+	}
+
+	/** Cells that have an item, counted from the cell owners rather than the occupancy masks */
+	int32 CountOccupiedCells(const UGridInventoryComponent* Grid)
+	{
+		int32 NumOccupied = 0;
+		for (int32 Y = 0; Y < Grid->GridHeight; ++Y)
+		{
+			for (int32 X = 0; X < Grid->GridWidth; ++X)
+			{
+				NumOccupied += Grid->GetItemAt(FIntPoint(X, Y)) ? 1 : 0;
+			}
+		}
+		return NumOccupied;
+	}
+
+	/** Cells the items in the grid should cover, if none of them overlap */
+	int32 CountItemCells(const UGridInventoryComponent* Grid)
+	{
+		int32 NumCells = 0;
+		for (const FGridItemPlacement& Placement : Grid->GetPlacements())
+		{
+			NumCells += Placement.Instance->GetData()->GridSize.X * Placement.Instance->GetData()->GridSize.Y;
+		}
+		return NumCells;
+	}
+
+	/** Fills the grid with items cycling through ItemData until not even the smallest one fits */
+	int32 FillToCapacity(UGridInventoryComponent* Grid, TConstArrayView<USwordItemData*> ItemData)
+	{
+		int32 NumPlaced = 0;
+		for (int32 Index = 0; ; ++Index)
+		{
+			UItemData* Data = ItemData[Index % ItemData.Num()];
+			if (CreateItem(Grid, Data))
+			{
+				++NumPlaced;
+			}
+			else if (Data->GridSize == FIntPoint(1, 1))
+			{
+				return NumPlaced;
+			}
+		}
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FGridInventoryPlacementTest, "InvTest.Grid.Placement", INVENTORY_TEST_FLAGS)
+bool FGridInventoryPlacementTest::RunTest(const FString& Parameters)
+{
+	using namespace GridInventoryTests;
+
+	InventoryTest::FTestWorld TestWorld;
+
+	/** 10 x 6 */
+	UGridInventoryComponent* Grid = TestWorld.SpawnInventory<UGridInventoryComponent>();
+	USwordItemData* ItemData = NewItemData(TestWorld, FIntPoint(2, 3));
+
+	UItemInstance* First = CreateItem(Grid, ItemData);
+	UItemInstance* Second = CreateItem(Grid, ItemData);
+	if (!TestNotNull(TEXT("The first item was placed"), First) || !TestNotNull(TEXT("The second item was placed"), Second))
+	{
+		return false;
+	}
+
+	FIntPoint Position;
+	TestTrue(TEXT("The first item is on the grid"), Grid->GetItemPosition(First, Position));
+	TestEqual(TEXT("The first item takes the first free cell"), Position, FIntPoint(0, 0));
+	TestTrue(TEXT("The second item is on the grid"), Grid->GetItemPosition(Second, Position));
+	TestEqual(TEXT("The second item goes right next to it"), Position, FIntPoint(2, 0));
+
+	TestTrue(TEXT("An item covers all of its cells"), Grid->GetItemAt(FIntPoint(1, 2)) == First);
+	TestNull(TEXT("Cells below an item are free"), Grid->GetItemAt(FIntPoint(0, 3)));
+
+	AddExpectedMessage(TEXT("does not fit there"), ELogVerbosity::Warning, EAutomationExpectedMessageFlags::Contains, 2);
+
+	Grid->ServerMoveGridItem(First, FIntPoint(1, 0));
+	Grid->GetItemPosition(First, Position);
+	TestEqual(TEXT("A move onto another item is rejected"), Position, FIntPoint(0, 0));
+
+	Grid->ServerMoveGridItem(First, FIntPoint(9, 0));
+	Grid->GetItemPosition(First, Position);
+	TestEqual(TEXT("A move off the grid is rejected"), Position, FIntPoint(0, 0));
+
+	Grid->ServerMoveGridItem(First, FIntPoint(8, 3));
+	Grid->GetItemPosition(First, Position);
+	TestEqual(TEXT("A move into free cells is applied"), Position, FIntPoint(8, 3));
+	TestNull(TEXT("The old cells are freed"), Grid->GetItemAt(FIntPoint(0, 0)));
+	TestTrue(TEXT("The new cells are taken"), Grid->GetItemAt(FIntPoint(9, 5)) == First);
+
+	/** Placements are part of the snapshot, a loaded grid looks the way it was left */
+	if (UItemDataRegistry* Registry = UItemDataRegistry::Get())
+	{
+		Registry->RegisterItemData(FSoftObjectPath(ItemData));
+	}
+
+	TArray<uint8> Bytes;
+	Grid->SaveInventoryToBytes(Bytes);
+
+	UGridInventoryComponent* Loaded = TestWorld.SpawnInventory<UGridInventoryComponent>();
+	if (TestTrue(TEXT("The grid snapshot loads"), Loaded->LoadInventoryFromBytes(Bytes)) && TestEqual(TEXT("Both items were loaded"), Loaded->GetPlacements().Num(), 2))
+	{
+		TestEqual(TEXT("The first item keeps its position"), Loaded->GetPlacements()[0].Position, FIntPoint(8, 3));
+		TestEqual(TEXT("The second item keeps its position"), Loaded->GetPlacements()[1].Position, FIntPoint(2, 0));
+	}
+
+	TestTrue(TEXT("The item is removed"), Grid->RemoveItemFromInventory(First));
+	TestNull(TEXT("Removing an item frees its cells"), Grid->GetItemAt(FIntPoint(8, 3)));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FGridInventoryCapacityTest, "InvTest.Grid.Capacity", INVENTORY_TEST_FLAGS)
+bool FGridInventoryCapacityTest::RunTest(const FString& Parameters)
+{
+	using namespace GridInventoryTests;
+
+	InventoryTest::FTestWorld TestWorld;
+
+	UGridInventoryComponent* Grid = TestWorld.SpawnInventory<UGridInventoryComponent>();
+	USwordItemData* Small = NewItemData(TestWorld, FIntPoint(1, 1));
+	USwordItemData* Large = NewItemData(TestWorld, FIntPoint(2, 2));
+
+	TArray<FItemInstanceInitializer> Initializers;
+	Initializers.SetNum(Grid->GridWidth * Grid->GridHeight);
+	for (FItemInstanceInitializer& Initializer : Initializers)
+	{
+		Initializer.ItemClass = UInventoryTestItemInstance::StaticClass();
+		Initializer.ItemData = Small;
+	}
+
+	TestEqual(TEXT("One item per cell fits"), Grid->CreateItemsInInventory(Initializers).Num(), Initializers.Num());
+	TestEqual(TEXT("Every cell is taken"), CountOccupiedCells(Grid), Initializers.Num());
+	TestNull(TEXT("A full grid rejects another item"), CreateItem(Grid, Small));
+
+	/** Freeing four scattered cells still leaves no room for a 2 x 2 item, freeing a square does */
+	Grid->RemoveItemsFromInventory({ Grid->GetItemAt(FIntPoint(0, 0)), Grid->GetItemAt(FIntPoint(2, 0)), Grid->GetItemAt(FIntPoint(4, 0)), Grid->GetItemAt(FIntPoint(6, 0)) });
+	TestNull(TEXT("Scattered cells don't fit a larger item"), CreateItem(Grid, Large));
+
+	Grid->RemoveItemsFromInventory({ Grid->GetItemAt(FIntPoint(0, 1)), Grid->GetItemAt(FIntPoint(1, 0)), Grid->GetItemAt(FIntPoint(1, 1)) });
+	TestNotNull(TEXT("A free square fits a larger item"), CreateItem(Grid, Large));
+
+	/** Stacks take no cells, MaxStacks bounds them instead */
+	USwordItemData* Arrows = TestWorld.NewItemData(TEXT("GridArrow"), 10);
+	AddExpectedMessage(TEXT("is at its stack limit"), ELogVerbosity::Warning, EAutomationExpectedMessageFlags::Contains, 1);
+	TestEqual(TEXT("Only MaxStacks full stacks are added"), Grid->AddStackableItem(Arrows, 10 * Grid->MaxStacks + 5), 10 * Grid->MaxStacks);
+	TestEqual(TEXT("The grid has MaxStacks stacks"), Grid->GetItemStacks().Num(), Grid->MaxStacks);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FGridInventoryBenchmark, "InvTest.Benchmark.Grid", INVENTORY_TEST_FLAGS)
+bool FGridInventoryBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace GridInventoryTests;
+
+	InventoryTest::FTestWorld TestWorld;
+	InventoryTest::FBenchmarkResults Results(TEXT("Grid"));
+
+	const TArray<USwordItemData*> ItemData = {
+		NewItemData(TestWorld, FIntPoint(2, 3)),
+		NewItemData(TestWorld, FIntPoint(1, 1)),
+		NewItemData(TestWorld, FIntPoint(2, 2)),
+		NewItemData(TestWorld, FIntPoint(1, 3)),
+		NewItemData(TestWorld, FIntPoint(1, 2)),
+	};
+
+	const int32 GridSizes[] = { 16, 32, 64 };
+	for (const int32 GridSize : GridSizes)
+	{
+		UGridInventoryComponent* Grid = TestWorld.SpawnInventory<UGridInventoryComponent>([GridSize](UGridInventoryComponent& Inventory)
+		{
+			Inventory.GridWidth = GridSize;
+			Inventory.GridHeight = GridSize;
+		});
+
+		const int32 NumCells = GridSize * GridSize;
+
+		int32 NumPlaced = 0;
+		const double FillSeconds = InventoryTest::TimeSeconds([&]()
+		{
+			NumPlaced = FillToCapacity(Grid, ItemData);
+		});
+
+		TestEqual(FString::Printf(TEXT("[%d] the grid is filled to capacity"), GridSize), CountOccupiedCells(Grid), NumCells);
+		TestEqual(FString::Printf(TEXT("[%d] no two items overlap"), GridSize), CountItemCells(Grid), NumCells);
+
+		/** Punch holes all over the grid, then pack what is left */
+		const TArray<UItemInstance*> Items = Grid->GetItemInstances();
+		TArray<UItemInstance*> ToRemove;
+		for (int32 Index = 0; Index < Items.Num(); Index += 2)
+		{
+			ToRemove.Add(Items[Index]);
+		}
+		Grid->RemoveItemsFromInventory(ToRemove);
+
+		bool bSorted = false;
+		const double SortSeconds = InventoryTest::TimeSeconds([&]()
+		{
+			bSorted = Grid->AutoSortGrid();
+		});
+
+		TestTrue(FString::Printf(TEXT("[%d] the remaining items pack"), GridSize), bSorted);
+		TestEqual(FString::Printf(TEXT("[%d] no two items overlap after sorting"), GridSize), CountOccupiedCells(Grid), CountItemCells(Grid));
+
+		Results.Add(TEXT("FillToCapacity"), NumCells, FillSeconds * 1e6 / FMath::Max(NumPlaced, 1), TEXT("us/item"));
+		Results.Add(TEXT("AutoSort"), NumCells, SortSeconds * 1e3, TEXT("ms"));
+		Results.Add(TEXT("AutoSortItems"), NumCells, Grid->GetNumItems(), TEXT("items"));
+	}
+
+	return Results.Save(*this);
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
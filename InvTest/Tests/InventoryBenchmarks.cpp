@@ -0,0 +1,250 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InventoryTestUtils.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "InventoryComponent.h"
+#include "InventoryTestTypes.h"
+#include "ItemActorPool.h"
+#include "ItemInstance.h"
+#include "UObject/UObjectGlobals.h"
+
+/**
+ * Throughput of the hot inventory paths at growing inventory sizes, written to Saved/Automation/InvTest.
+ *
+ * The numbers are for comparing runs on the same machine, the tests only fail if the inventory
+ * ends up in the wrong state.
+ */
+namespace InventoryBenchmarks
+{
+	const int32 InventorySizes[] = { 100, 1000, 10000 };
+
+	/** Items to fill an inventory with, ItemData is kept alive by the test world */
+	TArray<UItemInstance*> FillInventory(UInventoryComponent* Inventory, UItemData* ItemData, int32 NumItems)
+	{
+		TArray<FItemInstanceInitializer> Initializers;
+		Initializers.SetNum(NumItems);
+		for (FItemInstanceInitializer& Initializer : Initializers)
+		{
+			Initializer.ItemClass = UInventoryTestItemInstance::StaticClass();
+			Initializer.ItemData = ItemData;
+		}
+		return Inventory->CreateItemsInInventory(Initializers);
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInventoryBenchmarkCreateItemInstance, "InvTest.Benchmark.CreateItemInstance", INVENTORY_TEST_FLAGS)
+bool FInventoryBenchmarkCreateItemInstance::RunTest(const FString& Parameters)
+{
+	InventoryTest::FTestWorld TestWorld;
+	InventoryTest::FBenchmarkResults Results(TEXT("CreateItemInstance"));
+
+	UInventoryComponent* Inventory = TestWorld.SpawnInventory();
+	UItemData* ItemData = TestWorld.NewItemData(TEXT("BenchmarkSword"));
+
+	FItemInstanceInitializer Initializer;
+	Initializer.Outer = Inventory;
+	Initializer.OwnerActor = Inventory->GetOwner();
+	Initializer.ItemClass = UInventoryTestItemInstance::StaticClass();
+	Initializer.ItemData = ItemData;
+
+	for (const int32 NumItems : InventoryBenchmarks::InventorySizes)
+	{
+		/** Only instances, nothing registers them, so they are gone after the next GC */
+		TArray<UItemInstance*> Created;
+		Created.Reserve(NumItems);
+
+		const double Seconds = InventoryTest::TimeSeconds([&]()
+		{
+			for (int32 Index = 0; Index < NumItems; ++Index)
+			{
+				Created.Add(UItemInstance::CreateItemInstance(Initializer));
+			}
+		});
+
+		TestEqual(TEXT("Every CreateItemInstance call created an instance"), Created.FilterByPredicate([](const UItemInstance* Item) { return Item != nullptr; }).Num(), NumItems);
+
+		Results.Add(TEXT("CreateItemInstance"), NumItems, NumItems / FMath::Max(Seconds, UE_SMALL_NUMBER), TEXT("items/s"));
+		Results.Add(TEXT("CreateItemInstance"), NumItems, Seconds * 1e6 / NumItems, TEXT("us/item"));
+
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	}
+
+	return Results.Save(*this);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInventoryBenchmarkCreateItemInInventory, "InvTest.Benchmark.CreateItemInInventory", INVENTORY_TEST_FLAGS)
+bool FInventoryBenchmarkCreateItemInInventory::RunTest(const FString& Parameters)
+{
+	InventoryTest::FTestWorld TestWorld;
+	InventoryTest::FBenchmarkResults Results(TEXT("CreateItemInInventory"));
+
+	UItemData* ItemData = TestWorld.NewItemData(TEXT("BenchmarkSword"));
+
+	for (const int32 NumItems : InventoryBenchmarks::InventorySizes)
+	{
+		/** One call per item, each one creates the instance, registers the subobject and indexes it */
+		UInventoryComponent* Inventory = TestWorld.SpawnInventory();
+		const double SingleSeconds = InventoryTest::TimeSeconds([&]()
+		{
+			for (int32 Index = 0; Index < NumItems; ++Index)
+			{
+				Inventory->CreateItemInInventory(UInventoryTestItemInstance::StaticClass(), ItemData);
+			}
+		});
+
+		TestEqual(TEXT("Every item is in the inventory"), Inventory->GetNumItems(), NumItems);
+
+		const TArray<UItemInstance*> Items = Inventory->GetItemInstances();
+		const bool bAllRegistered = Items.Num() > 0 && Items.FindByPredicate([Inventory](const UItemInstance* Item) { return !Inventory->IsReplicatedSubObjectRegistered(Item); }) == nullptr;
+		TestTrue(TEXT("Every item is registered as a replicated subobject"), bAllRegistered);
+
+		Results.Add(TEXT("CreateItemInInventory"), NumItems, SingleSeconds * 1e6 / NumItems, TEXT("us/item"));
+
+		/** The same items through the batch API, one dirty mark for all of them */
+		UInventoryComponent* BatchInventory = TestWorld.SpawnInventory();
+		const double BatchSeconds = InventoryTest::TimeSeconds([&]()
+		{
+			InventoryBenchmarks::FillInventory(BatchInventory, ItemData, NumItems);
+		});
+
+		TestEqual(TEXT("Every batched item is in the inventory"), BatchInventory->GetNumItems(), NumItems);
+		Results.Add(TEXT("CreateItemsInInventory"), NumItems, BatchSeconds * 1e6 / NumItems, TEXT("us/item"));
+	}
+
+	return Results.Save(*this);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInventoryBenchmarkIsItemActorSpawned, "InvTest.Benchmark.IsItemActorSpawned", INVENTORY_TEST_FLAGS)
+bool FInventoryBenchmarkIsItemActorSpawned::RunTest(const FString& Parameters)
+{
+	InventoryTest::FTestWorld TestWorld;
+	InventoryTest::FBenchmarkResults Results(TEXT("IsItemActorSpawned"));
+
+	UItemData* ItemData = TestWorld.NewItemData(TEXT("BenchmarkSword"));
+	constexpr int32 NumLookups = 1000000;
+
+	for (const int32 NumItems : InventoryBenchmarks::InventorySizes)
+	{
+		UInventoryComponent* Inventory = TestWorld.SpawnInventory();
+		const TArray<UItemInstance*> Items = InventoryBenchmarks::FillInventory(Inventory, ItemData, NumItems);
+
+		/** Every tenth item has its actor out, like a few equipped items in a big inventory */
+		int32 NumExpected = 0;
+		for (int32 Index = 0; Index < Items.Num(); Index += 10)
+		{
+			Inventory->RequestItemActorSpawned(Items[Index], true);
+			++NumExpected;
+		}
+
+		/** Whole passes over the inventory, so every item is looked up equally often */
+		const int32 NumPasses = FMath::Max(NumLookups / NumItems, 1);
+
+		int32 NumSpawned = 0;
+		const double Seconds = InventoryTest::TimeSeconds([&]()
+		{
+			for (int32 Pass = 0; Pass < NumPasses; ++Pass)
+			{
+				for (UItemInstance* Item : Items)
+				{
+					NumSpawned += Inventory->IsItemActorSpawned(Item) ? 1 : 0;
+				}
+			}
+		});
+
+		TestEqual(TEXT("Lookups found every spawned actor"), NumSpawned, NumExpected * NumPasses);
+
+		Results.Add(TEXT("IsItemActorSpawned"), NumItems, Seconds * 1e9 / (static_cast<double>(NumPasses) * NumItems), TEXT("ns/lookup"));
+	}
+
+	return Results.Save(*this);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInventoryBenchmarkItemActors, "InvTest.Benchmark.ItemActorSpawnDestroy", INVENTORY_TEST_FLAGS)
+bool FInventoryBenchmarkItemActors::RunTest(const FString& Parameters)
+{
+	InventoryTest::FTestWorld TestWorld;
+	InventoryTest::FBenchmarkResults Results(TEXT("ItemActorSpawnDestroy"));
+
+	UItemData* ItemData = TestWorld.NewItemData(TEXT("BenchmarkSword"));
+	constexpr int32 NumItems = 1000;
+
+	UInventoryComponent* Inventory = TestWorld.SpawnInventory();
+	const TArray<UItemInstance*> Items = InventoryBenchmarks::FillInventory(Inventory, ItemData, NumItems);
+
+	/** The first round spawns new actors, the second one reuses the actors the first round released to the pool */
+	UItemActorPool* Pool = TestWorld.GetWorld()->GetSubsystem<UItemActorPool>();
+	if (!TestNotNull(TEXT("The world has an item actor pool"), Pool))
+	{
+		return false;
+	}
+	Pool->SetPoolCapacity(AActor::StaticClass(), NumItems);
+
+	const TCHAR* RoundNames[] = { TEXT("Cold"), TEXT("Pooled") };
+	for (const TCHAR* RoundName : RoundNames)
+	{
+		const double SpawnSeconds = InventoryTest::TimeSeconds([&]()
+		{
+			for (UItemInstance* Item : Items)
+			{
+				Inventory->RequestItemActorSpawned(Item, true);
+			}
+		});
+
+		const int32 NumSpawned = Items.FilterByPredicate([Inventory](UItemInstance* Item) { return Inventory->IsItemActorSpawned(Item); }).Num();
+		TestEqual(FString::Printf(TEXT("%s: every item actor spawned"), RoundName), NumSpawned, NumItems);
+
+		const double DestroySeconds = InventoryTest::TimeSeconds([&]()
+		{
+			for (UItemInstance* Item : Items)
+			{
+				Inventory->RequestItemActorSpawned(Item, false);
+			}
+		});
+
+		const int32 NumLeft = Items.FilterByPredicate([Inventory](UItemInstance* Item) { return Inventory->IsItemActorSpawned(Item); }).Num();
+		TestEqual(FString::Printf(TEXT("%s: every item actor destroyed"), RoundName), NumLeft, 0);
+
+		Results.Add(FString::Printf(TEXT("Spawn%s"), RoundName), NumItems, SpawnSeconds * 1e6 / NumItems, TEXT("us/actor"));
+		Results.Add(FString::Printf(TEXT("Destroy%s"), RoundName), NumItems, DestroySeconds * 1e6 / NumItems, TEXT("us/actor"));
+	}
+
+	TestEqual(TEXT("The second round was served from the pool"), Pool->GetNumHits(), NumItems);
+
+	return Results.Save(*this);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInventoryBenchmarkGarbageCollection, "InvTest.Benchmark.GarbageCollection", INVENTORY_TEST_FLAGS)
+bool FInventoryBenchmarkGarbageCollection::RunTest(const FString& Parameters)
+{
+	InventoryTest::FTestWorld TestWorld;
+	InventoryTest::FBenchmarkResults Results(TEXT("GarbageCollection"));
+
+	UItemData* ItemData = TestWorld.NewItemData(TEXT("BenchmarkSword"));
+
+	/** Baseline first, so the rows show what the items add to a full purge */
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	const double BaselineSeconds = InventoryTest::TimeSeconds([]() { CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS); });
+	Results.Add(TEXT("FullPurge"), 0, BaselineSeconds * 1e3, TEXT("ms"));
+
+	UInventoryComponent* Inventory = TestWorld.SpawnInventory();
+	int32 NumItems = 0;
+	for (const int32 TargetSize : InventoryBenchmarks::InventorySizes)
+	{
+		InventoryBenchmarks::FillInventory(Inventory, ItemData, TargetSize - NumItems);
+		NumItems = TargetSize;
+
+		/** The first purge after filling also frees the garbage the fill left behind, time the steady state */
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+		const double Seconds = InventoryTest::TimeSeconds([]() { CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS); });
+
+		TestEqual(TEXT("Items in the inventory survive garbage collection"), Inventory->GetNumItems(), NumItems);
+		Results.Add(TEXT("FullPurge"), NumItems, Seconds * 1e3, TEXT("ms"));
+	}
+
+	return Results.Save(*this);
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,193 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InventoryTestUtils.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "InventoryComponent.h"
+#include "InventoryGrantSubsystem.h"
+#include "InventoryTestTypes.h"
+#include "ItemInstance.h"
+
+/**
+ * UInventoryGrantSubsystem: grants queued during a frame are created together at its end.
+ *
+ * The test world's item data is already loaded, so the batch's prefetch completes right away and
+ * a single Tick creates everything.
+ */
+namespace InventoryGrantTests
+{
+	TArray<FItemInstanceInitializer> MakeInitializers(const TArray<UItemData*>& ItemData, int32 NumItems, bool bRollAffixes = false)
+	{
+		TArray<FItemInstanceInitializer> Initializers;
+		Initializers.SetNum(NumItems);
+		for (int32 Index = 0; Index < NumItems; ++Index)
+		{
+			Initializers[Index].ItemClass = UInventoryTestItemInstance::StaticClass();
+			Initializers[Index].ItemData = ItemData[Index % ItemData.Num()];
+			Initializers[Index].bRollAffixes = bRollAffixes;
+		}
+		return Initializers;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInventoryGrantTest, "InvTest.Grants.Batch", INVENTORY_TEST_FLAGS)
+bool FInventoryGrantTest::RunTest(const FString& Parameters)
+{
+	using namespace InventoryGrantTests;
+
+	InventoryTest::FTestWorld TestWorld;
+
+	UInventoryGrantSubsystem* Grants = TestWorld.GetWorld()->GetSubsystem<UInventoryGrantSubsystem>();
+	if (!TestNotNull(TEXT("The world has a grant subsystem"), Grants))
+	{
+		return false;
+	}
+
+	USwordItemData* Sword = TestWorld.NewItemData(TEXT("GrantSword"));
+	USwordItemData* Axe = TestWorld.NewItemData(TEXT("GrantAxe"));
+	Axe->InstanceClass = UInventoryTestItemInstance::StaticClass();
+
+	FItemAffixRange& Affix = Sword->PossibleAffixes.AddDefaulted_GetRef();
+	Affix.Stat = EItemStat::Damage;
+	Affix.MinMagnitude = 2.f;
+	Affix.MaxMagnitude = 4.f;
+
+	UInventoryComponent* First = TestWorld.SpawnInventory();
+	UInventoryComponent* Second = TestWorld.SpawnInventory();
+	UInventoryComponent* Destroyed = TestWorld.SpawnInventory();
+
+	Grants->QueueGrant(First, MakeInitializers({ Sword, Axe }, 10, true));
+	Grants->QueueGrant(Second, MakeInitializers({ Axe }, 5));
+	Grants->QueueGrant(Destroyed, MakeInitializers({ Axe }, 5));
+
+	/** Incompatible with the axe's InstanceClass, skipped without failing the rest of the grant */
+	FItemInstanceInitializer Invalid;
+	Invalid.ItemClass = UItemInstance::StaticClass();
+	Invalid.ItemData = Axe;
+	Grants->QueueGrant(Second, { Invalid });
+	Grants->QueueGrant(Second, MakeInitializers({ Sword }, 1));
+
+	TestEqual(TEXT("Nothing is created before the end of the frame"), First->GetNumItems() + Second->GetNumItems(), 0);
+
+	Destroyed->GetOwner()->Destroy();
+
+	AddExpectedMessage(TEXT("UInventoryGrantSubsystem skipped an initializer"), ELogVerbosity::Warning, EAutomationExpectedMessageFlags::Contains, 1);
+	TestWorld.Tick();
+
+	TestEqual(TEXT("Every valid item of the first grant was created"), First->GetNumItems(), 10);
+	TestEqual(TEXT("Grants to the same inventory add up"), Second->GetNumItems(), 6);
+	TestEqual(TEXT("Items keep the data of their initializer"), First->FindItemsByData(Sword).Num(), 5);
+
+	int32 NumWrongAffixes = 0;
+	for (const UItemInstance* Item : First->GetItemInstances())
+	{
+		const int32 ExpectedAffixes = Item->GetData() == Sword ? 1 : 0;
+		NumWrongAffixes += Item->GetModifiers().Num() == ExpectedAffixes ? 0 : 1;
+	}
+	TestEqual(TEXT("Affixes were rolled while preparing, once per item"), NumWrongAffixes, 0);
+
+	const TArray<UItemInstance*> Items = First->GetItemInstances();
+	const bool bAllRegistered = !Items.ContainsByPredicate([First](const UItemInstance* Item) { return !First->IsReplicatedSubObjectRegistered(Item); });
+	TestTrue(TEXT("Granted items are registered as replicated subobjects"), bAllRegistered);
+
+	/** The batch is done, the next frame creates nothing */
+	TestWorld.Tick();
+	TestEqual(TEXT("Grants are only created once"), First->GetNumItems(), 10);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInventoryGrantBenchmark, "InvTest.Benchmark.Grants", INVENTORY_TEST_FLAGS)
+bool FInventoryGrantBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace InventoryGrantTests;
+
+	InventoryTest::FTestWorld TestWorld;
+	InventoryTest::FBenchmarkResults Results(TEXT("Grants"));
+
+	UInventoryGrantSubsystem* Grants = TestWorld.GetWorld()->GetSubsystem<UInventoryGrantSubsystem>();
+	if (!TestNotNull(TEXT("The world has a grant subsystem"), Grants))
+	{
+		return false;
+	}
+
+	/** A match start: 100 characters granting 200 items each, out of a shared set of 20 items */
+	constexpr int32 NumInventories = 100;
+	constexpr int32 NumItemsPerInventory = 200;
+	constexpr int32 NumItems = NumInventories * NumItemsPerInventory;
+
+	TArray<UItemData*> ItemData;
+	for (int32 Index = 0; Index < 20; ++Index)
+	{
+		USwordItemData* Data = TestWorld.NewItemData(FString::Printf(TEXT("GrantBenchmarkItem%d"), Index));
+		FItemAffixRange& Affix = Data->PossibleAffixes.AddDefaulted_GetRef();
+		Affix.Stat = EItemStat::Damage;
+		Affix.MinMagnitude = 1.f;
+		Affix.MaxMagnitude = 5.f;
+		ItemData.Add(Data);
+	}
+
+	const TArray<FItemInstanceInitializer> Initializers = MakeInitializers(ItemData, NumItemsPerInventory, true);
+
+	/** What every character did in BeginPlay before, one CreateItemsInInventory each */
+	TArray<UInventoryComponent*> Inventories;
+	for (int32 Index = 0; Index < NumInventories; ++Index)
+	{
+		Inventories.Add(TestWorld.SpawnInventory());
+	}
+
+	const double DirectSeconds = InventoryTest::TimeSeconds([&]()
+	{
+		for (UInventoryComponent* Inventory : Inventories)
+		{
+			Inventory->CreateItemsInInventory(Initializers);
+		}
+	});
+
+	int32 NumCreated = 0;
+	for (const UInventoryComponent* Inventory : Inventories)
+	{
+		NumCreated += Inventory->GetNumItems();
+	}
+	TestEqual(TEXT("Direct: every item was created"), NumCreated, NumItems);
+
+	/** The same grants queued in one frame, the frame's tick creates the whole batch */
+	Inventories.Reset();
+	for (int32 Index = 0; Index < NumInventories; ++Index)
+	{
+		Inventories.Add(TestWorld.SpawnInventory());
+	}
+
+	const double BatchedSeconds = InventoryTest::TimeSeconds([&]()
+	{
+		for (UInventoryComponent* Inventory : Inventories)
+		{
+			Grants->QueueGrant(Inventory, Initializers);
+		}
+		TestWorld.Tick();
+	});
+
+	NumCreated = 0;
+	int32 NumWrongAffixes = 0;
+	for (const UInventoryComponent* Inventory : Inventories)
+	{
+		NumCreated += Inventory->GetNumItems();
+		for (const UItemInstance* Item : Inventory->GetItemInstances())
+		{
+			NumWrongAffixes += Item->GetModifiers().Num() == 1 ? 0 : 1;
+		}
+	}
+	TestEqual(TEXT("Batched: every item was created"), NumCreated, NumItems);
+	TestEqual(TEXT("Batched: every item rolled its affix"), NumWrongAffixes, 0);
+
+	Results.Add(TEXT("CreateItemsInInventory"), NumItems, DirectSeconds * 1e3, TEXT("ms"));
+	Results.Add(TEXT("CreateItemsInInventory"), NumItems, DirectSeconds * 1e6 / NumItems, TEXT("us/item"));
+	Results.Add(TEXT("GrantBatch"), NumItems, BatchedSeconds * 1e3, TEXT("ms"));
+	Results.Add(TEXT("GrantBatch"), NumItems, BatchedSeconds * 1e6 / NumItems, TEXT("us/item"));
+
+	return Results.Save(*this);
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
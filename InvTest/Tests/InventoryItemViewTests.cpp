@@ -0,0 +1,103 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InventoryTestUtils.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "InventoryComponent.h"
+#include "InventoryTestTypes.h"
+#include "ItemInstance.h"
+
+/**
+ * Flat item views for UI: change notifications and queries.
+ */
+namespace InventoryItemViewTests
+{
+	TArray<UItemInstance*> FillInventory(UInventoryComponent* Inventory, UItemData* ItemData, int32 NumItems)
+	{
+		TArray<FItemInstanceInitializer> Initializers;
+		Initializers.SetNum(NumItems);
+		for (FItemInstanceInitializer& Initializer : Initializers)
+		{
+			Initializer.ItemClass = UInventoryTestItemInstance::StaticClass();
+			Initializer.ItemData = ItemData;
+		}
+		return Inventory->CreateItemsInInventory(Initializers);
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInventoryItemViewsChangedTest, "InvTest.ItemViews.Changed", INVENTORY_TEST_FLAGS)
+bool FInventoryItemViewsChangedTest::RunTest(const FString& Parameters)
+{
+	using namespace InventoryItemViewTests;
+
+	InventoryTest::FTestWorld TestWorld;
+
+	UInventoryComponent* Inventory = TestWorld.SpawnInventory();
+
+	int32 NumBroadcasts = 0;
+	Inventory->OnItemViewsChanged.AddLambda([&NumBroadcasts](UInventoryComponent*)
+	{
+		++NumBroadcasts;
+	});
+
+	/** Many changes in one frame, instances and stacks alike */
+	const TArray<UItemInstance*> Items = FillInventory(Inventory, TestWorld.NewItemData(TEXT("ViewSword")), 50);
+	Inventory->AddStackableItem(TestWorld.NewItemData(TEXT("ViewArrow"), 20), 45);
+	Inventory->RemoveItemFromInventory(Items[10]);
+
+	TestEqual(TEXT("Views are up to date right away"), Inventory->GetItemViews().Num(), 49 + 3);
+	TestEqual(TEXT("Nothing is broadcast before the next tick"), NumBroadcasts, 0);
+
+	TestWorld.Tick();
+	TestEqual(TEXT("All changes of a frame are broadcast once"), NumBroadcasts, 1);
+
+	TestWorld.Tick();
+	TestEqual(TEXT("Frames without changes broadcast nothing"), NumBroadcasts, 1);
+
+	Inventory->RemoveItemFromInventory(Items[0]);
+	TestWorld.Tick();
+	TestEqual(TEXT("The next change is broadcast again"), NumBroadcasts, 2);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInventoryItemViewsQueryTest, "InvTest.ItemViews.Query", INVENTORY_TEST_FLAGS)
+bool FInventoryItemViewsQueryTest::RunTest(const FString& Parameters)
+{
+	using namespace InventoryItemViewTests;
+
+	InventoryTest::FTestWorld TestWorld;
+
+	UInventoryComponent* Inventory = TestWorld.SpawnInventory();
+	UItemData* CheapData = TestWorld.NewItemData(TEXT("CheapDagger"), 1, 5);
+	UItemData* PricyData = TestWorld.NewItemData(TEXT("PricySword"), 1, 50);
+	FillInventory(Inventory, PricyData, 3);
+	FillInventory(Inventory, CheapData, 4);
+
+	FInventoryViewQuery Query;
+	Query.SortBy = EInventoryViewSort::Value;
+	Query.bDescending = true;
+
+	int32 NumResults = 0;
+	const TConstArrayView<int32> FirstPage = Inventory->QueryItemViewIndices(Query, 0, 5, NumResults);
+	TestEqual(TEXT("Every view passes an empty filter"), NumResults, 7);
+	TestEqual(TEXT("The first page is full"), FirstPage.Num(), 5);
+
+	/** Display strings are read from the data the view points at */
+	const TArray<FInventoryItemView>& Views = Inventory->GetItemViews();
+	TestTrue(TEXT("The most valuable item comes first"), Views[FirstPage[0]].ItemData == PricyData);
+	TestTrue(TEXT("Cheap items come after the valuable ones"), Views[FirstPage[3]].ItemData == CheapData);
+
+	const TArray<FInventoryItemView> SecondPage = Inventory->QueryItemViews(Query, 1, 5, NumResults);
+	TestEqual(TEXT("The last page holds the rest"), SecondPage.Num(), 2);
+
+	Query.NameFilter = TEXT("dagger");
+	Inventory->QueryItemViewIndices(Query, 0, 0, NumResults);
+	TestEqual(TEXT("The name filter ignores case"), NumResults, 4);
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,310 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InventoryTestUtils.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "InventoryComponent.h"
+#include "InventoryJournal.h"
+#include "InventoryTestTypes.h"
+#include "ItemDataRegistry.h"
+#include "ItemInstance.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+/**
+ * UInventoryJournal recording and recovery.
+ *
+ * Every phase (recording, recovering, restarting) runs in its own test world. Destroying a world
+ * shuts its journal writer down, which writes everything queued and closes the files, like a server
+ * that stops. Item data lives in an outer world so it survives all of them.
+ */
+namespace InventoryJournalTests
+{
+	/** A key no earlier run has files for */
+	FString NewJournalKey(const TCHAR* Name)
+	{
+		return FString::Printf(TEXT("InvTest_%s_%s"), Name, *FGuid::NewGuid().ToString());
+	}
+
+	/** Mirrors FInventoryJournalWriter::GetJournalPath for the writer of every world */
+	FString GetJournalPath(const FString& Key)
+	{
+		return FPaths::ProjectSavedDir() / TEXT("InventoryJournal") / FPaths::MakeValidFileName(Key) + TEXT(".journal");
+	}
+
+	FString GetSnapshotPath(const FString& Key)
+	{
+		return FPaths::ProjectSavedDir() / TEXT("InventoryJournal") / FPaths::MakeValidFileName(Key) + TEXT(".snapshot");
+	}
+
+	void DeleteJournalFiles(const FString& Key)
+	{
+		IFileManager::Get().Delete(*GetJournalPath(Key), false, false, true);
+		IFileManager::Get().Delete(*GetSnapshotPath(Key), false, false, true);
+	}
+
+	/** Journals can only refer to item data that is registered */
+	void RegisterItemData(UItemData* ItemData)
+	{
+		if (UItemDataRegistry* Registry = UItemDataRegistry::Get())
+		{
+			Registry->RegisterItemData(FSoftObjectPath(ItemData));
+		}
+	}
+
+	/**
+	 * @brief An inventory that journals under Key, with its initial (empty) snapshot already written.
+	 *
+	 * Snapshots are otherwise only taken on request, so everything recorded afterwards stays in the journal.
+	 */
+	UInventoryComponent* SpawnJournaledInventory(InventoryTest::FTestWorld& TestWorld, const FString& Key)
+	{
+		UInventoryJournal* Journal = TestWorld.GetWorld()->GetSubsystem<UInventoryJournal>();
+		check(Journal);
+		Journal->SnapshotInterval = MAX_int32;
+
+		UInventoryComponent* Inventory = TestWorld.SpawnInventory();
+		Inventory->SetJournalKey(Key);
+		TestWorld.Tick();
+		return Inventory;
+	}
+
+	/** An inventory that recovers from Key, false if the recovery failed */
+	UInventoryComponent* RecoverInventory(InventoryTest::FTestWorld& TestWorld, const FString& Key)
+	{
+		UInventoryComponent* Inventory = TestWorld.SpawnInventory();
+		Inventory->SetJournalKey(Key);
+		return TestWorld.GetWorld()->GetSubsystem<UInventoryJournal>()->RecoverInventory(Inventory) ? Inventory : nullptr;
+	}
+
+	TArray<UItemInstance*> FillInventory(UInventoryComponent* Inventory, UItemData* ItemData, int32 NumItems)
+	{
+		TArray<FItemInstanceInitializer> Initializers;
+		Initializers.SetNum(NumItems);
+		for (FItemInstanceInitializer& Initializer : Initializers)
+		{
+			Initializer.ItemClass = UInventoryTestItemInstance::StaticClass();
+			Initializer.ItemData = ItemData;
+		}
+		return Inventory->CreateItemsInInventory(Initializers);
+	}
+
+	/** Guids of the items in Inventory, sorted so inventories can be compared regardless of item order */
+	TArray<FGuid> GetItemGuids(const UInventoryComponent* Inventory)
+	{
+		TArray<FGuid> Guids;
+		for (const UItemInstance* Item : Inventory->GetItemInstances())
+		{
+			Guids.Add(Item->GetItemGuid());
+		}
+		Guids.Sort();
+		return Guids;
+	}
+
+	TArray<FGuid> GetSpawnedItemGuids(const UInventoryComponent* Inventory)
+	{
+		TArray<FGuid> Guids;
+		for (UItemInstance* Item : Inventory->GetItemInstances())
+		{
+			if (Inventory->IsItemActorSpawned(Item))
+			{
+				Guids.Add(Item->GetItemGuid());
+			}
+		}
+		Guids.Sort();
+		return Guids;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInventoryJournalRoundTripTest, "InvTest.Journal.RoundTrip", INVENTORY_TEST_FLAGS)
+bool FInventoryJournalRoundTripTest::RunTest(const FString& Parameters)
+{
+	using namespace InventoryJournalTests;
+
+	InventoryTest::FTestWorld DataWorld;
+	UItemData* Sword = DataWorld.NewItemData(TEXT("JournalSword"));
+	UItemData* Ore = DataWorld.NewItemData(TEXT("JournalOre"), 100);
+	RegisterItemData(Sword);
+	RegisterItemData(Ore);
+
+	const FString Key = NewJournalKey(TEXT("RoundTrip"));
+	ON_SCOPE_EXIT
+	{
+		DeleteJournalFiles(Key);
+	};
+
+	/** Every kind of operation, the last record is torn by the "crash" below */
+	TArray<FGuid> ExpectedGuids;
+	TArray<FGuid> ExpectedSpawned;
+	{
+		InventoryTest::FTestWorld ServerWorld;
+		UInventoryComponent* Inventory = SpawnJournaledInventory(ServerWorld, Key);
+		UInventoryComponent* Chest = ServerWorld.SpawnInventory();
+
+		TArray<UItemInstance*> Items = FillInventory(Inventory, Sword, 10);
+		Inventory->AddStackableItem(Ore, 50);
+		Inventory->RemoveStackableItem(Ore, 20);
+		Inventory->RemoveItemsFromInventory({ Items[0], Items[1] });
+		Inventory->TransferItemsTo(Chest, { Items[2], Items[3] });
+
+		UItemInstance* Looted = FillInventory(Chest, Sword, 1)[0];
+		Chest->TransferItemTo(Inventory, Looted);
+
+		Inventory->RequestItemActorSpawned(Items[4], true);
+		Inventory->RequestItemActorSpawned(Items[5], true);
+		Inventory->RequestItemActorSpawned(Items[5], false);
+
+		ExpectedGuids = GetItemGuids(Inventory);
+		ExpectedSpawned = GetSpawnedItemGuids(Inventory);
+		TestEqual(TEXT("Server: items after the operations"), ExpectedGuids.Num(), 7);
+		TestEqual(TEXT("Server: ore after the operations"), Inventory->GetItemCountByData(Ore), 30);
+		TestEqual(TEXT("Server: one item actor is spawned"), ExpectedSpawned.Num(), 1);
+
+		FillInventory(Inventory, Sword, 1);
+	}
+
+	TArray<uint8> Bytes;
+	if (!TestTrue(TEXT("The journal was written"), FFileHelper::LoadFileToArray(Bytes, *GetJournalPath(Key))))
+	{
+		return false;
+	}
+	Bytes.SetNum(Bytes.Num() - 3);
+	FFileHelper::SaveArrayToFile(Bytes, *GetJournalPath(Key));
+
+	/** Recovery stops at the torn record, everything before it is restored */
+	TArray<FGuid> RecoveredGuids;
+	{
+		InventoryTest::FTestWorld RecoveryWorld;
+
+		AddExpectedMessage(TEXT("was torn"), ELogVerbosity::Warning, EAutomationExpectedMessageFlags::Contains, 1);
+		UInventoryComponent* Inventory = RecoverInventory(RecoveryWorld, Key);
+		if (!TestNotNull(TEXT("Recovery: the inventory was recovered"), Inventory))
+		{
+			return false;
+		}
+
+		TestTrue(TEXT("Recovery: every item before the torn record is back"), GetItemGuids(Inventory) == ExpectedGuids);
+		TestEqual(TEXT("Recovery: stack changes were replayed"), Inventory->GetItemCountByData(Ore), 30);
+		TestTrue(TEXT("Recovery: item actors are in their last recorded state"), GetSpawnedItemGuids(Inventory) == ExpectedSpawned);
+
+		/** Recorded after the recovery compacted everything into a snapshot, so they go to a new journal */
+		FillInventory(Inventory, Sword, 2);
+		Inventory->AddStackableItem(Ore, 5);
+
+		RecoveredGuids = GetItemGuids(Inventory);
+	}
+
+	/** The snapshot and the journal started over after the torn one restore the recovered inventory */
+	{
+		InventoryTest::FTestWorld RestartWorld;
+
+		UInventoryComponent* Inventory = RecoverInventory(RestartWorld, Key);
+		if (!TestNotNull(TEXT("Restart: the inventory was recovered"), Inventory))
+		{
+			return false;
+		}
+
+		TestTrue(TEXT("Restart: items match the recovered inventory"), GetItemGuids(Inventory) == RecoveredGuids);
+		TestEqual(TEXT("Restart: ore matches the recovered inventory"), Inventory->GetItemCountByData(Ore), 35);
+		TestTrue(TEXT("Restart: item actors match the recovered inventory"), GetSpawnedItemGuids(Inventory) == ExpectedSpawned);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInventoryJournalBenchmark, "InvTest.Benchmark.JournalReplay", INVENTORY_TEST_FLAGS)
+bool FInventoryJournalBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace InventoryJournalTests;
+
+	InventoryTest::FBenchmarkResults Results(TEXT("JournalReplay"));
+
+	InventoryTest::FTestWorld DataWorld;
+	UItemData* Sword = DataWorld.NewItemData(TEXT("JournalBenchmarkSword"));
+	UItemData* Ore = DataWorld.NewItemData(TEXT("JournalBenchmarkOre"), 1000);
+	RegisterItemData(Sword);
+	RegisterItemData(Ore);
+
+	const int32 NumRecordsList[] = { 1000, 10000, 100000 };
+	for (const int32 NumRecords : NumRecordsList)
+	{
+		const FString Key = NewJournalKey(TEXT("Benchmark"));
+		ON_SCOPE_EXIT
+		{
+			DeleteJournalFiles(Key);
+		};
+
+		/** Half creates, a quarter removes and a quarter stack changes */
+		const int32 NumCreates = NumRecords / 2;
+		const int32 NumRemoves = NumRecords / 4;
+		const int32 NumStackDeltas = NumRecords - NumCreates - NumRemoves;
+
+		TArray<FGuid> ExpectedGuids;
+		{
+			InventoryTest::FTestWorld ServerWorld;
+			UInventoryComponent* Inventory = SpawnJournaledInventory(ServerWorld, Key);
+
+			/** Game thread cost of recording, the writes happen on the writer thread */
+			const double RecordSeconds = InventoryTest::TimeSeconds([&]()
+			{
+				TArray<UItemInstance*> Items = FillInventory(Inventory, Sword, NumCreates);
+				Items.SetNum(NumRemoves);
+				Inventory->RemoveItemsFromInventory(Items);
+
+				for (int32 Index = 0; Index < NumStackDeltas; ++Index)
+				{
+					Inventory->AddStackableItem(Ore, 1);
+				}
+			});
+
+			ExpectedGuids = GetItemGuids(Inventory);
+			Results.Add(TEXT("Record"), NumRecords, RecordSeconds * 1e6 / NumRecords, TEXT("us/record"));
+		}
+
+		{
+			InventoryTest::FTestWorld RecoveryWorld;
+
+			UInventoryComponent* Inventory = nullptr;
+			const double ReplaySeconds = InventoryTest::TimeSeconds([&]()
+			{
+				Inventory = RecoverInventory(RecoveryWorld, Key);
+			});
+
+			if (!TestNotNull(FString::Printf(TEXT("[%d] The journal was replayed"), NumRecords), Inventory))
+			{
+				return false;
+			}
+			TestTrue(FString::Printf(TEXT("[%d] Replayed items"), NumRecords), GetItemGuids(Inventory) == ExpectedGuids);
+			TestEqual(FString::Printf(TEXT("[%d] Replayed stack changes"), NumRecords), Inventory->GetItemCountByData(Ore), NumStackDeltas);
+
+			Results.Add(TEXT("Replay"), NumRecords, ReplaySeconds * 1e3, TEXT("ms"));
+			Results.Add(TEXT("Replay"), NumRecords, NumRecords / FMath::Max(ReplaySeconds, UE_SMALL_NUMBER), TEXT("records/s"));
+		}
+
+		/** The recovery compacted the journal, the next one only loads the snapshot */
+		{
+			InventoryTest::FTestWorld RestartWorld;
+
+			UInventoryComponent* Inventory = nullptr;
+			const double SnapshotSeconds = InventoryTest::TimeSeconds([&]()
+			{
+				Inventory = RecoverInventory(RestartWorld, Key);
+			});
+
+			if (!TestNotNull(FString::Printf(TEXT("[%d] The snapshot was loaded"), NumRecords), Inventory))
+			{
+				return false;
+			}
+			TestTrue(FString::Printf(TEXT("[%d] Items from the snapshot"), NumRecords), GetItemGuids(Inventory) == ExpectedGuids);
+
+			Results.Add(TEXT("LoadSnapshot"), NumRecords, SnapshotSeconds * 1e3, TEXT("ms"));
+		}
+	}
+
+	return Results.Save(*this);
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,358 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InventoryTestUtils.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "InventoryComponent.h"
+#include "InventoryTestTypes.h"
+#include "ItemInstance.h"
+#include "UObject/CoreNet.h"
+
+/**
+ * What inventories give the net driver to send, per update and per idle frame, and to whom.
+ *
+ * There is no net driver in a test world, so these count rather than measure. The fast array delta
+ * is worked out from the lists' replication ids and keys, the same way FFastArraySerializer decides
+ * what to send: every entry whose key changed since the last ack is sent, every id that is gone is
+ * sent as a delete. Its size in bytes is not measured. Idle cost is the number of properties
+ * compared, derived from the classes' lifetime properties.
+ */
+namespace InventoryReplicationTests
+{
+	const int32 InventorySizes[] = { 100, 1000, 10000 };
+
+	/** ReplicationKey of every entry by ReplicationID, i.e., what a connection has acked */
+	TMap<int32, int32> GetAckedKeys(const FInventoryItemList& List)
+	{
+		TMap<int32, int32> Keys;
+		Keys.Reserve(List.Entries.Num());
+		for (const FInventoryItemEntry& Entry : List.Entries)
+		{
+			Keys.Add(Entry.ReplicationID, Entry.ReplicationKey);
+		}
+		return Keys;
+	}
+
+	struct FDelta
+	{
+		int32 NumChanged = 0;
+		int32 NumDeleted = 0;
+	};
+
+	/** Delta the list would send to a connection that acked AckedKeys */
+	FDelta GetDelta(const FInventoryItemList& List, const TMap<int32, int32>& AckedKeys)
+	{
+		FDelta Delta;
+
+		TSet<int32> Remaining;
+		Remaining.Reserve(AckedKeys.Num());
+		for (const TPair<int32, int32>& Pair : AckedKeys)
+		{
+			Remaining.Add(Pair.Key);
+		}
+
+		for (const FInventoryItemEntry& Entry : List.Entries)
+		{
+			const int32* AckedKey = AckedKeys.Find(Entry.ReplicationID);
+			if (!AckedKey || *AckedKey != Entry.ReplicationKey)
+			{
+				++Delta.NumChanged;
+			}
+			Remaining.Remove(Entry.ReplicationID);
+		}
+
+		Delta.NumDeleted = Remaining.Num();
+		return Delta;
+	}
+
+	/** Every replication key of a list, if any of them moves the net driver has something to send */
+	template<typename ListType>
+	TArray<int32> GetReplicationKeys(const ListType& List)
+	{
+		TArray<int32> Keys;
+		Keys.Reserve(List.Entries.Num() + 1);
+		Keys.Add(List.ArrayReplicationKey);
+		for (const auto& Entry : List.Entries)
+		{
+			Keys.Add(Entry.ReplicationKey);
+		}
+		return Keys;
+	}
+
+	TArray<int32> GetReplicationKeys(UInventoryComponent* Inventory)
+	{
+		TArray<int32> Keys;
+		Keys.Append(GetReplicationKeys(*InventoryTest::GetPropertyValue<FInventoryItemList>(Inventory, TEXT("Items"))));
+		Keys.Append(GetReplicationKeys(*InventoryTest::GetPropertyValue<FInventoryItemList>(Inventory, TEXT("VisibleItems"))));
+		Keys.Append(GetReplicationKeys(*InventoryTest::GetPropertyValue<FInventoryStackList>(Inventory, TEXT("Stacks"))));
+		return Keys;
+	}
+
+	/** What the net driver looks at for one object of a class */
+	struct FReplicatedProperties
+	{
+		int32 Num = 0;
+		/** Compared every update even when push model is on */
+		int32 NumPolled = 0;
+		/** Polled properties declared by the class under test, rather than by an engine super class */
+		TArray<FString> OwnPolled;
+	};
+
+	FReplicatedProperties GetReplicatedProperties(UClass* Class, UClass* OwnerClass)
+	{
+		Class->SetUpRuntimeReplicationData();
+
+		TArray<FLifetimeProperty> LifetimeProps;
+		Class->GetDefaultObject()->GetLifetimeReplicatedProps(LifetimeProps);
+
+		FReplicatedProperties Properties;
+		Properties.Num = LifetimeProps.Num();
+		for (const FLifetimeProperty& LifetimeProp : LifetimeProps)
+		{
+			if (LifetimeProp.bIsPushBased)
+			{
+				continue;
+			}
+
+			++Properties.NumPolled;
+
+			const FProperty* Property = Class->ClassReps[LifetimeProp.RepIndex].Property;
+			if (Property->GetOwnerClass()->IsChildOf(OwnerClass))
+			{
+				Properties.OwnPolled.Add(Property->GetName());
+			}
+		}
+		return Properties;
+	}
+
+	/** Condition of every replicated property the class declares, by property name */
+	TMap<FString, ELifetimeCondition> GetReplicationConditions(UClass* Class)
+	{
+		Class->SetUpRuntimeReplicationData();
+
+		TArray<FLifetimeProperty> LifetimeProps;
+		Class->GetDefaultObject()->GetLifetimeReplicatedProps(LifetimeProps);
+
+		TMap<FString, ELifetimeCondition> Conditions;
+		for (const FLifetimeProperty& LifetimeProp : LifetimeProps)
+		{
+			Conditions.Add(Class->ClassReps[LifetimeProp.RepIndex].Property->GetName(), LifetimeProp.Condition);
+		}
+		return Conditions;
+	}
+
+	/** Instances in the list other players receive, in no particular order */
+	TSet<UItemInstance*> GetVisibleItems(UInventoryComponent* Inventory)
+	{
+		TSet<UItemInstance*> Visible;
+		for (const FInventoryItemEntry& Entry : InventoryTest::GetPropertyValue<FInventoryItemList>(Inventory, TEXT("VisibleItems"))->Entries)
+		{
+			Visible.Add(Entry.Instance);
+		}
+		return Visible;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInventoryReplicationVisibilityTest, "InvTest.Replication.Visibility", INVENTORY_TEST_FLAGS)
+bool FInventoryReplicationVisibilityTest::RunTest(const FString& Parameters)
+{
+	using namespace InventoryReplicationTests;
+
+	InventoryTest::FTestWorld TestWorld;
+
+	/** The full lists only go to the owner, everyone else gets the visible subset */
+	const TMap<FString, ELifetimeCondition> Conditions = GetReplicationConditions(UInventoryComponent::StaticClass());
+	TestTrue(TEXT("Items only replicates to the owner"), Conditions.FindRef(TEXT("Items")) == COND_OwnerOnly);
+	TestTrue(TEXT("Stacks only replicate to the owner"), Conditions.FindRef(TEXT("Stacks")) == COND_OwnerOnly);
+	TestTrue(TEXT("VisibleItems replicates to everyone but the owner"), Conditions.FindRef(TEXT("VisibleItems")) == COND_SkipOwner);
+
+	UInventoryComponent* Inventory = TestWorld.SpawnInventory();
+
+	UItemData* ItemData = TestWorld.NewItemData(TEXT("VisibleSword"));
+
+	TArray<FItemInstanceInitializer> Initializers;
+	Initializers.SetNum(4);
+	for (FItemInstanceInitializer& Initializer : Initializers)
+	{
+		Initializer.ItemClass = UInventoryTestItemInstance::StaticClass();
+		Initializer.ItemData = ItemData;
+	}
+	const TArray<UItemInstance*> Items = Inventory->CreateItemsInInventory(Initializers);
+	if (!TestEqual(TEXT("Every item was created"), Items.Num(), 4))
+	{
+		return false;
+	}
+
+	auto AllRegistered = [Inventory, &Items]()
+	{
+		return !Items.ContainsByPredicate([Inventory](const UItemInstance* Item) { return !Inventory->IsReplicatedSubObjectRegistered(Item); });
+	};
+
+	TestTrue(TEXT("Every item is registered for the owner"), AllRegistered());
+	TestEqual(TEXT("New items are not visible to others"), GetVisibleItems(Inventory).Num(), 0);
+
+	/** Made visible explicitly, by spawning its actor, and by locking it */
+	Inventory->SetItemVisibleToOthers(Items[0], true);
+	Inventory->RequestItemActorSpawned(Items[1], true);
+	Inventory->SetItemActorLocked(Items[2], true);
+
+	const TSet<UItemInstance*> Visible = GetVisibleItems(Inventory);
+	TestTrue(TEXT("Visible items are in the visible subset"), Visible.Num() == 3 && Visible.Contains(Items[0]) && Visible.Contains(Items[1]) && Visible.Contains(Items[2]));
+	TestTrue(TEXT("Items with a spawned actor are visible to others"), Inventory->IsItemVisibleToOthers(Items[1]));
+	TestTrue(TEXT("Locked items are visible to others"), Inventory->IsItemVisibleToOthers(Items[2]));
+	TestFalse(TEXT("Other items stay owner only"), Inventory->IsItemVisibleToOthers(Items[3]));
+	TestTrue(TEXT("Changing the visibility keeps the items registered"), AllRegistered());
+	TestEqual(TEXT("The owner's list still holds every item"), Inventory->GetItemInstances().Num(), 4);
+
+	/** Hiding the first entry swaps the last one into its place, hiding that one must find it there */
+	Inventory->SetItemVisibleToOthers(Items[0], false);
+	Inventory->SetItemVisibleToOthers(Items[2], false);
+	TestTrue(TEXT("Hiding items removes exactly their entries"), GetVisibleItems(Inventory).Array() == TArray<UItemInstance*>({ Items[1] }));
+
+	Inventory->RequestItemActorSpawned(Items[1], false);
+	TestFalse(TEXT("Destroying the actor hides the item again"), Inventory->IsItemVisibleToOthers(Items[1]));
+
+	/** Removed items leave both lists and are no longer replicated at all */
+	Inventory->SetItemVisibleToOthers(Items[3], true);
+	Inventory->RemoveItemFromInventory(Items[3]);
+	TestEqual(TEXT("Removed items leave the visible subset"), GetVisibleItems(Inventory).Num(), 0);
+	TestFalse(TEXT("Removed items are unregistered"), Inventory->IsReplicatedSubObjectRegistered(Items[3]));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInventoryReplicationDeltaEntriesTest, "InvTest.Replication.DeltaEntries", INVENTORY_TEST_FLAGS)
+bool FInventoryReplicationDeltaEntriesTest::RunTest(const FString& Parameters)
+{
+	using namespace InventoryReplicationTests;
+
+	InventoryTest::FTestWorld TestWorld;
+	InventoryTest::FBenchmarkResults Results(TEXT("ReplicationDeltaEntries"));
+
+	UItemData* ItemData = TestWorld.NewItemData(TEXT("ReplicatedSword"));
+
+	for (const int32 NumItems : InventorySizes)
+	{
+		UInventoryComponent* Inventory = TestWorld.SpawnInventory();
+
+		TArray<FItemInstanceInitializer> Initializers;
+		Initializers.SetNum(NumItems);
+		for (FItemInstanceInitializer& Initializer : Initializers)
+		{
+			Initializer.ItemClass = UInventoryTestItemInstance::StaticClass();
+			Initializer.ItemData = ItemData;
+		}
+		const TArray<UItemInstance*> Items = Inventory->CreateItemsInInventory(Initializers);
+
+		const FInventoryItemList* List = InventoryTest::GetPropertyValue<FInventoryItemList>(Inventory, TEXT("Items"));
+		if (!TestNotNull(TEXT("The inventory has an Items list"), List))
+		{
+			return false;
+		}
+
+		/** One pickup */
+		TMap<int32, int32> AckedKeys = GetAckedKeys(*List);
+		Inventory->CreateItemInInventory(UInventoryTestItemInstance::StaticClass(), ItemData);
+
+		const FDelta AddDelta = GetDelta(*List, AckedKeys);
+		TestEqual(FString::Printf(TEXT("[%d] adding an item sends one entry"), NumItems), AddDelta.NumChanged, 1);
+		TestEqual(FString::Printf(TEXT("[%d] adding an item deletes nothing"), NumItems), AddDelta.NumDeleted, 0);
+
+		/** One item from the middle, the swap-remove moves the last entry but must not resend it */
+		AckedKeys = GetAckedKeys(*List);
+		Inventory->RemoveItemFromInventory(Items[NumItems / 2]);
+
+		const FDelta RemoveDelta = GetDelta(*List, AckedKeys);
+		TestEqual(FString::Printf(TEXT("[%d] removing an item sends no entries"), NumItems), RemoveDelta.NumChanged, 0);
+		TestEqual(FString::Printf(TEXT("[%d] removing an item sends one delete"), NumItems), RemoveDelta.NumDeleted, 1);
+
+		Results.Add(TEXT("AddItemEntries"), NumItems, AddDelta.NumChanged + AddDelta.NumDeleted, TEXT("entries"));
+		Results.Add(TEXT("RemoveItemEntries"), NumItems, RemoveDelta.NumChanged + RemoveDelta.NumDeleted, TEXT("entries"));
+	}
+
+	return Results.Save(*this);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInventoryReplicationIdleTest, "InvTest.Replication.IdleInventories", INVENTORY_TEST_FLAGS)
+bool FInventoryReplicationIdleTest::RunTest(const FString& Parameters)
+{
+	using namespace InventoryReplicationTests;
+
+	InventoryTest::FTestWorld TestWorld;
+	InventoryTest::FBenchmarkResults Results(TEXT("ReplicationIdleInventories"));
+
+	constexpr int32 NumInventories = 1000;
+	constexpr int32 NumItemsPerInventory = 20;
+	constexpr int32 NumFrames = 60;
+
+	/** With push model on, the net driver only compares properties that are not push based, or were marked dirty */
+	const FReplicatedProperties InventoryProperties = GetReplicatedProperties(UInventoryComponent::StaticClass(), UInventoryComponent::StaticClass());
+	const FReplicatedProperties ItemProperties = GetReplicatedProperties(UInventoryTestItemInstance::StaticClass(), UItemInstance::StaticClass());
+
+	TestTrue(FString::Printf(TEXT("Every inventory property is push based (not: %s)"), *FString::Join(InventoryProperties.OwnPolled, TEXT(", "))), InventoryProperties.OwnPolled.IsEmpty());
+	TestTrue(FString::Printf(TEXT("Every item property is push based (not: %s)"), *FString::Join(ItemProperties.OwnPolled, TEXT(", "))), ItemProperties.OwnPolled.IsEmpty());
+
+	UItemData* ItemData = TestWorld.NewItemData(TEXT("IdleSword"));
+
+	TArray<UInventoryComponent*> Inventories;
+	Inventories.Reserve(NumInventories);
+	for (int32 Index = 0; Index < NumInventories; ++Index)
+	{
+		UInventoryComponent* Inventory = TestWorld.SpawnInventory();
+
+		TArray<FItemInstanceInitializer> Initializers;
+		Initializers.SetNum(NumItemsPerInventory);
+		for (FItemInstanceInitializer& Initializer : Initializers)
+		{
+			Initializer.ItemClass = UInventoryTestItemInstance::StaticClass();
+			Initializer.ItemData = ItemData;
+		}
+		Inventory->CreateItemsInInventory(Initializers);
+
+		Inventories.Add(Inventory);
+	}
+
+	/** Settle whatever the fill queued up, from here on nothing touches the inventories */
+	TestWorld.Tick();
+
+	TArray<TArray<int32>> KeysBefore;
+	KeysBefore.Reserve(NumInventories);
+	for (UInventoryComponent* Inventory : Inventories)
+	{
+		KeysBefore.Add(GetReplicationKeys(Inventory));
+	}
+
+	const double Seconds = InventoryTest::TimeSeconds([&]()
+	{
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			TestWorld.Tick();
+		}
+	});
+
+	int32 NumChanged = 0;
+	for (int32 Index = 0; Index < NumInventories; ++Index)
+	{
+		NumChanged += GetReplicationKeys(Inventories[Index]) != KeysBefore[Index] ? 1 : 0;
+	}
+	TestEqual(TEXT("Idle inventories have nothing to replicate"), NumChanged, 0);
+
+	/**
+	 * Properties a net driver would compare per frame, nothing was marked dirty so push based ones are skipped.
+	 * Derived from the lifetime properties above, not measured.
+	 */
+	const double NumPolling = static_cast<double>(NumInventories) * (InventoryProperties.Num + NumItemsPerInventory * ItemProperties.Num);
+	const double NumPushModel = static_cast<double>(NumInventories) * (InventoryProperties.NumPolled + NumItemsPerInventory * ItemProperties.NumPolled);
+
+	Results.Add(TEXT("DerivedComparedPropertiesPolling"), NumInventories, NumPolling, TEXT("properties/frame"));
+	Results.Add(TEXT("DerivedComparedPropertiesPushModel"), NumInventories, NumPushModel, TEXT("properties/frame"));
+
+	/** Only the game side of a frame, there is no net driver to replicate the inventories */
+	Results.Add(TEXT("IdleFrameWithoutNetDriver"), NumInventories, Seconds * 1e3 / NumFrames, TEXT("ms/frame"));
+
+	return Results.Save(*this);
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
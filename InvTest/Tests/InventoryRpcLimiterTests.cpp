@@ -0,0 +1,200 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InventoryTestUtils.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Engine/DemoNetConnection.h"
+#include "InventoryComponent.h"
+#include "InventoryRpcLimiter.h"
+#include "InventoryTestTypes.h"
+#include "ItemDataRegistry.h"
+#include "ItemInstance.h"
+#include "UObject/StrongObjectPtr.h"
+
+/**
+ * Server rpc validation and the per-connection token buckets of UInventoryRpcLimiter.
+ *
+ * Test worlds are standalone, so the rpcs run their _Implementation right away, without a
+ * connection and so without being rate limited. The limiter is tested on its own, with
+ * connection objects that only serve as bucket keys.
+ */
+namespace InventoryRpcLimiterTests
+{
+	TStrongObjectPtr<UNetConnection> NewConnection()
+	{
+		return TStrongObjectPtr<UNetConnection>(NewObject<UDemoNetConnection>(GetTransientPackage()));
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInventoryRpcLimiterTest, "InvTest.Rpc.RateLimit", INVENTORY_TEST_FLAGS)
+bool FInventoryRpcLimiterTest::RunTest(const FString& Parameters)
+{
+	using namespace InventoryRpcLimiterTests;
+
+	InventoryTest::FTestWorld TestWorld;
+	InventoryTest::FBenchmarkResults Results(TEXT("RpcRateLimit"));
+
+	UInventoryRpcLimiter* Limiter = TestWorld.GetWorld()->GetSubsystem<UInventoryRpcLimiter>();
+	if (!TestNotNull(TEXT("Game worlds have an rpc limiter"), Limiter))
+	{
+		return false;
+	}
+
+	/** No refill, so the bucket only holds what it started with */
+	Limiter->TokensPerSecond = 0.f;
+	Limiter->BurstSize = 5.f;
+
+	const TStrongObjectPtr<UNetConnection> Spammer = NewConnection();
+	const TStrongObjectPtr<UNetConnection> Bystander = NewConnection();
+
+	int32 NumAccepted = 0;
+	for (int32 Index = 0; Index < 10; ++Index)
+	{
+		NumAccepted += Limiter->ConsumeTokens(Spammer.Get()) ? 1 : 0;
+	}
+	TestEqual(TEXT("A burst is accepted up to BurstSize"), NumAccepted, 5);
+	TestEqual(TEXT("Everything past the burst is rejected"), Limiter->GetNumRejected(), 5);
+
+	TestTrue(TEXT("Other connections have their own bucket"), Limiter->ConsumeTokens(Bystander.Get(), 4.f));
+	TestFalse(TEXT("Expensive rpcs cost more tokens"), Limiter->ConsumeTokens(Bystander.Get(), 2.f));
+	TestTrue(TEXT("Local calls are never limited"), Limiter->ConsumeTokens(nullptr, 100.f));
+
+	/** Rejecting has to stay cheaper than the rpcs it protects against */
+	constexpr int32 NumRejections = 1000000;
+	int32 NumUnexpectedlyAccepted = 0;
+	const double RejectSeconds = InventoryTest::TimeSeconds([&]()
+	{
+		for (int32 Index = 0; Index < NumRejections; ++Index)
+		{
+			NumUnexpectedlyAccepted += Limiter->ConsumeTokens(Spammer.Get()) ? 1 : 0;
+		}
+	});
+	TestEqual(TEXT("An empty bucket without refill rejects everything"), NumUnexpectedlyAccepted, 0);
+	Results.Add(TEXT("Reject"), NumRejections, RejectSeconds * 1e9 / NumRejections, TEXT("ns/rpc"));
+
+	/** With a refill rate, an empty bucket takes rpcs again after waiting */
+	Limiter->TokensPerSecond = 1000.f;
+	FPlatformProcess::Sleep(0.05f);
+	TestTrue(TEXT("The bucket refills over time"), Limiter->ConsumeTokens(Spammer.Get()));
+
+	return Results.Save(*this);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInventoryRpcLargeBatchTest, "InvTest.Rpc.LargeBatch", INVENTORY_TEST_FLAGS)
+bool FInventoryRpcLargeBatchTest::RunTest(const FString& Parameters)
+{
+	using namespace InventoryRpcLimiterTests;
+
+	InventoryTest::FTestWorld TestWorld;
+
+	UInventoryRpcLimiter* Limiter = TestWorld.GetWorld()->GetSubsystem<UInventoryRpcLimiter>();
+	if (!TestNotNull(TEXT("Game worlds have an rpc limiter"), Limiter))
+	{
+		return false;
+	}
+
+	Limiter->TokensPerSecond = 0.f;
+	Limiter->BurstSize = 40.f;
+
+	/** A batch costing more than BurstSize could never be paid for if it was charged in full */
+	const TStrongObjectPtr<UNetConnection> Connection = NewConnection();
+	TestTrue(TEXT("A batch over BurstSize is accepted with a full bucket"), Limiter->ConsumeTokens(Connection.Get(), 100.f));
+	TestFalse(TEXT("It empties the bucket"), Limiter->ConsumeTokens(Connection.Get()));
+
+	Limiter->TokensPerSecond = 1000.f;
+	FPlatformProcess::Sleep(0.05f);
+	TestTrue(TEXT("Once refilled, the next batch over BurstSize is accepted again"), Limiter->ConsumeTokens(Connection.Get(), 100.f));
+
+	/** The server drops oversized batches outright, clients split them */
+	UInventoryComponent* Inventory = TestWorld.SpawnInventory();
+	Inventory->bAllowClientItemCreation = true;
+
+	USwordItemData* ItemData = TestWorld.NewItemData(TEXT("BatchSword"));
+	ItemData->InstanceClass = UInventoryTestItemInstance::StaticClass();
+
+	UItemDataRegistry* Registry = UItemDataRegistry::Get();
+	if (!TestNotNull(TEXT("The engine has an item data registry"), Registry))
+	{
+		return false;
+	}
+
+	TArray<FItemCreateRequest> Requests;
+	Requests.SetNum(UInventoryComponent::MaxRequestsPerRpc + 1);
+	for (FItemCreateRequest& Request : Requests)
+	{
+		Request.ItemClass = UInventoryTestItemInstance::StaticClass();
+		Request.ItemDataId = Registry->RegisterItemData(FSoftObjectPath(ItemData));
+	}
+
+	AddExpectedMessage(TEXT("dropped a batch of"), ELogVerbosity::Warning, EAutomationExpectedMessageFlags::Contains, 1);
+	Inventory->ServerCreateItemsInInventory(Requests);
+	TestEqual(TEXT("A batch over MaxRequestsPerRpc is dropped"), Inventory->GetNumItems(), 0);
+
+	Requests.SetNum(UInventoryComponent::MaxRequestsPerRpc);
+	Inventory->ServerCreateItemsInInventory(Requests);
+	TestEqual(TEXT("A batch of MaxRequestsPerRpc is created"), Inventory->GetNumItems(), UInventoryComponent::MaxRequestsPerRpc);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInventoryRpcValidationTest, "InvTest.Rpc.Validation", INVENTORY_TEST_FLAGS)
+bool FInventoryRpcValidationTest::RunTest(const FString& Parameters)
+{
+	InventoryTest::FTestWorld TestWorld;
+
+	UInventoryComponent* Inventory = TestWorld.SpawnInventory();
+	UInventoryComponent* OtherInventory = TestWorld.SpawnInventory();
+
+	USwordItemData* ItemData = TestWorld.NewItemData(TEXT("RpcSword"));
+	ItemData->InstanceClass = UInventoryTestItemInstance::StaticClass();
+
+	UItemDataRegistry* Registry = UItemDataRegistry::Get();
+	if (!TestNotNull(TEXT("The engine has an item data registry"), Registry))
+	{
+		return false;
+	}
+	const FItemDataId ItemDataId = Registry->RegisterItemData(FSoftObjectPath(ItemData));
+
+	/** Clients may not create items unless the inventory allows it */
+	Inventory->ServerCreateItemInInventory(UInventoryTestItemInstance::StaticClass(), ItemDataId);
+	TestEqual(TEXT("Client item creation is off by default"), Inventory->GetNumItems(), 0);
+
+	Inventory->bAllowClientItemCreation = true;
+
+	AddExpectedMessage(TEXT("unknown item data id"), ELogVerbosity::Warning, EAutomationExpectedMessageFlags::Contains, 1);
+	Inventory->ServerCreateItemInInventory(UInventoryTestItemInstance::StaticClass(), FItemDataId::FromPath(FSoftObjectPath(TEXT("/Game/Items/DoesNotExist.DoesNotExist"))));
+	TestEqual(TEXT("Unknown item data is rejected"), Inventory->GetNumItems(), 0);
+
+	AddExpectedMessage(TEXT("can't be created as"), ELogVerbosity::Warning, EAutomationExpectedMessageFlags::Contains, 1);
+	Inventory->ServerCreateItemInInventory(UItemInstance::StaticClass(), ItemDataId);
+	TestEqual(TEXT("An instance class the data does not allow is rejected"), Inventory->GetNumItems(), 0);
+
+	Inventory->ServerCreateItemInInventory(UInventoryTestItemInstance::StaticClass(), ItemDataId);
+	TestEqual(TEXT("A valid request creates the item"), Inventory->GetNumItems(), 1);
+
+	/** Actor requests only work on this inventory's own items */
+	UItemInstance* Item = Inventory->GetItemInstances()[0];
+
+	FItemInstanceInitializer Initializer;
+	Initializer.ItemClass = UInventoryTestItemInstance::StaticClass();
+	Initializer.ItemData = ItemData;
+	const TArray<UItemInstance*> OtherItems = OtherInventory->CreateItemsInInventory({ Initializer });
+
+	AddExpectedMessage(TEXT("that is not in this inventory"), ELogVerbosity::Warning, EAutomationExpectedMessageFlags::Contains, 2);
+	Inventory->ServerSpawnItemActor(OtherItems[0]);
+	Inventory->ServerDestroyItemActor(OtherItems[0]);
+	TestFalse(TEXT("Another inventory's item is not spawned"), OtherInventory->IsItemActorSpawned(OtherItems[0]));
+
+	AddExpectedMessage(TEXT("had no ItemActor spawned"), ELogVerbosity::Warning, EAutomationExpectedMessageFlags::Contains, 1);
+	Inventory->ServerDestroyItemActor(Item);
+
+	Inventory->ServerSpawnItemActor(Item);
+	TestWorld.Tick();
+	TestTrue(TEXT("A valid spawn request spawns the actor"), Inventory->IsItemActorSpawned(Item));
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
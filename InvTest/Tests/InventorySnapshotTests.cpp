@@ -0,0 +1,145 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InventoryTestUtils.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "InventoryComponent.h"
+#include "InventoryTestTypes.h"
+#include "ItemDataRegistry.h"
+#include "ItemInstance.h"
+
+/** SaveInventoryToBytes / LoadInventoryFromBytes */
+namespace InventorySnapshotTests
+{
+	TArray<FGuid> GetItemGuids(const UInventoryComponent* Inventory)
+	{
+		TArray<FGuid> Guids;
+		for (const UItemInstance* Item : Inventory->GetItemInstances())
+		{
+			Guids.Add(Item->GetItemGuid());
+		}
+		return Guids;
+	}
+
+	/** Item data created by the test world is transient, snapshots can only refer to it once it is registered */
+	void RegisterItemData(UItemData* ItemData)
+	{
+		if (UItemDataRegistry* Registry = UItemDataRegistry::Get())
+		{
+			Registry->RegisterItemData(FSoftObjectPath(ItemData));
+		}
+	}
+
+	TArray<UItemInstance*> FillInventory(UInventoryComponent* Inventory, UItemData* ItemData, int32 NumItems)
+	{
+		TArray<FItemInstanceInitializer> Initializers;
+		Initializers.SetNum(NumItems);
+		for (FItemInstanceInitializer& Initializer : Initializers)
+		{
+			Initializer.ItemClass = UInventoryTestItemInstance::StaticClass();
+			Initializer.ItemData = ItemData;
+		}
+		return Inventory->CreateItemsInInventory(Initializers);
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInventorySnapshotRoundTripTest, "InvTest.Snapshot.RoundTrip", INVENTORY_TEST_FLAGS)
+bool FInventorySnapshotRoundTripTest::RunTest(const FString& Parameters)
+{
+	using namespace InventorySnapshotTests;
+
+	InventoryTest::FTestWorld TestWorld;
+
+	UItemData* SwordData = TestWorld.NewItemData(TEXT("SnapshotSword"));
+	UItemData* ShieldData = TestWorld.NewItemData(TEXT("SnapshotShield"));
+	UItemData* ArrowData = TestWorld.NewItemData(TEXT("SnapshotArrow"), 20);
+	for (UItemData* ItemData : { SwordData, ShieldData, ArrowData })
+	{
+		RegisterItemData(ItemData);
+	}
+
+	UInventoryComponent* Source = TestWorld.SpawnInventory();
+	FillInventory(Source, SwordData, 3);
+	FillInventory(Source, ShieldData, 2);
+	TestEqual(TEXT("All arrows were added"), Source->AddStackableItem(ArrowData, 45), 45);
+
+	TArray<uint8> Bytes;
+	Source->SaveInventoryToBytes(Bytes);
+
+	UInventoryComponent* Target = TestWorld.SpawnInventory();
+	if (!TestTrue(TEXT("The snapshot loads"), Target->LoadInventoryFromBytes(Bytes)))
+	{
+		return false;
+	}
+
+	TestEqual(TEXT("Same number of items"), Target->GetNumItems(), Source->GetNumItems());
+	TestEqual(TEXT("Same swords"), Target->GetItemCountByData(SwordData), 3);
+	TestEqual(TEXT("Same shields"), Target->GetItemCountByData(ShieldData), 2);
+	TestEqual(TEXT("Same arrows"), Target->GetItemCountByData(ArrowData), 45);
+	TestEqual(TEXT("Same stacks"), Target->GetItemStacks().Num(), Source->GetItemStacks().Num());
+	TestTrue(TEXT("Items keep their guids, in order"), GetItemGuids(Target) == GetItemGuids(Source));
+
+	/** Nothing is lost or made up, so saving the loaded inventory writes the same snapshot */
+	TArray<uint8> ResavedBytes;
+	Target->SaveInventoryToBytes(ResavedBytes);
+	TestTrue(TEXT("Saving the loaded inventory writes the same bytes"), ResavedBytes == Bytes);
+
+	/** Loading replaces, rather than appends to, what the inventory held */
+	TestTrue(TEXT("The snapshot loads again"), Target->LoadInventoryFromBytes(Bytes));
+	TestEqual(TEXT("Loading twice does not duplicate items"), Target->GetNumItems(), Source->GetNumItems());
+
+	/** A truncated snapshot fails and leaves the inventory as it was */
+	TArray<uint8> Truncated(Bytes.GetData(), Bytes.Num() / 2);
+	AddExpectedError(TEXT("malformed"), EAutomationExpectedErrorFlags::Contains, 0);
+	TestFalse(TEXT("A truncated snapshot does not load"), Target->LoadInventoryFromBytes(Truncated));
+	TestEqual(TEXT("A failed load keeps the items"), Target->GetNumItems(), Source->GetNumItems());
+	TestEqual(TEXT("A failed load keeps the arrows"), Target->GetItemCountByData(ArrowData), 45);
+	TestTrue(TEXT("A failed load keeps the guids"), GetItemGuids(Target) == GetItemGuids(Source));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInventoryBenchmarkSnapshot, "InvTest.Benchmark.Snapshot", INVENTORY_TEST_FLAGS)
+bool FInventoryBenchmarkSnapshot::RunTest(const FString& Parameters)
+{
+	using namespace InventorySnapshotTests;
+
+	InventoryTest::FTestWorld TestWorld;
+	InventoryTest::FBenchmarkResults Results(TEXT("Snapshot"));
+
+	UItemData* ItemData = TestWorld.NewItemData(TEXT("BenchmarkSword"));
+	RegisterItemData(ItemData);
+
+	const int32 InventorySizes[] = { 100, 1000, 10000 };
+	for (const int32 NumItems : InventorySizes)
+	{
+		UInventoryComponent* Source = TestWorld.SpawnInventory();
+		FillInventory(Source, ItemData, NumItems);
+
+		TArray<uint8> Bytes;
+		const double SaveSeconds = InventoryTest::TimeSeconds([&]()
+		{
+			Source->SaveInventoryToBytes(Bytes);
+		});
+
+		UInventoryComponent* Target = TestWorld.SpawnInventory();
+		bool bLoaded = false;
+		const double LoadSeconds = InventoryTest::TimeSeconds([&]()
+		{
+			bLoaded = Target->LoadInventoryFromBytes(Bytes);
+		});
+
+		TestTrue(FString::Printf(TEXT("[%d] the snapshot loads"), NumItems), bLoaded);
+		TestEqual(FString::Printf(TEXT("[%d] every item was loaded"), NumItems), Target->GetNumItems(), NumItems);
+
+		Results.Add(TEXT("Save"), NumItems, NumItems / FMath::Max(SaveSeconds, UE_SMALL_NUMBER), TEXT("items/s"));
+		Results.Add(TEXT("Load"), NumItems, NumItems / FMath::Max(LoadSeconds, UE_SMALL_NUMBER), TEXT("items/s"));
+		Results.Add(TEXT("Size"), NumItems, static_cast<double>(Bytes.Num()) / NumItems, TEXT("bytes/item"));
+	}
+
+	return Results.Save(*this);
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
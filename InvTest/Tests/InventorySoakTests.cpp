@@ -0,0 +1,206 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InventoryTestUtils.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "EngineUtils.h"
+#include "InventoryComponent.h"
+#include "InventoryTestTypes.h"
+#include "ItemInstance.h"
+#include "UObject/UObjectGlobals.h"
+#include "UObject/UObjectIterator.h"
+
+/**
+ * Long running create/remove cycles, the kind a server goes through over a long match.
+ *
+ * Memory is compared against a baseline taken after a warm up batch, so allocator bins and the
+ * item actor pool are already filled and only what removal fails to release shows up.
+ */
+namespace InventorySoakTests
+{
+	/** Growth that is still allocator noise, a leak of every item would be several times this */
+	constexpr uint64 MemoryToleranceBytes = 64ull * 1024 * 1024;
+
+	int32 CountItemInstances()
+	{
+		int32 NumInstances = 0;
+		for (TObjectIterator<UInventoryTestItemInstance> It; It; ++It)
+		{
+			++NumInstances;
+		}
+		return NumInstances;
+	}
+
+	int32 CountActors(UWorld* World)
+	{
+		int32 NumActors = 0;
+		for (TActorIterator<AActor> It(World); It; ++It)
+		{
+			++NumActors;
+		}
+		return NumActors;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInventorySoakCreateRemoveTest, "InvTest.Soak.CreateRemoveItems", INVENTORY_TEST_FLAGS)
+bool FInventorySoakCreateRemoveTest::RunTest(const FString& Parameters)
+{
+	using namespace InventorySoakTests;
+
+	InventoryTest::FTestWorld TestWorld;
+	InventoryTest::FBenchmarkResults Results(TEXT("SoakCreateRemoveItems"));
+
+	constexpr int32 NumItems = 1000000;
+	constexpr int32 BatchSize = 10000;
+	constexpr int32 BatchesPerCollect = 10;
+	/** Every this many items gets its actor spawned, so removal has actors to destroy as well */
+	constexpr int32 ActorInterval = 100;
+
+	UInventoryComponent* Inventory = TestWorld.SpawnInventory();
+	UItemData* ItemData = TestWorld.NewItemData(TEXT("SoakSword"));
+
+	TArray<FItemInstanceInitializer> Initializers;
+	Initializers.SetNum(BatchSize);
+	for (FItemInstanceInitializer& Initializer : Initializers)
+	{
+		Initializer.ItemClass = UInventoryTestItemInstance::StaticClass();
+		Initializer.ItemData = ItemData;
+	}
+
+	int32 NumNotRemoved = 0;
+	int32 NumStillRegistered = 0;
+	auto RunBatch = [&]()
+	{
+		const TArray<UItemInstance*> Items = Inventory->CreateItemsInInventory(Initializers);
+		for (int32 Index = 0; Index < Items.Num(); Index += ActorInterval)
+		{
+			Inventory->RequestItemActorSpawned(Items[Index], true);
+		}
+
+		NumNotRemoved += Items.Num() - Inventory->RemoveItemsFromInventory(Items);
+		for (UItemInstance* Item : Items)
+		{
+			NumStillRegistered += Inventory->IsReplicatedSubObjectRegistered(Item) ? 1 : 0;
+		}
+	};
+
+	/** Warm up, then take the baseline */
+	RunBatch();
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+
+	const uint64 BaselineMemory = InventoryTest::GetUsedPhysicalMemory();
+	const int32 BaselineActors = CountActors(TestWorld.GetWorld());
+
+	uint64 PeakMemory = BaselineMemory;
+	const double Seconds = InventoryTest::TimeSeconds([&]()
+	{
+		for (int32 Batch = 0; Batch < NumItems / BatchSize; ++Batch)
+		{
+			RunBatch();
+
+			if ((Batch + 1) % BatchesPerCollect == 0)
+			{
+				CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+				PeakMemory = FMath::Max(PeakMemory, InventoryTest::GetUsedPhysicalMemory());
+			}
+		}
+	});
+
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	const uint64 EndMemory = InventoryTest::GetUsedPhysicalMemory();
+
+	TestEqual(TEXT("Every item was removed"), NumNotRemoved, 0);
+	TestEqual(TEXT("No removed item is still a replicated subobject"), NumStillRegistered, 0);
+	TestEqual(TEXT("The inventory is empty"), Inventory->GetNumItems(), 0);
+	TestEqual(TEXT("Every removed instance was garbage collected"), CountItemInstances(), 0);
+	TestEqual(TEXT("Every item actor was destroyed or pooled"), CountActors(TestWorld.GetWorld()), BaselineActors);
+
+	if (BaselineMemory > 0)
+	{
+		const int64 Growth = static_cast<int64>(EndMemory) - static_cast<int64>(BaselineMemory);
+		TestTrue(FString::Printf(TEXT("Memory returned to baseline (grew by %lld bytes)"), Growth), Growth <= static_cast<int64>(MemoryToleranceBytes));
+
+		Results.Add(TEXT("MemoryGrowth"), NumItems, Growth / (1024.0 * 1024.0), TEXT("MiB"));
+		Results.Add(TEXT("PeakMemoryGrowth"), NumItems, (PeakMemory - BaselineMemory) / (1024.0 * 1024.0), TEXT("MiB"));
+	}
+	else
+	{
+		AddInfo(TEXT("The platform does not report used physical memory, only checked object and actor counts"));
+	}
+
+	Results.Add(TEXT("CreateRemove"), NumItems, Seconds * 1e6 / NumItems, TEXT("us/item"));
+
+	return Results.Save(*this);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInventorySoakLargeRemoveTest, "InvTest.Soak.RemoveFromLargeInventory", INVENTORY_TEST_FLAGS)
+bool FInventorySoakLargeRemoveTest::RunTest(const FString& Parameters)
+{
+	InventoryTest::FTestWorld TestWorld;
+	InventoryTest::FBenchmarkResults Results(TEXT("SoakRemoveFromLargeInventory"));
+
+	const int32 InventorySizes[] = { 1000, 10000, 100000, 200000 };
+	constexpr int32 NumRemovals = 1000;
+	/** Timer and cache noise between sizes, a search of the lookup buckets grows with the inventory instead */
+	constexpr double MaxGrowth = 5.0;
+
+	UItemData* ItemData = TestWorld.NewItemData(TEXT("SoakLargeSword"));
+
+	double SmallestSeconds = 0.0;
+	for (const int32 NumItems : InventorySizes)
+	{
+		UInventoryComponent* Inventory = TestWorld.SpawnInventory();
+
+		TArray<FItemInstanceInitializer> Initializers;
+		Initializers.SetNum(NumItems);
+		for (FItemInstanceInitializer& Initializer : Initializers)
+		{
+			Initializer.ItemClass = UInventoryTestItemInstance::StaticClass();
+			Initializer.ItemData = ItemData;
+		}
+		TArray<UItemInstance*> Items = Inventory->CreateItemsInInventory(Initializers);
+
+		/** Items from all over the inventory, every one of them is in the same data and class buckets */
+		const FRandomStream Stream(NumItems);
+		TArray<UItemInstance*> ToRemove;
+		for (int32 Removal = 0; Removal < NumRemovals; ++Removal)
+		{
+			const int32 Index = Stream.RandHelper(Items.Num());
+			ToRemove.Add(Items[Index]);
+			Items.RemoveAtSwap(Index);
+		}
+
+		int32 NumRemoved = 0;
+		const double Seconds = InventoryTest::TimeSeconds([&]()
+		{
+			for (UItemInstance* Item : ToRemove)
+			{
+				NumRemoved += Inventory->RemoveItemFromInventory(Item) ? 1 : 0;
+			}
+		});
+
+		TestEqual(FString::Printf(TEXT("[%d] Every item was removed"), NumItems), NumRemoved, NumRemovals);
+		TestEqual(FString::Printf(TEXT("[%d] The data index lost exactly the removed items"), NumItems), Inventory->FindItemsByData(ItemData).Num(), NumItems - NumRemovals);
+		TestEqual(FString::Printf(TEXT("[%d] The class index lost exactly the removed items"), NumItems), Inventory->GetItemCountByClass(UInventoryTestItemInstance::StaticClass()), NumItems - NumRemovals);
+
+		if (SmallestSeconds == 0.0)
+		{
+			SmallestSeconds = FMath::Max(Seconds, UE_SMALL_NUMBER);
+		}
+		else
+		{
+			TestTrue(FString::Printf(TEXT("[%d] Time per removal stays flat (%.2fx the smallest inventory)"), NumItems, Seconds / SmallestSeconds), Seconds <= SmallestSeconds * MaxGrowth);
+		}
+
+		Results.Add(TEXT("RemoveItemFromInventory"), NumItems, Seconds * 1e6 / NumRemovals, TEXT("us/item"));
+
+		Inventory->RemoveItemsFromInventory(Items);
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	}
+
+	return Results.Save(*this);
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
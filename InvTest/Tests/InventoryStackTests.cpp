@@ -0,0 +1,54 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InventoryTestUtils.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "InventoryComponent.h"
+#include "InventoryTestTypes.h"
+#include "ItemInstance.h"
+
+/**
+ * Stacks of fungible items, and promoting their units to instances.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInventoryStackPromoteTest, "InvTest.Stacks.Promote", INVENTORY_TEST_FLAGS)
+bool FInventoryStackPromoteTest::RunTest(const FString& Parameters)
+{
+	InventoryTest::FTestWorld TestWorld;
+
+	USwordItemData* ArrowData = TestWorld.NewItemData(TEXT("PromotedArrow"), 20);
+	ArrowData->InstanceClass = UInventoryTestItemInstance::StaticClass();
+
+	UInventoryComponent* Inventory = TestWorld.SpawnInventory();
+	TestEqual(TEXT("All arrows were added"), Inventory->AddStackableItem(ArrowData, 2), 2);
+	if (!TestEqual(TEXT("The arrows are in one stack"), Inventory->GetItemStacks().Num(), 1))
+	{
+		return false;
+	}
+	const int32 StackId = Inventory->GetItemStacks()[0].StackId;
+
+	/** A class the data does not allow is rejected before the stack is touched */
+	AddExpectedMessage(TEXT("can't be created as"), ELogVerbosity::Warning, EAutomationExpectedMessageFlags::Contains, 2);
+	TestNull(TEXT("An abstract class is rejected"), Inventory->PromoteStackToInstance(StackId, UItemInstance::StaticClass()));
+	TestNull(TEXT("A missing class is rejected"), Inventory->PromoteStackToInstance(StackId, nullptr));
+	TestEqual(TEXT("A rejected promotion keeps the unit in the stack"), Inventory->GetItemStacks()[0].Count, 2);
+	TestEqual(TEXT("A rejected promotion creates no item"), Inventory->GetNumItems(), 0);
+
+	UItemInstance* Item = Inventory->PromoteStackToInstance(StackId, UInventoryTestItemInstance::StaticClass());
+	if (!TestNotNull(TEXT("A compatible class is promoted"), Item))
+	{
+		return false;
+	}
+	TestTrue(TEXT("The instance is in the inventory"), Inventory->ContainsItem(Item));
+	TestEqual(TEXT("The unit left the stack"), Inventory->GetItemStacks()[0].Count, 1);
+	TestEqual(TEXT("No unit is lost or made up"), Inventory->GetItemCountByData(ArrowData), 2);
+
+	TestNotNull(TEXT("The last unit is promoted as well"), Inventory->PromoteStackToInstance(StackId, UInventoryTestItemInstance::StaticClass()));
+	TestEqual(TEXT("Promoting the last unit removes the stack"), Inventory->GetItemStacks().Num(), 0);
+	TestNull(TEXT("A removed stack can't be promoted"), Inventory->PromoteStackToInstance(StackId, UInventoryTestItemInstance::StaticClass()));
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,18 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ItemInstance.h"
+#include "InventoryTestTypes.generated.h"
+
+/**
+ * Concrete item instance used by the inventory automation tests, UItemInstance itself is abstract.
+ *
+ * Always compiled since UHT can't see preprocessor guards, but hidden from class pickers.
+ */
+UCLASS(Transient, HideDropdown, NotBlueprintable)
+class UInventoryTestItemInstance : public UItemInstance
+{
+	GENERATED_BODY()
+};
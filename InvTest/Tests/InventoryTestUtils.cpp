@@ -0,0 +1,138 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InventoryTestUtils.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "InventoryComponent.h"
+#include "ItemInstance.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Tickable.h"
+
+namespace InventoryTest
+{
+	FTestWorld::FTestWorld()
+	{
+		World = UWorld::CreateWorld(EWorldType::Game, false, MakeUniqueObjectName(GetTransientPackage(), UWorld::StaticClass(), TEXT("InventoryTestWorld")));
+
+		FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+		WorldContext.SetCurrentWorld(World);
+
+		World->InitializeActorsForPlay(FURL());
+		World->BeginPlay();
+	}
+
+	FTestWorld::~FTestWorld()
+	{
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+
+		ItemData.Reset();
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	}
+
+	AActor* FTestWorld::SpawnActor()
+	{
+		return World->SpawnActor<AActor>();
+	}
+
+	UActorComponent* FTestWorld::AddComponent(AActor* Owner, TSubclassOf<UActorComponent> ComponentClass)
+	{
+		return AddComponent(Owner, ComponentClass, [](UActorComponent&) {});
+	}
+
+	UActorComponent* FTestWorld::AddComponent(AActor* Owner, TSubclassOf<UActorComponent> ComponentClass, TFunctionRef<void(UActorComponent&)> Configure)
+	{
+		check(Owner && ComponentClass);
+
+		UActorComponent* Component = NewObject<UActorComponent>(Owner, ComponentClass);
+		Configure(*Component);
+		Owner->AddInstanceComponent(Component);
+		Component->RegisterComponent();
+		return Component;
+	}
+
+	UInventoryComponent* FTestWorld::SpawnInventory(TSubclassOf<UInventoryComponent> InventoryClass)
+	{
+		return SpawnInventory(InventoryClass, [](UInventoryComponent&) {});
+	}
+
+	UInventoryComponent* FTestWorld::SpawnInventory(TSubclassOf<UInventoryComponent> InventoryClass, TFunctionRef<void(UInventoryComponent&)> Configure)
+	{
+		UInventoryComponent* Inventory = CastChecked<UInventoryComponent>(AddComponent(SpawnActor(), InventoryClass, [&Configure](UActorComponent& Component)
+		{
+			Configure(*CastChecked<UInventoryComponent>(&Component));
+		}));
+		Inventory->bDeferItemActorRequests = false;
+		return Inventory;
+	}
+
+	USwordItemData* FTestWorld::NewItemData(const FString& Name, int32 MaxStackSize, uint32 Value)
+	{
+		USwordItemData* Data = NewObject<USwordItemData>(GetTransientPackage(), MakeUniqueObjectName(GetTransientPackage(), USwordItemData::StaticClass(), *Name));
+		Data->Name = FText::FromString(Name);
+		Data->Value = Value;
+		Data->MaxStackSize = MaxStackSize;
+		Data->ItemActor = TSoftClassPtr<AActor>(AActor::StaticClass());
+		Data->BaseDamage = 10;
+		Data->BaseCriticalStrikeChance = 0.f;
+		Data->BaseCriticalStrikeMultiplier = 1.f;
+		Data->BaseAttackSpeed = 1.f;
+
+		ItemData.Emplace(Data);
+		return Data;
+	}
+
+	void FTestWorld::Tick(float DeltaSeconds)
+	{
+		World->Tick(LEVELTICK_All, DeltaSeconds);
+		FTickableGameObject::TickObjects(World, LEVELTICK_All, false, DeltaSeconds);
+	}
+
+	void FBenchmarkResults::Add(const FString& Metric, int64 Size, double Value, const FString& Unit)
+	{
+		FRow& Row = Rows.AddDefaulted_GetRef();
+		Row.Metric = Metric;
+		Row.Size = Size;
+		Row.Value = Value;
+		Row.Unit = Unit;
+	}
+
+	bool FBenchmarkResults::Save(FAutomationTestBase& Test) const
+	{
+		FString Csv = TEXT("Benchmark,Metric,Size,Value,Unit\n");
+		for (const FRow& Row : Rows)
+		{
+			Csv += FString::Printf(TEXT("%s,%s,%lld,%.6f,%s\n"), *Name, *Row.Metric, Row.Size, Row.Value, *Row.Unit);
+			Test.AddInfo(FString::Printf(TEXT("%s [%lld]: %.4f %s"), *Row.Metric, Row.Size, Row.Value, *Row.Unit));
+		}
+
+		const FString FileName = GetResultsDir() / (Name + TEXT(".csv"));
+		if (!FFileHelper::SaveStringToFile(Csv, *FileName))
+		{
+			Test.AddWarning(FString::Printf(TEXT("Could not write benchmark results to %s"), *FileName));
+			return false;
+		}
+
+		Test.AddInfo(FString::Printf(TEXT("Wrote %d results to %s"), Rows.Num(), *FileName));
+		return true;
+	}
+
+	FString FBenchmarkResults::GetResultsDir()
+	{
+		return FPaths::ProjectSavedDir() / TEXT("Automation") / TEXT("InvTest");
+	}
+
+	uint64 GetUsedPhysicalMemory()
+	{
+		return FPlatformMemory::GetStats().UsedPhysical;
+	}
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
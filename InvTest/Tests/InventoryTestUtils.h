@@ -0,0 +1,150 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Misc/AutomationTest.h"
+#include "UObject/StrongObjectPtr.h"
+#include "UObject/UnrealType.h"
+
+class UInventoryComponent;
+class UItemData;
+class USwordItemData;
+
+/**
+ * Flags of every inventory test. They only need a game world, so they run headless, e.g.:
+ * UnrealEditor-Cmd InvTest.uproject -nullrhi -unattended -ExecCmds="Automation RunTests InvTest; Quit"
+ */
+#define INVENTORY_TEST_FLAGS (EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::ProductFilter)
+
+namespace InventoryTest
+{
+	/**
+	 * A standalone game world for the duration of a test, destroyed with this object.
+	 *
+	 * Standalone, so every actor in it has authority and the server side paths run.
+	 * World subsystems are created as in a real game world, tickable ones only tick through Tick.
+	 */
+	class FTestWorld
+	{
+	public:
+		FTestWorld();
+		~FTestWorld();
+
+		UWorld* GetWorld() const { return World; }
+
+		/** Spawns an empty actor that has begun play */
+		AActor* SpawnActor();
+
+		/** Adds and registers a component of ComponentClass, it begins play right away */
+		UActorComponent* AddComponent(AActor* Owner, TSubclassOf<UActorComponent> ComponentClass);
+
+		/** AddComponent, Configure runs before the component is registered and initialized */
+		UActorComponent* AddComponent(AActor* Owner, TSubclassOf<UActorComponent> ComponentClass, TFunctionRef<void(UActorComponent&)> Configure);
+
+		template<typename T>
+		T* AddComponent(AActor* Owner)
+		{
+			return CastChecked<T>(AddComponent(Owner, T::StaticClass()));
+		}
+
+		/** Spawns an actor with an inventory of InventoryClass, item actor requests are applied right away */
+		template<typename T = UInventoryComponent>
+		T* SpawnInventory()
+		{
+			return CastChecked<T>(SpawnInventory(T::StaticClass()));
+		}
+
+		/** SpawnInventory, Configure runs before the inventory is registered (e.g., to size a grid) */
+		template<typename T>
+		T* SpawnInventory(TFunctionRef<void(T&)> Configure)
+		{
+			return CastChecked<T>(SpawnInventory(T::StaticClass(), [&Configure](UInventoryComponent& Inventory) { Configure(*CastChecked<T>(&Inventory)); }));
+		}
+
+		UInventoryComponent* SpawnInventory(TSubclassOf<UInventoryComponent> InventoryClass);
+		UInventoryComponent* SpawnInventory(TSubclassOf<UInventoryComponent> InventoryClass, TFunctionRef<void(UInventoryComponent&)> Configure);
+
+		/**
+		 * @brief New transient item data, its item actor is a plain AActor.
+		 *
+		 * Kept alive until this world is destroyed. Stackable if MaxStackSize is greater than 1.
+		 */
+		USwordItemData* NewItemData(const FString& Name, int32 MaxStackSize = 1, uint32 Value = 1);
+
+		/** Advances the world, and its tickable subsystems (spawn queue, journal, grants), by a frame */
+		void Tick(float DeltaSeconds = 1.f / 60.f);
+
+	private:
+		UWorld* World = nullptr;
+
+		TArray<TStrongObjectPtr<UItemData>> ItemData;
+	};
+
+	/**
+	 * @brief Results of a benchmark, one row per measurement.
+	 *
+	 * Save writes them to Saved/Automation/InvTest/<Name>.csv (overwriting the last run) and adds every
+	 * row to the test's log, so they show up in the automation report as well.
+	 */
+	class FBenchmarkResults
+	{
+	public:
+		explicit FBenchmarkResults(const FString& InName)
+			: Name(InName)
+		{
+		}
+
+		/**
+		 * @param Metric what was measured, e.g., "CreateItemInInventory"
+		 * @param Size problem size of the measurement, e.g., the number of items in the inventory
+		 */
+		void Add(const FString& Metric, int64 Size, double Value, const FString& Unit);
+
+		bool Save(FAutomationTestBase& Test) const;
+
+		static FString GetResultsDir();
+
+	private:
+		struct FRow
+		{
+			FString Metric;
+			int64 Size = 0;
+			double Value = 0.0;
+			FString Unit;
+		};
+
+		FString Name;
+		TArray<FRow> Rows;
+	};
+
+	/** Wall clock seconds Body takes */
+	template<typename FunctorType>
+	double TimeSeconds(FunctorType&& Body)
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		Body();
+		return FPlatformTime::Seconds() - StartTime;
+	}
+
+	/** Bytes the allocator has handed out right now, 0 if the platform does not track it */
+	uint64 GetUsedPhysicalMemory();
+
+	/**
+	 * @brief Value of a reflected property of Object, private ones included.
+	 *
+	 * Lets tests look at replicated state (e.g., an inventory's item list) without making it part of the API.
+	 * @return nullptr if Object's class has no property named PropertyName
+	 */
+	template<typename T>
+	T* GetPropertyValue(UObject* Object, FName PropertyName)
+	{
+		FProperty* Property = Object ? FindFProperty<FProperty>(Object->GetClass(), PropertyName) : nullptr;
+		return Property ? Property->ContainerPtrToValuePtr<T>(Object) : nullptr;
+	}
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
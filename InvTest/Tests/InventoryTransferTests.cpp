@@ -0,0 +1,132 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InventoryTestUtils.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "GridInventoryComponent.h"
+#include "InventoryComponent.h"
+#include "InventoryTestTypes.h"
+#include "ItemInstance.h"
+
+/**
+ * Moving item instances between inventories: what carries over, and the all-or-nothing rule.
+ */
+namespace InventoryTransferTests
+{
+	TArray<UItemInstance*> FillInventory(UInventoryComponent* Inventory, UItemData* ItemData, int32 NumItems)
+	{
+		TArray<FItemInstanceInitializer> Initializers;
+		Initializers.SetNum(NumItems);
+		for (FItemInstanceInitializer& Initializer : Initializers)
+		{
+			Initializer.ItemClass = UInventoryTestItemInstance::StaticClass();
+			Initializer.ItemData = ItemData;
+		}
+		return Inventory->CreateItemsInInventory(Initializers);
+	}
+
+	/** The actor the item actually has */
+	AActor* GetItemActor(UItemInstance* Item)
+	{
+		const TObjectPtr<AActor>* ItemActor = InventoryTest::GetPropertyValue<TObjectPtr<AActor>>(Item, TEXT("ItemActor"));
+		return ItemActor ? ItemActor->Get() : nullptr;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInventoryTransferBulkTest, "InvTest.Transfer.Bulk", INVENTORY_TEST_FLAGS)
+bool FInventoryTransferBulkTest::RunTest(const FString& Parameters)
+{
+	using namespace InventoryTransferTests;
+
+	InventoryTest::FTestWorld TestWorld;
+
+	UItemData* ItemData = TestWorld.NewItemData(TEXT("TransferredSword"));
+	UInventoryComponent* Source = TestWorld.SpawnInventory();
+	UInventoryComponent* Target = TestWorld.SpawnInventory();
+
+	const TArray<UItemInstance*> Items = FillInventory(Source, ItemData, 5);
+	if (!TestEqual(TEXT("Every item was created"), Items.Num(), 5))
+	{
+		return false;
+	}
+
+	Source->RequestItemActorSpawned(Items[0], true);
+	Source->RequestItemActorSpawned(Items[1], true);
+	AActor* KeptActor = GetItemActor(Items[0]);
+	AActor* DroppedActor = GetItemActor(Items[1]);
+	const FGuid Guid = Items[0]->GetItemGuid();
+
+	/** The same instances move, with their actors when asked to keep them */
+	const TArray<UItemInstance*> Moved = { Items[0], Items[2], Items[3] };
+	if (!TestTrue(TEXT("The transfer succeeds"), Source->TransferItemsTo(Target, Moved, true)))
+	{
+		return false;
+	}
+
+	TestEqual(TEXT("The moved items left the source"), Source->GetNumItems(), 2);
+	TestEqual(TEXT("The moved items are in the target"), Target->GetNumItems(), 3);
+	TestTrue(TEXT("The instances were moved, not recreated"), !Moved.ContainsByPredicate([Target](UItemInstance* Item) { return !Target->ContainsItem(Item); }));
+	TestTrue(TEXT("The instances belong to the target"), !Moved.ContainsByPredicate([Target](UItemInstance* Item) { return Item->GetOuter() != Target; }));
+	TestTrue(TEXT("The instances replicate with the target"), !Moved.ContainsByPredicate([Source, Target](UItemInstance* Item) { return !Target->IsReplicatedSubObjectRegistered(Item) || Source->IsReplicatedSubObjectRegistered(Item); }));
+	TestTrue(TEXT("The item keeps its guid"), Items[0]->GetItemGuid() == Guid);
+
+	TestTrue(TEXT("A kept actor stays spawned"), GetItemActor(Items[0]) == KeptActor && Target->IsItemActorSpawned(Items[0]));
+	TestTrue(TEXT("A kept actor belongs to the target's owner"), KeptActor->GetOwner() == Target->GetOwner());
+	TestTrue(TEXT("A kept actor keeps the item visible to others"), Target->IsItemVisibleToOthers(Items[0]));
+
+	/** Without keeping them, actors are destroyed on the way */
+	TestTrue(TEXT("A single item transfers"), Source->TransferItemTo(Target, Items[1]));
+	TestNull(TEXT("The actor was not kept"), GetItemActor(Items[1]));
+	TestFalse(TEXT("The target has no actor for the item"), Target->IsItemActorSpawned(Items[1]));
+	TestTrue(TEXT("The released actor is no longer shown"), !IsValid(DroppedActor) || DroppedActor->IsHidden());
+
+	/** A bad list moves nothing, not even the valid part of it */
+	AddExpectedMessage(TEXT("or listed twice"), ELogVerbosity::Warning, EAutomationExpectedMessageFlags::Contains, 2);
+	TestFalse(TEXT("An item listed twice fails the transfer"), Target->TransferItemsTo(Source, { Items[0], Items[2], Items[0] }));
+	TestFalse(TEXT("An item from another inventory fails the transfer"), Target->TransferItemsTo(Source, { Items[0], Items[4] }));
+	TestEqual(TEXT("A failed transfer takes nothing out"), Target->GetNumItems(), 4);
+	TestEqual(TEXT("A failed transfer puts nothing in"), Source->GetNumItems(), 1);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInventoryTransferAllOrNothingTest, "InvTest.Transfer.AllOrNothing", INVENTORY_TEST_FLAGS)
+bool FInventoryTransferAllOrNothingTest::RunTest(const FString& Parameters)
+{
+	using namespace InventoryTransferTests;
+
+	InventoryTest::FTestWorld TestWorld;
+
+	UItemData* ItemData = TestWorld.NewItemData(TEXT("ChestSword"));
+	UInventoryComponent* Chest = TestWorld.SpawnInventory();
+	FillInventory(Chest, ItemData, 6);
+
+	/** Four cells, one of them taken */
+	UGridInventoryComponent* Backpack = TestWorld.SpawnInventory<UGridInventoryComponent>([](UGridInventoryComponent& Inventory)
+	{
+		Inventory.GridWidth = 2;
+		Inventory.GridHeight = 2;
+	});
+	FillInventory(Backpack, ItemData, 1);
+
+	TestFalse(TEXT("Looting more than fits fails"), Chest->TransferAllItemsTo(Backpack));
+	TestEqual(TEXT("Nothing left the chest"), Chest->GetNumItems(), 6);
+	TestEqual(TEXT("Nothing was added to the backpack"), Backpack->GetNumItems(), 1);
+
+	const TArray<UItemInstance*> ChestItems = Chest->GetItemInstances();
+	TestTrue(TEXT("What fits is moved"), Chest->TransferItemsTo(Backpack, { ChestItems[0], ChestItems[1], ChestItems[2] }));
+	TestEqual(TEXT("The backpack is full"), Backpack->GetNumItems(), 4);
+	TestEqual(TEXT("The rest stays in the chest"), Chest->GetNumItems(), 3);
+
+	/** Emptying into an inventory without a limit moves everything at once */
+	UInventoryComponent* Stash = TestWorld.SpawnInventory();
+	TestTrue(TEXT("Everything moves to the stash"), Chest->TransferAllItemsTo(Stash));
+	TestEqual(TEXT("The chest is empty"), Chest->GetNumItems(), 0);
+	TestEqual(TEXT("The stash holds the chest's items"), Stash->GetNumItems(), 3);
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
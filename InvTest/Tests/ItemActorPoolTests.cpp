@@ -0,0 +1,88 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InventoryTestUtils.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "ItemActorPool.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+
+/**
+ * UItemActorPool reuse: hits and misses, prewarming, and per-class capacity.
+ */
+namespace ItemActorPoolTests
+{
+	/** Whether the actor is in the state the pool hands out, rather than the hidden one it keeps */
+	bool IsActive(const AActor* ItemActor)
+	{
+		return IsValid(ItemActor) && !ItemActor->IsHidden() && ItemActor->GetIsReplicated();
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FItemActorPoolReuseTest, "InvTest.ItemActors.Pool", INVENTORY_TEST_FLAGS)
+bool FItemActorPoolReuseTest::RunTest(const FString& Parameters)
+{
+	using namespace ItemActorPoolTests;
+
+	InventoryTest::FTestWorld TestWorld;
+
+	UItemActorPool* Pool = TestWorld.GetWorld()->GetSubsystem<UItemActorPool>();
+	if (!TestNotNull(TEXT("The world has an item actor pool"), Pool))
+	{
+		return false;
+	}
+
+	const TSubclassOf<AActor> ActorClass = AActor::StaticClass();
+	AActor* Owner = TestWorld.SpawnActor();
+
+	/** Prewarming spawns up to the capacity, never past it */
+	Pool->SetPoolCapacity(ActorClass, 4);
+	Pool->PrewarmPool(ActorClass, 10);
+
+	TArray<AActor*> Actors;
+	for (int32 Index = 0; Index < 5; ++Index)
+	{
+		Actors.Add(Pool->AcquireItemActor(ActorClass, FTransform::Identity, Owner));
+	}
+	TestEqual(TEXT("Prewarmed actors are hits"), Pool->GetNumHits(), 4);
+	TestEqual(TEXT("The pool spawns once it is empty"), Pool->GetNumMisses(), 1);
+	TestTrue(TEXT("Acquired actors are shown and replicate"), !Actors.ContainsByPredicate([](const AActor* ItemActor) { return !IsActive(ItemActor); }));
+	TestTrue(TEXT("Acquired actors belong to the requested owner"), Actors[0]->GetOwner() == Owner);
+
+	/** The pool keeps up to its capacity, the actor released past that is destroyed */
+	for (AActor* ItemActor : Actors)
+	{
+		Pool->ReleaseItemActor(ItemActor);
+	}
+	TestTrue(TEXT("Released actors are hidden and stop replicating"), IsValid(Actors[0]) && Actors[0]->IsHidden() && !Actors[0]->GetIsReplicated());
+	TestTrue(TEXT("Released actors no longer have an owner"), Actors[0]->GetOwner() == nullptr);
+	TestFalse(TEXT("An actor released into a full pool is destroyed"), IsValid(Actors[4]));
+
+	AActor* Reused = Pool->AcquireItemActor(ActorClass, FTransform::Identity, Owner);
+	TestTrue(TEXT("A released actor is handed out again"), Reused == Actors[3]);
+	TestEqual(TEXT("Reuse counts as a hit"), Pool->GetNumHits(), 5);
+	TestEqual(TEXT("Reuse spawns nothing"), Pool->GetNumMisses(), 1);
+
+	/** Shrinking the capacity destroys the excess, the most recently released actors first */
+	Pool->SetPoolCapacity(ActorClass, 1);
+	TestTrue(TEXT("Shrinking keeps actors up to the new capacity"), IsValid(Actors[0]));
+	TestFalse(TEXT("Shrinking destroys the excess"), IsValid(Actors[1]) || IsValid(Actors[2]));
+	TestTrue(TEXT("Shrinking leaves acquired actors alone"), IsActive(Reused));
+
+	/** Destroyed from outside while pooled (e.g., level cleanup), the pool spawns a new one instead */
+	Actors[0]->Destroy();
+	AActor* Spawned = Pool->AcquireItemActor(ActorClass, FTransform::Identity, Owner);
+	TestTrue(TEXT("A pooled actor destroyed from outside is skipped"), IsActive(Spawned) && Spawned != Actors[0]);
+	TestEqual(TEXT("Skipping a destroyed actor is a miss"), Pool->GetNumMisses(), 2);
+
+	/** A capacity of zero turns pooling off for the class */
+	Pool->SetPoolCapacity(ActorClass, 0);
+	Pool->ReleaseItemActor(Spawned);
+	TestFalse(TEXT("Without capacity released actors are destroyed"), IsValid(Spawned));
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
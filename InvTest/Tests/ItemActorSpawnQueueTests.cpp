@@ -0,0 +1,222 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InventoryTestUtils.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "InventoryComponent.h"
+#include "InventoryTestTypes.h"
+#include "ItemActorSpawnQueue.h"
+#include "ItemInstance.h"
+#include "Components/SceneComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+
+/**
+ * UItemActorSpawnQueue: the per-frame budget, processing order, and requests cancelling out.
+ *
+ * The queue is ticked directly rather than through the world, so every Tick call is exactly one frame.
+ */
+namespace ItemActorSpawnQueueTests
+{
+	constexpr float FrameSeconds = 1.f / 60.f;
+
+	/** An inventory whose item actor requests go through the spawn queue, owned by an actor at Location */
+	UInventoryComponent* SpawnQueuedInventory(InventoryTest::FTestWorld& TestWorld, const FVector& Location = FVector::ZeroVector)
+	{
+		AActor* Owner = TestWorld.SpawnActor();
+
+		/** An empty actor has no location without a root */
+		USceneComponent* Root = NewObject<USceneComponent>(Owner);
+		Owner->SetRootComponent(Root);
+		Root->RegisterComponent();
+		Owner->SetActorLocation(Location);
+
+		UInventoryComponent* Inventory = TestWorld.AddComponent<UInventoryComponent>(Owner);
+		Inventory->bDeferItemActorRequests = true;
+		return Inventory;
+	}
+
+	TArray<UItemInstance*> FillInventory(UInventoryComponent* Inventory, UItemData* ItemData, int32 NumItems)
+	{
+		TArray<FItemInstanceInitializer> Initializers;
+		Initializers.SetNum(NumItems);
+		for (FItemInstanceInitializer& Initializer : Initializers)
+		{
+			Initializer.ItemClass = UInventoryTestItemInstance::StaticClass();
+			Initializer.ItemData = ItemData;
+		}
+		return Inventory->CreateItemsInInventory(Initializers);
+	}
+
+	/** The actor the item actually has, IsItemActorSpawned already counts pending spawns */
+	AActor* GetItemActor(UItemInstance* Item)
+	{
+		const TObjectPtr<AActor>* ItemActor = InventoryTest::GetPropertyValue<TObjectPtr<AActor>>(Item, TEXT("ItemActor"));
+		return ItemActor ? ItemActor->Get() : nullptr;
+	}
+
+	int32 CountItemActors(const TArray<UItemInstance*>& Items)
+	{
+		return Items.FilterByPredicate([](UItemInstance* Item) { return IsValid(GetItemActor(Item)); }).Num();
+	}
+
+	void RequestItemActors(UInventoryComponent* Inventory, const TArray<UItemInstance*>& Items, bool bSpawned)
+	{
+		for (UItemInstance* Item : Items)
+		{
+			Inventory->RequestItemActorSpawned(Item, bSpawned);
+		}
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FItemActorSpawnQueueBudgetTest, "InvTest.ItemActors.SpawnQueueBudget", INVENTORY_TEST_FLAGS)
+bool FItemActorSpawnQueueBudgetTest::RunTest(const FString& Parameters)
+{
+	using namespace ItemActorSpawnQueueTests;
+
+	InventoryTest::FTestWorld TestWorld;
+
+	UItemActorSpawnQueue* SpawnQueue = TestWorld.GetWorld()->GetSubsystem<UItemActorSpawnQueue>();
+	if (!TestNotNull(TEXT("The world has a spawn queue"), SpawnQueue))
+	{
+		return false;
+	}
+
+	UInventoryComponent* Inventory = SpawnQueuedInventory(TestWorld);
+	const TArray<UItemInstance*> Items = FillInventory(Inventory, TestWorld.NewItemData(TEXT("QueuedSword")), 20);
+
+	/** A time budget nothing reaches, so only the count limits a frame */
+	SpawnQueue->MaxRequestsPerFrame = 8;
+	SpawnQueue->MaxMillisecondsPerFrame = 1000.f;
+
+	RequestItemActors(Inventory, Items, true);
+	TestEqual(TEXT("Spawns wait for the queue"), CountItemActors(Items), 0);
+	TestEqual(TEXT("Every spawn is pending"), SpawnQueue->GetNumPendingRequests(), 20);
+	TestTrue(TEXT("A pending spawn already counts as spawned"), Inventory->IsItemActorSpawned(Items[0]));
+
+	const int32 ExpectedActors[] = { 8, 16, 20 };
+	for (const int32 Expected : ExpectedActors)
+	{
+		SpawnQueue->Tick(FrameSeconds);
+		TestEqual(FString::Printf(TEXT("[%d] A frame spawns at most MaxRequestsPerFrame actors"), Expected), CountItemActors(Items), Expected);
+	}
+	TestEqual(TEXT("The queue is drained"), SpawnQueue->GetNumPendingRequests(), 0);
+
+	/** An exhausted time budget still lets one request through, so the queue always makes progress */
+	SpawnQueue->MaxMillisecondsPerFrame = 0.f;
+
+	RequestItemActors(Inventory, Items, false);
+	for (int32 Frame = 1; Frame <= 3; ++Frame)
+	{
+		SpawnQueue->Tick(FrameSeconds);
+		TestEqual(FString::Printf(TEXT("[%d] A frame over its time budget destroys one actor"), Frame), CountItemActors(Items), 20 - Frame);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FItemActorSpawnQueueOrderTest, "InvTest.ItemActors.SpawnQueueOrder", INVENTORY_TEST_FLAGS)
+bool FItemActorSpawnQueueOrderTest::RunTest(const FString& Parameters)
+{
+	using namespace ItemActorSpawnQueueTests;
+
+	InventoryTest::FTestWorld TestWorld;
+
+	UItemActorSpawnQueue* SpawnQueue = TestWorld.GetWorld()->GetSubsystem<UItemActorSpawnQueue>();
+	if (!TestNotNull(TEXT("The world has a spawn queue"), SpawnQueue))
+	{
+		return false;
+	}
+	SpawnQueue->MaxRequestsPerFrame = 1;
+	SpawnQueue->MaxMillisecondsPerFrame = 1000.f;
+
+	/** A player at the origin, one owner next to them and one far past any net cull distance */
+	TestWorld.GetWorld()->SpawnActor<APlayerController>();
+	UInventoryComponent* Near = SpawnQueuedInventory(TestWorld);
+	UInventoryComponent* Far = SpawnQueuedInventory(TestWorld, FVector(1e7f, 0.f, 0.f));
+
+	UItemData* ItemData = TestWorld.NewItemData(TEXT("OrderedSword"));
+	const TArray<UItemInstance*> NearItems = FillInventory(Near, ItemData, 2);
+	const TArray<UItemInstance*> FarItems = FillInventory(Far, ItemData, 2);
+
+	/** Give the far owner an actor to destroy later */
+	Far->RequestItemActorSpawned(FarItems[1], true);
+	SpawnQueue->Tick(FrameSeconds);
+	if (!TestNotNull(TEXT("The setup spawn went through"), GetItemActor(FarItems[1])))
+	{
+		return false;
+	}
+
+	/** Queued far first and the destroy last, processed the other way around */
+	Far->RequestItemActorSpawned(FarItems[0], true);
+	Near->RequestItemActorSpawned(NearItems[0], true);
+	Near->RequestItemActorSpawned(NearItems[1], true);
+	Far->RequestItemActorSpawned(FarItems[1], false);
+
+	SpawnQueue->Tick(FrameSeconds);
+	TestNull(TEXT("Destroys go before any spawn"), GetItemActor(FarItems[1]));
+	TestNull(TEXT("Nothing else runs in the same frame"), GetItemActor(FarItems[0]));
+
+	SpawnQueue->Tick(FrameSeconds);
+	TestNotNull(TEXT("The owner more players see spawns first"), GetItemActor(NearItems[0]));
+	TestNull(TEXT("The far owner waits, though it was queued first"), GetItemActor(FarItems[0]));
+
+	SpawnQueue->Tick(FrameSeconds);
+	TestNotNull(TEXT("Equally relevant spawns run in the order they were queued"), GetItemActor(NearItems[1]));
+	TestNull(TEXT("The far owner is still waiting"), GetItemActor(FarItems[0]));
+
+	SpawnQueue->Tick(FrameSeconds);
+	TestNotNull(TEXT("The far owner spawns last"), GetItemActor(FarItems[0]));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FItemActorSpawnQueueCancelTest, "InvTest.ItemActors.SpawnQueueCancel", INVENTORY_TEST_FLAGS)
+bool FItemActorSpawnQueueCancelTest::RunTest(const FString& Parameters)
+{
+	using namespace ItemActorSpawnQueueTests;
+
+	InventoryTest::FTestWorld TestWorld;
+
+	UItemActorSpawnQueue* SpawnQueue = TestWorld.GetWorld()->GetSubsystem<UItemActorSpawnQueue>();
+	if (!TestNotNull(TEXT("The world has a spawn queue"), SpawnQueue))
+	{
+		return false;
+	}
+
+	UInventoryComponent* Inventory = SpawnQueuedInventory(TestWorld);
+	const TArray<UItemInstance*> Items = FillInventory(Inventory, TestWorld.NewItemData(TEXT("CancelledSword")), 3);
+
+	/** Spawn then destroy before the queue runs leaves the item without an actor, and nothing queued */
+	Inventory->RequestItemActorSpawned(Items[0], true);
+	Inventory->RequestItemActorSpawned(Items[0], false);
+	TestEqual(TEXT("A spawn and a destroy cancel out"), SpawnQueue->GetNumPendingRequests(), 0);
+	TestFalse(TEXT("The cancelled spawn no longer counts as spawned"), Inventory->IsItemActorSpawned(Items[0]));
+
+	TestTrue(TEXT("A new request is queued"), SpawnQueue->EnqueueRequest(Inventory, Items[1], EItemActorRequestType::Spawn));
+	TestFalse(TEXT("The same request again is ignored"), SpawnQueue->EnqueueRequest(Inventory, Items[1], EItemActorRequestType::Spawn));
+	TestEqual(TEXT("A duplicate adds nothing"), SpawnQueue->GetNumPendingRequests(), 1);
+
+	SpawnQueue->Tick(FrameSeconds);
+	TestNull(TEXT("A cancelled spawn never runs"), GetItemActor(Items[0]));
+	TestNotNull(TEXT("A duplicated spawn runs once"), GetItemActor(Items[1]));
+
+	/** Destroy then spawn keeps the actor that is already there */
+	AActor* ItemActor = GetItemActor(Items[1]);
+	Inventory->RequestItemActorSpawned(Items[1], false);
+	Inventory->RequestItemActorSpawned(Items[1], true);
+	TestEqual(TEXT("A destroy and a spawn cancel out"), SpawnQueue->GetNumPendingRequests(), 0);
+	SpawnQueue->Tick(FrameSeconds);
+	TestTrue(TEXT("The item keeps its actor"), GetItemActor(Items[1]) == ItemActor);
+
+	/** Removing an item drops its pending request, the queue must not touch it afterwards */
+	Inventory->RequestItemActorSpawned(Items[2], true);
+	Inventory->RemoveItemFromInventory(Items[2]);
+	TestEqual(TEXT("Removing an item cancels its request"), SpawnQueue->GetNumPendingRequests(), 0);
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
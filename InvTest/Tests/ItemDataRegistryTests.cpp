@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InventoryTestUtils.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "ItemDataRegistry.h"
+#include "UObject/StrongObjectPtr.h"
+
+/**
+ * UItemDataRegistry with synthetic asset paths.
+ *
+ * Registries are created on their own rather than using the engine's, so the made up paths do
+ * not end up in the registry every other test resolves item data through.
+ */
+namespace ItemDataRegistryTests
+{
+	TStrongObjectPtr<UItemDataRegistry> NewRegistry()
+	{
+		return TStrongObjectPtr<UItemDataRegistry>(NewObject<UItemDataRegistry>(GetTransientPackage()));
+	}
+
+	/** Paths shaped like those of a large item catalog, none of them has to exist */
+	TArray<FSoftObjectPath> MakeItemDataPaths(int32 NumPaths)
+	{
+		TArray<FSoftObjectPath> Paths;
+		Paths.Reserve(NumPaths);
+		for (int32 Index = 0; Index < NumPaths; ++Index)
+		{
+			const FString AssetName = FString::Printf(TEXT("DA_Item_%06d"), Index);
+			Paths.Emplace(FString::Printf(TEXT("/Game/Items/Category%02d/%s.%s"), Index % 64, *AssetName, *AssetName));
+		}
+		return Paths;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInventoryBenchmarkItemDataRegistry, "InvTest.Benchmark.ItemDataRegistry", INVENTORY_TEST_FLAGS)
+bool FInventoryBenchmarkItemDataRegistry::RunTest(const FString& Parameters)
+{
+	using namespace ItemDataRegistryTests;
+
+	InventoryTest::FBenchmarkResults Results(TEXT("ItemDataRegistry"));
+
+	const int32 CatalogSizes[] = { 1000, 10000, 50000 };
+	for (const int32 NumPaths : CatalogSizes)
+	{
+		const TArray<FSoftObjectPath> Paths = MakeItemDataPaths(NumPaths);
+		const TStrongObjectPtr<UItemDataRegistry> Registry = NewRegistry();
+
+		TArray<FItemDataId> Ids;
+		Ids.Reserve(NumPaths);
+		const double RegisterSeconds = InventoryTest::TimeSeconds([&]()
+		{
+			for (const FSoftObjectPath& Path : Paths)
+			{
+				Ids.Add(Registry->RegisterItemData(Path));
+			}
+		});
+
+		/** A collision would have been fatal, so every path has its own id */
+		TestEqual(FString::Printf(TEXT("[%d] Every path was registered"), NumPaths), Registry->GetNumRegisteredItemData(), NumPaths);
+
+		int32 NumResolved = 0;
+		const double LookupSeconds = InventoryTest::TimeSeconds([&]()
+		{
+			for (int32 Index = 0; Index < NumPaths; ++Index)
+			{
+				NumResolved += Registry->GetItemDataPath(Ids[Index]) == Paths[Index] ? 1 : 0;
+			}
+		});
+		TestEqual(FString::Printf(TEXT("[%d] Every id maps back to its path"), NumPaths), NumResolved, NumPaths);
+
+		/** Registering again (e.g., an asset the scan already found) keeps the id */
+		TestTrue(FString::Printf(TEXT("[%d] Registering twice returns the same id"), NumPaths), Registry->RegisterItemData(Paths[0]) == Ids[0]);
+		TestEqual(FString::Printf(TEXT("[%d] Registering twice adds nothing"), NumPaths), Registry->GetNumRegisteredItemData(), NumPaths);
+
+		Results.Add(TEXT("Register"), NumPaths, RegisterSeconds * 1000.0, TEXT("ms"));
+		Results.Add(TEXT("RegisterPerPath"), NumPaths, RegisterSeconds * 1e9 / NumPaths, TEXT("ns/path"));
+		Results.Add(TEXT("GetItemDataPath"), NumPaths, LookupSeconds * 1e9 / NumPaths, TEXT("ns/lookup"));
+	}
+
+	return Results.Save(*this);
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
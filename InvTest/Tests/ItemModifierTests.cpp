@@ -0,0 +1,238 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InventoryTestUtils.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "InventoryComponent.h"
+#include "InventoryTestTypes.h"
+#include "ItemInstance.h"
+
+/**
+ * Rolled affixes and runtime modifiers on item instances, and the cached final stats.
+ */
+namespace ItemModifierTests
+{
+	/** An item with no affixes, base damage 10, no crits and an attack speed of 1 */
+	UItemInstance* NewItem(InventoryTest::FTestWorld& TestWorld, UItemData* ItemData)
+	{
+		FItemInstanceInitializer Initializer;
+		Initializer.ItemClass = UInventoryTestItemInstance::StaticClass();
+		Initializer.ItemData = ItemData;
+
+		const TArray<UItemInstance*> Items = TestWorld.SpawnInventory()->CreateItemsInInventory({ Initializer });
+		return Items.Num() == 1 ? Items[0] : nullptr;
+	}
+
+	/** ReplicationKey of every modifier by ReplicationID, what a connection has acked */
+	TMap<int32, int32> GetAckedKeys(const UItemInstance* Item)
+	{
+		TMap<int32, int32> Keys;
+		for (const FItemModifier& Modifier : Item->GetModifiers())
+		{
+			Keys.Add(Modifier.ReplicationID, Modifier.ReplicationKey);
+		}
+		return Keys;
+	}
+
+	/** Modifiers the fast array would send to a connection that acked AckedKeys */
+	int32 CountChangedModifiers(const UItemInstance* Item, const TMap<int32, int32>& AckedKeys)
+	{
+		int32 NumChanged = 0;
+		for (const FItemModifier& Modifier : Item->GetModifiers())
+		{
+			const int32* AckedKey = AckedKeys.Find(Modifier.ReplicationID);
+			NumChanged += !AckedKey || *AckedKey != Modifier.ReplicationKey ? 1 : 0;
+		}
+		return NumChanged;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FItemModifierStatsTest, "InvTest.Stats.Modifiers", INVENTORY_TEST_FLAGS)
+bool FItemModifierStatsTest::RunTest(const FString& Parameters)
+{
+	using namespace ItemModifierTests;
+
+	InventoryTest::FTestWorld TestWorld;
+
+	UItemInstance* Item = NewItem(TestWorld, TestWorld.NewItemData(TEXT("ModifiedSword")));
+	if (!TestNotNull(TEXT("The item was created"), Item))
+	{
+		return false;
+	}
+
+	int32 NumBroadcasts = 0;
+	Item->OnStatsChanged.AddLambda([&NumBroadcasts](UItemInstance*) { ++NumBroadcasts; });
+
+	TestEqual(TEXT("No modifiers, the base damage"), Item->GetStat(EItemStat::Damage), 10.f);
+
+	/** (10 + 5) * (1 + 0.5) */
+	const int32 FlatId = Item->AddModifier(EItemStat::Damage, EItemModifierOp::Additive, 5.f);
+	const int32 PercentId = Item->AddModifier(EItemStat::Damage, EItemModifierOp::Multiplicative, 0.5f);
+	TestEqual(TEXT("Additive then multiplicative"), Item->GetStat(EItemStat::Damage), 22.5f);
+	TestEqual(TEXT("Other stats are untouched"), Item->GetStat(EItemStat::AttackSpeed), 1.f);
+
+	Item->AddModifier(EItemStat::AttackSpeed, EItemModifierOp::Multiplicative, 0.2f);
+	const FItemCombatStats Stats = Item->GetFinalStats();
+	TestEqual(TEXT("Final stats have the damage"), Stats.Damage, 22.5f);
+	TestEqual(TEXT("Final stats have the attack speed"), Stats.AttackSpeed, 1.2f);
+
+	TestTrue(TEXT("The flat modifier is removed"), Item->RemoveModifier(FlatId));
+	TestEqual(TEXT("Removing a modifier takes its contribution back out"), Item->GetStat(EItemStat::Damage), 15.f);
+	TestFalse(TEXT("A modifier can only be removed once"), Item->RemoveModifier(FlatId));
+
+	TestTrue(TEXT("The percent modifier is removed"), Item->RemoveModifier(PercentId));
+	TestEqual(TEXT("Back to the base damage"), Item->GetStat(EItemStat::Damage), 10.f);
+
+	TestEqual(TEXT("Every change was broadcast once"), NumBroadcasts, 5);
+
+	/** Only the added modifier goes out, removing one sends a delete rather than the other modifiers */
+	TMap<int32, int32> AckedKeys = GetAckedKeys(Item);
+	const int32 CritId = Item->AddModifier(EItemStat::CriticalStrikeChance, EItemModifierOp::Additive, 0.25f);
+	TestEqual(TEXT("Adding a modifier sends only that modifier"), CountChangedModifiers(Item, AckedKeys), 1);
+
+	Item->AddModifier(EItemStat::Damage, EItemModifierOp::Additive, 1.f);
+	AckedKeys = GetAckedKeys(Item);
+	Item->RemoveModifier(CritId);
+	TestEqual(TEXT("Removing a modifier resends none of the others"), CountChangedModifiers(Item, AckedKeys), 0);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FItemModifierAffixTest, "InvTest.Stats.Affixes", INVENTORY_TEST_FLAGS)
+bool FItemModifierAffixTest::RunTest(const FString& Parameters)
+{
+	using namespace ItemModifierTests;
+
+	InventoryTest::FTestWorld TestWorld;
+
+	USwordItemData* ItemData = TestWorld.NewItemData(TEXT("AffixSword"));
+
+	FItemAffixRange& Always = ItemData->PossibleAffixes.AddDefaulted_GetRef();
+	Always.Stat = EItemStat::Damage;
+	Always.MinMagnitude = 2.f;
+	Always.MaxMagnitude = 4.f;
+
+	FItemAffixRange& Never = ItemData->PossibleAffixes.AddDefaulted_GetRef();
+	Never.Stat = EItemStat::AttackSpeed;
+	Never.RollChance = 0.f;
+
+	constexpr int32 NumItems = 100;
+	int32 NumWrongAffixes = 0;
+	int32 NumOutOfRange = 0;
+	for (int32 Index = 0; Index < NumItems; ++Index)
+	{
+		const UItemInstance* Item = NewItem(TestWorld, ItemData);
+		if (!Item || Item->GetModifiers().Num() != 1 || Item->GetModifiers()[0].Stat != EItemStat::Damage)
+		{
+			++NumWrongAffixes;
+			continue;
+		}
+
+		const float Damage = Item->GetStat(EItemStat::Damage);
+		NumOutOfRange += Damage >= 12.f && Damage <= 14.f ? 0 : 1;
+	}
+
+	TestEqual(TEXT("Every item rolled exactly the affix with a roll chance of 1"), NumWrongAffixes, 0);
+	TestEqual(TEXT("Rolled damage is within the affix range"), NumOutOfRange, 0);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FItemModifierBenchmark, "InvTest.Benchmark.ModifiedStats", INVENTORY_TEST_FLAGS)
+bool FItemModifierBenchmark::RunTest(const FString& Parameters)
+{
+	InventoryTest::FTestWorld TestWorld;
+	InventoryTest::FBenchmarkResults Results(TEXT("ModifiedStats"));
+
+	constexpr int32 NumItems = 10000;
+	constexpr int32 NumModifiersPerItem = 8;
+	constexpr int32 NumPasses = 20;
+
+	UInventoryComponent* Inventory = TestWorld.SpawnInventory();
+	UItemData* ItemData = TestWorld.NewItemData(TEXT("BenchmarkSword"));
+
+	TArray<FItemInstanceInitializer> Initializers;
+	Initializers.SetNum(NumItems);
+	for (FItemInstanceInitializer& Initializer : Initializers)
+	{
+		Initializer.ItemClass = UInventoryTestItemInstance::StaticClass();
+		Initializer.ItemData = ItemData;
+	}
+	const TArray<UItemInstance*> Items = Inventory->CreateItemsInInventory(Initializers);
+
+	for (UItemInstance* Item : Items)
+	{
+		for (int32 Index = 0; Index < NumModifiersPerItem; ++Index)
+		{
+			Item->AddModifier(static_cast<EItemStat>(Index % static_cast<int32>(EItemStat::MAX)), Index % 2 ? EItemModifierOp::Multiplicative : EItemModifierOp::Additive, 0.1f);
+		}
+	}
+
+	/** Fills the caches */
+	float Sum = 0.f;
+	for (const UItemInstance* Item : Items)
+	{
+		Sum += Item->GetStat(EItemStat::Damage);
+	}
+
+	const double CachedSeconds = InventoryTest::TimeSeconds([&]()
+	{
+		for (int32 Pass = 0; Pass < NumPasses; ++Pass)
+		{
+			for (const UItemInstance* Item : Items)
+			{
+				Sum += Item->GetStat(EItemStat::Damage);
+			}
+		}
+	});
+
+	/** What every query would cost without the cache: fold the item's modifiers over its base stat */
+	const double RebuiltSeconds = InventoryTest::TimeSeconds([&]()
+	{
+		for (int32 Pass = 0; Pass < NumPasses; ++Pass)
+		{
+			for (const UItemInstance* Item : Items)
+			{
+				float Additive = 0.f;
+				float Multiplicative = 0.f;
+				for (const FItemModifier& Modifier : Item->GetModifiers())
+				{
+					if (Modifier.Stat == EItemStat::Damage)
+					{
+						(Modifier.Op == EItemModifierOp::Additive ? Additive : Multiplicative) += Modifier.Magnitude;
+					}
+				}
+				Sum += (Item->GetData()->GetCombatStats().Damage + Additive) * (1.f + Multiplicative);
+			}
+		}
+	});
+
+	/** A combat frame: one modifier changes on every hundredth item, then every item is queried */
+	const double ChurnSeconds = InventoryTest::TimeSeconds([&]()
+	{
+		for (int32 Pass = 0; Pass < NumPasses; ++Pass)
+		{
+			for (int32 Index = Pass % 100; Index < Items.Num(); Index += 100)
+			{
+				Items[Index]->RemoveModifier(Items[Index]->AddModifier(EItemStat::Damage, EItemModifierOp::Additive, 1.f));
+			}
+			for (const UItemInstance* Item : Items)
+			{
+				Sum += Item->GetStat(EItemStat::Damage);
+			}
+		}
+	});
+
+	TestTrue(TEXT("Stats are finite"), FMath::IsFinite(Sum));
+
+	const double NumQueries = static_cast<double>(NumPasses) * NumItems;
+	Results.Add(TEXT("CachedGetStat"), NumItems, CachedSeconds * 1e9 / NumQueries, TEXT("ns/query"));
+	Results.Add(TEXT("RebuiltGetStat"), NumItems, RebuiltSeconds * 1e9 / NumQueries, TEXT("ns/query"));
+	Results.Add(TEXT("ChurnFrame"), NumItems, ChurnSeconds * 1e3 / NumPasses, TEXT("ms/frame"));
+
+	return Results.Save(*this);
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,230 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InventoryTestUtils.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "InventoryComponent.h"
+#include "InventoryTestTypes.h"
+#include "ItemInstance.h"
+#include "ItemStatTable.h"
+
+/**
+ * UItemStatTable batch queries, checked against and timed next to reading every item's UItemData.
+ */
+namespace ItemStatTableTests
+{
+	/** Item data with stats that differ per index, so a wrong row shows up as a wrong result */
+	TArray<USwordItemData*> NewItemData(InventoryTest::FTestWorld& TestWorld, int32 NumData)
+	{
+		TArray<USwordItemData*> ItemData;
+		for (int32 Index = 0; Index < NumData; ++Index)
+		{
+			USwordItemData* Data = TestWorld.NewItemData(FString::Printf(TEXT("StatSword%d"), Index));
+			Data->BaseDamage = 10 + Index;
+			Data->BaseCriticalStrikeChance = (Index % 11) / 10.f;
+			Data->BaseCriticalStrikeMultiplier = 1.5f + (Index % 5) * 0.25f;
+			Data->BaseAttackSpeed = 0.5f + (Index % 7) * 0.1f;
+			ItemData.Add(Data);
+		}
+		return ItemData;
+	}
+
+	float ComputeDPS(const FItemCombatStats& Stats)
+	{
+		return Stats.Damage * (1.f + FMath::Clamp(Stats.CriticalStrikeChance, 0.f, 1.f) * (Stats.CriticalStrikeMultiplier - 1.f)) * Stats.AttackSpeed;
+	}
+
+	/** The per-UObject path: instance -> data -> stats, one item at a time */
+	float ComputeBaseDPS(const UItemInstance* Item)
+	{
+		return ComputeDPS(Item->GetData()->GetCombatStats());
+	}
+
+	/** Items spread round robin over ItemData, all in one inventory */
+	TArray<UItemInstance*> FillInventory(UInventoryComponent* Inventory, TConstArrayView<USwordItemData*> ItemData, int32 NumItems)
+	{
+		TArray<FItemInstanceInitializer> Initializers;
+		Initializers.SetNum(NumItems);
+		for (int32 Index = 0; Index < NumItems; ++Index)
+		{
+			Initializers[Index].ItemClass = UInventoryTestItemInstance::StaticClass();
+			Initializers[Index].ItemData = ItemData[Index % ItemData.Num()];
+		}
+		return Inventory->CreateItemsInInventory(Initializers);
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FItemStatTableBatchTest, "InvTest.Stats.TableBatch", INVENTORY_TEST_FLAGS)
+bool FItemStatTableBatchTest::RunTest(const FString& Parameters)
+{
+	using namespace ItemStatTableTests;
+
+	InventoryTest::FTestWorld TestWorld;
+
+	UItemStatTable* StatTable = UItemStatTable::Get();
+	if (!TestNotNull(TEXT("The engine has an item stat table"), StatTable))
+	{
+		return false;
+	}
+
+	/** Not a multiple of four, so the scalar tail is covered as well */
+	constexpr int32 NumItems = 103;
+	const TArray<USwordItemData*> ItemData = NewItemData(TestWorld, 13);
+
+	UInventoryComponent* Inventory = TestWorld.SpawnInventory();
+	const TArray<UItemInstance*> Items = FillInventory(Inventory, ItemData, NumItems);
+
+	TArray<int32> StatIndices;
+	for (const UItemInstance* Item : Items)
+	{
+		StatIndices.Add(Item->GetStatIndex());
+	}
+
+	TestFalse(TEXT("Every item has a row"), StatIndices.Contains(INDEX_NONE));
+	TestEqual(TEXT("Items of the same data share a row"), Items[0]->GetStatIndex(), Items[ItemData.Num()]->GetStatIndex());
+	TestEqual(TEXT("Registering again returns the same row"), StatTable->RegisterItemData(ItemData[0]), Items[0]->GetStatIndex());
+
+	TArray<float> DPS;
+	DPS.SetNumZeroed(NumItems);
+	StatTable->ComputeBaseDPS(StatIndices, DPS);
+
+	const TArray<float> ItemsDPS = StatTable->ComputeItemsDPS(Items);
+
+	TArray<float> AllDPS;
+	AllDPS.SetNumZeroed(StatTable->Num());
+	StatTable->ComputeAllBaseDPS(AllDPS);
+
+	int32 NumMismatches = 0;
+	for (int32 Index = 0; Index < NumItems; ++Index)
+	{
+		const float Expected = ComputeBaseDPS(Items[Index]);
+		NumMismatches += FMath::IsNearlyEqual(DPS[Index], Expected, 1e-3f) ? 0 : 1;
+		NumMismatches += FMath::IsNearlyEqual(ItemsDPS[Index], Expected, 1e-3f) ? 0 : 1;
+		NumMismatches += FMath::IsNearlyEqual(AllDPS[StatIndices[Index]], Expected, 1e-3f) ? 0 : 1;
+	}
+	TestEqual(TEXT("Batch DPS matches the per item DPS"), NumMismatches, 0);
+
+	TArray<UItemInstance*> WithNull = Items;
+	WithNull.Insert(nullptr, 1);
+	const TArray<float> WithNullDPS = StatTable->ComputeItemsDPS(WithNull);
+	TestEqual(TEXT("A null item gets 0"), WithNullDPS[1], 0.f);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FItemStatTableModifiedItemsTest, "InvTest.Stats.TableModifiedItems", INVENTORY_TEST_FLAGS)
+bool FItemStatTableModifiedItemsTest::RunTest(const FString& Parameters)
+{
+	using namespace ItemStatTableTests;
+
+	InventoryTest::FTestWorld TestWorld;
+
+	UItemStatTable* StatTable = UItemStatTable::Get();
+	if (!TestNotNull(TEXT("The engine has an item stat table"), StatTable))
+	{
+		return false;
+	}
+
+	/** Every other item is modified, the rest keep their base stats */
+	constexpr int32 NumItems = 9;
+	const TArray<USwordItemData*> ItemData = NewItemData(TestWorld, 3);
+
+	UInventoryComponent* Inventory = TestWorld.SpawnInventory();
+	const TArray<UItemInstance*> Items = FillInventory(Inventory, ItemData, NumItems);
+	for (int32 Index = 0; Index < NumItems; Index += 2)
+	{
+		Items[Index]->AddModifier(EItemStat::Damage, EItemModifierOp::Additive, 5.f);
+		Items[Index]->AddModifier(EItemStat::AttackSpeed, EItemModifierOp::Multiplicative, 0.5f);
+	}
+
+	const TArray<float> ItemsDPS = StatTable->ComputeItemsDPS(Items);
+
+	int32 NumMismatches = 0;
+	for (int32 Index = 0; Index < NumItems; ++Index)
+	{
+		NumMismatches += FMath::IsNearlyEqual(ItemsDPS[Index], ComputeDPS(Items[Index]->GetFinalStats()), 1e-3f) ? 0 : 1;
+	}
+	TestEqual(TEXT("Batch DPS matches the DPS of the final stats"), NumMismatches, 0);
+	TestTrue(TEXT("Modifiers are applied"), ItemsDPS[0] > ComputeBaseDPS(Items[0]));
+	TestTrue(TEXT("Unmodified items keep their base DPS"), FMath::IsNearlyEqual(ItemsDPS[1], ComputeBaseDPS(Items[1]), 1e-3f));
+
+	/** Changing a modifier afterwards shows up in the next batch */
+	Items[1]->AddModifier(EItemStat::CriticalStrikeChance, EItemModifierOp::Additive, 1.f);
+	const TArray<float> UpdatedDPS = StatTable->ComputeItemsDPS(Items);
+	TestTrue(TEXT("A new modifier shows up in the next batch"), FMath::IsNearlyEqual(UpdatedDPS[1], ComputeDPS(Items[1]->GetFinalStats()), 1e-3f));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FItemStatTableBenchmark, "InvTest.Benchmark.StatTable", INVENTORY_TEST_FLAGS)
+bool FItemStatTableBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace ItemStatTableTests;
+
+	InventoryTest::FTestWorld TestWorld;
+	InventoryTest::FBenchmarkResults Results(TEXT("StatTable"));
+
+	UItemStatTable* StatTable = UItemStatTable::Get();
+	if (!TestNotNull(TEXT("The engine has an item stat table"), StatTable))
+	{
+		return false;
+	}
+
+	constexpr int32 NumPasses = 100;
+	const TArray<USwordItemData*> ItemData = NewItemData(TestWorld, 64);
+
+	const int32 InventorySizes[] = { 100, 1000, 10000 };
+	for (const int32 NumItems : InventorySizes)
+	{
+		UInventoryComponent* Inventory = TestWorld.SpawnInventory();
+		const TArray<UItemInstance*> Items = FillInventory(Inventory, ItemData, NumItems);
+
+		TArray<float> ObjectDPS;
+		ObjectDPS.SetNumZeroed(NumItems);
+		const double ObjectSeconds = InventoryTest::TimeSeconds([&]()
+		{
+			for (int32 Pass = 0; Pass < NumPasses; ++Pass)
+			{
+				for (int32 Index = 0; Index < NumItems; ++Index)
+				{
+					ObjectDPS[Index] = ComputeBaseDPS(Items[Index]);
+				}
+			}
+		});
+
+		/** Rows are looked up once, like a combat system would when items enter play */
+		TArray<int32> StatIndices;
+		StatIndices.Reserve(NumItems);
+		for (const UItemInstance* Item : Items)
+		{
+			StatIndices.Add(Item->GetStatIndex());
+		}
+
+		TArray<float> TableDPS;
+		TableDPS.SetNumZeroed(NumItems);
+		const double TableSeconds = InventoryTest::TimeSeconds([&]()
+		{
+			for (int32 Pass = 0; Pass < NumPasses; ++Pass)
+			{
+				StatTable->ComputeBaseDPS(StatIndices, TableDPS);
+			}
+		});
+
+		int32 NumMismatches = 0;
+		for (int32 Index = 0; Index < NumItems; ++Index)
+		{
+			NumMismatches += FMath::IsNearlyEqual(ObjectDPS[Index], TableDPS[Index], 1e-3f) ? 0 : 1;
+		}
+		TestEqual(FString::Printf(TEXT("[%d] both paths compute the same DPS"), NumItems), NumMismatches, 0);
+
+		const double NumEvaluations = static_cast<double>(NumPasses) * NumItems;
+		Results.Add(TEXT("PerObjectDPS"), NumItems, ObjectSeconds * 1e9 / NumEvaluations, TEXT("ns/item"));
+		Results.Add(TEXT("StatTableBaseDPS"), NumItems, TableSeconds * 1e9 / NumEvaluations, TEXT("ns/item"));
+	}
+
+	return Results.Save(*this);
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,285 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InventoryTestUtils.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "GridInventoryComponent.h"
+#include "InventoryTestTypes.h"
+#include "LootTable.h"
+#include "UObject/StrongObjectPtr.h"
+
+/**
+ * ULootTable sampling: the alias table's distribution, nested tables, unit limits, adding drops to a full
+ * inventory, and rolls per second.
+ */
+namespace LootTableTests
+{
+	/** A transient table, kept alive by the returned pointer, its sampler is built */
+	TStrongObjectPtr<ULootTable> NewLootTable(TArray<FLootTableEntry> Entries)
+	{
+		TStrongObjectPtr<ULootTable> Table(NewObject<ULootTable>());
+		Table->Entries = MoveTemp(Entries);
+		Table->BuildSampler();
+		return Table;
+	}
+
+	FLootTableEntry MakeEntry(UItemData* ItemData, float Weight, int32 MinQuantity = 1, int32 MaxQuantity = 1)
+	{
+		FLootTableEntry Entry;
+		Entry.ItemData = ItemData;
+		Entry.ItemClass = UInventoryTestItemInstance::StaticClass();
+		Entry.Weight = Weight;
+		Entry.MinQuantity = MinQuantity;
+		Entry.MaxQuantity = MaxQuantity;
+		return Entry;
+	}
+
+	FLootTableEntry MakeNestedEntry(ULootTable* NestedTable, int32 MinQuantity = 1, int32 MaxQuantity = 1)
+	{
+		FLootTableEntry Entry;
+		Entry.NestedTable = NestedTable;
+		Entry.MinQuantity = MinQuantity;
+		Entry.MaxQuantity = MaxQuantity;
+		return Entry;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLootTableDistributionTest, "InvTest.Loot.Distribution", INVENTORY_TEST_FLAGS)
+bool FLootTableDistributionTest::RunTest(const FString& Parameters)
+{
+	using namespace LootTableTests;
+
+	InventoryTest::FTestWorld TestWorld;
+
+	/** Weights 1 : 2 : 3 : 4, and one that must never drop */
+	TArray<UItemData*> ItemData;
+	TArray<FLootTableEntry> Entries;
+	for (int32 Index = 0; Index < 4; ++Index)
+	{
+		ItemData.Add(TestWorld.NewItemData(FString::Printf(TEXT("LootSword%d"), Index)));
+		Entries.Add(MakeEntry(ItemData.Last(), Index + 1.f, 2, 5));
+	}
+	UItemData* Never = TestWorld.NewItemData(TEXT("LootNever"));
+	Entries.Add(MakeEntry(Never, 0.f));
+
+	const TStrongObjectPtr<ULootTable> Table = NewLootTable(MoveTemp(Entries));
+
+	/** A single Roll call picks at most 65536 entries, so roll a million in batches */
+	constexpr int32 NumBatches = 20;
+	constexpr int32 RollsPerBatch = 50000;
+	constexpr int32 NumRolls = NumBatches * RollsPerBatch;
+
+	const FRandomStream Stream(1234);
+	TArray<FLootDrop> Drops;
+	for (int32 Batch = 0; Batch < NumBatches; ++Batch)
+	{
+		Table->Roll(Stream, FGameplayTagContainer(), Drops, RollsPerBatch);
+	}
+
+	TestEqual(TEXT("One drop per roll"), Drops.Num(), NumRolls);
+
+	TMap<FSoftObjectPath, int32> Counts;
+	int32 QuantitySeen[6] = {};
+	int32 NumBadQuantities = 0;
+	for (const FLootDrop& Drop : Drops)
+	{
+		++Counts.FindOrAdd(Drop.ItemData.ToSoftObjectPath());
+		if (Drop.Quantity >= 2 && Drop.Quantity <= 5)
+		{
+			++QuantitySeen[Drop.Quantity];
+		}
+		else
+		{
+			++NumBadQuantities;
+		}
+	}
+
+	/** The standard deviation of each share is below 0.05%, so this only fails if the sampler is off */
+	for (int32 Index = 0; Index < ItemData.Num(); ++Index)
+	{
+		const double Share = Counts.FindRef(FSoftObjectPath(ItemData[Index])) / static_cast<double>(NumRolls);
+		TestTrue(FString::Printf(TEXT("Entry %d drops %.4f of the time, expected %.4f"), Index, Share, (Index + 1) / 10.0), FMath::IsNearlyEqual(Share, (Index + 1) / 10.0, 0.005));
+	}
+
+	TestFalse(TEXT("A zero weight entry never drops"), Counts.Contains(FSoftObjectPath(Never)));
+	TestEqual(TEXT("Quantities stay within the entry's range"), NumBadQuantities, 0);
+	for (int32 Quantity = 2; Quantity <= 5; ++Quantity)
+	{
+		TestTrue(FString::Printf(TEXT("Quantity %d is rolled"), Quantity), QuantitySeen[Quantity] > 0);
+	}
+
+	/** The same seed rolls the same drops */
+	TArray<FLootDrop> Again;
+	Table->Roll(FRandomStream(1234), FGameplayTagContainer(), Again, 100);
+	bool bSameDrops = true;
+	for (int32 Index = 0; Index < Again.Num(); ++Index)
+	{
+		bSameDrops &= Again[Index].ItemData == Drops[Index].ItemData && Again[Index].Quantity == Drops[Index].Quantity;
+	}
+	TestTrue(TEXT("Rolls are deterministic for a seed"), bSameDrops);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLootTableNestedTest, "InvTest.Loot.NestedTables", INVENTORY_TEST_FLAGS)
+bool FLootTableNestedTest::RunTest(const FString& Parameters)
+{
+	using namespace LootTableTests;
+
+	InventoryTest::FTestWorld TestWorld;
+
+	UItemData* Gem = TestWorld.NewItemData(TEXT("LootGem"));
+	const TStrongObjectPtr<ULootTable> Gems = NewLootTable({ MakeEntry(Gem, 1.f) });
+
+	/** Every roll of the parent rolls the gem table three times */
+	const TStrongObjectPtr<ULootTable> Chest = NewLootTable({ MakeNestedEntry(Gems.Get(), 3, 3) });
+
+	TArray<FLootDrop> Drops;
+	Chest->Roll(FRandomStream(1), FGameplayTagContainer(), Drops, 10);
+	TestEqual(TEXT("Nested quantities multiply"), Drops.Num(), 30);
+
+	/** Huge nested quantities are cut off at the pick limit instead of running away */
+	const TStrongObjectPtr<ULootTable> Hoard = NewLootTable({ MakeNestedEntry(Gems.Get(), 100000, 100000) });
+
+	AddExpectedMessage(TEXT("the drops were cut short"), ELogVerbosity::Warning, EAutomationExpectedMessageFlags::Contains, 1);
+	Drops.Reset();
+	Hoard->Roll(FRandomStream(1), FGameplayTagContainer(), Drops, 100);
+	TestTrue(TEXT("A roll picks at most 65536 entries"), Drops.Num() > 0 && Drops.Num() <= 65536);
+
+	/** A table that reaches itself drops nothing, and says so when its sampler is built */
+	const TStrongObjectPtr<ULootTable> Ping = NewLootTable({});
+	const TStrongObjectPtr<ULootTable> Pong = NewLootTable({ MakeNestedEntry(Ping.Get()) });
+
+	AddExpectedError(TEXT("contains itself through its nested tables"), EAutomationExpectedErrorFlags::Contains, 0);
+	Ping->Entries = { MakeNestedEntry(Pong.Get()), MakeEntry(Gem, 1.f) };
+	Ping->BuildSampler();
+
+	Drops.Reset();
+	Ping->Roll(FRandomStream(1), FGameplayTagContainer(), Drops, 100);
+	TestEqual(TEXT("A cyclic table drops nothing"), Drops.Num(), 0);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLootTableDropsTest, "InvTest.Loot.Drops", INVENTORY_TEST_FLAGS)
+bool FLootTableDropsTest::RunTest(const FString& Parameters)
+{
+	using namespace LootTableTests;
+
+	InventoryTest::FTestWorld TestWorld;
+
+	UItemData* Sword = TestWorld.NewItemData(TEXT("LootDropSword"));
+	UItemData* Arrow = TestWorld.NewItemData(TEXT("LootDropArrow"), 20);
+
+	/** A single pick of a non-stackable entry would be a million instances */
+	const TStrongObjectPtr<ULootTable> Armory = NewLootTable({ MakeEntry(Sword, 1.f, 1000000, 1000000) });
+
+	AddExpectedMessage(TEXT("the drops were cut short"), ELogVerbosity::Warning, EAutomationExpectedMessageFlags::Contains, 1);
+	TArray<FLootDrop> Drops;
+	Armory->Roll(FRandomStream(1), FGameplayTagContainer(), Drops, 1);
+	int32 NumUnits = 0;
+	for (const FLootDrop& Drop : Drops)
+	{
+		NumUnits += Drop.Quantity;
+	}
+	TestEqual(TEXT("A roll drops at most 65536 units"), NumUnits, 65536);
+
+	/** Four cells and a single stack: 4 of 6 swords and 20 of 50 arrows fit */
+	UGridInventoryComponent* Grid = TestWorld.SpawnInventory<UGridInventoryComponent>([](UGridInventoryComponent& Inventory)
+	{
+		Inventory.GridWidth = 2;
+		Inventory.GridHeight = 2;
+		Inventory.MaxStacks = 1;
+	});
+
+	TArray<FLootDrop> Loot;
+	Loot.SetNum(2);
+	Loot[0].ItemData = Sword;
+	Loot[0].ItemClass = UInventoryTestItemInstance::StaticClass();
+	Loot[0].Quantity = 6;
+	Loot[1].ItemData = Arrow;
+	Loot[1].Quantity = 50;
+
+	AddExpectedMessage(TEXT("is at its stack limit"), ELogVerbosity::Warning, EAutomationExpectedMessageFlags::Contains, 1);
+	bool bAdded = false;
+	TArray<FLootDrop> Leftovers;
+	ULootTable::AddDropsToInventory(Grid, MoveTemp(Loot), FOnLootDropsAdded::CreateLambda([&bAdded, &Leftovers](const TArray<FLootDrop>& InLeftovers)
+	{
+		bAdded = true;
+		Leftovers = InLeftovers;
+	}));
+
+	/** The data is prefetched first, which may take a frame */
+	for (int32 Frame = 0; Frame < 10 && !bAdded; ++Frame)
+	{
+		TestWorld.Tick();
+	}
+	if (!TestTrue(TEXT("The leftovers are reported once the drops were added"), bAdded))
+	{
+		return false;
+	}
+
+	TestEqual(TEXT("Swords are added until the grid is full"), Grid->GetItemCountByData(Sword), 4);
+	TestEqual(TEXT("Arrows are added until the stack is full"), Grid->GetItemCountByData(Arrow), 20);
+
+	TMap<FSoftObjectPath, int32> LeftoverUnits;
+	for (const FLootDrop& Leftover : Leftovers)
+	{
+		LeftoverUnits.FindOrAdd(Leftover.ItemData.ToSoftObjectPath()) += Leftover.Quantity;
+	}
+	TestEqual(TEXT("The swords that did not fit are left over"), LeftoverUnits.FindRef(FSoftObjectPath(Sword)), 2);
+	TestEqual(TEXT("The arrows that did not fit are left over"), LeftoverUnits.FindRef(FSoftObjectPath(Arrow)), 30);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLootTableBenchmark, "InvTest.Benchmark.LootRolls", INVENTORY_TEST_FLAGS)
+bool FLootTableBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace LootTableTests;
+
+	InventoryTest::FTestWorld TestWorld;
+	InventoryTest::FBenchmarkResults Results(TEXT("LootRolls"));
+
+	constexpr int32 NumRolls = 1 << 16;
+	constexpr int32 NumBatches = 32;
+
+	const int32 TableSizes[] = { 10, 100, 1000, 10000 };
+	for (const int32 NumEntries : TableSizes)
+	{
+		/** Skewed weights, so most columns of the alias table have an alias */
+		TArray<FLootTableEntry> Entries;
+		for (int32 Index = 0; Index < NumEntries; ++Index)
+		{
+			Entries.Add(MakeEntry(TestWorld.NewItemData(FString::Printf(TEXT("BenchmarkLoot%d"), Index)), 1.f + Index % 17));
+		}
+		const TStrongObjectPtr<ULootTable> Table = NewLootTable(MoveTemp(Entries));
+
+		/** Batches stay under the pick limit, a horde wave rolls its drops the same way */
+		TArray<FLootDrop> Drops;
+		Drops.Reserve(NumRolls);
+		int64 NumDrops = 0;
+		const FRandomStream Stream(42);
+		const double Seconds = InventoryTest::TimeSeconds([&]()
+		{
+			for (int32 Batch = 0; Batch < NumBatches; ++Batch)
+			{
+				Drops.Reset();
+				Table->Roll(Stream, FGameplayTagContainer(), Drops, NumRolls);
+				NumDrops += Drops.Num();
+			}
+		});
+
+		TestEqual(FString::Printf(TEXT("[%d] one drop per roll"), NumEntries), NumDrops, static_cast<int64>(NumRolls) * NumBatches);
+
+		const double TotalRolls = static_cast<double>(NumRolls) * NumBatches;
+		Results.Add(TEXT("Roll"), NumEntries, TotalRolls / FMath::Max(Seconds, UE_SMALL_NUMBER) / 1e6, TEXT("Mrolls/s"));
+		Results.Add(TEXT("Roll"), NumEntries, Seconds * 1e9 / TotalRolls, TEXT("ns/roll"));
+	}
+
+	return Results.Save(*this);
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS